@@ -0,0 +1,51 @@
+"""Compile time of a large autodiff kernel.
+
+Builds a kernel with a long chain of arithmetic (a few thousand statements
+after autodiff), compiles its forward and gradient versions, and prints the
+compile time along with the scoped profiler records of the IR passes. Most of
+that time is spent in full_simplify, where whole_kernel_cse used to dominate.
+
+Usage:
+    python3 full_simplify_compile_time.py --num-terms 1000
+"""
+
+import argparse
+import time
+
+import taichi as ti
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--num-terms", type=int, default=500)
+    parser.add_argument("--arch", default="cpu")
+    args = parser.parse_args()
+
+    ti.init(arch=getattr(ti, args.arch), offline_cache=False)
+    n = 1024
+    x = ti.field(ti.f32, shape=n, needs_grad=True)
+    loss = ti.field(ti.f32, shape=(), needs_grad=True)
+
+    @ti.kernel
+    def compute():
+        for i in x:
+            v = x[i]
+            acc = 0.0
+            for j in ti.static(range(args.num_terms)):
+                v = ti.sin(v) * (j + 1) + v * v * 0.5 - 1.0
+                acc += v / (j + 2)
+            loss[None] += acc
+
+    start = time.perf_counter()
+    compute()
+    forward = time.perf_counter() - start
+    start = time.perf_counter()
+    compute.grad()
+    backward = time.perf_counter() - start
+
+    print(f"{args.num_terms} terms: forward {forward:.2f} s, gradient {backward:.2f} s (compile + launch)")
+    ti.profiler.print_scoped_profiler_info()
+
+
+if __name__ == "__main__":
+    main()
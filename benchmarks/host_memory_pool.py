@@ -0,0 +1,51 @@
+"""Allocation throughput of the host memory pool.
+
+Allocates and frees temporary ndarrays of mixed sizes on the CPU backend, the
+way iterative solvers and data pipelines do, and prints the number of
+allocations per second and the report of the host memory pool: the memory it
+reserves, the use of its size classes and the fragmentation of its free page
+runs.
+
+Usage:
+    python3 host_memory_pool.py --num-iters 2000
+"""
+
+import argparse
+import time
+
+import taichi as ti
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--num-iters", type=int, default=2000)
+    parser.add_argument("--num-live", type=int, default=32)
+    args = parser.parse_args()
+
+    ti.init(arch=ti.cpu, offline_cache=False)
+
+    @ti.kernel
+    def fill(a: ti.types.ndarray(), v: ti.f32):
+        for i in a:
+            a[i] = v
+
+    # Small (a few KB) to large (a few MB) arrays
+    sizes = [16, 256, 4096, 65536, 1 << 20]
+    live = [None] * args.num_live
+    fill(ti.ndarray(ti.f32, shape=16), 0.0)  # compile
+
+    start = time.perf_counter()
+    for i in range(args.num_iters):
+        a = ti.ndarray(ti.f32, shape=sizes[i % len(sizes)] + i % 7)
+        fill(a, i)
+        live[(i * 13) % args.num_live] = a
+    ti.sync()
+    elapsed = time.perf_counter() - start
+    print(f"{args.num_iters / elapsed:.0f} ndarrays allocated, filled and freed per second")
+
+    live.clear()
+    print(ti._lib.core.host_memory_pool_report())
+
+
+if __name__ == "__main__":
+    main()
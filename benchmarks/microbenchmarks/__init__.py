@@ -1,17 +1,21 @@
 from .atomic_ops import AtomicOpsPlan
 from .fill import FillPlan
+from .launch_overhead import LaunchOverheadPlan
 from .math_opts import MathOpsPlan
 from .matrix_ops import MatrixOpsPlan
 from .memcpy import MemcpyPlan
 from .saxpy import SaxpyPlan
+from .sparse_struct_for import SparseStructForPlan
 from .stencil2d import Stencil2DPlan
 
 benchmark_plan_list = [
     AtomicOpsPlan,
     FillPlan,
+    LaunchOverheadPlan,
     MathOpsPlan,
     MatrixOpsPlan,
     MemcpyPlan,
     SaxpyPlan,
+    SparseStructForPlan,
     Stencil2DPlan,
 ]
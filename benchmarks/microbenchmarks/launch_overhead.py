@@ -0,0 +1,49 @@
+from microbenchmarks._items import BenchmarkItem, Container, DataType
+from microbenchmarks._metric import MetricType
+from microbenchmarks._plan import BenchmarkPlan
+from microbenchmarks._utils import dtype_size, size2tag
+
+import taichi as ti
+
+
+def launch_overhead_default(arch, repeat, container, dtype, dsize_tiny, get_metric):
+    # Tiny kernels are dominated by the cost of waking up the CPU thread pool
+    # and waiting for it, so use many more launches than other plans.
+    repeat = repeat * 100
+    num_elements = dsize_tiny // dtype_size(dtype)
+    x = container(dtype, num_elements)
+
+    @ti.kernel
+    def inc_field(x: ti.template()):
+        for i in x:
+            x[i] += ti.cast(1, dtype)
+
+    @ti.kernel
+    def inc_array(x: ti.types.ndarray()):
+        for i in x:
+            x[i] += ti.cast(1, dtype)
+
+    func = inc_field if container == ti.field else inc_array
+    return get_metric(repeat, func, x)
+
+
+class DataSizeTiny(BenchmarkItem):
+    name = "dsize_tiny"
+
+    def __init__(self):
+        self._items = {}
+        for i in range(0, 4):  # [256B,2KB,16KB,128KB]
+            size_bytes = 256 * (8**i)
+            self._items[size2tag(size_bytes)] = size_bytes
+
+
+class LaunchOverheadPlan(BenchmarkPlan):
+    def __init__(self, arch: str):
+        super().__init__("launch_overhead", arch, basic_repeat_times=10)
+        dtype = DataType()
+        dtype.remove(["i64", "f64"])
+        self.create_plan(Container(), dtype, DataSizeTiny(), MetricType())
+        # the per-launch overhead is only visible end-to-end
+        self.remove_cases_with_tags(["kernel_elapsed_time_ms"])
+        self.add_func(["field"], launch_overhead_default)
+        self.add_func(["ndarray"], launch_overhead_default)
@@ -0,0 +1,45 @@
+from microbenchmarks._items import BenchmarkItem
+from microbenchmarks._metric import MetricType
+from microbenchmarks._plan import BenchmarkPlan
+
+import taichi as ti
+
+
+def sparse_struct_for_default(arch, repeat, num_blocks, get_metric):
+    # A pointer grid with a fixed number of active 8x8 blocks: every launch
+    # regenerates the element lists of the struct-for, so small lists measure
+    # the fixed cost of listgen and of the list managers.
+    block_size = 8
+    grid_blocks = 1024
+    x = ti.field(ti.f32)
+    ti.root.pointer(ti.ij, grid_blocks).dense(ti.ij, block_size).place(x)
+
+    @ti.kernel
+    def activate(n: ti.i32):
+        for b in range(n):
+            x[(b % grid_blocks) * block_size, (b // grid_blocks) * block_size] = 1.0
+
+    @ti.kernel
+    def scale(factor: ti.f32):
+        for i, j in x:
+            x[i, j] *= factor
+
+    activate(num_blocks)
+    return get_metric(repeat, scale, 1.0)
+
+
+class NumActiveBlocks(BenchmarkItem):
+    name = "num_blocks"
+
+    def __init__(self):
+        self._items = {}
+        for i in range(0, 4):  # [16,256,4K,64K]
+            num_blocks = 16 * (16**i)
+            self._items[f"{num_blocks}blocks"] = num_blocks
+
+
+class SparseStructForPlan(BenchmarkPlan):
+    def __init__(self, arch: str):
+        super().__init__("sparse_struct_for", arch, basic_repeat_times=10)
+        self.create_plan(NumActiveBlocks(), MetricType())
+        self.add_func(["sparse_struct_for"], sparse_struct_for_default)
@@ -0,0 +1,119 @@
+"""Start-up cost of the offline cache layouts.
+
+Fills an offline cache with many kernels in each layout ('pack' and 'files'),
+then measures, in fresh processes, how long ti.init() plus the first launch of
+a few cached kernels takes. The per-file layout parses the metadata of every
+cached kernel before the first launch, while the pack only looks up the
+kernels that are launched.
+
+Usage:
+    python3 offline_cache_startup.py --num-kernels 20000
+"""
+
+import argparse
+import os
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+LAYOUTS = ["files", "pack"]
+
+x = None
+
+
+def make_kernels(num_kernels):
+    import taichi as ti
+
+    kernels = []
+    for j in range(num_kernels):
+
+        @ti.kernel
+        def k():
+            x[None] += ti.static(j)
+
+        kernels.append(k)
+    return kernels
+
+
+def worker(args):
+    global x
+    import taichi as ti
+
+    kernels = make_kernels(args.num_kernels)
+    num_launches = args.num_kernels if args.populate else args.num_launches
+    start = time.perf_counter()
+    ti.init(
+        arch=ti.cpu,
+        offline_cache=True,
+        offline_cache_file_path=args.path,
+        offline_cache_layout=args.layout,
+        offline_cache_max_size_of_files=1 << 30,
+        offline_cache_cleaning_policy="never",
+    )
+    x = ti.field(ti.i32, shape=())
+    for k in kernels[:num_launches]:
+        k()
+    elapsed = time.perf_counter() - start
+    ti.reset()
+    print(elapsed)
+
+
+def run_worker(layout, path, num_kernels, num_launches, populate=False):
+    cmd = [
+        sys.executable,
+        os.path.abspath(__file__),
+        "--worker",
+        "--layout",
+        layout,
+        "--path",
+        path,
+        "--num-kernels",
+        str(num_kernels),
+        "--num-launches",
+        str(num_launches),
+    ]
+    if populate:
+        cmd.append("--populate")
+    out = subprocess.run(cmd, check=True, capture_output=True, text=True).stdout
+    return float(out.strip().splitlines()[-1])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--num-kernels", type=int, default=2000)
+    parser.add_argument("--num-launches", type=int, default=10)
+    parser.add_argument("--repeats", type=int, default=5)
+    parser.add_argument("--worker", action="store_true", help=argparse.SUPPRESS)
+    parser.add_argument("--populate", action="store_true", help=argparse.SUPPRESS)
+    parser.add_argument("--layout", choices=LAYOUTS, help=argparse.SUPPRESS)
+    parser.add_argument("--path", help=argparse.SUPPRESS)
+    args = parser.parse_args()
+
+    if args.worker:
+        worker(args)
+        return
+
+    root = tempfile.mkdtemp()
+    try:
+        for layout in LAYOUTS:
+            path = os.path.join(root, layout)
+            populate = run_worker(layout, path, args.num_kernels, args.num_launches, populate=True)
+            times = [
+                run_worker(layout, path, args.num_kernels, args.num_launches) for _ in range(args.repeats)
+            ]
+            print(
+                f"{layout:>5}: {args.num_kernels} cached kernels, "
+                f"init + {args.num_launches} launches: "
+                f"median {statistics.median(times) * 1000:.1f} ms, "
+                f"min {min(times) * 1000:.1f} ms "
+                f"(populating took {populate:.1f} s)"
+            )
+    finally:
+        shutil.rmtree(root)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,84 @@
+"""Compile time of a Vulkan AOT module with one and several compile threads.
+
+Builds an AOT module of many multi-task kernels without launching any of them,
+once per value of `num_compile_threads`, and prints the compile times. The
+offloaded tasks of each kernel are generated and optimized by `spirv-opt` on
+up to `num_compile_threads` threads. The saved modules are checked to be
+identical. Run with `--log-level debug` to see the codegen and spirv-opt time
+of each kernel.
+
+Usage:
+    python3 spirv_aot_compile_time.py --num-kernels 600 --num-tasks 8 --threads 1 4 16
+"""
+
+import argparse
+import os
+import re
+import tempfile
+import time
+
+import taichi as ti
+
+
+def build_module(arch, num_compile_threads, num_kernels, num_tasks, num_terms, log_level):
+    ti.init(arch=arch, offline_cache=False, num_compile_threads=num_compile_threads, log_level=log_level)
+    n = 4096
+    x = ti.field(ti.f32, shape=n)
+    y = ti.field(ti.f32, shape=n)
+
+    def make_kernel(seed):
+        @ti.kernel
+        def compute(a: ti.f32):
+            for t in ti.static(range(num_tasks)):
+                for i in x:
+                    v = x[i] + a
+                    for j in ti.static(range(num_terms)):
+                        v = ti.sin(v) * (seed + j + t + 1) + v * v * 0.5
+                    y[i] += v
+
+        return compute
+
+    kernels = [make_kernel(k) for k in range(num_kernels)]
+    m = ti.aot.Module()
+    start = time.perf_counter()
+    for k, kernel in enumerate(kernels):
+        m.add_kernel(kernel, name=f"compute_{k}")
+    elapsed = time.perf_counter() - start
+
+    # Kernel names carry a counter which differs between the runs
+    contents = {}
+    with tempfile.TemporaryDirectory() as tmpdir:
+        m.save(tmpdir)
+        for name in sorted(os.listdir(tmpdir)):
+            with open(os.path.join(tmpdir, name), "rb") as f:
+                key = re.sub(r"compute_c\d+", "compute", name)
+                contents[key] = re.sub(rb"compute_c\d+", b"compute", f.read())
+    ti.reset()
+    return elapsed, contents
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--num-kernels", type=int, default=600)
+    parser.add_argument("--num-tasks", type=int, default=8)
+    parser.add_argument("--num-terms", type=int, default=50)
+    parser.add_argument("--threads", type=int, nargs="+", default=[1, 4, os.cpu_count()])
+    parser.add_argument("--arch", default="vulkan")
+    parser.add_argument("--log-level", default="warn")
+    args = parser.parse_args()
+
+    arch = getattr(ti, args.arch)
+    baseline = None
+    reference = None
+    for threads in args.threads:
+        elapsed, contents = build_module(
+            arch, threads, args.num_kernels, args.num_tasks, args.num_terms, args.log_level
+        )
+        if reference is None:
+            baseline, reference = elapsed, contents
+        assert contents == reference, "The AOT module depends on num_compile_threads"
+        print(f"num_compile_threads={threads}: {elapsed:.3f} s ({baseline / elapsed:.2f}x)")
+
+
+if __name__ == "__main__":
+    main()
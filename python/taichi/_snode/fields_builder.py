@@ -86,9 +86,16 @@ class FieldsBuilder:
         self.empty = False
         return self.root.pointer(indices, dimensions)
 
-    def _hash(self, indices, dimensions):
+    def hash(
+        self,
+        indices: Union[Sequence[_Axis], _Axis],
+        dimensions: Union[Sequence[int], int],
+        capacity: Optional[int] = None,
+    ):
         """Same as :func:`taichi.lang.snode.SNode.hash`"""
-        raise NotImplementedError()
+        self._check_not_finalized()
+        self.empty = False
+        return self.root.hash(indices, dimensions, capacity)
 
     def dynamic(
         self,
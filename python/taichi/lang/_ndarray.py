@@ -69,7 +69,7 @@ class Ndarray:
         """
         if impl.current_cfg().arch != _ti_core.Arch.cuda and impl.current_cfg().arch != _ti_core.Arch.x64:
             self._fill_by_kernel(val)
-        elif _ti_core.is_tensor(self.element_type):
+        elif _ti_core.is_tensor(self.element_type) or self.arr.is_strided():
             self._fill_by_kernel(val)
         elif self.dtype == primitive_types.f32:
             impl.get_runtime().prog.fill_float(self.arr, val)
@@ -184,6 +184,32 @@ class Ndarray:
         ndarray_to_ndarray(self, other)
         impl.get_runtime().sync()
 
+    @python_scope
+    def to_dlpack(self):
+        """Exports the ndarray as a DLPack capsule that shares its memory, without a copy.
+
+        Only supported on the CPU backend. The capsule keeps the ndarray alive until its consumer releases it, but
+        `ti.reset()` frees the memory of all ndarrays regardless.
+
+        Returns:
+            PyCapsule: The DLPack capsule, named "dltensor".
+        """
+        return impl.get_runtime().prog.ndarray_to_dlpack(self, self.arr)
+
+    def __dlpack__(self, stream=None, max_version=None, dl_device=None, copy=None):
+        """Implements the DLPack protocol of the Python array API, see `to_dlpack()`."""
+        if stream is not None:
+            raise BufferError("ti.Ndarray lives in host memory, so it takes no stream")
+        if dl_device is not None and tuple(dl_device) != self.__dlpack_device__():
+            raise BufferError(f"ti.Ndarray cannot be exported to the DLPack device {dl_device}")
+        if copy:
+            raise BufferError("ti.Ndarray is only exported without a copy")
+        return self.to_dlpack()
+
+    def __dlpack_device__(self):
+        # (kDLCPU, 0)
+        return (1, 0)
+
     def _set_grad(self, grad):
         """Sets the gradient ndarray.
 
@@ -232,14 +258,17 @@ class ScalarNdarray(Ndarray):
     Args:
         dtype (DataType): Data type of each value.
         shape (Tuple[int]): Shape of the ndarray.
+        arr (Optional[_ti_core.Ndarray]): An existing ndarray to wrap instead of allocating one.
     """
 
-    def __init__(self, dtype, arr_shape):
+    def __init__(self, dtype, arr_shape, arr=None):
         super().__init__()
         self.dtype = cook_dtype(dtype)
-        self.arr = impl.get_runtime().prog.create_ndarray(
-            self.dtype, arr_shape, layout=Layout.NULL, zero_fill=True, dbg_info=_ti_core.DebugInfo(get_traceback())
-        )
+        if arr is None:
+            arr = impl.get_runtime().prog.create_ndarray(
+                self.dtype, arr_shape, layout=Layout.NULL, zero_fill=True, dbg_info=_ti_core.DebugInfo(get_traceback())
+            )
+        self.arr = arr
         self.shape = tuple(self.arr.shape)
         self.element_type = dtype
 
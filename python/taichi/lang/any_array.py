@@ -33,7 +33,10 @@ class AnyArray:
 
     def get_type(self):
         return NdarrayTypeMetadata(
-            _ti_core.get_external_tensor_element_type(self.ptr), None, _ti_core.get_external_tensor_needs_grad(self.ptr)
+            _ti_core.get_external_tensor_element_type(self.ptr),
+            None,
+            _ti_core.get_external_tensor_needs_grad(self.ptr),
+            _ti_core.get_external_tensor_strided(self.ptr),
         )  # AnyArray can take any shape
 
     @property
@@ -671,6 +671,7 @@ class ASTTransformer(Builder):
                         full_name,
                         arg_features[2],
                         arg_features[3],
+                        arg_features[4],
                     ),
                 )
             if isinstance(annotation, texture_type.TextureType):
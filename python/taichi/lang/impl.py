@@ -859,6 +859,43 @@ def ndarray(dtype, shape, needs_grad=False):
     return x
 
 
+def from_dlpack(ext_arr, element_shape=()):
+    """Imports an array from another library as a Taichi ndarray that shares its memory, without a copy.
+
+    Only supported on the CPU backend, for arrays in host memory. Strided arrays, e.g. transposed or sliced views, are
+    imported as they are, and kernels taking them are compiled for strided access. Their vector or matrix elements must
+    be compact, and their elements must not overlap.
+
+    Args:
+        ext_arr: An array that implements the DLPack protocol (`__dlpack__`), such as a NumPy array or a PyTorch CPU
+            tensor, or a DLPack capsule.
+        element_shape (Tuple[int]): The shape of the elements, e.g. (3,) for an ndarray of 3D vectors. These are the
+            last dimensions of `ext_arr`.
+
+    Returns:
+        Union[ScalarNdarray, VectorNdarray, MatrixNdarray]: The ndarray, which keeps `ext_arr` alive.
+
+    Example::
+
+        >>> x = np.zeros((16, 3), dtype=np.float32)
+        >>> y = ti.from_dlpack(x, element_shape=(3,))  # ndarray of shape (16,) of 3D vectors, aliasing x
+    """
+    prog = get_runtime().prog
+    if prog is None:
+        raise TaichiRuntimeError("Cannot create ndarray, maybe you forgot to call `ti.init()` first?")
+    capsule = ext_arr.__dlpack__() if hasattr(ext_arr, "__dlpack__") else ext_arr
+    element_shape = tuple(element_shape)
+    if len(element_shape) > 2:
+        raise TaichiRuntimeError(f"{element_shape} is not a valid element shape for ndarray")
+    arr = prog.ndarray_from_dlpack(capsule, list(element_shape))
+    dtype = arr.element_data_type()
+    if len(element_shape) == 0:
+        return ScalarNdarray(dtype, tuple(arr.shape), arr=arr)
+    if len(element_shape) == 1:
+        return VectorNdarray(element_shape[0], dtype, tuple(arr.shape), arr=arr)
+    return MatrixNdarray(element_shape[0], element_shape[1], dtype, tuple(arr.shape), arr=arr)
+
+
 @taichi_scope
 def ti_format_list_to_content_entries(raw):
     # return a pair of [content, format]
@@ -1196,6 +1233,7 @@ __all__ = [
     "axes",
     "deactivate_all_snodes",
     "field",
+    "from_dlpack",
     "grouped",
     "ndarray",
     "one",
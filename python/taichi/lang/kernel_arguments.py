@@ -124,9 +124,9 @@ def decl_sparse_matrix(dtype, name):
     )
 
 
-def decl_ndarray_arg(element_type, ndim, name, needs_grad, boundary):
-    arg_id = impl.get_runtime().compiling_callable.insert_ndarray_param(element_type, ndim, name, needs_grad)
-    return AnyArray(_ti_core.make_external_tensor_expr(element_type, ndim, arg_id, needs_grad, 0, boundary))
+def decl_ndarray_arg(element_type, ndim, name, needs_grad, boundary, strided=False):
+    arg_id = impl.get_runtime().compiling_callable.insert_ndarray_param(element_type, ndim, name, needs_grad, strided)
+    return AnyArray(_ti_core.make_external_tensor_expr(element_type, ndim, arg_id, needs_grad, 0, boundary, strided))
 
 
 def decl_texture_arg(num_dimensions, name):
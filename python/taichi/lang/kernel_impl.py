@@ -442,11 +442,11 @@ class TaichiCallableTemplateMapper:
             if isinstance(arg, taichi.lang._ndarray.Ndarray):
                 anno.check_matched(arg.get_type(), arg_name)
                 needs_grad = (arg.grad is not None) if anno.needs_grad is None else anno.needs_grad
-                return arg.element_type, len(arg.shape), needs_grad, anno.boundary
+                return arg.element_type, len(arg.shape), needs_grad, anno.boundary, arg.arr.is_strided()
             if isinstance(arg, AnyArray):
                 ty = arg.get_type()
                 anno.check_matched(arg.get_type(), arg_name)
-                return ty.element_type, len(arg.shape), ty.needs_grad, anno.boundary
+                return ty.element_type, len(arg.shape), ty.needs_grad, anno.boundary, ty.strided
             # external arrays
             shape = getattr(arg, "shape", None)
             if shape is None:
@@ -493,7 +493,7 @@ class TaichiCallableTemplateMapper:
                 if len(element_shape) != 0
                 else arg.dtype
             )
-            return element_type, len(shape) - len(element_shape), needs_grad, anno.boundary
+            return element_type, len(shape) - len(element_shape), needs_grad, anno.boundary, False
         if isinstance(anno, sparse_matrix_builder):
             return arg.dtype
         # Use '#' as a placeholder because other kinds of arguments are not involved in template instantiation
@@ -1181,6 +1181,46 @@ class _BoundedDifferentiableMethod:
         return self._adjoint(self._kernel_owner, *args, **kwargs)
 
 
+def prefetch(*kernels):
+    """Compiles kernels in the background, several at a time.
+
+    Each item is either a kernel, or a tuple ``(kernel, *args)`` holding the
+    arguments the kernel is going to be launched with, which select the
+    template instantiation to compile. A later launch of one of these kernels
+    only waits until that particular kernel is compiled.
+
+    Kernels are compiled concurrently on the LLVM backends only (the number of
+    threads follows ``num_compile_threads``). Elsewhere, and for kernels that
+    call real functions, this is a no-op and the kernel is compiled on its
+    first launch as usual. Errors reported by the backend compiler are raised
+    by the launch of the kernel.
+
+    Args:
+        *kernels: The kernels to compile.
+
+    Example::
+
+        >>> ti.prefetch(init, (step, x, 0.1), render)
+        >>> init()  # Only waits for `init`
+    """
+    kernel_cpps = []
+    for item in kernels:
+        kernel, args = (item[0], item[1:]) if isinstance(item, tuple) else (item, ())
+        if isinstance(kernel, _BoundedDifferentiableMethod):
+            primal = kernel._primal
+            if not kernel._is_staticmethod:
+                args = (kernel._kernel_owner, *args)
+        elif getattr(kernel, "_is_wrapped_kernel", False) and not kernel._is_classkernel:
+            primal = kernel._primal
+        else:
+            raise TaichiSyntaxError(f"{kernel} is not a Taichi kernel")
+        args = _process_args(primal, args, {})
+        key = primal.ensure_compiled(*args)
+        kernel_cpps.append(primal.compiled_kernels[key])
+    prog = impl.get_runtime().prog
+    prog.prefetch_kernels(prog.config(), prog.get_device_caps(), kernel_cpps)
+
+
 def data_oriented(cls):
     """Marks a class as Taichi compatible.
 
@@ -1242,4 +1282,4 @@ def data_oriented(cls):
     return cls
 
 
-__all__ = ["data_oriented", "func", "kernel", "pyfunc", "real_func"]
+__all__ = ["data_oriented", "func", "kernel", "prefetch", "pyfunc", "real_func"]
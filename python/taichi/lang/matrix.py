@@ -1654,13 +1654,14 @@ class MatrixNdarray(Ndarray):
         m (int): Number of columns of the matrix.
         dtype (DataType): Data type of each value.
         shape (Union[int, tuple[int]]): Shape of the ndarray.
+        arr (Optional[_ti_core.Ndarray]): An existing ndarray to wrap instead of allocating one.
 
     Example::
 
         >>> arr = ti.MatrixNdarray(2, 2, ti.f32, shape=(3, 3))
     """
 
-    def __init__(self, n, m, dtype, shape):
+    def __init__(self, n, m, dtype, shape, arr=None):
         self.n = n
         self.m = m
         super().__init__()
@@ -1670,14 +1671,16 @@ class MatrixNdarray(Ndarray):
         self.layout = Layout.AOS
         self.shape = tuple(shape)
         self.element_type = _type_factory.get_tensor_type((self.n, self.m), self.dtype)
-        # TODO: we should pass in element_type, shape, layout instead.
-        self.arr = impl.get_runtime().prog.create_ndarray(
-            cook_dtype(self.element_type),
-            shape,
-            Layout.AOS,
-            zero_fill=True,
-            dbg_info=ti_python_core.DebugInfo(get_traceback()),
-        )
+        if arr is None:
+            # TODO: we should pass in element_type, shape, layout instead.
+            arr = impl.get_runtime().prog.create_ndarray(
+                cook_dtype(self.element_type),
+                shape,
+                Layout.AOS,
+                zero_fill=True,
+                dbg_info=ti_python_core.DebugInfo(get_traceback()),
+            )
+        self.arr = arr
 
     @property
     def element_shape(self):
@@ -1770,13 +1773,14 @@ class VectorNdarray(Ndarray):
         n (int): Size of the vector.
         dtype (DataType): Data type of each value.
         shape (Tuple[int]): Shape of the ndarray.
+        arr (Optional[_ti_core.Ndarray]): An existing ndarray to wrap instead of allocating one.
 
     Example::
 
         >>> a = ti.VectorNdarray(3, ti.f32, (3, 3))
     """
 
-    def __init__(self, n, dtype, shape):
+    def __init__(self, n, dtype, shape, arr=None):
         self.n = n
         super().__init__()
         # TODO(zhanlue): remove self.dtype and migrate its usages to element_type
@@ -1785,13 +1789,15 @@ class VectorNdarray(Ndarray):
         self.layout = Layout.AOS
         self.shape = tuple(shape)
         self.element_type = _type_factory.get_tensor_type((n,), self.dtype)
-        self.arr = impl.get_runtime().prog.create_ndarray(
-            cook_dtype(self.element_type),
-            shape,
-            Layout.AOS,
-            zero_fill=True,
-            dbg_info=ti_python_core.DebugInfo(get_traceback()),
-        )
+        if arr is None:
+            arr = impl.get_runtime().prog.create_ndarray(
+                cook_dtype(self.element_type),
+                shape,
+                Layout.AOS,
+                zero_fill=True,
+                dbg_info=ti_python_core.DebugInfo(get_traceback()),
+            )
+        self.arr = arr
 
     @property
     def element_shape(self):
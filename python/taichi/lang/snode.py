@@ -53,14 +53,28 @@ class SNode:
             dimensions = [dimensions] * len(axes)
         return SNode(self.ptr.pointer(axes, dimensions, _ti_core.DebugInfo(get_traceback())))
 
-    @staticmethod
-    def _hash(axes, dimensions):
-        # original code is #def hash(self,axes, dimensions) without #@staticmethod   before fix pylint R0201
-        """Not supported."""
-        raise RuntimeError("hash not yet supported")
-        # if isinstance(dimensions, int):
-        #     dimensions = [dimensions] * len(axes)
-        # return SNode(self.ptr.hash(axes, dimensions))
+    def hash(self, axes, dimensions, capacity=None):
+        """Adds a hash SNode as a child component of `self`.
+
+        Only the active cells are stored, in a hash table keyed by their
+        indices, so `dimensions` may describe a bounding box much larger than
+        the memory footprint. Currently only supported on CPU backends, and
+        only directly under the root.
+
+        Args:
+            axes (List[Axis]): Axes to activate.
+            dimensions (Union[List[int], int]): Shape of each axis.
+            capacity (int): Maximum number of cells that can be active at
+                the same time. Defaults to `min(prod(dimensions), 65536)`.
+
+        Returns:
+            The added :class:`~taichi.lang.SNode` instance.
+        """
+        if impl.current_cfg().arch not in (_ti_core.x64, _ti_core.arm64):
+            raise TaichiRuntimeError("Hash SNode is only supported on CPU backends.")
+        if isinstance(dimensions, numbers.Number):
+            dimensions = [dimensions] * len(axes)
+        return SNode(self.ptr.hash(axes, dimensions, capacity or 0, _ti_core.DebugInfo(get_traceback())))
 
     def dynamic(self, axis, dimension, chunk_size=None):
         """Adds a dynamic SNode as a child component of `self`.
@@ -289,7 +303,7 @@ class SNode:
         for c in ch:
             c.deactivate_all()
         SNodeType = _ti_core.SNodeType
-        if self.ptr.type == SNodeType.pointer or self.ptr.type == SNodeType.bitmasked:
+        if self.ptr.type in (SNodeType.pointer, SNodeType.hash, SNodeType.bitmasked):
             from taichi._kernels import snode_deactivate  # pylint: disable=C0415
 
             snode_deactivate(self)
@@ -1,6 +1,9 @@
 from math import sqrt
 
+from taichi._lib import core as _ti_core
+from taichi.lang._ndarray import Ndarray
 from taichi.lang.exception import TaichiRuntimeError, TaichiTypeError
+from taichi.lang.impl import get_runtime
 
 import taichi as ti
 
@@ -24,11 +27,14 @@ def MatrixFreeCG(A, b, x, tol=1e-6, maxiter=5000, quiet=True):
 
     Args:
         A (LinearOperator): The coefficient matrix A of the linear system.
-        b (Field): The right-hand side of the linear system.
-        x (Field): The initial guess for the solution.
+        b (Field, Ndarray): The right-hand side of the linear system.
+        x (Field, Ndarray): The initial guess for the solution.
         maxiter (int): Maximum number of iterations.
         atol: Tolerance(absolute) for convergence.
         quiet (bool): Switch to turn on/off iteration log.
+
+    On CPUs, scalar Ndarrays are solved in place by a native solver that runs on the
+    Taichi thread pool. The matvec kernel of `A` is then called on Ndarrays.
     """
 
     if b.dtype != x.dtype:
@@ -43,6 +49,9 @@ def MatrixFreeCG(A, b, x, tol=1e-6, maxiter=5000, quiet=True):
         raise TaichiRuntimeError(f"Dimension mismatch b.shape{b.shape} != x.shape{x.shape}.")
 
     size = b.shape
+    if isinstance(b, Ndarray) and isinstance(x, Ndarray):
+        return _native_matrixfree_cg(A, b, x, solver_dtype, tol, maxiter, quiet)
+
     vector_fields_builder = ti.FieldsBuilder()
     p = ti.field(dtype=solver_dtype)
     r = ti.field(dtype=solver_dtype)
@@ -137,6 +146,20 @@ def MatrixFreeCG(A, b, x, tol=1e-6, maxiter=5000, quiet=True):
     return succeeded
 
 
+def _native_matrixfree_cg(A, b, x, solver_dtype, tol, maxiter, quiet):
+    arch = get_runtime().prog.config().arch
+    if arch not in (_ti_core.Arch.x64, _ti_core.Arch.arm64):
+        raise TaichiRuntimeError(f"MatrixFreeCG on Ndarrays is only supported on CPUs, got {arch}.")
+    if _ti_core.is_tensor(b.element_type) or _ti_core.is_tensor(x.element_type):
+        raise TaichiTypeError("MatrixFreeCG only supports scalar Ndarrays.")
+    p = ti.ndarray(dtype=solver_dtype, shape=b.shape)
+    Ap = ti.ndarray(dtype=solver_dtype, shape=b.shape)
+    solver_class = _ti_core.MatrixFreeCGf if solver_dtype == ti.f32 else _ti_core.MatrixFreeCGd
+    prog = get_runtime().prog
+    solver = solver_class(prog, p.arr, Ap.arr, lambda: A.matvec(p, Ap), maxiter, tol, not quiet)
+    return solver.solve(prog, x.arr, b.arr)
+
+
 def MatrixFreeBICGSTAB(A, b, x, tol=1e-6, maxiter=5000, quiet=True):
     """Matrix-free biconjugate-gradient stabilized solver (BiCGSTAB).
 
@@ -17,20 +17,33 @@ class SparseCG:
         x0 (numpy ndarray, taichi Ndarray): The initial guess for the solution.
         max_iter (int): Maximum number of iterations.
         atol: Tolerance(absolute) for convergence.
+        preconditioner (str): Preconditioner of the CPU solver, one of "none", "jacobi",
+            "block_jacobi" and "ic" (incomplete Cholesky).
+        block_size (int): Number of consecutive rows in a block of the "block_jacobi" preconditioner.
+
+    On CPUs the solver runs on the Taichi thread pool. When `x0` is a taichi Ndarray, the solution
+    is written into it in place and `solve()` returns it.
     """
 
-    def __init__(self, A, b, x0=None, max_iter=50, atol=1e-6):
+    def __init__(self, A, b, x0=None, max_iter=50, atol=1e-6, preconditioner="none", block_size=4):
         self.dtype = A.dtype
         self.ti_arch = get_runtime().prog.config().arch
         self.matrix = A
         self.b = b
+        self.x0 = x0
         if self.ti_arch == _ti_core.Arch.cuda:
+            if preconditioner != "none":
+                raise TaichiRuntimeError("CG preconditioners are only supported on CPUs")
             self.cg_solver = _ti_core.make_cucg_solver(A.matrix, max_iter, atol, True)
         elif self.ti_arch == _ti_core.Arch.x64 or self.ti_arch == _ti_core.Arch.arm64:
             if self.dtype == f32:
-                self.cg_solver = _ti_core.make_float_cg_solver(A.matrix, max_iter, atol, True)
+                self.cg_solver = _ti_core.make_float_cg_solver(
+                    A.matrix, max_iter, atol, True, preconditioner, block_size
+                )
             elif self.dtype == f64:
-                self.cg_solver = _ti_core.make_double_cg_solver(A.matrix, max_iter, atol, True)
+                self.cg_solver = _ti_core.make_double_cg_solver(
+                    A.matrix, max_iter, atol, True, preconditioner, block_size
+                )
             else:
                 raise TaichiRuntimeError(f"Unsupported CG dtype: {self.dtype}")
             if isinstance(b, Ndarray):
@@ -52,5 +65,7 @@ class SparseCG:
                 return x, True
             raise TaichiRuntimeError(f"Unsupported CG RHS type: {type(self.b)}")
         else:
-            self.cg_solver.solve()
+            self.cg_solver.solve(get_runtime().prog)
+            if isinstance(self.x0, Ndarray):
+                return self.x0, self.cg_solver.is_success()
             return self.cg_solver.get_x(), self.cg_solver.is_success()
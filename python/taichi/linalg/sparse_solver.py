@@ -17,11 +17,20 @@ class SparseSolver:
     Args:
         solver_type (str): The factorization type.
         ordering (str): The method for matrices re-ordering.
+        backend (str): "eigen" for Eigen's solvers, or "supernodal" for the multithreaded supernodal
+            Cholesky of the CPU backend, which supports "LLT" and "LDLT" and also the "natural" ordering.
     """
 
-    def __init__(self, dtype=f32, solver_type="LLT", ordering="AMD"):
+    def __init__(self, dtype=f32, solver_type="LLT", ordering="AMD", backend="eigen"):
         self.matrix = None
         self.dtype = dtype
+        if backend == "supernodal":
+            self._init_supernodal(dtype, solver_type, ordering)
+            return
+        if backend != "eigen":
+            raise TaichiRuntimeError(
+                f"The backend {backend} is not supported. Only eigen and supernodal are supported."
+            )
         solver_type_list = ["LLT", "LDLT", "LU"]
         solver_ordering = ["AMD", "COLAMD"]
         if solver_type in solver_type_list and ordering in solver_ordering:
@@ -40,6 +49,19 @@ class SparseSolver:
                 f"The solver type {solver_type} with {ordering} is not supported for now. Only {solver_type_list} with {solver_ordering} are supported."
             )
 
+    def _init_supernodal(self, dtype, solver_type, ordering):
+        solver_type_list = ["LLT", "LDLT"]
+        solver_ordering = ["AMD", "COLAMD", "natural"]
+        if solver_type not in solver_type_list or ordering not in solver_ordering:
+            raise TaichiRuntimeError(
+                f"The supernodal solver type {solver_type} with {ordering} is not supported. Only {solver_type_list} with {solver_ordering} are supported."
+            )
+        prog = taichi.lang.impl.get_runtime().prog
+        taichi_arch = prog.config().arch
+        if taichi_arch not in (_ti_core.Arch.x64, _ti_core.Arch.arm64):
+            raise TaichiRuntimeError("The supernodal SparseSolver only supports CPU for now.")
+        self.solver = _ti_core.make_supernodal_sparse_solver(prog, dtype, solver_type, ordering)
+
     @staticmethod
     def _type_assert(sparse_matrix):
         raise TaichiRuntimeError(
@@ -281,12 +281,17 @@ class KernelProfiler:
         # there is no corresponding implementation in other backends yet.
         # Profiler dose not print invalid kernel attributes info for now.
         kernel_attribute_state = self._traced_records[0].register_per_thread > 0
+        # Per-thread busy time of the thread pool is only recorded on CPU.
+        # imbalance = max / avg busy time of participating threads (1.0 is perfect balance)
+        cpu_busy_state = any(record.cpu_num_busy_threads > 0 for record in self._traced_records)
 
         # headers
         table_header = self._make_table_header("trace")
         column_header = "[  start.time | kernel.time |"  # default
         if kernel_attribute_state:
             column_header += "   regs  |   shared mem | grid size | block size | occupancy |"  # kernel_attributes
+        if cpu_busy_state:
+            column_header += " threads |    busy.max |    busy.avg | imbalance |"  # cpu thread pool
         for idx in range(values_num):
             column_header += metric_list[idx].header + "|"
         column_header = (column_header + "] Kernel name").replace("|]", "]")
@@ -312,6 +317,15 @@ class KernelProfiler:
                     record.block_size,
                     record.active_blocks_per_multiprocessor,
                 ]
+            if cpu_busy_state:
+                formatted_str += "  {:6d} |{:9.3f} ms |{:9.3f} ms |  {:8.2f} |"
+                imbalance = record.cpu_max_busy_time / record.cpu_avg_busy_time if record.cpu_avg_busy_time > 0 else 1.0
+                values += [
+                    record.cpu_num_busy_threads,
+                    record.cpu_max_busy_time,
+                    record.cpu_avg_busy_time,
+                    imbalance,
+                ]
             for idx in range(values_num):
                 formatted_str += metric_list[idx].val_format + "|"
                 values += [record.metric_values[idx] * metric_list[idx].scale]
@@ -4,11 +4,12 @@ from taichi.lang import util
 
 
 class NdarrayTypeMetadata:
-    def __init__(self, element_type, shape=None, needs_grad=False):
+    def __init__(self, element_type, shape=None, needs_grad=False, strided=False):
         self.element_type = element_type
         self.shape = shape
         self.layout = Layout.AOS
         self.needs_grad = needs_grad
+        self.strided = strided
 
 
 # TODO(Haidong): This is a helper function that creates a MatrixType
@@ -5,20 +5,26 @@
 #include "taichi/ir/visitors.h"
 #include "taichi/program/program.h"
 
+#include <tuple>
 #include <unordered_map>
 
 namespace taichi::lang {
 
+// Walks an IR and its copy made by IRNode::clone() side by side, making the
+// operands of the copied statements point to the copies of their operands.
+// Operands are usually defined before their users, so this is done in a single
+// walk, and the few operands that have not been seen yet are fixed up at the
+// end.
 class IRCloner : public IRVisitor {
  private:
   IRNode *other_node;
   std::unordered_map<Stmt *, Stmt *> operand_map_;
+  // The operands to fix up: a copied statement, the index of the operand and
+  // the original operand
+  std::vector<std::tuple<Stmt *, int, Stmt *>> unresolved_operands_;
 
  public:
-  enum Phase { register_operand_map, replace_operand } phase;
-
-  explicit IRCloner(IRNode *other_node)
-      : other_node(other_node), phase(register_operand_map) {
+  explicit IRCloner(IRNode *other_node) : other_node(other_node) {
     allow_undefined_visitor = true;
     invoke_default_visitor = true;
   }
@@ -33,17 +39,30 @@ class IRCloner : public IRVisitor {
   }
 
   void generic_visit(Stmt *stmt) {
-    if (phase == register_operand_map)
-      operand_map_[stmt] = other_node->as<Stmt>();
-    else {
-      TI_ASSERT(phase == replace_operand);
-      auto other_stmt = other_node->as<Stmt>();
-      TI_ASSERT(stmt->num_operands() == other_stmt->num_operands());
-      for (int i = 0; i < stmt->num_operands(); i++) {
-        if (operand_map_.find(stmt->operand(i)) == operand_map_.end())
-          other_stmt->set_operand(i, stmt->operand(i));
-        else
-          other_stmt->set_operand(i, operand_map_[stmt->operand(i)]);
+    auto other_stmt = other_node->as<Stmt>();
+    operand_map_[stmt] = other_stmt;
+    TI_ASSERT(stmt->num_operands() == other_stmt->num_operands());
+    for (int i = 0; i < stmt->num_operands(); i++) {
+      Stmt *op = stmt->operand(i);
+      auto it = operand_map_.find(op);
+      if (it != operand_map_.end()) {
+        other_stmt->set_operand(i, it->second);
+      } else {
+        other_stmt->set_operand(i, op);
+        if (op != nullptr) {
+          unresolved_operands_.emplace_back(other_stmt, i, op);
+        }
+      }
+    }
+  }
+
+  // Operands that are still not in the map are outside of the cloned IR, and
+  // stay shared with it
+  void resolve_remaining_operands() {
+    for (auto &[other_stmt, i, op] : unresolved_operands_) {
+      auto it = operand_map_.find(op);
+      if (it != operand_map_.end()) {
+        other_stmt->set_operand(i, it->second);
       }
     }
   }
@@ -95,11 +114,10 @@ class IRCloner : public IRVisitor {
     generic_visit(stmt);
     auto other = other_node->as<OffloadedStmt>();
 
-#define CLONE_BLOCK(B)                    \
-  if (stmt->B) {                          \
-    other->B = std::make_unique<Block>(); \
-    other_node = other->B.get();          \
-    stmt->B->accept(this);                \
+#define CLONE_BLOCK(B)           \
+  if (stmt->B) {                 \
+    other_node = other->B.get(); \
+    stmt->B->accept(this);       \
   }
 
     CLONE_BLOCK(tls_prologue)
@@ -121,10 +139,8 @@ class IRCloner : public IRVisitor {
   static std::unique_ptr<IRNode> run(IRNode *root) {
     std::unique_ptr<IRNode> new_root = root->clone();
     IRCloner cloner(new_root.get());
-    cloner.phase = IRCloner::register_operand_map;
-    root->accept(&cloner);
-    cloner.phase = IRCloner::replace_operand;
     root->accept(&cloner);
+    cloner.resolve_remaining_operands();
 
     return new_root;
   }
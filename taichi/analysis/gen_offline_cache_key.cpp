@@ -1,5 +1,7 @@
 #include "offline_cache_util.h"
 
+#include <cstring>
+
 #include "taichi/ir/expr.h"
 #include "taichi/ir/frontend_ir.h"
 #include "taichi/ir/ir.h"
@@ -53,18 +55,18 @@ class ASTSerializer : public IRVisitor, public ExpressionVisitor {
   using IRVisitor::visit;
 
  public:
-  explicit ASTSerializer(std::ostream *os) : ExpressionVisitor(false), os_(os) {
+  // Writes the serialization to |os|, or feeds it to |hasher|
+  ASTSerializer(std::ostream *os,
+                OfflineCacheKeyHasher *hasher,
+                OfflineCacheKeyGenerator *generator)
+      : ExpressionVisitor(false),
+        os_(os),
+        hasher_(hasher),
+        generator_(generator) {
+    TI_ASSERT((os_ == nullptr) != (hasher_ == nullptr));
     this->allow_undefined_visitor = false;
   }
 
-  void set_ostream(std::ostream *os) {
-    this->os_ = os;
-  }
-
-  std::ostream *get_ostream() {
-    return this->os_;
-  }
-
   void visit(Expression *expr) override {
     this->ExpressionVisitor::visit(expr);
   }
@@ -424,10 +426,14 @@ class ASTSerializer : public IRVisitor, public ExpressionVisitor {
     emit(stmt->outputs);
   }
 
-  static void run(IRNode *ast, std::ostream *os) {
-    ASTSerializer serializer(os);
+  static void run(IRNode *ast,
+                  std::ostream *os,
+                  OfflineCacheKeyHasher *hasher,
+                  OfflineCacheKeyGenerator *generator) {
+    ASTSerializer serializer(os, hasher, generator);
     ast->accept(&serializer);
     serializer.emit_dependencies();
+    serializer.flush();
   }
 
  private:
@@ -446,13 +452,14 @@ class ASTSerializer : public IRVisitor, public ExpressionVisitor {
     emit(static_cast<std::size_t>(snode_tree_roots_.size()));
     for (const auto *snode : snode_tree_roots_) {
       std::string key;
-      if (snode_key_cache_.find(snode) == snode_key_cache_.end()) {
-        key = get_hashed_offline_cache_key_of_snode(snode);
-        snode_key_cache_[snode] = key;
+      if (auto iter = snode_key_cache_.find(snode);
+          iter != snode_key_cache_.end()) {
+        key = iter->second;
       } else {
-        key = snode_key_cache_[snode];
+        key = generator_ ? generator_->get_snode_tree_key(snode)
+                         : get_hashed_offline_cache_key_of_snode(snode);
+        snode_key_cache_[snode] = key;
       }
-      snode_key_cache_[snode] = key;
       emit_bytes(key.c_str(), key.size());
     }
 
@@ -464,15 +471,36 @@ class ASTSerializer : public IRVisitor, public ExpressionVisitor {
   template <typename T>
   void emit_pod(const T &val) {
     static_assert(std::is_pod<T>::value);
-    TI_ASSERT(os_);
-    os_->write((const char *)&val, sizeof(T));
+    if (buffer_size_ + sizeof(T) > sizeof(buffer_)) {
+      flush();
+    }
+    std::memcpy(buffer_ + buffer_size_, &val, sizeof(T));
+    buffer_size_ += sizeof(T);
   }
 
   void emit_bytes(const char *bytes, std::size_t len) {
-    TI_ASSERT(os_);
     if (!bytes)
       return;
-    os_->write(bytes, len);
+    if (buffer_size_ + len <= sizeof(buffer_)) {
+      std::memcpy(buffer_ + buffer_size_, bytes, len);
+      buffer_size_ += len;
+    } else {
+      flush();
+      write(bytes, len);
+    }
+  }
+
+  void flush() {
+    write(buffer_, buffer_size_);
+    buffer_size_ = 0;
+  }
+
+  void write(const char *bytes, std::size_t len) {
+    if (hasher_) {
+      hasher_->process(bytes, len);
+    } else {
+      os_->write(bytes, len);
+    }
   }
 
   template <typename T>
@@ -663,6 +691,11 @@ class ASTSerializer : public IRVisitor, public ExpressionVisitor {
 #undef DEFINE_EMIT_ENUM
 
   std::ostream *os_{nullptr};
+  OfflineCacheKeyHasher *hasher_{nullptr};
+  OfflineCacheKeyGenerator *generator_{nullptr};
+  // Most of the emitted values are a few bytes long
+  char buffer_[4096];
+  std::size_t buffer_size_{0};
   std::vector<const SNode *> snode_tree_roots_;
   std::unordered_map<const SNode *, std::string> snode_key_cache_;
   std::map<Function *, std::size_t> real_funcs_;
@@ -672,7 +705,13 @@ class ASTSerializer : public IRVisitor, public ExpressionVisitor {
 }  // namespace
 
 void gen_offline_cache_key(IRNode *ast, std::ostream *os) {
-  ASTSerializer::run(ast, os);
+  ASTSerializer::run(ast, os, /*hasher=*/nullptr, /*generator=*/nullptr);
+}
+
+void gen_offline_cache_key(IRNode *ast,
+                           OfflineCacheKeyHasher *hasher,
+                           OfflineCacheKeyGenerator *generator) {
+  ASTSerializer::run(ast, /*os=*/nullptr, hasher, generator);
 }
 
 }  // namespace taichi::lang
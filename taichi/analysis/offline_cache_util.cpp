@@ -10,10 +10,149 @@
 
 #include "picosha2.h"
 
+#include <cstring>
 #include <vector>
 
 namespace taichi::lang {
 
+namespace {
+
+class Sha256KeyHasher : public OfflineCacheKeyHasher {
+ public:
+  void process(const void *data, std::size_t size) override {
+    auto *p = (const std::uint8_t *)data;
+    hasher_.process(p, p + size);
+  }
+
+  std::string finish() override {
+    hasher_.finish();
+    return picosha2::get_hash_hex_string(hasher_);
+  }
+
+  std::unique_ptr<OfflineCacheKeyHasher> clone() const override {
+    return std::make_unique<Sha256KeyHasher>(*this);
+  }
+
+ private:
+  picosha2::hash256_one_by_one hasher_;
+};
+
+// XXH64 (https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md)
+class XxHash64KeyHasher : public OfflineCacheKeyHasher {
+ public:
+  void process(const void *data, std::size_t size) override {
+    auto *p = (const uint8 *)data;
+    total_size_ += size;
+    if (buffer_size_ + size < kStripeSize) {
+      std::memcpy(buffer_ + buffer_size_, p, size);
+      buffer_size_ += size;
+      return;
+    }
+    if (buffer_size_ > 0) {
+      auto n = kStripeSize - buffer_size_;
+      std::memcpy(buffer_ + buffer_size_, p, n);
+      process_stripe(buffer_);
+      p += n;
+      size -= n;
+      buffer_size_ = 0;
+    }
+    for (; size >= kStripeSize; p += kStripeSize, size -= kStripeSize) {
+      process_stripe(p);
+    }
+    std::memcpy(buffer_, p, size);
+    buffer_size_ = size;
+  }
+
+  std::string finish() override {
+    uint64 h;
+    if (total_size_ >= kStripeSize) {
+      h = rotl(acc_[0], 1) + rotl(acc_[1], 7) + rotl(acc_[2], 12) +
+          rotl(acc_[3], 18);
+      for (auto acc : acc_) {
+        h = (h ^ round(0, acc)) * kPrime1 + kPrime4;
+      }
+    } else {
+      h = kPrime5;
+    }
+    h += total_size_;
+
+    const uint8 *p = buffer_;
+    std::size_t size = buffer_size_;
+    for (; size >= 8; p += 8, size -= 8) {
+      h = rotl(h ^ round(0, read<uint64>(p)), 27) * kPrime1 + kPrime4;
+    }
+    if (size >= 4) {
+      h = rotl(h ^ (read<uint32>(p) * kPrime1), 23) * kPrime2 + kPrime3;
+      p += 4;
+      size -= 4;
+    }
+    for (; size > 0; p++, size--) {
+      h = rotl(h ^ (*p * kPrime5), 11) * kPrime1;
+    }
+
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    return fmt::format("{:016x}", h);
+  }
+
+  std::unique_ptr<OfflineCacheKeyHasher> clone() const override {
+    return std::make_unique<XxHash64KeyHasher>(*this);
+  }
+
+ private:
+  static constexpr std::size_t kStripeSize = 32;
+  static constexpr uint64 kPrime1 = 0x9E3779B185EBCA87ULL;
+  static constexpr uint64 kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+  static constexpr uint64 kPrime3 = 0x165667B19E3779F9ULL;
+  static constexpr uint64 kPrime4 = 0x85EBCA77C2B2AE63ULL;
+  static constexpr uint64 kPrime5 = 0x27D4EB2F165667C5ULL;
+
+  static uint64 rotl(uint64 x, int r) {
+    return (x << r) | (x >> (64 - r));
+  }
+
+  static uint64 round(uint64 acc, uint64 input) {
+    return rotl(acc + input * kPrime2, 31) * kPrime1;
+  }
+
+  template <typename T>
+  static uint64 read(const uint8 *p) {
+    T val;
+    std::memcpy(&val, p, sizeof(T));  // Little-endian hosts only
+    return val;
+  }
+
+  void process_stripe(const uint8 *p) {
+    for (int i = 0; i < 4; i++) {
+      acc_[i] = round(acc_[i], read<uint64>(p + i * 8));
+    }
+  }
+
+  // Seed is 0
+  uint64 acc_[4]{kPrime1 + kPrime2, kPrime2, 0, 0 - kPrime1};
+  uint64 total_size_{0};
+  uint8 buffer_[kStripeSize];
+  std::size_t buffer_size_{0};
+};
+
+}  // namespace
+
+std::unique_ptr<OfflineCacheKeyHasher> OfflineCacheKeyHasher::create(
+    const std::string &algorithm) {
+  if (algorithm == "sha256") {
+    return std::make_unique<Sha256KeyHasher>();
+  } else if (algorithm == "xxhash64") {
+    return std::make_unique<XxHash64KeyHasher>();
+  }
+  TI_ERROR("Unknown offline cache key hash \"{}\" (expected \"sha256\" or "
+           "\"xxhash64\")",
+           algorithm);
+  return nullptr;
+}
+
 static std::vector<std::uint8_t> get_offline_cache_key_of_parameter_list(
     const std::vector<CallableBase::Parameter> &parameter_list) {
   BinaryOutputSerializer serializer;
@@ -57,6 +196,12 @@ static std::vector<std::uint8_t> get_offline_cache_key_of_compile_config(
   if (arch_is_cpu(config.arch)) {
     serializer(config.default_cpu_block_dim);
     serializer(config.cpu_max_num_threads);
+    serializer(config.cpu_guided_range_for());
+    serializer(config.vectorize_range_for);
+    if (config.vectorize_range_for) {
+      serializer(config.simd_width);
+      serializer(config.max_vector_width);
+    }
   } else if (arch_is_gpu(config.arch)) {
     serializer(config.default_gpu_block_dim);
     serializer(config.gpu_max_reg);
@@ -69,6 +214,9 @@ static std::vector<std::uint8_t> get_offline_cache_key_of_compile_config(
   if (config.arch == Arch::opengl || config.arch == Arch::gles) {
     serializer(config.allow_nv_shader_extension);
   }
+  if (config.arch == Arch::flagos) {
+    serializer(config.flagos_chip);
+  }
   serializer(config.make_mesh_block_local);
   serializer(config.optimize_mesh_reordered_mapping);
   serializer(config.mesh_localize_to_end_mapping);
@@ -167,36 +315,67 @@ std::string get_hashed_offline_cache_key_of_snode(const SNode *snode) {
   return picosha2::get_hash_hex_string(hasher);
 }
 
-std::string get_hashed_offline_cache_key(const CompileConfig &config,
-                                         const DeviceCapabilityConfig &caps,
-                                         Kernel *kernel) {
-  std::vector<std::uint8_t> kernel_params_string, kernel_rets_string;
-  std::string kernel_body_string;
-  if (kernel) {  // param_list, rets, body
-    kernel_params_string =
-        get_offline_cache_key_of_parameter_list(kernel->parameter_list);
-    kernel_rets_string = get_offline_cache_key_of_rets(kernel->rets);
-    std::ostringstream oss;
-    gen_offline_cache_key(kernel->ir.get(), &oss);
-    kernel_body_string = oss.str();
-  }
-
-  auto compile_config_key = get_offline_cache_key_of_compile_config(config);
+std::string OfflineCacheKeyGenerator::get_hashed_key(
+    const CompileConfig &config,
+    const DeviceCapabilityConfig &caps,
+    Kernel *kernel) {
+  TI_ASSERT(kernel);
+  // Serializing the compile config and device caps is cheap, hashing them is
+  // not: only hash them again when they changed
+  auto prefix = get_offline_cache_key_of_compile_config(config);
   auto device_caps_key = get_offline_cache_key_of_device_caps(caps);
+  prefix.insert(prefix.end(), device_caps_key.begin(), device_caps_key.end());
+  std::unique_ptr<OfflineCacheKeyHasher> hasher;
+  {
+    std::lock_guard<std::mutex> _(mut_);
+    if (!prefix_hasher_ || algorithm_ != config.offline_cache_key_hash ||
+        prefix_ != prefix) {
+      prefix_hasher_ =
+          OfflineCacheKeyHasher::create(config.offline_cache_key_hash);
+      prefix_hasher_->process(prefix.data(), prefix.size());
+      algorithm_ = config.offline_cache_key_hash;
+      prefix_ = std::move(prefix);
+    }
+    hasher = prefix_hasher_->clone();
+  }
+
+  // param_list, rets, body
+  auto kernel_params_key =
+      get_offline_cache_key_of_parameter_list(kernel->parameter_list);
+  hasher->process(kernel_params_key.data(), kernel_params_key.size());
+  auto kernel_rets_key = get_offline_cache_key_of_rets(kernel->rets);
+  hasher->process(kernel_rets_key.data(), kernel_rets_key.size());
+  gen_offline_cache_key(kernel->ir.get(), hasher.get(), this);
   std::string autodiff_mode =
       std::to_string(static_cast<std::size_t>(kernel->autodiff_mode));
-  picosha2::hash256_one_by_one hasher;
-  hasher.process(compile_config_key.begin(), compile_config_key.end());
-  hasher.process(device_caps_key.begin(), device_caps_key.end());
-  hasher.process(kernel_params_string.begin(), kernel_params_string.end());
-  hasher.process(kernel_rets_string.begin(), kernel_rets_string.end());
-  hasher.process(kernel_body_string.begin(), kernel_body_string.end());
-  hasher.process(autodiff_mode.begin(), autodiff_mode.end());
-  hasher.finish();
+  hasher->process(autodiff_mode.data(), autodiff_mode.size());
 
-  auto res = picosha2::get_hash_hex_string(hasher);
+  auto res = hasher->finish();
   res.insert(res.begin(), 'T');  // The key must start with a letter
   return res;
 }
 
+std::string OfflineCacheKeyGenerator::get_snode_tree_key(const SNode *root) {
+  {
+    std::lock_guard<std::mutex> _(mut_);
+    // Also compare the id, in case the tree was destroyed and its root
+    // reallocated at the same address
+    if (auto iter = snode_keys_.find(root);
+        iter != snode_keys_.end() && iter->second.first == root->id) {
+      return iter->second.second;
+    }
+  }
+  auto key = get_hashed_offline_cache_key_of_snode(root);
+  std::lock_guard<std::mutex> _(mut_);
+  snode_keys_[root] = {root->id, key};
+  return key;
+}
+
+std::string get_hashed_offline_cache_key(const CompileConfig &config,
+                                         const DeviceCapabilityConfig &caps,
+                                         Kernel *kernel) {
+  OfflineCacheKeyGenerator generator;
+  return generator.get_hashed_key(config, caps, kernel);
+}
+
 }  // namespace taichi::lang
@@ -1,6 +1,13 @@
 #pragma once
 
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "taichi/rhi/arch.h"
 
@@ -13,10 +20,57 @@ class IRNode;
 class SNode;
 class Kernel;
 
+// Incrementally hashes the bytes making up an offline cache key
+class OfflineCacheKeyHasher {
+ public:
+  virtual ~OfflineCacheKeyHasher() = default;
+
+  virtual void process(const void *data, std::size_t size) = 0;
+
+  // Returns the digest as a hex string. The hasher must not be used
+  // afterwards.
+  virtual std::string finish() = 0;
+
+  virtual std::unique_ptr<OfflineCacheKeyHasher> clone() const = 0;
+
+  // |algorithm| is "sha256" or "xxhash64" (non-cryptographic, much faster)
+  static std::unique_ptr<OfflineCacheKeyHasher> create(
+      const std::string &algorithm);
+};
+
+// Generates the offline cache keys of kernels. The kernel AST is hashed while
+// it is walked, and the parts shared by many kernels (the compile config, the
+// device caps and the SNode trees) are only hashed once.
+class OfflineCacheKeyGenerator {
+ public:
+  std::string get_hashed_key(const CompileConfig &config,
+                             const DeviceCapabilityConfig &caps,
+                             Kernel *kernel);
+
+  // Returns get_hashed_offline_cache_key_of_snode(root), computed once per
+  // SNode tree
+  std::string get_snode_tree_key(const SNode *root);
+
+ private:
+  std::mutex mut_;
+  // The serialized compile config and device caps, and the state of the
+  // hasher after processing them
+  std::string algorithm_;
+  std::vector<std::uint8_t> prefix_;
+  std::unique_ptr<OfflineCacheKeyHasher> prefix_hasher_;
+  // SNode tree root => (root id, key)
+  std::unordered_map<const SNode *, std::pair<int, std::string>> snode_keys_;
+};
+
 std::string get_hashed_offline_cache_key_of_snode(const SNode *snode);
 std::string get_hashed_offline_cache_key(const CompileConfig &config,
                                          const DeviceCapabilityConfig &caps,
                                          Kernel *kernel);
 void gen_offline_cache_key(IRNode *ast, std::ostream *os);
+// Hashes the AST without building its serialization. SNode tree keys are
+// memoized in |generator| when it is given.
+void gen_offline_cache_key(IRNode *ast,
+                           OfflineCacheKeyHasher *hasher,
+                           OfflineCacheKeyGenerator *generator = nullptr);
 
 }  // namespace taichi::lang
@@ -16,6 +16,9 @@
 #if defined(TI_WITH_AMDGPU)
 #include "taichi/codegen/amdgpu/codegen_amdgpu.h"
 #endif
+#if defined(TI_WITH_FLAGOS)
+#include "taichi/codegen/flagos/codegen_flagos.h"
+#endif
 #include "taichi/system/timer.h"
 #include "taichi/ir/analysis.h"
 #include "taichi/ir/transforms.h"
@@ -64,6 +67,13 @@ std::unique_ptr<KernelCodeGen> KernelCodeGen::create(
                                                  tlctx);
 #else
     TI_NOT_IMPLEMENTED
+#endif
+  } else if (arch == Arch::flagos) {
+#if defined(TI_WITH_FLAGOS)
+    return std::make_unique<KernelCodeGenFlagOS>(compile_config, kernel, ir,
+                                                 tlctx);
+#else
+    TI_NOT_IMPLEMENTED
 #endif
   } else {
     TI_NOT_IMPLEMENTED
@@ -84,6 +94,8 @@ LLVMCompiledKernel KernelCodeGen::compile_kernel_to_module() {
   for (int i = 0; i < offloads.size(); i++) {
     auto compile_func = [&, i] {
       tlctx_.fetch_this_thread_struct_module();
+      // The copy of the task is freed in bulk once it is compiled
+      IRArenaScope arena_scope(compile_config_.ir_arena);
       auto offload = irpass::analysis::clone(offloads[i].get());
       irpass::re_id(offload.get());
 
@@ -92,7 +104,13 @@ LLVMCompiledKernel KernelCodeGen::compile_kernel_to_module() {
       auto new_data = this->compile_task(i, compile_config_, nullptr, &blk);
       data[i] = std::make_unique<LLVMCompiledTask>(std::move(new_data));
     };
-    worker.enqueue(compile_func);
+    // Handing a single task over to a worker only adds a round trip through
+    // another LLVM context.
+    if (offloads.size() == 1 || compile_config_.num_compile_threads <= 1) {
+      compile_func();
+    } else {
+      worker.enqueue(compile_func);
+    }
   }
   worker.flush();
 
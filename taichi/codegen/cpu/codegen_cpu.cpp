@@ -3,6 +3,7 @@
 #include "taichi/runtime/program_impls/llvm/llvm_program.h"
 #include "taichi/common/core.h"
 #include "taichi/util/io.h"
+#include "taichi/math/arithmetic.h"
 #include "taichi/util/lang_util.h"
 #include "taichi/util/file_sequence_writer.h"
 #include "taichi/program/program.h"
@@ -68,8 +69,10 @@ class TaskCodeGenCPU : public TaskCodeGenLLVM {
 
     auto [begin, end] = get_range_for_bounds(stmt);
 
-    call("cpu_parallel_range_for", get_arg(0),
-         tlctx->get_constant(stmt->num_cpu_threads), begin, end,
+    // With guided scheduling, block_dim is the minimal chunk size.
+    call(compile_config.cpu_guided_range_for() ? "cpu_parallel_range_for_guided"
+                                               : "cpu_parallel_range_for",
+         get_arg(0), tlctx->get_constant(stmt->num_cpu_threads), begin, end,
          tlctx->get_constant(step), tlctx->get_constant(stmt->block_dim),
          tls_prologue, body, epilogue, tlctx->get_constant(stmt->tls_size));
   }
@@ -163,11 +166,17 @@ class TaskCodeGenCPU : public TaskCodeGenLLVM {
   }
 
   void visit(OffloadedStmt *stmt) override {
+    using Type = OffloadedStmt::TaskType;
     TI_ASSERT(current_offload == nullptr);
     current_offload = stmt;
-    if (stmt->bls_size > 0)
+    if (stmt->bls_size > 0 && stmt->task_type == Type::struct_for) {
+      // The BLS buffer of a struct-for is placed after the TLS of the
+      // thread processing the block. See visit(BlockLocalPtrStmt).
+      bls_tls_offset_ = taichi::iroundup(stmt->tls_size, kBlsAlignment);
+      stmt->tls_size = bls_tls_offset_ + stmt->bls_size;
+    } else if (stmt->bls_size > 0) {
       create_bls_buffer(stmt);
-    using Type = OffloadedStmt::TaskType;
+    }
     auto offloaded_task_name = init_offloaded_task_function(stmt);
     if (compile_config.kernel_profiler && arch_is_cpu(compile_config.arch)) {
       call("LLVMRuntime_profiler_start", get_runtime(),
@@ -182,6 +191,18 @@ class TaskCodeGenCPU : public TaskCodeGenLLVM {
     } else if (stmt->task_type == Type::struct_for) {
       stmt->block_dim = std::min(stmt->snode->parent->max_num_elements(),
                                  (int64)stmt->block_dim);
+      if (stmt->bls_size > 0) {
+        // Process each list element in one go, so that the footprint of its
+        // block is staged into the BLS buffer only once. This matches
+        // list_element_size in create_offload_struct_for.
+        auto *leaf_block =
+            stmt->is_bit_vectorized ? stmt->snode->parent : stmt->snode;
+        const int64 leaf_num_elements = leaf_block->type == SNodeType::hash
+                                            ? leaf_block->chunk_size
+                                            : leaf_block->max_num_elements();
+        stmt->block_dim = (int)std::min(
+            leaf_num_elements, (int64)taichi_listgen_max_element_size);
+      }
       create_offload_struct_for(stmt);
     } else if (stmt->task_type == Type::listgen) {
       emit_list_gen(stmt);
@@ -201,6 +222,21 @@ class TaskCodeGenCPU : public TaskCodeGenLLVM {
     current_offload = nullptr;
   }
 
+  void visit(BlockLocalPtrStmt *stmt) override {
+    if (current_offload->task_type != OffloadedStmt::TaskType::struct_for) {
+      TaskCodeGenLLVM::visit(stmt);
+      return;
+    }
+    auto offset =
+        builder->CreateAdd(tlctx->get_constant((int32)bls_tls_offset_),
+                           llvm_val[stmt->offset]);
+    auto ptr = builder->CreateGEP(llvm::Type::getInt8Ty(*llvm_context),
+                                  get_tls_base_ptr(), offset);
+    auto ptr_type = llvm::PointerType::get(
+        tlctx->get_data_type(stmt->ret_type.ptr_removed()), 0);
+    llvm_val[stmt] = builder->CreatePointerCast(ptr, ptr_type);
+  }
+
   void visit(ExternalFuncCallStmt *stmt) override {
     if (stmt->type == ExternalFuncCallStmt::BITCODE) {
       TaskCodeGenLLVM::visit_call_bitcode(stmt);
@@ -212,11 +248,16 @@ class TaskCodeGenCPU : public TaskCodeGenLLVM {
   }
 
  private:
+  static constexpr std::size_t kBlsAlignment = 16;
+
   std::tuple<llvm::Value *, llvm::Value *> get_spmd_info() override {
     auto thread_idx = tlctx->get_constant(0);
     auto block_dim = tlctx->get_constant(1);
     return std::make_tuple(thread_idx, block_dim);
   }
+
+  // The offset of the BLS buffer of the current struct-for in the TLS
+  std::size_t bls_tls_offset_{0};
 };
 
 static llvm::Triple get_host_target_triple() {
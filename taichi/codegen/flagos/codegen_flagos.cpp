@@ -22,12 +22,17 @@ namespace lang {
 
 using namespace llvm;
 
-void TaskCodeGenFlagOS::create_print(std::string tag,
-                                     DataType dt,
-                                     llvm::Value *value){
-    // FlagOS print functionality
-    // TODO: Implement using FlagOS debug/logging API
-    TI_NOT_IMPLEMENTED}
+llvm::Value *TaskCodeGenFlagOS::create_print(std::string tag,
+                                             DataType dt,
+                                             llvm::Value *value) {
+  if (is_simulated()) {
+    // The simulator prints with the host printf
+    return TaskCodeGenLLVM::create_print(tag, dt, value);
+  }
+  // FlagOS print functionality
+  // TODO: Implement using FlagOS debug/logging API
+  TI_NOT_IMPLEMENTED
+}
 
 std::tuple<llvm::Value *, llvm::Type *> TaskCodeGenFlagOS::
     create_value_and_type(llvm::Value *value, DataType dt) {
@@ -35,6 +40,10 @@ std::tuple<llvm::Value *, llvm::Type *> TaskCodeGenFlagOS::
 }
 
 void TaskCodeGenFlagOS::visit(PrintStmt *stmt) {
+  if (is_simulated()) {
+    TaskCodeGenLLVM::visit(stmt);
+    return;
+  }
   // FlagOS print support
   // TODO: Implement using FlagOS debug API
   TI_NOT_IMPLEMENTED
@@ -205,12 +214,17 @@ void TaskCodeGenFlagOS::visit(OffloadedStmt *stmt) {
       }
     }
     if (stmt->task_type == Type::listgen) {
-      // Use device-specific block configuration
-      // TODO: Query FlagOS for optimal configuration
-      int num_compute_units = 64;  // Placeholder
-      current_task->grid_dim = num_compute_units * 4;
+      // Sized from the compute units of the device, see LlvmRuntimeExecutor
+      current_task->grid_dim = compile_config.saturating_grid_dim;
     }
     current_task->block_dim = stmt->block_dim;
+    if (is_simulated() && (stmt->task_type == Type::struct_for ||
+                           stmt->task_type == Type::listgen)) {
+      // The host runtime generates the element lists and runs struct-fors
+      // on its own thread pool, so a single SPMD thread launches them.
+      current_task->grid_dim = 1;
+      current_task->block_dim = 1;
+    }
     TI_ASSERT(current_task->grid_dim != 0);
     TI_ASSERT(current_task->block_dim != 0);
     offloaded_tasks.push_back(*current_task);
@@ -243,14 +257,11 @@ void TaskCodeGenFlagOS::visit(BinaryOpStmt *stmt) {
 
 std::tuple<llvm::Value *, llvm::Value *> TaskCodeGenFlagOS::get_spmd_info() {
   // Get SPMD (Single Program Multiple Data) execution information
-  // This is similar to CUDA/AMDGPU but uses FlagOS abstractions
-
-  // TODO: Use FlagOS intrinsics when available
-  // For now, use LLVM GPU intrinsics
-  auto thread_idx =
-      builder->CreateIntrinsic(Intrinsic::nvvm_read_ptx_sreg_tid_x, {}, {});
-  auto block_dim =
-      builder->CreateIntrinsic(Intrinsic::nvvm_read_ptx_sreg_ntid_x, {}, {});
+  // This is similar to CUDA/AMDGPU but uses FlagOS abstractions. The runtime
+  // builtins are bound to the registers of the chip by FlagTree, or to the
+  // simulated thread on the host (see TaichiLLVMContext::module_from_file).
+  auto thread_idx = call("thread_idx");
+  auto block_dim = call("block_dim");
 
   return std::make_tuple(thread_idx, block_dim);
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "taichi/codegen/codegen.h"
 #include "taichi/codegen/llvm/codegen_llvm.h"
 
 namespace taichi {
@@ -29,16 +30,27 @@ class TaskCodeGenFlagOS : public TaskCodeGenLLVM {
   void visit(OffloadedStmt *stmt) override;
   void visit(PrintStmt *stmt) override;
   void visit(ExternalFuncCallStmt *stmt) override;
+  void visit(RangeForStmt *for_stmt) override;
 
   // Parallel for constructs
   void create_offload_range_for(OffloadedStmt *stmt) override;
-  void create_offload_struct_for(OffloadedStmt *stmt) override;
   void create_offload_mesh_for(OffloadedStmt *stmt) override;
 
  protected:
+  // Whether the kernel runs on the host simulator (the "sim" chip)
+  bool is_simulated() const {
+    return compile_config.flagos_chip == "sim";
+  }
+
+  // The simulator runs the host runtime, whose element lists are traversed
+  // by the host thread pool.
+  bool struct_for_uses_host_thread_pool() const override {
+    return is_simulated();
+  }
+
   // FlagOS-specific code generation helpers
   void emit_flagos_gc(OffloadedStmt *stmt);
-  void create_bls_buffer(OffloadedStmt *stmt) override;
+  void create_bls_buffer(OffloadedStmt *stmt);
 
   // SPMD (Single Program Multiple Data) information
   std::tuple<llvm::Value *, llvm::Value *> get_spmd_info() override;
@@ -56,7 +68,9 @@ class TaskCodeGenFlagOS : public TaskCodeGenLLVM {
   void visit(BinaryOpStmt *stmt) override;
 
   // Print support
-  void create_print(std::string tag, DataType dt, llvm::Value *value) override;
+  llvm::Value *create_print(std::string tag,
+                            DataType dt,
+                            llvm::Value *value) override;
   std::tuple<llvm::Value *, llvm::Type *> create_value_and_type(
       llvm::Value *value,
       DataType dt);
@@ -69,7 +83,7 @@ class KernelCodeGenFlagOS : public KernelCodeGen {
  public:
   KernelCodeGenFlagOS(const CompileConfig &compile_config,
                       const Kernel *kernel,
-                      IRNode *ir = nullptr,
+                      IRNode *ir,
                       TaichiLLVMContext &tlctx)
       : KernelCodeGen(compile_config, kernel, ir, tlctx) {
   }
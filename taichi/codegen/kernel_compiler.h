@@ -23,6 +23,12 @@ class KernelCompiler {
                          const Kernel &kernel_def,
                          IRNode &chi_ir) const = 0;
 
+  // Whether kernels may be compiled on several threads at once (see
+  // KernelCompilationManager::prefetch).
+  virtual bool supports_concurrent_compilation() const {
+    return false;
+  }
+
   virtual ~KernelCompiler() = default;
 };
 
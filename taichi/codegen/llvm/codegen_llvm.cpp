@@ -235,6 +235,10 @@ std::unique_ptr<RuntimeObject> TaskCodeGenLLVM::emit_struct_meta_object(
   } else if (snode->type == SNodeType::pointer) {
     meta = std::make_unique<RuntimeObject>("PointerMeta", this, builder.get());
     emit_struct_meta_base("Pointer", meta->ptr, snode);
+  } else if (snode->type == SNodeType::hash) {
+    meta = std::make_unique<RuntimeObject>("HashMeta", this, builder.get());
+    emit_struct_meta_base("Hash", meta->ptr, snode);
+    meta->call("set_table_size", tlctx->get_constant(snode->chunk_size));
   } else if (snode->type == SNodeType::root) {
     meta = std::make_unique<RuntimeObject>("RootMeta", this, builder.get());
     emit_struct_meta_base("Root", meta->ptr, snode);
@@ -266,7 +270,8 @@ void TaskCodeGenLLVM::emit_struct_meta_base(const std::string &name,
         StructCompilerLLVM::get_llvm_body_type(module.get(), snode);
     auto element_ty = body_type->getArrayElementType();
     element_size = tlctx->get_type_size(element_ty);
-  } else if (snode->type == SNodeType::pointer) {
+  } else if (snode->type == SNodeType::pointer ||
+             snode->type == SNodeType::hash) {
     auto element_ty = StructCompilerLLVM::get_llvm_node_type(
         module.get(), snode->ch[0].get());
     element_size = tlctx->get_type_size(element_ty);
@@ -524,7 +529,7 @@ void TaskCodeGenLLVM::visit(UnaryOpStmt *stmt) {
   } else if (op == UnaryOpType::bit_not) {
     llvm_val[stmt] = builder->CreateNot(input);
   } else if (op == UnaryOpType::neg) {
-    if (is_real(stmt->operand->ret_type)) {
+    if (is_real(stmt->operand->ret_type.get_element_type())) {
       llvm_val[stmt] = builder->CreateFNeg(input, "neg");
     } else {
       llvm_val[stmt] = builder->CreateNeg(input, "neg");
@@ -1142,14 +1147,26 @@ void TaskCodeGenLLVM::emit_list_gen(OffloadedStmt *listgen) {
     // Since there's only one container to expand, we need a special kernel for
     // more parallelism.
     call("element_listgen_root", get_runtime(), meta_parent, meta_child);
+  } else if (snode_parent->type == SNodeType::hash) {
+    // Elements of a hash node range over table slots instead of indices.
+    call("element_listgen_hash", get_runtime(), meta_parent, meta_child);
   } else {
     call("element_listgen_nonroot", get_runtime(), meta_parent, meta_child);
   }
 }
 
 void TaskCodeGenLLVM::emit_gc(OffloadedStmt *stmt) {
-  auto snode = stmt->snode->id;
-  call("node_gc", get_runtime(), tlctx->get_constant(snode));
+  auto snode = stmt->snode;
+  call("node_gc", get_runtime(), tlctx->get_constant(snode->id));
+  if (snode->type == SNodeType::hash) {
+    // A hash SNode is always a child of the root, so there is a single node.
+    auto tree_id = snode->get_snode_tree_id();
+    auto node = call_struct_func(tree_id, snode->get_ch_from_parent_func_name(),
+                                 builder->CreateBitCast(
+                                     get_root(tree_id),
+                                     llvm::Type::getInt8PtrTy(*llvm_context)));
+    call(snode, node, "gc", {});
+  }
 }
 
 void TaskCodeGenLLVM::create_increment(llvm::Value *ptr, llvm::Value *value) {
@@ -1648,6 +1665,36 @@ void TaskCodeGenLLVM::visit(GlobalLoadStmt *stmt) {
   create_global_load(stmt, false);
 }
 
+void TaskCodeGenLLVM::visit(VectorLoadStmt *stmt) {
+  auto *vec_type = tlctx->get_data_type(stmt->ret_type);
+  TI_ASSERT(llvm::isa<llvm::VectorType>(vec_type));
+  auto *ptr = builder->CreateBitCast(llvm_val[stmt->src],
+                                     llvm::PointerType::get(vec_type, 0));
+  // The address is only known to be aligned to the element size
+  auto align = llvm::Align(tlctx->get_type_size(
+      tlctx->get_data_type(stmt->ret_type.get_element_type())));
+  if (stmt->mask) {
+    llvm_val[stmt] =
+        builder->CreateMaskedLoad(vec_type, ptr, align, llvm_val[stmt->mask]);
+  } else {
+    llvm_val[stmt] = builder->CreateAlignedLoad(vec_type, ptr, align);
+  }
+}
+
+void TaskCodeGenLLVM::visit(VectorStoreStmt *stmt) {
+  auto *val = llvm_val[stmt->val];
+  TI_ASSERT(llvm::isa<llvm::VectorType>(val->getType()));
+  auto *ptr = builder->CreateBitCast(
+      llvm_val[stmt->dest], llvm::PointerType::get(val->getType(), 0));
+  auto align = llvm::Align(tlctx->get_type_size(
+      tlctx->get_data_type(stmt->val->ret_type.get_element_type())));
+  if (stmt->mask) {
+    builder->CreateMaskedStore(val, ptr, align, llvm_val[stmt->mask]);
+  } else {
+    builder->CreateAlignedStore(val, ptr, align);
+  }
+}
+
 std::string TaskCodeGenLLVM::get_runtime_snode_name(SNode *snode) {
   if (snode->type == SNodeType::root) {
     return "Root";
@@ -1806,6 +1853,7 @@ void TaskCodeGenLLVM::visit(SNodeLookupStmt *stmt) {
         builder->CreateGEP(parent_ty, parent, llvm_val[stmt->input_index]);
   } else if (snode->type == SNodeType::dense ||
              snode->type == SNodeType::pointer ||
+             snode->type == SNodeType::hash ||
              snode->type == SNodeType::dynamic ||
              snode->type == SNodeType::bitmasked) {
     if (stmt->activate) {
@@ -1887,9 +1935,11 @@ void TaskCodeGenLLVM::visit(ExternalPtrStmt *stmt) {
   auto members =
       stmt->base_ptr->ret_type.ptr_removed()->as<StructType>()->elements();
   bool needs_grad = members.size() > TypeFactory::GRAD_PTR_POS_IN_NDARRAY;
+  bool strided = TypeFactory::is_strided_ndarray_struct(
+      stmt->base_ptr->ret_type.ptr_removed());
   auto struct_type =
       tlctx->get_data_type(TypeFactory::get_instance().get_ndarray_struct_type(
-          arg_type, stmt->ndim, needs_grad));
+          arg_type, stmt->ndim, needs_grad, strided));
   auto *gep = builder->CreateGEP(
       struct_type, llvm_val.at(stmt->base_ptr),
       {tlctx->get_constant(0), tlctx->get_constant(int(stmt->is_grad) + 1)});
@@ -1917,6 +1967,38 @@ void TaskCodeGenLLVM::visit(ExternalPtrStmt *stmt) {
   int num_array_args = num_indices - num_element_indices;
   const size_t element_shape_index_offset = num_array_args;
 
+  if (strided) {
+    // The strides of the array dimensions, in scalars, follow their sizes in
+    // the shape struct. Vector and matrix elements are compact.
+    auto offset = tlctx->get_constant(0);
+    for (int i = 0; i < num_array_args; i++) {
+      auto stride = builder->CreateGEP(
+          struct_type, llvm_val[stmt->base_ptr],
+          {tlctx->get_constant(0),
+           tlctx->get_constant(TypeFactory::SHAPE_POS_IN_NDARRAY),
+           tlctx->get_constant(stmt->ndim + i)});
+      stride =
+          builder->CreateLoad(tlctx->get_data_type(PrimitiveType::i32), stride);
+      offset = builder->CreateAdd(
+          offset, builder->CreateMul(llvm_val[stmt->indices[i]], stride));
+    }
+    auto element_offset = tlctx->get_constant(0);
+    for (int i = 0; i < num_element_indices; i++) {
+      element_offset = builder->CreateMul(
+          element_offset, tlctx->get_constant(stmt->element_shape[i]));
+      element_offset = builder->CreateAdd(
+          element_offset,
+          llvm_val[stmt->indices[element_shape_index_offset + i]]);
+    }
+    offset = builder->CreateAdd(offset, element_offset);
+    auto ret_ptr = builder->CreateGEP(
+        tlctx->get_data_type(arg_type), ptr_val,
+        builder->CreateSExt(offset, llvm::Type::getInt64Ty(*llvm_context)));
+    llvm_val[stmt] = builder->CreateBitCast(
+        ret_ptr, llvm::PointerType::get(tlctx->get_data_type(dt), 0));
+    return;
+  }
+
   for (int i = 0; i < num_array_args; i++) {
     auto raw_arg = builder->CreateGEP(
         struct_type, llvm_val[stmt->base_ptr],
@@ -2095,6 +2177,10 @@ void TaskCodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt) {
   llvm::Function *body = nullptr;
   auto leaf_block = stmt->snode;
 
+  // On CPU, the TLS xlogues are passed to the runtime and run once per thread
+  // instead of once per block. See cpu_parallel_struct_for in runtime.cpp.
+  const bool per_thread_tls = struct_for_uses_host_thread_pool();
+
   // For a bit-vectorized loop over a quant array, we generate struct for on its
   // parent node (must be "dense") instead of itself for higher performance.
   if (stmt->is_bit_vectorized) {
@@ -2176,7 +2262,7 @@ void TaskCodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt) {
     call(refine, parent_coordinates, block_corner_coordinates,
          tlctx->get_constant(0));
 
-    if (stmt->tls_prologue) {
+    if (stmt->tls_prologue && !per_thread_tls) {
       stmt->tls_prologue->accept(this);
     }
 
@@ -2224,8 +2310,15 @@ void TaskCodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt) {
     // initialize the coordinates
     auto new_coordinates = create_entry_block_alloca(physical_coordinate_ty);
 
-    call(refine, parent_coordinates, new_coordinates,
-         builder->CreateLoad(loop_index_ty, loop_index));
+    // The loop index of a hash leaf block is a table slot, which has to be
+    // translated into the index of the cell it holds (-1 if inactive).
+    llvm::Value *cell_index = builder->CreateLoad(loop_index_ty, loop_index);
+    if (leaf_block->type == SNodeType::hash) {
+      cell_index = call(leaf_block, element.get("element"), "slot_index",
+                        {cell_index});
+    }
+
+    call(refine, parent_coordinates, new_coordinates, cell_index);
 
     // For a bit-vectorized loop over a quant array, one more refine step is
     // needed to make final coordinates non-consecutive, since each thread will
@@ -2253,6 +2346,9 @@ void TaskCodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt) {
                             {builder->CreateLoad(loop_index_ty, loop_index)});
       is_active = builder->CreateIsNotNull(is_active);
       exec_cond = builder->CreateAnd(exec_cond, is_active);
+    } else if (leaf_block->type == SNodeType::hash) {
+      exec_cond = builder->CreateAnd(
+          exec_cond, builder->CreateICmpSGE(cell_index, tlctx->get_constant(0)));
     }
 
     builder->CreateCondBr(exec_cond, struct_for_body_bb, body_tail_bb);
@@ -2282,34 +2378,50 @@ void TaskCodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt) {
       call("block_barrier");  // "__syncthreads()"
     }
 
-    if (stmt->tls_epilogue) {
+    if (stmt->tls_epilogue && !per_thread_tls) {
       stmt->tls_epilogue->accept(this);
     }
   }
 
-  int list_element_size = std::min(leaf_block->max_num_elements(),
-                                   (int64)taichi_listgen_max_element_size);
+  const int64 leaf_num_elements = leaf_block->type == SNodeType::hash
+                                      ? leaf_block->chunk_size
+                                      : leaf_block->max_num_elements();
+  int list_element_size =
+      std::min(leaf_num_elements, (int64)taichi_listgen_max_element_size);
   int num_splits = std::max(1, list_element_size / stmt->block_dim +
                                    (list_element_size % stmt->block_dim != 0));
 
-  auto struct_for_func = get_runtime_function("parallel_struct_for");
-
-  if (arch_is_gpu(current_arch())) {
-    struct_for_func = llvm::cast<llvm::Function>(
-        module
-            ->getOrInsertFunction(
-                tlctx->get_struct_for_func_name(stmt->tls_size),
-                struct_for_func->getFunctionType(),
-                struct_for_func->getAttributes())
-            .getCallee());
-    struct_for_tls_sizes.insert(stmt->tls_size);
-  }
-  // Loop over nodes in the element list, in parallel
-  call(struct_for_func, get_context(), tlctx->get_constant(leaf_block->id),
-       tlctx->get_constant(list_element_size), tlctx->get_constant(num_splits),
-       body, tlctx->get_constant(stmt->tls_size),
-       tlctx->get_constant(stmt->num_cpu_threads));
-  // TODO: why do we need num_cpu_threads on GPUs?
+  if (per_thread_tls) {
+    auto *tls_prologue = create_xlogue(stmt->tls_prologue);
+    auto *tls_epilogue = create_xlogue(stmt->tls_epilogue);
+    // Loop over nodes in the element list, in parallel
+    call("cpu_parallel_struct_for", get_context(),
+         tlctx->get_constant(leaf_block->id),
+         tlctx->get_constant(list_element_size),
+         tlctx->get_constant(num_splits), body, tls_prologue, tls_epilogue,
+         tlctx->get_constant(stmt->tls_size),
+         tlctx->get_constant(stmt->num_cpu_threads));
+  } else {
+    auto struct_for_func = get_runtime_function("parallel_struct_for");
+
+    if (arch_is_gpu(current_arch())) {
+      struct_for_func = llvm::cast<llvm::Function>(
+          module
+              ->getOrInsertFunction(
+                  tlctx->get_struct_for_func_name(stmt->tls_size),
+                  struct_for_func->getFunctionType(),
+                  struct_for_func->getAttributes())
+              .getCallee());
+      struct_for_tls_sizes.insert(stmt->tls_size);
+    }
+    // Loop over nodes in the element list, in parallel
+    call(struct_for_func, get_context(), tlctx->get_constant(leaf_block->id),
+         tlctx->get_constant(list_element_size),
+         tlctx->get_constant(num_splits), body,
+         tlctx->get_constant(stmt->tls_size),
+         tlctx->get_constant(stmt->num_cpu_threads));
+    // TODO: why do we need num_cpu_threads on GPUs?
+  }
 
   current_coordinates = nullptr;
   parent_coordinates = nullptr;
@@ -2984,7 +3096,7 @@ LLVMCompiledTask LLVMCompiledTask::clone() const {
 }
 
 LLVMCompiledKernel LLVMCompiledKernel::clone() const {
-  return {tasks, llvm::CloneModule(*module)};
+  return {tasks, module ? llvm::CloneModule(*module) : nullptr};
 }
 
 }  // namespace taichi::lang
@@ -312,6 +312,10 @@ class TaskCodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
 
   void visit(GlobalLoadStmt *stmt) override;
 
+  void visit(VectorLoadStmt *stmt) override;
+
+  void visit(VectorStoreStmt *stmt) override;
+
   void visit(GetRootStmt *stmt) override;
 
   void visit(LinearizeStmt *stmt) override;
@@ -336,6 +340,12 @@ class TaskCodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
     return false;  // on CPU devices just pass in a pointer
   }
 
+  // Whether struct-fors are parallelized by the thread pool of the host
+  // runtime (see cpu_parallel_struct_for) instead of by SPMD threads.
+  virtual bool struct_for_uses_host_thread_pool() const {
+    return arch_is_cpu(current_arch());
+  }
+
   std::string init_offloaded_task_function(OffloadedStmt *stmt,
                                            std::string suffix = "");
 
@@ -14,6 +14,8 @@ KernelCompiler::KernelCompiler(Config config) : config_(std::move(config)) {
 KernelCompiler::IRNodePtr KernelCompiler::compile(
     const CompileConfig &compile_config,
     const Kernel &kernel_def) const {
+  // The returned IR keeps the arena alive until it is deleted
+  IRArenaScope arena_scope(compile_config.ir_arena);
   auto ir = irpass::analysis::clone(kernel_def.ir.get());
   bool verbose = compile_config.print_ir;
   if (kernel_def.is_accessor && !compile_config.print_accessor_ir) {
@@ -23,6 +23,10 @@ class KernelCompiler : public lang::KernelCompiler {
                  const Kernel &kernel_def,
                  IRNode &chi_ir) const override;
 
+  bool supports_concurrent_compilation() const override {
+    return true;
+  }
+
  private:
   Config config_;
 };
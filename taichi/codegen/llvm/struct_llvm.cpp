@@ -106,6 +106,13 @@ void StructCompilerLLVM::generate_types(SNode &snode) {
                                     snode.max_num_elements());
     body_type = llvm::ArrayType::get(llvm::PointerType::getInt8PtrTy(*ctx),
                                      snode.max_num_elements());
+  } else if (type == SNodeType::hash) {
+    // keys and mutexes of the table slots and the number of tombstones, see
+    // node_hash.h
+    aux_type = llvm::ArrayType::get(llvm::PointerType::getInt32Ty(*ctx),
+                                    2 * snode.chunk_size + 2);
+    body_type = llvm::ArrayType::get(llvm::PointerType::getInt8PtrTy(*ctx),
+                                     snode.chunk_size);
   } else if (type == SNodeType::dynamic) {
     // mutex and n (number of elements)
     aux_type =
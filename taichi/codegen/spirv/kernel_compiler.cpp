@@ -13,6 +13,8 @@ KernelCompiler::KernelCompiler(Config config) : config_(std::move(config)) {
 KernelCompiler::IRNodePtr KernelCompiler::compile(
     const CompileConfig &compile_config,
     const Kernel &kernel_def) const {
+  // The returned IR keeps the arena alive until it is deleted
+  IRArenaScope arena_scope(compile_config.ir_arena);
   auto ir = irpass::analysis::clone(kernel_def.ir.get());
   irpass::compile_to_executable(ir.get(), compile_config, &kernel_def,
                                 kernel_def.autodiff_mode,
@@ -36,6 +38,7 @@ KernelCompiler::CKDPtr KernelCompiler::compile(
   params.arch = compile_config.arch;
   params.caps = device_caps;
   params.enable_spv_opt = compile_config.external_optimization_level > 0;
+  params.num_compile_threads = compile_config.num_compile_threads;
   spirv::KernelCodegen codegen(params);
   spirv::CompiledKernelData::InternalData internal_data;
   codegen.run(internal_data.metadata.kernel_attribs,
@@ -1,5 +1,6 @@
 #include "taichi/codegen/spirv/spirv_codegen.h"
 
+#include <exception>
 #include <string>
 #include <vector>
 #include <variant>
@@ -7,6 +8,7 @@
 #include "taichi/codegen/codegen_utils.h"
 #include "taichi/program/program.h"
 #include "taichi/program/kernel.h"
+#include "taichi/program/parallel_executor.h"
 #include "taichi/ir/statements.h"
 #include "taichi/ir/ir.h"
 #include "taichi/util/line_appender.h"
@@ -14,6 +16,7 @@
 #include "taichi/codegen/spirv/spirv_ir_builder.h"
 #include "taichi/ir/transforms.h"
 #include "taichi/math/arithmetic.h"
+#include "taichi/system/timer.h"
 
 #include <spirv-tools/libspirv.hpp>
 #include <spirv-tools/optimizer.hpp>
@@ -2658,6 +2661,22 @@ static void spriv_message_consumer(spv_message_level_t level,
   }
 }
 
+double KernelCodegen::Stats::codegen_ms() const {
+  double total = 0;
+  for (const auto &task : tasks) {
+    total += task.codegen_ms;
+  }
+  return total;
+}
+
+double KernelCodegen::Stats::spirv_opt_ms() const {
+  double total = 0;
+  for (const auto &task : tasks) {
+    total += task.spirv_opt_ms;
+  }
+  return total;
+}
+
 KernelCodegen::KernelCodegen(const Params &params)
     : params_(params), ctx_attribs_(*params.kernel, &params.caps) {
   TI_ASSERT(params.kernel);
@@ -2665,24 +2684,28 @@ KernelCodegen::KernelCodegen(const Params &params)
 
   uint32_t spirv_version = params.caps.get(DeviceCapability::spirv_version);
 
-  spv_target_env target_env;
   if (spirv_version >= 0x10600) {
-    target_env = SPV_ENV_VULKAN_1_3;
+    target_env_ = SPV_ENV_VULKAN_1_3;
   } else if (spirv_version >= 0x10500) {
-    target_env = SPV_ENV_VULKAN_1_2;
+    target_env_ = SPV_ENV_VULKAN_1_2;
   } else if (spirv_version >= 0x10400) {
-    target_env = SPV_ENV_VULKAN_1_1_SPIRV_1_4;
+    target_env_ = SPV_ENV_VULKAN_1_1_SPIRV_1_4;
   } else if (spirv_version >= 0x10300) {
-    target_env = SPV_ENV_VULKAN_1_1;
+    target_env_ = SPV_ENV_VULKAN_1_1;
   } else {
-    target_env = SPV_ENV_VULKAN_1_0;
+    target_env_ = SPV_ENV_VULKAN_1_0;
   }
 
-  spirv_opt_ = std::make_unique<spvtools::Optimizer>(target_env);
-  spirv_opt_->SetMessageConsumer(spriv_message_consumer);
-  if (params.enable_spv_opt) {
+  spirv_opt_options_.set_run_validator(false);
+}
+
+std::unique_ptr<spvtools::Optimizer> KernelCodegen::create_spirv_optimizer()
+    const {
+  auto spirv_opt = std::make_unique<spvtools::Optimizer>(target_env_);
+  spirv_opt->SetMessageConsumer(spriv_message_consumer);
+  if (params_.enable_spv_opt) {
     // From: SPIRV-Tools/source/opt/optimizer.cpp
-    spirv_opt_->RegisterPass(spvtools::CreateWrapOpKillPass())
+    spirv_opt->RegisterPass(spvtools::CreateWrapOpKillPass())
         .RegisterPass(spvtools::CreateDeadBranchElimPass())
         .RegisterPass(spvtools::CreateMergeReturnPass())
         .RegisterPass(spvtools::CreateInlineExhaustivePass())
@@ -2707,27 +2730,85 @@ KernelCodegen::KernelCodegen(const Params &params)
         .RegisterPass(spvtools::CreateReduceLoadSizePass())
         .RegisterPass(spvtools::CreateBlockMergePass());
   }
-  spirv_opt_options_.set_run_validator(false);
-
-  spirv_tools_ = std::make_unique<spvtools::SpirvTools>(target_env);
+  return spirv_opt;
 }
 
 void KernelCodegen::run(TaichiKernelAttributes &kernel_attribs,
                         std::vector<std::vector<uint32_t>> &generated_spirv) {
   auto *root = params_.ir_root->as<Block>();
   auto &tasks = root->statements;
-  for (int i = 0; i < tasks.size(); ++i) {
-    TaskCodegen::Params tp;
-    tp.task_ir = tasks[i]->as<OffloadedStmt>();
-    tp.task_id_in_kernel = i;
-    tp.compiled_structs = params_.compiled_structs;
-    tp.ctx_attribs = &ctx_attribs_;
-    tp.ti_kernel_name = fmt::format("{}_{}", params_.ti_kernel_name, i);
-    tp.arch = params_.arch;
-    tp.caps = &params_.caps;
-
-    TaskCodegen cgen(tp);
-    auto task_res = cgen.run();
+  const int num_tasks = tasks.size();
+  const double start_time = Time::get_time();
+
+  // Each task is generated and optimized on its own: the task IR and the
+  // kernel context attributes are only read, so tasks can be compiled in any
+  // order. The results are collected by task index, which keeps the output
+  // identical to a serial run.
+  struct TaskResult {
+    TaskCodegen::Result codegen;
+    std::vector<uint32_t> optimized_spv;
+    bool opt_success{true};
+    TaskStats stats;
+    std::exception_ptr error;
+  };
+  std::vector<TaskResult> results(num_tasks);
+
+  auto compile_task = [&](int i) {
+    auto &result = results[i];
+    try {
+      TaskCodegen::Params tp;
+      tp.task_ir = tasks[i]->as<OffloadedStmt>();
+      tp.task_id_in_kernel = i;
+      tp.compiled_structs = params_.compiled_structs;
+      tp.ctx_attribs = &ctx_attribs_;
+      tp.ti_kernel_name = fmt::format("{}_{}", params_.ti_kernel_name, i);
+      tp.arch = params_.arch;
+      tp.caps = &params_.caps;
+      result.stats.name = tp.ti_kernel_name;
+
+      double t = Time::get_time();
+      TaskCodegen cgen(tp);
+      result.codegen = cgen.run();
+      result.stats.codegen_ms = (Time::get_time() - t) * 1000;
+
+      t = Time::get_time();
+      auto spirv_opt = create_spirv_optimizer();
+      result.optimized_spv = result.codegen.spirv_code;
+      auto &spv = result.optimized_spv;
+      result.opt_success =
+          spirv_opt->Run(spv.data(), spv.size(), &spv, spirv_opt_options_);
+      TI_WARN_IF(!result.opt_success, "SPIRV optimization failed");
+      result.stats.spirv_opt_ms = (Time::get_time() - t) * 1000;
+      result.stats.size_before_opt = result.codegen.spirv_code.size();
+      result.stats.size_after_opt = spv.size();
+    } catch (...) {
+      result.error = std::current_exception();
+    }
+  };
+
+  const int num_threads =
+      std::max(1, std::min(params_.num_compile_threads, num_tasks));
+  if (num_threads <= 1) {
+    for (int i = 0; i < num_tasks; ++i) {
+      compile_task(i);
+    }
+  } else {
+    ParallelExecutor workers("spirv_codegen", num_threads);
+    for (int i = 0; i < num_tasks; ++i) {
+      workers.enqueue([&compile_task, i] { compile_task(i); });
+    }
+    workers.flush();
+  }
+
+  stats_ = Stats();
+  stats_.num_threads = num_threads;
+  for (int i = 0; i < num_tasks; ++i) {
+    auto &result = results[i];
+    // Report the error of the first failing task, as a serial run would
+    if (result.error) {
+      std::rethrow_exception(result.error);
+    }
+    auto &task_res = result.codegen;
 
     for (auto &[id, access] : task_res.arr_access) {
       for (auto &arr_access_element : ctx_attribs_.arr_access) {
@@ -2737,31 +2818,21 @@ void KernelCodegen::run(TaichiKernelAttributes &kernel_attribs,
       }
     }
 
-    std::vector<uint32_t> optimized_spv(task_res.spirv_code);
-
-    bool success = true;
-    {
-      bool result = false;
-      TI_WARN_IF(
-          (result = !spirv_opt_->Run(optimized_spv.data(), optimized_spv.size(),
-                                     &optimized_spv, spirv_opt_options_)),
-          "SPIRV optimization failed");
-      if (result) {
-        success = false;
-      }
-    }
-
-    TI_TRACE("SPIRV-Tools-opt: binary size, before={}, after={}",
-             task_res.spirv_code.size(), optimized_spv.size());
+    TI_TRACE(
+        "SPIRV-Tools-opt: {} binary size, before={}, after={}, codegen={:.2f} "
+        "ms, spirv-opt={:.2f} ms",
+        result.stats.name, result.stats.size_before_opt,
+        result.stats.size_after_opt, result.stats.codegen_ms,
+        result.stats.spirv_opt_ms);
 
     // Enable to dump SPIR-V assembly of kernels
     if constexpr (false) {
       std::vector<uint32_t> &spirv =
-          success ? optimized_spv : task_res.spirv_code;
+          result.opt_success ? result.optimized_spv : task_res.spirv_code;
 
       std::string spirv_asm;
-      spirv_tools_->Disassemble(optimized_spv, &spirv_asm);
-      auto kernel_name = tp.ti_kernel_name;
+      spvtools::SpirvTools(target_env_).Disassemble(spirv, &spirv_asm);
+      auto kernel_name = result.stats.name;
       TI_WARN("SPIR-V Assembly dump for {} :\n{}\n\n", kernel_name, spirv_asm);
 
       std::ofstream fout(kernel_name + ".spv",
@@ -2772,10 +2843,18 @@ void KernelCodegen::run(TaichiKernelAttributes &kernel_attribs,
     }
 
     kernel_attribs.tasks_attribs.push_back(std::move(task_res.task_attribs));
-    generated_spirv.push_back(std::move(optimized_spv));
+    generated_spirv.push_back(std::move(result.optimized_spv));
+    stats_.tasks.push_back(std::move(result.stats));
   }
   kernel_attribs.ctx_attribs = std::move(ctx_attribs_);
   kernel_attribs.name = params_.ti_kernel_name;
+
+  stats_.wall_ms = (Time::get_time() - start_time) * 1000;
+  TI_DEBUG(
+      "SPIR-V codegen for {}: {} tasks on {} threads in {:.2f} ms (codegen "
+      "{:.2f} ms, spirv-opt {:.2f} ms)",
+      params_.ti_kernel_name, num_tasks, num_threads, stats_.wall_ms,
+      stats_.codegen_ms(), stats_.spirv_opt_ms());
 }
 
 }  // namespace spirv
@@ -24,6 +24,27 @@ class KernelCodegen {
     Arch arch;
     DeviceCapabilityConfig caps;
     bool enable_spv_opt{true};
+    // The offloaded tasks are generated and optimized on up to this many
+    // threads. The output does not depend on it.
+    int num_compile_threads{1};
+  };
+
+  // Compile-time statistics of the last run()
+  struct TaskStats {
+    std::string name;
+    double codegen_ms{0};
+    double spirv_opt_ms{0};
+    // Sizes of the SPIR-V binary, in words
+    std::size_t size_before_opt{0};
+    std::size_t size_after_opt{0};
+  };
+  struct Stats {
+    std::vector<TaskStats> tasks;
+    int num_threads{1};
+    double wall_ms{0};
+
+    double codegen_ms() const;
+    double spirv_opt_ms() const;
   };
 
   explicit KernelCodegen(const Params &params);
@@ -31,13 +52,21 @@ class KernelCodegen {
   void run(TaichiKernelAttributes &kernel_attribs,
            std::vector<std::vector<uint32_t>> &generated_spirv);
 
+  const Stats &get_stats() const {
+    return stats_;
+  }
+
  private:
+  // spvtools::Optimizer keeps per-run state in its passes, so each task gets
+  // its own one.
+  std::unique_ptr<spvtools::Optimizer> create_spirv_optimizer() const;
+
   Params params_;
   KernelContextAttributes ctx_attribs_;
+  spv_target_env target_env_;
 
-  std::unique_ptr<spvtools::Optimizer> spirv_opt_{nullptr};
-  std::unique_ptr<spvtools::SpirvTools> spirv_tools_{nullptr};
   spvtools::OptimizerOptions spirv_opt_options_;
+  Stats stats_;
 };
 
 }  // namespace spirv
@@ -2,8 +2,13 @@
 
 #include "taichi/analysis/offline_cache_util.h"
 #include "taichi/codegen/compiled_kernel_data.h"
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/frontend_ir.h"
+#include "taichi/ir/statements.h"
 #include "taichi/util/offline_cache.h"
 
+#include <sstream>
+
 namespace taichi::lang {
 
 namespace offline_cache {
@@ -50,10 +55,30 @@ struct CacheCleanerUtils<CacheData> {
 
 }  // namespace offline_cache
 
+namespace {
+
+bool calls_real_functions(const Kernel &kernel_def) {
+  // Real functions are compiled in place the first time they are called, so
+  // two kernels sharing one must not be compiled at the same time.
+  auto calls = irpass::analysis::gather_statements(
+      kernel_def.ir.get(), [](Stmt *stmt) {
+        return stmt->is<FrontendFuncCallStmt>() || stmt->is<FuncCallStmt>();
+      });
+  return !calls.empty();
+}
+
+}  // namespace
+
 KernelCompilationManager::KernelCompilationManager(Config config)
     : config_(std::move(config)) {
   TI_DEBUG("Create KernelCompilationManager with offline_cache_file_path = {}",
            config_.offline_cache_path);
+  if (config_.use_cache_pack) {
+    // Nothing is read until the first kernel is looked up
+    cache_pack_ = std::make_unique<offline_cache::CachePack>(
+        config_.offline_cache_path, kMetadataLockName);
+    return;
+  }
   auto filepath = join_path(config_.offline_cache_path, kMetadataFilename);
   auto lock_path = join_path(config_.offline_cache_path, kMetadataLockName);
   if (path_exists(filepath)) {
@@ -76,12 +101,69 @@ const CompiledKernelData &KernelCompilationManager::load_or_compile(
   const auto kernel_key = make_kernel_key(compile_config, caps, kernel_def);
   auto cached_kernel = try_load_cached_kernel(kernel_def, kernel_key,
                                               compile_config.arch, cache_mode);
+  if (!cached_kernel) {
+    cached_kernel = try_take_prefetched_kernel(kernel_key);
+  }
   return cached_kernel ? *cached_kernel
                        : compile_and_cache_kernel(kernel_key, compile_config,
                                                   caps, kernel_def);
 }
 
+void KernelCompilationManager::prefetch(
+    const CompileConfig &compile_config,
+    const DeviceCapabilityConfig &caps,
+    const std::vector<const Kernel *> &kernel_defs) {
+  if (config_.num_prefetch_threads <= 0 ||
+      !config_.kernel_compiler->supports_concurrent_compilation()) {
+    return;
+  }
+  if (!prefetch_workers_) {
+    prefetch_workers_ = std::make_unique<ParallelExecutor>(
+        "prefetch", config_.num_prefetch_threads);
+  }
+  // Parallelism comes from compiling several kernels at once; splitting each
+  // of them over the compile threads as well would only oversubscribe.
+  auto config = std::make_shared<CompileConfig>(compile_config);
+  config->num_compile_threads = 1;
+  auto device_caps = std::make_shared<DeviceCapabilityConfig>(caps);
+  for (const auto *kernel_def : kernel_defs) {
+    if (calls_real_functions(*kernel_def)) {
+      continue;
+    }
+    auto cache_mode = get_cache_mode(compile_config, *kernel_def);
+    auto kernel_key = make_kernel_key(compile_config, caps, *kernel_def);
+    if (prefetching_kernels_.count(kernel_key) ||
+        try_load_cached_kernel(*kernel_def, kernel_key, compile_config.arch,
+                               cache_mode)) {
+      continue;
+    }
+    TI_DEBUG("Prefetch kernel '{}' (key='{}')", kernel_def->get_name(),
+             kernel_key);
+    auto task = std::make_shared<
+        std::packaged_task<std::unique_ptr<CompiledKernelData>()>>(
+        [this, config, device_caps, kernel_def] {
+          auto ckd = compile_kernel(*config, *device_caps, *kernel_def);
+          // The compiled module belongs to the LLVM context of this worker
+          // thread; a dump/load round trip moves it into a context owned by
+          // the CompiledKernelData itself.
+          std::stringstream ss;
+          TI_ASSERT(ckd->dump(ss) == CompiledKernelData::Err::kNoError);
+          CompiledKernelData::Err err;
+          auto loaded = CompiledKernelData::load(ss, &err);
+          TI_ASSERT(err == CompiledKernelData::Err::kNoError);
+          return loaded;
+        });
+    prefetching_kernels_[kernel_key] = {cache_mode, task->get_future()};
+    prefetch_workers_->enqueue([task] { (*task)(); });
+  }
+}
+
 void KernelCompilationManager::dump() {
+  finish_prefetching();
+  if (cache_pack_) {
+    dump_to_pack();
+    return;
+  }
   if (caching_kernels_.empty()) {
     return;
   }
@@ -144,10 +226,38 @@ void KernelCompilationManager::dump() {
   }
 }
 
+void KernelCompilationManager::dump_to_pack() {
+  std::vector<offline_cache::CachePack::Record> records;
+  for (const auto &[kernel_key, kernel] : caching_kernels_) {
+    if (kernel.cache_mode != CacheData::MemAndDiskCache) {
+      continue;
+    }
+    std::ostringstream oss;
+    auto err = kernel.compiled_kernel_data->dump(oss);
+    if (err != CompiledKernelData::Err::kNoError) {
+      TI_DEBUG("Dump cached CompiledKernelData(kernel_key={}) failed: {}",
+               kernel_key, CompiledKernelData::get_err_msg(err));
+      continue;
+    }
+    records.push_back({kernel_key, oss.str()});
+  }
+  std::vector<std::string> used_keys;
+  for (const auto *e : updated_data_) {
+    used_keys.push_back(e->kernel_key);
+  }
+  cache_pack_->commit(records, used_keys);
+  caching_kernels_.clear();
+  updated_data_.clear();
+}
+
 void KernelCompilationManager::clean_offline_cache(
     offline_cache::CleanCachePolicy policy,
     int max_bytes,
     double cleaning_factor) const {
+  if (cache_pack_) {
+    cache_pack_->clean(policy, max_bytes, cleaning_factor);
+    return;
+  }
   using CacheCleaner = offline_cache::CacheCleaner<CacheData>;
   offline_cache::CacheCleanerConfig config;
   config.path = config_.offline_cache_path;
@@ -186,8 +296,8 @@ std::string KernelCompilationManager::make_kernel_key(
     if (!kernel_def.ir_is_ast()) {
       kernel_key = kernel_def.get_name();
     } else {  // The kernel key is generated from AST
-      kernel_key = get_hashed_offline_cache_key(compile_config, caps,
-                                                (Kernel *)&kernel_def);
+      kernel_key = key_generator_.get_hashed_key(compile_config, caps,
+                                                 (Kernel *)&kernel_def);
     }
 
     kernel_def.set_kernel_key_for_cache(kernel_key);
@@ -213,6 +323,21 @@ const CompiledKernelData *KernelCompilationManager::try_load_cached_kernel(
   if (cache_mode == CacheData::MemAndDiskCache) {
     auto &kernels = cached_data_.kernels;
     auto iter = kernels.find(kernel_key);
+    if (iter == kernels.end() && cache_pack_) {
+      // The pack has no metadata to load up front; kernels are added to
+      // cached_data_ as they are looked up.
+      auto loaded = load_ckd(kernel_key, arch);
+      if (!loaded) {
+        return nullptr;
+      }
+      TI_ASSERT(loaded->arch() == arch);
+      iter = kernels.emplace(kernel_key, KernelCacheData{}).first;
+      auto &k = iter->second;
+      k.kernel_key = kernel_key;
+      k.last_used_at = std::time(nullptr);
+      k.compiled_kernel_data = std::move(loaded);
+      updated_data_.push_back(&k);
+    }
     if (iter != kernels.end()) {
       auto &k = iter->second;
       if (k.compiled_kernel_data) {
@@ -242,40 +367,91 @@ const CompiledKernelData &KernelCompilationManager::compile_and_cache_kernel(
   TI_DEBUG_IF(cache_mode == CacheData::MemAndDiskCache,
               "Cache kernel '{}' (key='{}')", kernel_def.get_name(),
               kernel_key);
+  return cache_kernel(kernel_key, cache_mode,
+                      compile_kernel(compile_config, caps, kernel_def));
+}
+
+const CompiledKernelData &KernelCompilationManager::cache_kernel(
+    const std::string &kernel_key,
+    CacheData::CacheMode cache_mode,
+    std::unique_ptr<CompiledKernelData> compiled_kernel_data) {
   TI_ASSERT(caching_kernels_.find(kernel_key) == caching_kernels_.end());
   KernelCacheData k;
   k.kernel_key = kernel_key;
   k.created_at = k.last_used_at = std::time(nullptr);
-  k.compiled_kernel_data = compile_kernel(compile_config, caps, kernel_def);
+  k.compiled_kernel_data = std::move(compiled_kernel_data);
   k.size = 0;  // Populate `size` within the KernelCompilationManager::dump()
   k.cache_mode = cache_mode;
   const auto &kernel_data = (caching_kernels_[kernel_key] = std::move(k));
   return *kernel_data.compiled_kernel_data;
 }
 
+const CompiledKernelData *KernelCompilationManager::try_take_prefetched_kernel(
+    const std::string &kernel_key) {
+  auto iter = prefetching_kernels_.find(kernel_key);
+  if (iter == prefetching_kernels_.end()) {
+    return nullptr;
+  }
+  auto prefetching = std::move(iter->second);
+  // Erased before waiting, so that a kernel failing to compile is compiled
+  // (and reports its error) again on the next launch.
+  prefetching_kernels_.erase(iter);
+  auto ckd = prefetching.compiled_kernel_data.get();
+  return &cache_kernel(kernel_key, prefetching.cache_mode, std::move(ckd));
+}
+
+void KernelCompilationManager::finish_prefetching() {
+  while (!prefetching_kernels_.empty()) {
+    const auto kernel_key = prefetching_kernels_.begin()->first;
+    try {
+      try_take_prefetched_kernel(kernel_key);
+    } catch (const std::exception &e) {
+      // Never launched, so nobody is waiting for this error.
+      TI_DEBUG("Prefetching kernel (key='{}') failed: {}", kernel_key,
+               e.what());
+    }
+  }
+}
+
 std::unique_ptr<CompiledKernelData> KernelCompilationManager::load_ckd(
     const std::string &kernel_key,
     Arch arch) {
+  if (cache_pack_) {
+    auto payload = cache_pack_->find(kernel_key);
+    if (!payload) {
+      return nullptr;
+    }
+    std::istringstream iss{std::string(*payload)};
+    return load_ckd(iss, fmt::format("{} (key={})",
+                                     offline_cache::CachePack::kPackFilename,
+                                     kernel_key));
+  }
   const auto filename = make_filename(kernel_key);
   if (std::ifstream ifs(filename, std::ios::in | std::ios::binary);
       ifs.is_open()) {
-    CompiledKernelData::Err err;
-    auto ckd = CompiledKernelData::load(ifs, &err);
-    if (err != CompiledKernelData::Err::kNoError) {
-      TI_DEBUG("Load cache file {} failed: {}", filename,
-               CompiledKernelData::get_err_msg(err));
-      return nullptr;
-    }
-    if (auto err = ckd->check(); err != CompiledKernelData::Err::kNoError) {
-      TI_DEBUG("Check CompiledKernelData loaded from {} failed: {}", filename,
-               CompiledKernelData::get_err_msg(err));
-      return nullptr;
-    }
-    return ckd;
+    return load_ckd(ifs, filename);
   }
   return nullptr;
 }
 
+std::unique_ptr<CompiledKernelData> KernelCompilationManager::load_ckd(
+    std::istream &is,
+    const std::string &source) {
+  CompiledKernelData::Err err;
+  auto ckd = CompiledKernelData::load(is, &err);
+  if (err != CompiledKernelData::Err::kNoError) {
+    TI_DEBUG("Load cache file {} failed: {}", source,
+             CompiledKernelData::get_err_msg(err));
+    return nullptr;
+  }
+  if (auto err = ckd->check(); err != CompiledKernelData::Err::kNoError) {
+    TI_DEBUG("Check CompiledKernelData loaded from {} failed: {}", source,
+             CompiledKernelData::get_err_msg(err));
+    return nullptr;
+  }
+  return ckd;
+}
+
 CacheData::CacheMode KernelCompilationManager::get_cache_mode(
     const CompileConfig &compile_config,
     const Kernel &kernel_def) {
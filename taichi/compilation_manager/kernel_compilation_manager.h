@@ -1,13 +1,17 @@
 #pragma once
 
 #include <ctime>
+#include <future>
 #include <string>
 #include <memory>
 #include <unordered_map>
 
+#include "taichi/analysis/offline_cache_util.h"
 #include "taichi/util/offline_cache.h"
+#include "taichi/util/offline_cache_pack.h"
 #include "taichi/codegen/kernel_compiler.h"
 #include "taichi/codegen/compiled_kernel_data.h"
+#include "taichi/program/parallel_executor.h"
 
 namespace taichi::lang {
 
@@ -54,16 +58,29 @@ class KernelCompilationManager final {
   struct Config {
     std::string offline_cache_path;
     std::unique_ptr<KernelCompiler> kernel_compiler;
+    // Store the cache in a single pack (see offline_cache::CachePack) instead
+    // of one file per kernel plus a metadata file
+    bool use_cache_pack{false};
+    // Number of threads compiling prefetched kernels (0 disables prefetching)
+    int num_prefetch_threads{0};
   };
 
   explicit KernelCompilationManager(Config init_params);
 
+  // Start compiling the given kernels in the background, one kernel per
+  // thread. A later load_or_compile() of one of them only waits for that
+  // kernel. Kernels that are cached, already prefetching, or that the kernel
+  // compiler cannot build concurrently are left to load_or_compile().
+  void prefetch(const CompileConfig &compile_config,
+                const DeviceCapabilityConfig &caps,
+                const std::vector<const Kernel *> &kernel_defs);
+
   // Load from memory || Load from disk || (Compile && Cache in memory)
   const CompiledKernelData &load_or_compile(const CompileConfig &compile_config,
                                             const DeviceCapabilityConfig &caps,
                                             const Kernel &kernel_def);
 
-  // Dump the cached data in memory to disk
+  // Dump the cached data in memory to disk (waits for pending prefetches)
   void dump();
 
   // Run offline cache cleaning
@@ -95,9 +112,27 @@ class KernelCompilationManager final {
       const DeviceCapabilityConfig &caps,
       const Kernel &kernel_def);
 
+  const CompiledKernelData &cache_kernel(
+      const std::string &kernel_key,
+      CacheData::CacheMode cache_mode,
+      std::unique_ptr<CompiledKernelData> compiled_kernel_data);
+
+  // Waits for the prefetched kernel and moves it into caching_kernels_.
+  // Rethrows the compilation error, if any.
+  const CompiledKernelData *try_take_prefetched_kernel(
+      const std::string &kernel_key);
+
+  void finish_prefetching();
+
   std::unique_ptr<CompiledKernelData> load_ckd(const std::string &kernel_key,
                                                Arch arch);
 
+  static std::unique_ptr<CompiledKernelData> load_ckd(
+      std::istream &is,
+      const std::string &source);
+
+  void dump_to_pack();
+
   static CacheData::CacheMode get_cache_mode(
       const CompileConfig &compile_config,
       const Kernel &kernel_def);
@@ -106,6 +141,17 @@ class KernelCompilationManager final {
   CachingKernels caching_kernels_;
   CacheData cached_data_;
   std::vector<KernelCacheData *> updated_data_;
+  std::unique_ptr<offline_cache::CachePack> cache_pack_;
+  mutable OfflineCacheKeyGenerator key_generator_;
+
+  struct PrefetchingKernel {
+    CacheData::CacheMode cache_mode{CacheData::MemCache};
+    std::future<std::unique_ptr<CompiledKernelData>> compiled_kernel_data;
+  };
+  std::unordered_map<std::string, PrefetchingKernel> prefetching_kernels_;
+  // Declared last so that the workers are joined before anything they use
+  // goes away.
+  std::unique_ptr<ParallelExecutor> prefetch_workers_;
 };
 
 }  // namespace taichi::lang
@@ -12,8 +12,10 @@ PER_INTERNAL_OP(test_stack)
 PER_INTERNAL_OP(test_active_mask)
 PER_INTERNAL_OP(test_shfl)
 PER_INTERNAL_OP(test_list_manager)
+PER_INTERNAL_OP(test_runtime_object_allocator)
 PER_INTERNAL_OP(test_node_allocator)
 PER_INTERNAL_OP(test_node_allocator_gc_cpu)
+PER_INTERNAL_OP(test_node_allocator_gc_parallel_cpu)
 PER_INTERNAL_OP(do_nothing)
 PER_INTERNAL_OP(refresh_counter)
 PER_INTERNAL_OP(test_internal_func_args)
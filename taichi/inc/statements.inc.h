@@ -31,6 +31,8 @@ PER_STATEMENT(PrintStmt)
 PER_STATEMENT(RandStmt)
 PER_STATEMENT(GlobalLoadStmt)
 PER_STATEMENT(GlobalStoreStmt)
+PER_STATEMENT(VectorLoadStmt)
+PER_STATEMENT(VectorStoreStmt)
 PER_STATEMENT(AtomicOpStmt)
 PER_STATEMENT(LocalStoreStmt)
 PER_STATEMENT(SNodeOpStmt)
@@ -641,8 +641,8 @@ void InternalFuncCallExpression::flatten(FlattenContext *ctx) {
 }
 
 void ExternalTensorExpression::flatten(FlattenContext *ctx) {
-  auto type =
-      TypeFactory::get_instance().get_ndarray_struct_type(dt, ndim, needs_grad);
+  auto type = TypeFactory::get_instance().get_ndarray_struct_type(
+      dt, ndim, needs_grad, strided);
   type = TypeFactory::get_instance().get_pointer_type((Type *)type);
 
   auto ptr = Stmt::make<ArgLoadStmt>(
@@ -532,20 +532,24 @@ class ExternalTensorExpression : public Expression {
   bool is_grad{false};
   int arg_depth{0};
   BoundaryMode boundary{BoundaryMode::kUnsafe};
+  // Whether the ndarray is passed with the strides of its dimensions, e.g.
+  // when it aliases a strided tensor imported through DLPack
+  bool strided{false};
 
   ExternalTensorExpression(const DataType &dt,
                            int ndim,
                            const std::vector<int> &arg_id,
                            bool needs_grad = false,
                            int arg_depth = false,
-                           BoundaryMode boundary = BoundaryMode::kUnsafe) {
-    init(dt, ndim, arg_id, needs_grad, arg_depth, boundary);
+                           BoundaryMode boundary = BoundaryMode::kUnsafe,
+                           bool strided = false) {
+    init(dt, ndim, arg_id, needs_grad, arg_depth, boundary, strided);
   }
 
   explicit ExternalTensorExpression(Expr *expr) : is_grad(true) {
     auto ptr = expr->cast<ExternalTensorExpression>();
     init(ptr->dt, ptr->ndim, ptr->arg_id, ptr->needs_grad, ptr->arg_depth,
-         ptr->boundary);
+         ptr->boundary, ptr->strided);
   }
 
   void flatten(FlattenContext *ctx) override;
@@ -558,8 +562,8 @@ class ExternalTensorExpression : public Expression {
   }
 
   void type_check(const CompileConfig *config) override {
-    ret_type = TypeFactory::get_instance().get_ndarray_struct_type(dt, ndim,
-                                                                   needs_grad);
+    ret_type = TypeFactory::get_instance().get_ndarray_struct_type(
+        dt, ndim, needs_grad, strided);
     ret_type.set_is_pointer(true);
     config_ = config;
   }
@@ -572,13 +576,15 @@ class ExternalTensorExpression : public Expression {
             const std::vector<int> &arg_id,
             bool needs_grad,
             int arg_depth,
-            BoundaryMode boundary) {
+            BoundaryMode boundary,
+            bool strided) {
     this->dt = dt;
     this->ndim = ndim;
     this->arg_id = arg_id;
     this->needs_grad = needs_grad;
     this->arg_depth = arg_depth;
     this->boundary = boundary;
+    this->strided = strided;
   }
 };
 
@@ -11,6 +11,7 @@
 #include "taichi/common/core.h"
 #include "taichi/common/exceptions.h"
 #include "taichi/common/one_or_more.h"
+#include "taichi/ir/ir_arena.h"
 #include "taichi/ir/snode.h"
 #include "taichi/ir/mesh.h"
 #include "taichi/ir/type_factory.h"
@@ -26,6 +27,7 @@ namespace taichi::lang {
 class IRNode;
 class Block;
 class Stmt;
+class StmtField;
 using pStmt = std::unique_ptr<Stmt>;
 
 class SNode;
@@ -107,9 +109,15 @@ class Identifier {
 #ifdef TI_WITH_LLVM
 using stmt_vector = llvm::SmallVector<pStmt, 8>;
 using stmt_ref_vector = llvm::SmallVector<Stmt *, 2>;
+// Most statements have at most 4 operands and fields, so these do not need a
+// heap allocation of their own
+using operand_vector = llvm::SmallVector<Stmt **, 4>;
+using stmt_field_vector = llvm::SmallVector<std::unique_ptr<StmtField>, 4>;
 #else
 using stmt_vector = std::vector<pStmt>;
 using stmt_ref_vector = std::vector<Stmt *>;
+using operand_vector = std::vector<Stmt **>;
+using stmt_field_vector = std::vector<std::unique_ptr<StmtField>>;
 #endif
 
 class VecStatement {
@@ -224,7 +232,7 @@ class Load {
 
 }  // namespace ir_traits
 
-class IRNode {
+class IRNode : public IRArenaAllocated {
  public:
   virtual void accept(IRVisitor *visitor) {
     TI_NOT_IMPLEMENTED
@@ -287,7 +295,7 @@ class IRNode {
   TI_DEFINE_ACCEPT                 \
   TI_DEFINE_CLONE
 
-class StmtField {
+class StmtField : public IRArenaAllocated {
  public:
   StmtField() = default;
 
@@ -359,7 +367,7 @@ class StmtFieldManager {
   Stmt *stmt_;
 
  public:
-  std::vector<std::unique_ptr<StmtField>> fields;
+  stmt_field_vector fields;
 
   explicit StmtFieldManager(Stmt *stmt) : stmt_(stmt) {
   }
@@ -392,7 +400,7 @@ class StmtFieldManager {
 
 class Stmt : public IRNode {
  protected:
-  std::vector<Stmt **> operands;
+  operand_vector operands;
   explicit Stmt(const DebugInfo &dbg_info);
 
  public:
@@ -0,0 +1,108 @@
+#include "taichi/ir/ir_arena.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+#include "taichi/common/logging.h"
+
+namespace taichi::lang {
+
+namespace {
+
+thread_local IRArena *current_arena = nullptr;
+
+// Every allocation starts with a header pointing to its arena, or null for
+// the heap. It is as large as the alignment of the allocations so that the
+// objects that follow stay aligned.
+constexpr std::size_t kAlignment = alignof(std::max_align_t);
+constexpr std::size_t kHeaderSize = kAlignment;
+static_assert(sizeof(IRArena *) <= kHeaderSize);
+
+std::size_t align_up(std::size_t size) {
+  return (size + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+}  // namespace
+
+IRArena::~IRArena() {
+  for (char *chunk : chunks_) {
+    std::free(chunk);
+  }
+}
+
+void *IRArena::allocate(std::size_t size) {
+  IRArena *arena = current_arena;
+  char *block;
+  if (arena) {
+    block = (char *)arena->allocate_from_chunks(kHeaderSize + align_up(size));
+    arena->refs_.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    block = (char *)::operator new(kHeaderSize + size);
+  }
+  *(IRArena **)block = arena;
+  return block + kHeaderSize;
+}
+
+void IRArena::deallocate(void *ptr) {
+  if (!ptr) {
+    return;
+  }
+  char *block = (char *)ptr - kHeaderSize;
+  IRArena *arena = *(IRArena **)block;
+  if (arena) {
+    arena->unref();
+  } else {
+    ::operator delete(block);
+  }
+}
+
+IRArena *IRArena::current() {
+  return current_arena;
+}
+
+void *IRArena::allocate_from_chunks(std::size_t size) {
+  bytes_allocated_ += size;
+  if (size > (std::size_t)(end_ - cursor_)) {
+    if (size > next_chunk_size_ / 4) {
+      // Too large to waste the rest of a chunk on: give it its own one
+      auto *chunk = (char *)std::malloc(size);
+      TI_ERROR_IF(!chunk, "Out of memory allocating {} bytes of IR", size);
+      chunks_.push_back(chunk);
+      return chunk;
+    }
+    cursor_ = (char *)std::malloc(next_chunk_size_);
+    TI_ERROR_IF(!cursor_, "Out of memory allocating {} bytes of IR",
+                next_chunk_size_);
+    chunks_.push_back(cursor_);
+    end_ = cursor_ + next_chunk_size_;
+    next_chunk_size_ = std::min(next_chunk_size_ * 2, kMaxChunkSize);
+  }
+  char *result = cursor_;
+  cursor_ += size;
+  return result;
+}
+
+void IRArena::unref() {
+  if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete this;
+  }
+}
+
+IRArenaScope::IRArenaScope(bool enabled) {
+  if (enabled) {
+    arena_ = new IRArena();
+  }
+  previous_ = current_arena;
+  current_arena = arena_;
+}
+
+IRArenaScope::~IRArenaScope() {
+  TI_ASSERT(current_arena == arena_);
+  current_arena = previous_;
+  if (arena_) {
+    arena_->unref();
+  }
+}
+
+}  // namespace taichi::lang
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace taichi::lang {
+
+// A bump allocator for the IR nodes of one compilation.
+//
+// While an IRArenaScope is active on a thread, the statements, blocks and
+// statement fields created on that thread are carved out of the arena of the
+// scope instead of being malloc'ed one by one. Deleting one of them runs its
+// destructor but does not free its memory: all of it goes away at once when
+// the scope is over and the last node allocated from the arena is deleted.
+// Nodes may thus outlive their scope (e.g. the IR returned by
+// KernelCompiler::compile) and be deleted from any thread.
+//
+// Nodes created outside of any scope are allocated on the heap as before, and
+// both kinds can be mixed freely in one IR.
+class IRArena {
+ public:
+  IRArena(const IRArena &) = delete;
+  IRArena &operator=(const IRArena &) = delete;
+
+  // Allocates |size| bytes from the arena of the current scope, or from the
+  // heap outside of any scope. The memory is aligned for any object.
+  static void *allocate(std::size_t size);
+
+  // Releases memory returned by allocate()
+  static void deallocate(void *ptr);
+
+  // The arena of the innermost scope active on this thread, if any
+  static IRArena *current();
+
+  // The number of bytes handed out so far, headers included
+  std::size_t bytes_allocated() const {
+    return bytes_allocated_;
+  }
+
+  // The number of allocations not deallocated yet, while the scope is active
+  std::size_t num_live_allocations() const {
+    return refs_.load(std::memory_order_relaxed) - 1;
+  }
+
+ private:
+  friend class IRArenaScope;
+
+  IRArena() = default;
+  ~IRArena();
+
+  void *allocate_from_chunks(std::size_t size);
+  // Drops one reference: the scope holds one, and every live allocation holds
+  // one. The arena deletes itself when the count reaches zero.
+  void unref();
+
+  std::vector<char *> chunks_;
+  char *cursor_{nullptr};
+  char *end_{nullptr};
+  std::size_t next_chunk_size_{kMinChunkSize};
+  std::size_t bytes_allocated_{0};
+  std::atomic<std::size_t> refs_{1};
+
+  static constexpr std::size_t kMinChunkSize = 64 << 10;
+  static constexpr std::size_t kMaxChunkSize = 4 << 20;
+};
+
+// Makes the IR nodes created on this thread come from a new IRArena until the
+// scope is destroyed. Scopes nest. Within a disabled scope, nodes are
+// allocated on the heap again, e.g. for IR that outlives the compilation.
+class IRArenaScope {
+ public:
+  explicit IRArenaScope(bool enabled = true);
+  ~IRArenaScope();
+
+  IRArenaScope(const IRArenaScope &) = delete;
+  IRArenaScope &operator=(const IRArenaScope &) = delete;
+
+  // Null if the scope is disabled
+  IRArena *arena() const {
+    return arena_;
+  }
+
+ private:
+  IRArena *arena_{nullptr};
+  IRArena *previous_{nullptr};
+};
+
+// Base of the classes whose instances are allocated through IRArena
+class IRArenaAllocated {
+ public:
+  static void *operator new(std::size_t size) {
+    return IRArena::allocate(size);
+  }
+
+  static void operator delete(void *ptr) {
+    IRArena::deallocate(ptr);
+  }
+};
+
+}  // namespace taichi::lang
@@ -507,8 +507,10 @@ MeshPatchIndexStmt *IRBuilder::get_patch_index() {
 ArgLoadStmt *IRBuilder::create_ndarray_arg_load(const std::vector<int> &arg_id,
                                                 DataType dt,
                                                 int ndim,
-                                                int arg_depth) {
-  auto type = TypeFactory::get_instance().get_ndarray_struct_type(dt, ndim);
+                                                int arg_depth,
+                                                bool strided) {
+  auto type = TypeFactory::get_instance().get_ndarray_struct_type(
+      dt, ndim, /*needs_grad=*/false, strided);
 
   return insert(Stmt::make_typed<ArgLoadStmt>(arg_id, type, /*is_ptr=*/true,
                                               /*create_load=*/false,
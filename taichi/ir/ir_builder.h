@@ -153,7 +153,8 @@ class IRBuilder {
   ArgLoadStmt *create_ndarray_arg_load(const std::vector<int> &arg_id,
                                        DataType dt,
                                        int total_dim,
-                                       int arg_depth);
+                                       int arg_depth,
+                                       bool strided = false);
 
   // The return value of the kernel.
   ReturnStmt *create_return(Stmt *value);
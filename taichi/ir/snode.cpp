@@ -133,6 +133,32 @@ SNode &SNode::dynamic(const Axis &expr,
   return snode;
 }
 
+SNode &SNode::hash(const std::vector<Axis> &axes,
+                   const std::vector<int> &sizes,
+                   int capacity,
+                   const DebugInfo &dbg_info) {
+  // Without a hint, allow up to 64K active cells.
+  constexpr int64 kDefaultHashCapacity = 1 << 16;
+  constexpr int64 kMaxHashCapacity = 1 << 29;
+  if (capacity < 0) {
+    ErrorEmitter(TaichiRuntimeError(), &dbg_info,
+                 fmt::format("Hash SNode capacity must be non-negative, got {}.",
+                             capacity));
+  }
+  auto &snode = create_node(axes, sizes, SNodeType::hash, dbg_info);
+  int64 num_cells = std::min(
+      capacity > 0 ? (int64)capacity : kDefaultHashCapacity,
+      snode.num_cells_per_container);
+  if (num_cells > kMaxHashCapacity) {
+    ErrorEmitter(TaichiRuntimeError(), &dbg_info,
+                 fmt::format("Hash SNode capacity {} exceeds the limit {}.",
+                             num_cells, kMaxHashCapacity));
+  }
+  // Keep the load factor of the open-addressing table at or below 1/2.
+  snode.chunk_size = (int)bit::least_pot_bound(std::size_t(num_cells) * 2);
+  return snode;
+}
+
 SNode &SNode::bit_struct(BitStructType *bit_struct_type,
                          const DebugInfo &dbg_info) {
   auto &snode = create_node({}, {}, SNodeType::bit_struct, dbg_info);
@@ -198,17 +198,24 @@ class SNode {
     return SNode::bitmasked(std::vector<Axis>{axis}, size, dbg_info);
   }
 
+  // |capacity| bounds the number of cells that can be active at the same time.
+  // The hash table itself has |chunk_size| slots. A capacity of zero picks a
+  // default based on the shape.
+  SNode &hash(const std::vector<Axis> &axes,
+              const std::vector<int> &sizes,
+              int capacity,
+              const DebugInfo &dbg_info = DebugInfo());
+
   SNode &hash(const std::vector<Axis> &axes,
               const std::vector<int> &sizes,
               const DebugInfo &dbg_info = DebugInfo()) {
-    return create_node(axes, sizes, SNodeType::hash, dbg_info);
+    return hash(axes, sizes, 0, dbg_info);
   }
 
   SNode &hash(const std::vector<Axis> &axes,
               int sizes,
               const DebugInfo &dbg_info = DebugInfo()) {
-    return create_node(axes, std::vector<int>{sizes}, SNodeType::hash,
-                       dbg_info);
+    return hash(axes, std::vector<int>{sizes}, 0, dbg_info);
   }
 
   SNode &hash(const Axis &axis,
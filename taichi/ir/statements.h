@@ -833,6 +833,76 @@ class GlobalStoreStmt : public Stmt, public ir_traits::Store {
   TI_DEFINE_ACCEPT_AND_CLONE;
 };
 
+/**
+ * Loads a vector (TensorType) value from consecutive global addresses, |src|
+ * being the address of the first lane. Lanes whose |mask| is false are not
+ * accessed. |mask| is a vector of u1, or nullptr if all lanes are active.
+ * Only generated by irpass::vectorize_range_for().
+ */
+class VectorLoadStmt : public Stmt, public ir_traits::Load {
+ public:
+  Stmt *src;
+  Stmt *mask;
+
+  VectorLoadStmt(Stmt *src,
+                 Stmt *mask,
+                 const DebugInfo &dbg_info = DebugInfo())
+      : Stmt(dbg_info), src(src), mask(mask) {
+    TI_STMT_REG_FIELDS;
+  }
+
+  bool has_global_side_effect() const override {
+    return false;
+  }
+
+  bool common_statement_eliminable() const override {
+    return false;
+  }
+
+  // IR Trait: Load
+  stmt_refs get_load_pointers() const override {
+    return src;
+  }
+
+  TI_STMT_DEF_FIELDS(ret_type, src, mask);
+  TI_DEFINE_ACCEPT_AND_CLONE;
+};
+
+/**
+ * Stores a vector (TensorType) value to consecutive global addresses, |dest|
+ * being the address of the first lane. See VectorLoadStmt for |mask|.
+ */
+class VectorStoreStmt : public Stmt, public ir_traits::Store {
+ public:
+  Stmt *dest;
+  Stmt *val;
+  Stmt *mask;
+
+  VectorStoreStmt(Stmt *dest,
+                  Stmt *val,
+                  Stmt *mask,
+                  const DebugInfo &dbg_info = DebugInfo())
+      : Stmt(dbg_info), dest(dest), val(val), mask(mask) {
+    TI_STMT_REG_FIELDS;
+  }
+
+  bool common_statement_eliminable() const override {
+    return false;
+  }
+
+  // IR Trait: Store
+  stmt_refs get_store_destination() const override {
+    return dest;
+  }
+
+  Stmt *get_store_data() const override {
+    return val;
+  }
+
+  TI_STMT_DEF_FIELDS(ret_type, dest, val, mask);
+  TI_DEFINE_ACCEPT_AND_CLONE;
+};
+
 /**
  * A load from a local variable, i.e., an "alloca".
  */
@@ -82,6 +82,7 @@ void make_block_local(IRNode *root,
                       const MakeBlockLocalPass::Args &args);
 void make_cpu_multithreaded_range_for(IRNode *root,
                                       const CompileConfig &config);
+bool vectorize_range_for(IRNode *root, const CompileConfig &config);
 void make_mesh_thread_local(IRNode *root,
                             const CompileConfig &config,
                             const MakeBlockLocalPass::Args &args);
@@ -197,12 +197,20 @@ DataType TypeFactory::create_tensor_type(std::vector<int> shape,
 
 const Type *TypeFactory::get_ndarray_struct_type(DataType dt,
                                                  int ndim,
-                                                 bool needs_grad) {
+                                                 bool needs_grad,
+                                                 bool strided) {
+  TI_ASSERT(!strided || ndim > 0);
   ndim = std::max(1, ndim);  // Avoiding empty struct
   std::vector<AbstractDictionaryMember> shape_members;
   for (int i = 0; i < ndim; i++) {
     shape_members.push_back({PrimitiveType::i32, fmt::format("dim_{}", i)});
   }
+  if (strided) {
+    for (int i = 0; i < ndim; i++) {
+      shape_members.push_back(
+          {PrimitiveType::i32, fmt::format("stride_{}", i)});
+    }
+  }
   auto *shape_type = get_struct_type(shape_members);
   std::vector<AbstractDictionaryMember> members;
   members.push_back({shape_type, "shape"});
@@ -214,6 +222,16 @@ const Type *TypeFactory::get_ndarray_struct_type(DataType dt,
   return get_struct_type(members);
 }
 
+bool TypeFactory::is_strided_ndarray_struct(const Type *type) {
+  auto *shape_type = type->as<StructType>()
+                         ->get_element_type({SHAPE_POS_IN_NDARRAY})
+                         ->as<StructType>();
+  const auto &members = shape_type->elements();
+  return members.size() % 2 == 0 &&
+         members.back().name ==
+             fmt::format("stride_{}", members.size() / 2 - 1);
+}
+
 const Type *TypeFactory::get_rwtexture_struct_type() {
   return get_ndarray_struct_type(PrimitiveType::f32, 3);
 }
@@ -34,9 +34,14 @@ class TypeFactory {
       DataType dt,
       const std::string &layout = "none");
 
+  // When |strided| is set, the shape struct of the ndarray carries the
+  // strides of its dimensions, in scalars, after their sizes.
   const Type *get_ndarray_struct_type(DataType dt,
                                       int ndim,
-                                      bool needs_grad = false);
+                                      bool needs_grad = false,
+                                      bool strided = false);
+
+  static bool is_strided_ndarray_struct(const Type *type);
 
   const Type *get_rwtexture_struct_type();
 
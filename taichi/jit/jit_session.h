@@ -27,6 +27,29 @@ class JITSession {
   virtual JITModule *add_module(std::unique_ptr<llvm::Module> M,
                                 int max_reg = 0) = 0;
 
+  // Adds a module whose symbols every module added afterwards may refer to
+  // without defining them. Only supported on CPUs.
+  virtual JITModule *add_shared_module(std::unique_ptr<llvm::Module> M) {
+    TI_NOT_IMPLEMENTED
+  }
+
+  // Compiles |M| into a relocatable object file, the same way add_module()
+  // would before linking it. Only supported on CPUs.
+  virtual std::string compile_to_object(llvm::Module &M) {
+    TI_NOT_IMPLEMENTED
+  }
+
+  // Links an object file produced by compile_to_object() in a session with
+  // the same target_id(). Symbols are resolved as for add_module().
+  virtual JITModule *add_object(std::unique_ptr<llvm::MemoryBuffer> &&obj) {
+    TI_NOT_IMPLEMENTED
+  }
+
+  // Identifies the target triple, CPU and features code is generated for.
+  virtual std::string target_id() const {
+    TI_NOT_IMPLEMENTED
+  }
+
   // virtual void remove_module(JITModule *module) = 0;
 
   virtual void *lookup(const std::string Name) {
@@ -34,7 +34,8 @@ std::vector<int> Callable::insert_arr_param(const DataType &dt,
 std::vector<int> Callable::insert_ndarray_param(const DataType &dt,
                                                 int ndim,
                                                 const std::string &name,
-                                                bool needs_grad) {
+                                                bool needs_grad,
+                                                bool strided) {
   // Transform ndarray param to a struct type with a pointer to `dt`.
   std::vector<int> element_shape{};
   auto dtype = dt;
@@ -44,8 +45,8 @@ std::vector<int> Callable::insert_ndarray_param(const DataType &dt,
   }
   // FIXME: we have to use dtype here to scalarization.
   // If we could avoid using parameter_list in codegen it'll be fine
-  auto *type = TypeFactory::get_instance().get_ndarray_struct_type(dtype, ndim,
-                                                                   needs_grad);
+  auto *type = TypeFactory::get_instance().get_ndarray_struct_type(
+      dtype, ndim, needs_grad, strided);
   auto p =
       Parameter(type, /*is_array=*/true, false, 0, ndim + element_shape.size(),
                 element_shape, BufferFormat::unknown, needs_grad);
@@ -151,7 +151,8 @@ class TI_DLL_EXPORT Callable : public CallableBase {
   std::vector<int> insert_ndarray_param(const DataType &dt,
                                         int ndim,
                                         const std::string &name = "",
-                                        bool needs_grad = false);
+                                        bool needs_grad = false,
+                                        bool strided = false);
   std::vector<int> insert_texture_param(int total_dim,
                                         const std::string &name = "");
   std::vector<int> insert_pointer_param(const DataType &dt,
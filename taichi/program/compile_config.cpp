@@ -1,5 +1,6 @@
 #include "compile_config.h"
 
+#include <cstdlib>
 #include <thread>
 #include "taichi/rhi/arch.h"
 #include "taichi/util/offline_cache.h"
@@ -46,6 +47,7 @@ CompileConfig::CompileConfig() {
   force_scalarize_matrix = false;
   half2_vectorization = false;
   make_cpu_multithreading_loop = true;
+  vectorize_range_for = false;
 
   saturating_grid_dim = 0;
   max_block_dim = 0;
@@ -72,6 +74,32 @@ void CompileConfig::fit() {
   if (arch_uses_spirv(arch)) {
     demote_dense_struct_fors = true;
   }
+  TI_ERROR_IF(cpu_block_dim_adaptive_policy != "static" &&
+                  cpu_block_dim_adaptive_policy != "guided",
+              "Unknown cpu_block_dim_adaptive_policy \"{}\", expected "
+              "\"static\" or \"guided\"",
+              cpu_block_dim_adaptive_policy);
+  TI_ERROR_IF(cpu_numa_policy != "first_touch" &&
+                  cpu_numa_policy != "interleave" && cpu_numa_policy != "none",
+              "Unknown cpu_numa_policy \"{}\", expected \"first_touch\", "
+              "\"interleave\" or \"none\"",
+              cpu_numa_policy);
+  TI_ERROR_IF(offline_cache_layout != "pack" && offline_cache_layout != "files",
+              "Unknown offline_cache_layout \"{}\", expected \"pack\" or "
+              "\"files\"",
+              offline_cache_layout);
+  if (vectorize_range_for &&
+      (real_matrix_scalarize || force_scalarize_matrix)) {
+    TI_WARN(
+        "vectorize_range_for has no effect when the matrices are scalarized, "
+        "please also set real_matrix_scalarize=False");
+    vectorize_range_for = false;
+  }
+  if (arch == Arch::flagos && flagos_chip == "generic") {
+    if (const char *chip = std::getenv("TI_FLAGOS_CHIP")) {
+      flagos_chip = chip;
+    }
+  }
   offline_cache::disable_offline_cache_if_needed(this);
 }
 
@@ -42,12 +42,21 @@ struct CompileConfig {
   bool force_scalarize_matrix;
   bool half2_vectorization;
   bool make_cpu_multithreading_loop;
+  // Widens the inner loops of CPU range-fors to
+  // min(simd_width, max_vector_width) lanes. Requires
+  // real_matrix_scalarize = false (see vectorize_range_for.cpp).
+  bool vectorize_range_for;
   DataType default_fp;
   DataType default_ip;
   DataType default_up;
   std::string extra_flags;
   int default_cpu_block_dim;
   bool cpu_block_dim_adaptive;
+  // How CPU range-fors are chunked when cpu_block_dim_adaptive is on:
+  // "static": one block per thread (see make_cpu_multithreaded_range_for);
+  // "guided": shrinking chunks handed out at runtime, with block_dim as the
+  // minimal chunk size (see cpu_parallel_range_for_guided in runtime.cpp).
+  std::string cpu_block_dim_adaptive_policy{"static"};
   int default_gpu_block_dim;
   int gpu_max_reg;
   int ad_stack_size{0};  // 0 = adaptive
@@ -58,6 +67,12 @@ struct CompileConfig {
   int saturating_grid_dim;
   int max_block_dim;
   int cpu_max_num_threads;
+  // How the pages of root buffers and ndarrays are placed on the NUMA nodes
+  // on CPU: "first_touch", "interleave" or "none" (see taichi/system/numa.h)
+  std::string cpu_numa_policy{"first_touch"};
+  // Advise the kernel to back root buffers and ndarrays with transparent
+  // huge pages on CPU (Linux only)
+  bool cpu_huge_pages{false};
   int random_seed;
 
   // LLVM backend options:
@@ -96,8 +111,13 @@ struct CompileConfig {
   int offline_cache_max_size_of_files{100 * 1024 *
                                       1024};   // bytes, default: 100MB
   double offline_cache_cleaning_factor{0.25};  // [0.f, 1.f]
+  std::string offline_cache_layout{"pack"};    // "pack"|"files"
+  std::string offline_cache_key_hash{"sha256"};  // "sha256"|"xxhash64"
 
   int num_compile_threads{4};
+  // Allocates the IR of each compilation from a single IRArena, see
+  // taichi/ir/ir_arena.h
+  bool ir_arena{true};
   std::string vk_api_version;
 
   size_t cuda_stack_limit{0};
@@ -105,10 +125,17 @@ struct CompileConfig {
   // FlagOS backend options:
   std::string flagos_chip{
       "generic"};  // Target chip: mlu370, ascend910, dcu, etc.
+  // Used to size the grids when the chip cannot report it
+  int flagos_num_compute_units{64};
 
   CompileConfig();
 
   void fit();
+
+  bool cpu_guided_range_for() const {
+    return arch_is_cpu(arch) && cpu_block_dim_adaptive &&
+           cpu_block_dim_adaptive_policy == "guided";
+  }
 };
 
 extern TI_DLL_EXPORT CompileConfig default_compile_config;
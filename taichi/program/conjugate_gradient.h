@@ -1,58 +1,70 @@
 #include "sparse_matrix.h"
 
 #include "taichi/program/ndarray.h"
+#include "taichi/program/preconditioned_cg.h"
 #include "taichi/program/program.h"
 
-#include "Eigen/IterativeLinearSolvers"
-
 namespace taichi::lang {
+
+// Conjugate gradient on the CPU, see PreconditionedCG. Vectors set from
+// ndarrays are used in place: the solution is written into the ndarray of x.
 template <typename EigenT, typename DT>
 class CG {
  public:
-  CG(SparseMatrix &A, int max_iters, float tol, bool verbose)
-      : A_(A), max_iters_(max_iters), tol_(tol), verbose_(verbose) {
+  CG(SparseMatrix &A,
+     int max_iters,
+     float tol,
+     bool verbose,
+     const std::string &preconditioner = "none",
+     int block_size = 4)
+      : A_(A),
+        max_iters_(max_iters),
+        tol_(tol),
+        verbose_(verbose),
+        preconditioner_(cg_preconditioner_from_name(preconditioner)),
+        block_size_(block_size) {
     x_ = EigenT::Zero(A_.num_cols());
     b_ = EigenT::Zero(A_.num_rows());
   }
 
   void set_x(EigenT &x) {
     x_ = x;
+    x_ptr_ = nullptr;
   }
 
   void set_b(EigenT &b) {
     b_ = b;
+    b_ptr_ = nullptr;
   }
 
   void set_x_ndarray(Program *prog, Ndarray &x) {
-    size_t dX = prog->get_ndarray_data_ptr_as_int(&x);
-    x_ = Eigen::Map<EigenT>((DT *)dX, A_.num_cols());
+    x_ptr_ = (DT *)prog->get_ndarray_data_ptr_as_int(&x);
   }
 
   void set_b_ndarray(Program *prog, Ndarray &b) {
-    size_t db = prog->get_ndarray_data_ptr_as_int(&b);
-    b_ = Eigen::Map<EigenT>((DT *)db, A_.num_rows());
+    b_ptr_ = (DT *)prog->get_ndarray_data_ptr_as_int(&b);
   }
 
-  void solve() {
-    Eigen::ConjugateGradient<Eigen::SparseMatrix<DT>,
-                             Eigen::Lower | Eigen::Upper>
-        cg;
-    cg.setMaxIterations(max_iters_);
-    cg.setTolerance(tol_);
-    EigenSparseMatrix<Eigen::SparseMatrix<DT>> &A =
-        static_cast<EigenSparseMatrix<Eigen::SparseMatrix<DT>> &>(A_);
-    Eigen::SparseMatrix<DT> *A_eigen =
-        (Eigen::SparseMatrix<DT> *)A.get_matrix();
-    cg.compute(*A_eigen);
-    x_ = cg.solve(b_);
+  void solve(Program *prog) {
+    if (!solver_) {
+      solver_ = make_solver();
+    }
+    solver_->set_thread_pool(get_cpu_thread_pool(prog));
+    DT *x = x_ptr_ ? x_ptr_ : x_.data();
+    const DT *b = b_ptr_ ? b_ptr_ : b_.data();
+    is_success_ = solver_->solve(x, b, max_iters_, tol_, 0);
     if (verbose_) {
-      std::cout << "#iterations:     " << cg.iterations() << std::endl;
-      std::cout << "estimated error: " << cg.error() << std::endl;
+      std::cout << "#iterations:     " << solver_->num_iterations()
+                << std::endl;
+      std::cout << "estimated error: " << solver_->relative_residual()
+                << std::endl;
     }
-    is_success_ = !(cg.info());
   }
 
   EigenT &get_x() {
+    if (x_ptr_) {
+      x_ = Eigen::Map<EigenT>(x_ptr_, A_.num_cols());
+    }
     return x_;
   }
 
@@ -61,23 +73,109 @@ class CG {
   }
 
  private:
+  template <int Storage>
+  std::unique_ptr<PreconditionedCG<DT>> make_solver_from() {
+    using EigenMatrix = Eigen::SparseMatrix<DT, Storage>;
+    auto *A = dynamic_cast<EigenSparseMatrix<EigenMatrix> *>(&A_);
+    if (A == nullptr) {
+      return nullptr;
+    }
+    auto *A_eigen = (EigenMatrix *)A->get_matrix();
+    A_eigen->makeCompressed();
+    // A is symmetric, so its CSC arrays are its CSR arrays as well
+    return std::make_unique<PreconditionedCG<DT>>(
+        A_.num_rows(), A_eigen->outerIndexPtr(), A_eigen->innerIndexPtr(),
+        A_eigen->valuePtr(), preconditioner_, block_size_);
+  }
+
+  std::unique_ptr<PreconditionedCG<DT>> make_solver() {
+    TI_ERROR_IF(A_.num_rows() != A_.num_cols(),
+                "CG needs a square matrix, got {}x{}", A_.num_rows(),
+                A_.num_cols());
+    auto solver = make_solver_from<Eigen::ColMajor>();
+    if (!solver) {
+      solver = make_solver_from<Eigen::RowMajor>();
+    }
+    TI_ERROR_IF(!solver, "CG needs a CPU sparse matrix of its data type");
+    return solver;
+  }
+
   SparseMatrix &A_;
   EigenT x_;
   EigenT b_;
+  DT *x_ptr_{nullptr};
+  const DT *b_ptr_{nullptr};
   int max_iters_{0};
   DT tol_{0.0f};
   bool verbose_{false};
+  CGPreconditioner preconditioner_{CGPreconditioner::none};
+  int block_size_{4};
+  std::unique_ptr<PreconditionedCG<DT>> solver_;
   bool is_success_{false};
 };
 
 template <typename EigenT, typename DT>
-std::unique_ptr<CG<EigenT, DT>> make_cg_solver(SparseMatrix &A,
-                                               int max_iters,
-                                               float tol,
-                                               bool verbose) {
-  return std::make_unique<CG<EigenT, DT>>(A, max_iters, tol, verbose);
+std::unique_ptr<CG<EigenT, DT>> make_cg_solver(
+    SparseMatrix &A,
+    int max_iters,
+    float tol,
+    bool verbose,
+    const std::string &preconditioner = "none",
+    int block_size = 4) {
+  return std::make_unique<CG<EigenT, DT>>(A, max_iters, tol, verbose,
+                                          preconditioner, block_size);
 }
 
+// Matrix-free conjugate gradient on the CPU. |apply| computes Ap = A p on the
+// ndarrays |p| and |Ap|, typically by launching a Taichi kernel on them.
+template <typename DT>
+class MatrixFreeCG {
+ public:
+  MatrixFreeCG(Program *prog,
+               Ndarray &p,
+               Ndarray &Ap,
+               std::function<void()> apply,
+               int max_iters,
+               float tol,
+               bool verbose)
+      : max_iters_(max_iters),
+        tol_(tol),
+        verbose_(verbose),
+        n_((int)p.get_nelement()),
+        solver_(n_,
+                (DT *)prog->get_ndarray_data_ptr_as_int(&p),
+                (DT *)prog->get_ndarray_data_ptr_as_int(&Ap),
+                std::move(apply)) {
+    TI_ERROR_IF(Ap.get_nelement() != p.get_nelement(),
+                "Dimension mismatch between p and Ap");
+  }
+
+  // Solves in place in |x| until |r| <= tol
+  bool solve(Program *prog, Ndarray &x, const Ndarray &b) {
+    TI_ERROR_IF(x.get_nelement() != n_ || b.get_nelement() != n_,
+                "Dimension mismatch, the operator has {} rows", n_);
+    solver_.set_thread_pool(get_cpu_thread_pool(prog));
+    const bool success =
+        solver_.solve((DT *)prog->get_ndarray_data_ptr_as_int(&x),
+                      (const DT *)prog->get_ndarray_data_ptr_as_int(&b),
+                      max_iters_, 0, tol_);
+    if (verbose_) {
+      std::cout << "#iterations:     " << solver_.num_iterations()
+                << std::endl;
+      std::cout << "estimated error: " << solver_.relative_residual()
+                << std::endl;
+    }
+    return success;
+  }
+
+ private:
+  int max_iters_{0};
+  DT tol_{0.0f};
+  bool verbose_{false};
+  int n_{0};
+  PreconditionedCG<DT> solver_;
+};
+
 class CUCG {
  public:
   CUCG(SparseMatrix &A, int max_iters, float tol, bool verbose)
@@ -0,0 +1,227 @@
+#include "taichi/program/dlpack_funcs.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "taichi/ir/type_factory.h"
+#include "taichi/ir/type_utils.h"
+#include "taichi/program/ndarray.h"
+#include "taichi/program/program.h"
+
+namespace taichi::lang {
+
+namespace {
+
+// Owns the shape and the strides of an exported tensor
+struct DLPackExport {
+  DLManagedTensor tensor;
+  std::vector<int64_t> shape;
+  std::vector<int64_t> strides;
+  std::function<void()> release;
+};
+
+void delete_dlpack_export(DLManagedTensor *tensor) {
+  auto *ctx = (DLPackExport *)tensor->manager_ctx;
+  if (ctx->release) {
+    ctx->release();
+  }
+  delete ctx;
+}
+
+}  // namespace
+
+DLDataType to_dlpack_data_type(DataType dt) {
+  DLDataType result;
+  result.lanes = 1;
+  result.bits = data_type_size(dt) * 8;
+  if (dt->is_primitive(PrimitiveTypeID::u1)) {
+    result.code = kDLBool;
+  } else if (is_real(dt)) {
+    result.code = kDLFloat;
+  } else if (is_integral(dt)) {
+    result.code = is_signed(dt) ? kDLInt : kDLUInt;
+  } else {
+    TI_ERROR("Data type {} is not supported by DLPack", dt->to_string());
+  }
+  return result;
+}
+
+DataType from_dlpack_data_type(DLDataType dt) {
+  TI_ERROR_IF(dt.lanes != 1, "DLPack tensors with {} lanes are not supported",
+              dt.lanes);
+  if (dt.code == kDLBool && dt.bits == 8) {
+    return PrimitiveType::u1;
+  } else if (dt.code == kDLFloat) {
+    if (dt.bits == 16) {
+      return PrimitiveType::f16;
+    } else if (dt.bits == 32) {
+      return PrimitiveType::f32;
+    } else if (dt.bits == 64) {
+      return PrimitiveType::f64;
+    }
+  } else if (dt.code == kDLInt) {
+    if (dt.bits == 8) {
+      return PrimitiveType::i8;
+    } else if (dt.bits == 16) {
+      return PrimitiveType::i16;
+    } else if (dt.bits == 32) {
+      return PrimitiveType::i32;
+    } else if (dt.bits == 64) {
+      return PrimitiveType::i64;
+    }
+  } else if (dt.code == kDLUInt) {
+    if (dt.bits == 8) {
+      return PrimitiveType::u8;
+    } else if (dt.bits == 16) {
+      return PrimitiveType::u16;
+    } else if (dt.bits == 32) {
+      return PrimitiveType::u32;
+    } else if (dt.bits == 64) {
+      return PrimitiveType::u64;
+    }
+  }
+  TI_ERROR("DLPack data type (code {}, {} bits) is not supported", dt.code,
+           dt.bits);
+}
+
+DLManagedTensor *ndarray_to_dlpack(Program *prog,
+                                   Ndarray *ndarray,
+                                   std::function<void()> release) {
+  TI_ERROR_IF(!arch_is_cpu(prog->compile_config().arch),
+              "Ndarrays can be exported to DLPack only on the CPU backend, "
+              "not on {}",
+              arch_name(prog->compile_config().arch));
+  // The consumer reads the memory right away, so pending kernels writing to
+  // it must be done
+  prog->synchronize();
+
+  auto ctx = std::make_unique<DLPackExport>();
+  const auto &total_shape = ndarray->total_shape();
+  ctx->shape.assign(total_shape.begin(), total_shape.end());
+  ctx->strides.resize(total_shape.size());
+  int64_t stride = 1;
+  for (int i = (int)total_shape.size() - 1; i >= 0; i--) {
+    ctx->strides[i] = stride;
+    stride *= total_shape[i];
+  }
+  // Strided ndarrays are AOS with compact elements
+  for (int i = 0; i < (int)ndarray->strides.size(); i++) {
+    ctx->strides[i] = ndarray->strides[i];
+  }
+  ctx->release = std::move(release);
+
+  DLTensor &tensor = ctx->tensor.dl_tensor;
+  tensor.data = (void *)prog->get_ndarray_data_ptr_as_int(ndarray);
+  tensor.device = {kDLCPU, 0};
+  tensor.ndim = (int32_t)total_shape.size();
+  tensor.dtype = to_dlpack_data_type(ndarray->get_element_data_type());
+  tensor.shape = ctx->shape.data();
+  tensor.strides = ctx->strides.data();
+  tensor.byte_offset = 0;
+  ctx->tensor.manager_ctx = ctx.get();
+  ctx->tensor.deleter = delete_dlpack_export;
+  return &ctx.release()->tensor;
+}
+
+Ndarray *ndarray_from_dlpack(Program *prog,
+                             DLManagedTensor *tensor,
+                             const std::vector<int> &element_shape,
+                             std::function<void()> release) {
+  const DLTensor &dl_tensor = tensor->dl_tensor;
+  TI_ERROR_IF(dl_tensor.device.device_type != kDLCPU &&
+                  dl_tensor.device.device_type != kDLCUDAHost,
+              "Only DLPack tensors in host memory can be imported, got device "
+              "type {}",
+              (int)dl_tensor.device.device_type);
+  const int num_element_dims = (int)element_shape.size();
+  TI_ERROR_IF(dl_tensor.ndim <= num_element_dims,
+              "A DLPack tensor of {} dimensions cannot hold an array of "
+              "elements of {} dimensions",
+              dl_tensor.ndim, num_element_dims);
+  DataType element_type = from_dlpack_data_type(dl_tensor.dtype);
+
+  std::vector<int> shape;
+  for (int i = 0; i < dl_tensor.ndim; i++) {
+    const int64_t dim = dl_tensor.shape[i];
+    TI_ERROR_IF(dim <= 0 || dim > std::numeric_limits<int>::max(),
+                "Dimension {} of the DLPack tensor has an unsupported size {}",
+                i, dim);
+    if (i >= dl_tensor.ndim - num_element_dims) {
+      const int element_dim = element_shape[i - dl_tensor.ndim +
+                                            num_element_dims];
+      TI_ERROR_IF(dim != element_dim,
+                  "Dimension {} of the DLPack tensor has the size {}, but the "
+                  "element shape says {}",
+                  i, dim, element_dim);
+    }
+  }
+  const int ndim = dl_tensor.ndim - num_element_dims;
+  shape.assign(dl_tensor.shape, dl_tensor.shape + ndim);
+
+  // Vector and matrix elements must be compact. The other dimensions may have
+  // any positive strides, as long as no two elements overlap. Strides of
+  // dimensions of size 1 do not matter.
+  std::vector<int> strides;
+  if (dl_tensor.strides != nullptr) {
+    int64_t element_size = 1;
+    for (int i = dl_tensor.ndim - 1; i >= ndim; i--) {
+      TI_ERROR_IF(dl_tensor.shape[i] != 1 &&
+                      dl_tensor.strides[i] != element_size,
+                  "The elements of the DLPack tensor are not compact "
+                  "(dimension {} has the stride {} instead of {}), make it "
+                  "contiguous before importing it",
+                  i, dl_tensor.strides[i], element_size);
+      element_size *= dl_tensor.shape[i];
+    }
+    std::vector<int> order;
+    for (int i = 0; i < ndim; i++) {
+      if (shape[i] != 1) {
+        TI_ERROR_IF(dl_tensor.strides[i] <= 0,
+                    "Dimension {} of the DLPack tensor has the stride {}, "
+                    "only positive strides are supported",
+                    i, dl_tensor.strides[i]);
+        order.push_back(i);
+      }
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+      return dl_tensor.strides[a] < dl_tensor.strides[b];
+    });
+    // Each dimension must step over the whole extent of the smaller ones
+    int64_t extent = element_size;
+    for (int i : order) {
+      TI_ERROR_IF(dl_tensor.strides[i] < extent,
+                  "The elements of the DLPack tensor overlap (dimension {} "
+                  "has the stride {}, less than {})",
+                  i, dl_tensor.strides[i], extent);
+      extent = dl_tensor.strides[i] * shape[i];
+      TI_ERROR_IF(extent > std::numeric_limits<int>::max(),
+                  "The DLPack tensor spans more than {} scalars, which "
+                  "ndarrays cannot index",
+                  std::numeric_limits<int>::max());
+    }
+    strides.resize(ndim, 1);
+    bool compact = true;
+    int64_t expected_stride = element_size;
+    for (int i = ndim - 1; i >= 0; i--) {
+      if (shape[i] != 1) {
+        strides[i] = (int)dl_tensor.strides[i];
+        compact = compact && strides[i] == expected_stride;
+      }
+      expected_stride *= shape[i];
+    }
+    // Kernels for compact ndarrays are faster, keep those when possible
+    if (compact) {
+      strides.clear();
+    }
+  }
+
+  DataType type = element_type;
+  if (!element_shape.empty()) {
+    type = TypeFactory::create_tensor_type(element_shape, element_type);
+  }
+  void *data = (char *)dl_tensor.data + dl_tensor.byte_offset;
+  return prog->create_ndarray_from_host_memory(data, type, shape, strides,
+                                               std::move(release));
+}
+
+}  // namespace taichi::lang
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "dlpack/dlpack.h"
+
+#include "taichi/ir/type.h"
+
+namespace taichi::lang {
+
+class Ndarray;
+class Program;
+
+DLDataType to_dlpack_data_type(DataType dt);
+DataType from_dlpack_data_type(DLDataType dt);
+
+// Exports |ndarray| as a DLPack tensor aliasing its memory, without a copy.
+// Only on the CPU backend. The tensor has the total shape of the ndarray,
+// i.e. the dimensions of vector and matrix elements come last. Its deleter
+// calls |release|, which should drop whatever keeps |ndarray| alive.
+DLManagedTensor *ndarray_to_dlpack(Program *prog,
+                                   Ndarray *ndarray,
+                                   std::function<void()> release);
+
+// Imports a DLPack tensor in host memory as an Ndarray aliasing it, without a
+// copy. Its last element_shape.size() dimensions form the vector or matrix
+// elements, which must be compact. The other dimensions may have any positive
+// strides that do not make elements overlap; kernels taking the Ndarray are
+// then compiled for its strides.
+//
+// On success the Ndarray keeps |tensor| until it is deleted, and then calls
+// |release|, which should call the deleter of |tensor|. On failure |tensor|
+// is left to the caller.
+Ndarray *ndarray_from_dlpack(Program *prog,
+                             DLManagedTensor *tensor,
+                             const std::vector<int> &element_shape,
+                             std::function<void()> release);
+
+}  // namespace taichi::lang
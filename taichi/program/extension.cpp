@@ -9,12 +9,12 @@ bool is_extension_supported(Arch arch, Extension ext) {
   static std::unordered_map<Arch, std::unordered_set<Extension>> arch2ext = {
       {Arch::x64,
        {Extension::sparse, Extension::quant, Extension::quant_basic,
-        Extension::data64, Extension::adstack, Extension::assertion,
-        Extension::extfunc, Extension::mesh}},
+        Extension::data64, Extension::adstack, Extension::bls,
+        Extension::assertion, Extension::extfunc, Extension::mesh}},
       {Arch::arm64,
        {Extension::sparse, Extension::quant, Extension::quant_basic,
-        Extension::data64, Extension::adstack, Extension::assertion,
-        Extension::mesh}},
+        Extension::data64, Extension::adstack, Extension::bls,
+        Extension::assertion, Extension::mesh}},
       {Arch::cuda,
        {Extension::sparse, Extension::quant, Extension::quant_basic,
         Extension::data64, Extension::adstack, Extension::bls,
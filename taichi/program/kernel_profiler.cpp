@@ -1,5 +1,6 @@
 #include "kernel_profiler.h"
 
+#include "taichi/system/threading.h"
 #include "taichi/system/timer.h"
 #include "taichi/rhi/cuda/cuda_driver.h"
 #include "taichi/rhi/cuda/cuda_profiler.h"
@@ -103,7 +104,16 @@ class DefaultProfiler : public KernelProfilerBase {
     statistical_results_.clear();
   }
 
+  void set_cpu_thread_pool(ThreadPool *thread_pool) override {
+    thread_pool_ = thread_pool;
+    thread_pool_->set_busy_time_tracking(true);
+  }
+
   void start(const std::string &kernel_name) override {
+    if (thread_pool_) {
+      // Drop whatever ran outside of profiled tasks.
+      thread_pool_->pop_busy_times();
+    }
     start_t_ = Time::get_time();
     event_name_ = kernel_name;
   }
@@ -115,6 +125,21 @@ class DefaultProfiler : public KernelProfilerBase {
     KernelProfileTracedRecord record;
     record.name = event_name_;
     record.kernel_elapsed_time_in_ms = ms;
+    if (thread_pool_) {
+      double max_busy = 0, total_busy = 0;
+      for (auto busy : thread_pool_->pop_busy_times()) {
+        if (busy > 0) {
+          record.cpu_num_busy_threads++;
+          max_busy = std::max(max_busy, busy);
+          total_busy += busy;
+        }
+      }
+      if (record.cpu_num_busy_threads > 0) {
+        record.cpu_max_busy_time_in_ms = max_busy * 1000.0;
+        record.cpu_avg_busy_time_in_ms =
+            total_busy * 1000.0 / record.cpu_num_busy_threads;
+      }
+    }
     traced_records_.push_back(record);
     // count record
     auto it =
@@ -133,6 +158,7 @@ class DefaultProfiler : public KernelProfilerBase {
  private:
   double start_t_;
   std::string event_name_;
+  ThreadPool *thread_pool_{nullptr};
 };
 
 }  // namespace
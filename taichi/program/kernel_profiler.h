@@ -10,6 +10,10 @@
 #include <memory>
 #include <regex>
 
+namespace taichi {
+class ThreadPool;
+}  // namespace taichi
+
 namespace taichi::lang {
 
 struct KernelProfileTracedRecord {
@@ -24,6 +28,10 @@ struct KernelProfileTracedRecord {
   float time_since_base{0.0};        // for Timeline
   std::string name;                  // kernel name
   std::vector<float> metric_values;  // user selected metrics
+  // CPU thread pool load balance (CPU backends only)
+  int cpu_num_busy_threads{0};
+  float cpu_max_busy_time_in_ms{0.0};
+  float cpu_avg_busy_time_in_ms{0.0};
 };
 
 struct KernelProfileStatisticalResult {
@@ -67,6 +75,11 @@ class KernelProfilerBase {
     return false;
   }
 
+  // CPU backends only: attributes the per-thread busy time of the thread pool
+  // to the profiled tasks.
+  virtual void set_cpu_thread_pool(ThreadPool *thread_pool) {
+  }
+
   // TODO: remove start and always use start_with_handle
   virtual void start(const std::string &kernel_name) { TI_NOT_IMPLEMENTED };
 
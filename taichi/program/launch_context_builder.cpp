@@ -247,6 +247,7 @@ void LaunchContextBuilder::set_arg_ndarray(const std::vector<int> &arg_id,
   TI_ASSERT_INFO(arr.shape.size() <= taichi_max_num_indices,
                  "External array cannot have > {max_num_indices} indices");
   set_arg_ndarray_impl(arg_id, ptr, arr.shape);
+  set_ndarray_strides(arg_id, arr);
 }
 
 void LaunchContextBuilder::set_arg_argpack(const std::vector<int> &arg_id,
@@ -268,6 +269,8 @@ void LaunchContextBuilder::set_arg_ndarray_with_grad(
   intptr_t ptr_grad = arr_grad.get_device_allocation_ptr_as_int();
   TI_ASSERT_INFO(arr.shape.size() <= taichi_max_num_indices,
                  "External array cannot have > {max_num_indices} indices");
+  TI_ERROR_IF(arr.is_strided() || arr_grad.is_strided(),
+              "Strided ndarrays cannot have gradients");
   set_arg_ndarray_impl(arg_id, ptr, arr.shape, ptr_grad);
 }
 
@@ -329,6 +332,38 @@ void LaunchContextBuilder::set_arg_ndarray_impl(const std::vector<int> &arg_id,
   set_array_runtime_size(arg_id, total_size);
 }
 
+void LaunchContextBuilder::set_ndarray_strides(const std::vector<int> &arg_id,
+                                               const Ndarray &arr) {
+  if (!TypeFactory::is_strided_ndarray_struct(
+          args_type->get_element_type(arg_id))) {
+    TI_ERROR_IF(arr.is_strided(),
+                "Argument {} is a strided ndarray, but the kernel was compiled "
+                "for compact ones",
+                fmt::join(arg_id, ", "));
+    return;
+  }
+  // A kernel compiled for strided ndarrays takes compact ones as well
+  std::vector<int> strides = arr.strides;
+  if (strides.empty()) {
+    const auto &total_shape = arr.total_shape();
+    int stride = 1;
+    for (int i = (int)total_shape.size() - 1; i >= (int)arr.shape.size();
+         i--) {
+      stride *= total_shape[i];
+    }
+    strides.resize(arr.shape.size());
+    for (int i = (int)arr.shape.size() - 1; i >= 0; i--) {
+      strides[i] = stride;
+      stride *= arr.shape[i];
+    }
+  }
+  const int ndim = arr.shape.size();
+  for (int i = 0; i < ndim; i++) {
+    set_struct_arg(concatenate_vector<int>(arg_id, {0, ndim + i}),
+                   (int32)strides[i]);
+  }
+}
+
 void LaunchContextBuilder::set_arg_matrix(int arg_id, const Matrix &matrix) {
   int type_size = data_type_size(matrix.dtype());
   for (uint32_t i = 0; i < matrix.length(); i++) {
@@ -99,6 +99,7 @@ class LaunchContextBuilder {
 
  private:
   TypedConstant fetch_ret_impl(int offset, const Type *dt);
+  void set_ndarray_strides(const std::vector<int> &arg_id, const Ndarray &arr);
   CallableBase *kernel_;
   std::unique_ptr<RuntimeContext> owned_ctx_;
   // |ctx_| *almost* always points to |owned_ctx_|. However, it is possible
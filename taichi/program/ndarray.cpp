@@ -117,11 +117,28 @@ Ndarray::Ndarray(DeviceAllocation &devalloc,
   TI_ASSERT(type->is<PrimitiveType>());
 }
 
+Ndarray::Ndarray(Program *prog,
+                 DeviceAllocation &devalloc,
+                 const DataType type,
+                 const std::vector<int> &shape,
+                 const std::vector<int> &strides,
+                 std::function<void()> release,
+                 const DebugInfo &dbg_info)
+    : Ndarray(devalloc, type, shape, ExternalArrayLayout::kNull, dbg_info) {
+  TI_ASSERT(strides.empty() || strides.size() == shape.size());
+  this->strides = strides;
+  prog_ = prog;
+  release_ = std::move(release);
+}
+
 Ndarray::~Ndarray() {
   if (prog_) {
     // prog_->flush();
     ndarray_alloc_.device->dealloc_memory(ndarray_alloc_);
   }
+  if (release_) {
+    release_();
+  }
 }
 
 intptr_t Ndarray::get_device_allocation_ptr_as_int() const {
@@ -154,9 +171,24 @@ std::size_t Ndarray::get_nelement() const {
   return nelement_;
 }
 
+std::size_t Ndarray::get_scalar_offset(const std::vector<int> &I) const {
+  if (!is_strided()) {
+    return flatten_index(total_shape_, I);
+  }
+  // Strided Ndarrays are AOS, the indices of the element come last
+  const int ndim = shape.size();
+  std::size_t offset =
+      flatten_index(get_element_shape(),
+                    std::vector<int>(I.begin() + ndim, I.end()));
+  for (int i = 0; i < ndim; i++) {
+    offset += (std::size_t)I[i] * strides[i];
+  }
+  return offset;
+}
+
 TypedConstant Ndarray::read(const std::vector<int> &I) const {
   prog_->synchronize();
-  size_t index = flatten_index(total_shape_, I);
+  size_t index = get_scalar_offset(I);
   size_t size = data_type_size(get_element_data_type());
   taichi::lang::Device::AllocParams alloc_params;
   alloc_params.host_write = false;
@@ -191,7 +223,7 @@ void Ndarray::write(const std::vector<int> &I, TypedConstant val) const {
     std::memcpy(&val.value_bits, &float16, 4);
   }
 
-  size_t index = flatten_index(total_shape_, I);
+  size_t index = get_scalar_offset(I);
   size_t size_ = data_type_size(get_element_data_type());
   taichi::lang::Device::AllocParams alloc_params;
   alloc_params.host_write = true;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include <vector>
 
 #include "taichi/inc/constants.h"
@@ -47,12 +48,30 @@ class TI_DLL_EXPORT Ndarray {
                    ExternalArrayLayout layout = ExternalArrayLayout::kNull,
                    const DebugInfo &dbg_info = DebugInfo());
 
+  /* Constructs a Ndarray managed by Program from memory it does not own,
+   * e.g. imported through DLPack. |devalloc| aliases that memory, and
+   * |release| is called once the Ndarray no longer uses it. |strides| are
+   * the strides of the dimensions in |shape|, in scalars, or empty if the
+   * memory is a compact row-major array.
+   */
+  explicit Ndarray(Program *prog,
+                   DeviceAllocation &devalloc,
+                   const DataType type,
+                   const std::vector<int> &shape,
+                   const std::vector<int> &strides,
+                   std::function<void()> release,
+                   const DebugInfo &dbg_info = DebugInfo());
+
   DeviceAllocation ndarray_alloc_{kDeviceNullAllocation};
   DataType dtype;
   // Invariant: Since ndarray indices are flattened for vector/matrix, this is
   // always true:
   //   num_active_indices = shape.size()
   std::vector<int> shape;
+  // Strides of the dimensions in |shape|, in scalars. Empty when the Ndarray
+  // is a compact row-major array, which is the case unless it aliases a
+  // strided tensor. Vector and matrix elements are always compact.
+  std::vector<int> strides;
   ExternalArrayLayout layout{ExternalArrayLayout::kNull};
   DebugInfo dbg_info;
 
@@ -63,6 +82,9 @@ class TI_DLL_EXPORT Ndarray {
   DeviceAllocation get_device_allocation() const;
   std::size_t get_element_size() const;
   std::size_t get_nelement() const;
+  bool is_strided() const {
+    return !strides.empty();
+  }
   TypedConstant read(const std::vector<int> &I) const;
   void write(const std::vector<int> &I, TypedConstant val) const;
   int64 read_int(const std::vector<int> &i);
@@ -77,11 +99,14 @@ class TI_DLL_EXPORT Ndarray {
   ~Ndarray();
 
  private:
+  std::size_t get_scalar_offset(const std::vector<int> &I) const;
+
   std::size_t nelement_{1};
   std::size_t element_size_{1};
   std::vector<int> total_shape_;
 
   Program *prog_{nullptr};
+  std::function<void()> release_;
 };
 
 }  // namespace taichi::lang
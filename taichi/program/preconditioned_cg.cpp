@@ -0,0 +1,473 @@
+#include "taichi/program/preconditioned_cg.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace taichi::lang {
+
+namespace {
+
+// Below this many rows per split, a pass runs on fewer splits.
+constexpr int kMinRowsPerSplit = 1 << 12;
+
+// IC(0) breaks down on some SPD matrices. It is then retried on a matrix
+// whose diagonal is scaled by 1 + shift, doubling the shift every time.
+constexpr double kInitialIcShift = 1e-3;
+constexpr int kMaxIcShifts = 16;
+
+}  // namespace
+
+CGPreconditioner cg_preconditioner_from_name(const std::string &name) {
+  if (name.empty() || name == "none") {
+    return CGPreconditioner::none;
+  } else if (name == "jacobi") {
+    return CGPreconditioner::jacobi;
+  } else if (name == "block_jacobi") {
+    return CGPreconditioner::block_jacobi;
+  } else if (name == "ic") {
+    return CGPreconditioner::ic;
+  }
+  TI_ERROR(
+      "Unknown CG preconditioner \"{}\", expected one of none, jacobi, "
+      "block_jacobi and ic",
+      name);
+}
+
+template <typename DT>
+PreconditionedCG<DT>::PreconditionedCG(int n,
+                                       const int *outer_ptr,
+                                       const int *inner_indices,
+                                       const DT *values,
+                                       CGPreconditioner preconditioner,
+                                       int block_size)
+    : n_(n),
+      outer_ptr_(outer_ptr),
+      inner_indices_(inner_indices),
+      values_(values),
+      preconditioner_(preconditioner),
+      block_size_(1) {
+  if (preconditioner_ == CGPreconditioner::block_jacobi) {
+    TI_ERROR_IF(block_size <= 0, "Invalid block size {} for block-Jacobi",
+                block_size);
+    block_size_ = block_size;
+  }
+  p_storage_.resize(n_);
+  q_storage_.resize(n_);
+  p_ = p_storage_.data();
+  q_ = q_storage_.data();
+  switch (preconditioner_) {
+    case CGPreconditioner::jacobi:
+      setup_jacobi();
+      break;
+    case CGPreconditioner::block_jacobi:
+      setup_block_jacobi(block_size_);
+      break;
+    case CGPreconditioner::ic:
+      setup_ic();
+      break;
+    default:
+      break;
+  }
+}
+
+template <typename DT>
+PreconditionedCG<DT>::PreconditionedCG(int n,
+                                       DT *p,
+                                       DT *Ap,
+                                       std::function<void()> apply)
+    : n_(n), apply_(std::move(apply)), p_(p), q_(Ap) {
+}
+
+template <typename DT>
+DT PreconditionedCG<DT>::diagonal(int i) const {
+  const int *first = inner_indices_ + outer_ptr_[i];
+  const int *last = inner_indices_ + outer_ptr_[i + 1];
+  const int *it = std::lower_bound(first, last, i);
+  return it != last && *it == i ? values_[it - inner_indices_] : DT(0);
+}
+
+template <typename DT>
+void PreconditionedCG<DT>::setup_jacobi() {
+  factor_.resize(n_);
+  for (int i = 0; i < n_; i++) {
+    const DT d = diagonal(i);
+    TI_ERROR_IF(!(d > 0),
+                "Jacobi preconditioner needs a positive diagonal, but "
+                "A({}, {}) is {}",
+                i, i, d);
+    factor_[i] = 1 / d;
+  }
+}
+
+template <typename DT>
+void PreconditionedCG<DT>::setup_block_jacobi(int block_size) {
+  const int num_blocks = (n_ + block_size - 1) / block_size;
+  factor_.assign((std::size_t)num_blocks * block_size * block_size, 0);
+  for (int b = 0; b < num_blocks; b++) {
+    const int begin = b * block_size;
+    const int m = std::min(block_size, n_ - begin);
+    DT *L = factor_.data() + (std::size_t)b * block_size * block_size;
+    for (int i = 0; i < m; i++) {
+      for (int k = outer_ptr_[begin + i]; k < outer_ptr_[begin + i + 1]; k++) {
+        const int j = inner_indices_[k] - begin;
+        if (j >= 0 && j <= i) {
+          L[i * block_size + j] = values_[k];
+        }
+      }
+    }
+    // Dense Cholesky of the block, in place
+    for (int j = 0; j < m; j++) {
+      DT d = L[j * block_size + j];
+      for (int k = 0; k < j; k++) {
+        d -= L[j * block_size + k] * L[j * block_size + k];
+      }
+      TI_ERROR_IF(!(d > 0),
+                  "Block-Jacobi preconditioner needs positive definite "
+                  "diagonal blocks, but the block at row {} is not",
+                  begin);
+      d = std::sqrt(d);
+      L[j * block_size + j] = d;
+      for (int i = j + 1; i < m; i++) {
+        DT s = L[i * block_size + j];
+        for (int k = 0; k < j; k++) {
+          s -= L[i * block_size + k] * L[j * block_size + k];
+        }
+        L[i * block_size + j] = s / d;
+      }
+    }
+  }
+}
+
+template <typename DT>
+void PreconditionedCG<DT>::setup_ic() {
+  // The pattern of L is the lower triangle of A, whose rows end at the
+  // diagonal.
+  l_outer_ptr_.assign(n_ + 1, 0);
+  for (int i = 0; i < n_; i++) {
+    const int *first = inner_indices_ + outer_ptr_[i];
+    const int *last = inner_indices_ + outer_ptr_[i + 1];
+    const int *diag = std::lower_bound(first, last, i);
+    TI_ERROR_IF(diag == last || *diag != i,
+                "IC preconditioner needs a full diagonal, but A({}, {}) is not "
+                "stored",
+                i, i);
+    l_outer_ptr_[i + 1] = l_outer_ptr_[i] + int(diag - first) + 1;
+  }
+  l_inner_indices_.resize(l_outer_ptr_[n_]);
+  factor_.resize(l_outer_ptr_[n_]);
+  for (int i = 0; i < n_; i++) {
+    std::copy(inner_indices_ + outer_ptr_[i],
+              inner_indices_ + outer_ptr_[i] +
+                  (l_outer_ptr_[i + 1] - l_outer_ptr_[i]),
+              l_inner_indices_.begin() + l_outer_ptr_[i]);
+  }
+
+  double shift = 0;
+  for (int attempt = 0; attempt <= kMaxIcShifts; attempt++) {
+    bool broke_down = false;
+    for (int i = 0; i < n_ && !broke_down; i++) {
+      const int row_begin = l_outer_ptr_[i];
+      const int row_end = l_outer_ptr_[i + 1];
+      for (int k = row_begin; k < row_end; k++) {
+        const int j = l_inner_indices_[k];
+        DT s = values_[outer_ptr_[i] + (k - row_begin)];
+        if (j == i) {
+          s *= DT(1 + shift);
+        }
+        // s -= sum of L(i, c) * L(j, c) over the columns c < j in both rows
+        int a = row_begin;
+        int c = l_outer_ptr_[j];
+        while (a < k && l_inner_indices_[c] < j) {
+          if (l_inner_indices_[a] < l_inner_indices_[c]) {
+            a++;
+          } else if (l_inner_indices_[a] > l_inner_indices_[c]) {
+            c++;
+          } else {
+            s -= factor_[a++] * factor_[c++];
+          }
+        }
+        if (j < i) {
+          factor_[k] = s / factor_[l_outer_ptr_[j + 1] - 1];
+        } else if (s > 0) {
+          factor_[k] = std::sqrt(s);
+        } else {
+          broke_down = true;
+          break;
+        }
+      }
+    }
+    if (!broke_down) {
+      if (shift > 0) {
+        TI_TRACE("IC preconditioner needed a diagonal shift of {}", shift);
+      }
+      return;
+    }
+    shift = shift == 0 ? kInitialIcShift : shift * 2;
+  }
+  TI_ERROR("IC preconditioner broke down, the matrix is not positive definite");
+}
+
+template <typename DT>
+void PreconditionedCG<DT>::precondition_rows(const DT *r,
+                                             DT *z,
+                                             int begin,
+                                             int end) const {
+  if (preconditioner_ == CGPreconditioner::jacobi) {
+    for (int i = begin; i < end; i++) {
+      z[i] = factor_[i] * r[i];
+    }
+    return;
+  }
+  // Block-Jacobi. Splits start at block boundaries.
+  const int bs = block_size_;
+  for (int begin_row = begin; begin_row < end; begin_row += bs) {
+    const int m = std::min(bs, n_ - begin_row);
+    const DT *L = factor_.data() + (std::size_t)(begin_row / bs) * bs * bs;
+    DT *y = z + begin_row;
+    for (int i = 0; i < m; i++) {
+      DT s = r[begin_row + i];
+      for (int k = 0; k < i; k++) {
+        s -= L[i * bs + k] * y[k];
+      }
+      y[i] = s / L[i * bs + i];
+    }
+    for (int i = m - 1; i >= 0; i--) {
+      DT s = y[i];
+      for (int k = i + 1; k < m; k++) {
+        s -= L[k * bs + i] * y[k];
+      }
+      y[i] = s / L[i * bs + i];
+    }
+  }
+}
+
+template <typename DT>
+void PreconditionedCG<DT>::precondition_ic(const DT *r, DT *z) const {
+  // L y = r
+  for (int i = 0; i < n_; i++) {
+    DT s = r[i];
+    const int diag = l_outer_ptr_[i + 1] - 1;
+    for (int k = l_outer_ptr_[i]; k < diag; k++) {
+      s -= factor_[k] * z[l_inner_indices_[k]];
+    }
+    z[i] = s / factor_[diag];
+  }
+  // L^T z = y, column by column
+  for (int i = n_ - 1; i >= 0; i--) {
+    const int diag = l_outer_ptr_[i + 1] - 1;
+    z[i] /= factor_[diag];
+    for (int k = l_outer_ptr_[i]; k < diag; k++) {
+      z[l_inner_indices_[k]] -= factor_[k] * z[i];
+    }
+  }
+}
+
+template <typename DT>
+template <typename F>
+DT PreconditionedCG<DT>::parallel_sum(const F &f) {
+  const int num_splits = (int)row_splits_.size() - 1;
+  if (num_splits == 1 || thread_pool_ == nullptr) {
+    DT sum = 0;
+    for (int i = 0; i < num_splits; i++) {
+      sum += f(i, row_splits_[i], row_splits_[i + 1]);
+    }
+    return sum;
+  }
+  std::vector<DT> partial_sums(num_splits);
+  struct Task {
+    const F *f;
+    const int *row_splits;
+    DT *partial_sums;
+  } task{&f, row_splits_.data(), partial_sums.data()};
+  thread_pool_->run(num_splits, thread_pool_->get_max_num_threads(), &task,
+                    [](void *context, int thread_id, int i) {
+                      auto &task = *(Task *)context;
+                      task.partial_sums[i] = (*task.f)(
+                          i, task.row_splits[i], task.row_splits[i + 1]);
+                    });
+  DT sum = 0;
+  for (int i = 0; i < num_splits; i++) {
+    sum += partial_sums[i];
+  }
+  return sum;
+}
+
+template <typename DT>
+bool PreconditionedCG<DT>::solve(DT *x,
+                                 const DT *b,
+                                 int max_iters,
+                                 DT rtol,
+                                 DT atol) {
+  // A few splits per thread, so that idle threads can steal
+  const int max_num_threads =
+      thread_pool_ ? thread_pool_->get_max_num_threads() : 1;
+  const int num_splits =
+      std::clamp(n_ / kMinRowsPerSplit, 1, max_num_threads * 4);
+  row_splits_.assign(num_splits + 1, n_);
+  row_splits_[0] = 0;
+  for (int s = 1; s < num_splits; s++) {
+    int row;
+    if (outer_ptr_ != nullptr) {
+      const int64 target = (int64)outer_ptr_[n_] * s / num_splits;
+      row = int(std::lower_bound(outer_ptr_, outer_ptr_ + n_, target) -
+                outer_ptr_);
+    } else {
+      row = int((int64)n_ * s / num_splits);
+    }
+    row = row / block_size_ * block_size_;
+    row_splits_[s] = std::max(row, row_splits_[s - 1]);
+  }
+
+  r_.resize(n_);
+  DT *r = r_.data();
+  DT *z = r;
+  if (preconditioner_ != CGPreconditioner::none) {
+    z_.resize(n_);
+    z = z_.data();
+  }
+  const bool local_preconditioner =
+      preconditioner_ == CGPreconditioner::jacobi ||
+      preconditioner_ == CGPreconditioner::block_jacobi;
+
+  // q = A p, returns p.q
+  auto apply_operator = [&]() -> DT {
+    if (apply_) {
+      apply_();
+      return parallel_sum([&](int, int begin, int end) {
+        DT sum = 0;
+        for (int i = begin; i < end; i++) {
+          sum += p_[i] * q_[i];
+        }
+        return sum;
+      });
+    }
+    return parallel_sum([&](int, int begin, int end) {
+      DT sum = 0;
+      for (int i = begin; i < end; i++) {
+        DT s = 0;
+        for (int k = outer_ptr_[i]; k < outer_ptr_[i + 1]; k++) {
+          s += values_[k] * p_[inner_indices_[k]];
+        }
+        q_[i] = s;
+        sum += p_[i] * s;
+      }
+      return sum;
+    });
+  };
+  auto dot = [&](const DT *u, const DT *v) {
+    return parallel_sum([&](int, int begin, int end) {
+      DT sum = 0;
+      for (int i = begin; i < end; i++) {
+        sum += u[i] * v[i];
+      }
+      return sum;
+    });
+  };
+
+  parallel_sum([&](int, int begin, int end) {
+    std::copy(x + begin, x + end, p_ + begin);
+    return DT(0);
+  });
+  apply_operator();
+  // r = b - A x, z = M^-1 r
+  parallel_sum([&](int, int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      r[i] = b[i] - q_[i];
+    }
+    if (local_preconditioner) {
+      precondition_rows(r, z, begin, end);
+    }
+    return DT(0);
+  });
+  if (preconditioner_ == CGPreconditioner::ic) {
+    precondition_ic(r, z);
+  }
+  const DT b_norm2 = dot(b, b);
+  DT r_norm2 = dot(r, r);
+  DT rz = z == r ? r_norm2 : dot(r, z);
+
+  num_iterations_ = 0;
+  if (b_norm2 == 0) {
+    std::fill(x, x + n_, DT(0));
+    relative_residual_ = 0;
+    return true;
+  }
+  const DT threshold = std::max(rtol * rtol * b_norm2, atol * atol);
+  parallel_sum([&](int, int begin, int end) {
+    std::copy(z + begin, z + end, p_ + begin);
+    return DT(0);
+  });
+
+  while (true) {
+    relative_residual_ = std::sqrt(r_norm2 / b_norm2);
+    if (r_norm2 <= threshold) {
+      return true;
+    }
+    if (num_iterations_ >= max_iters) {
+      return false;
+    }
+    const DT pq = apply_operator();
+    if (!(pq > 0)) {
+      // A is not positive definite, or p vanished
+      return false;
+    }
+    const DT alpha = rz / pq;
+
+    // x += alpha p, r -= alpha q, z = M^-1 r. The sums r.r and r.z share
+    // the pass through two slots of a split's partial sums.
+    DT rz_next = 0;
+    if (local_preconditioner) {
+      std::vector<DT> rz_partial_sums(row_splits_.size() - 1);
+      r_norm2 = parallel_sum([&](int split, int begin, int end) {
+        DT sum = 0;
+        for (int i = begin; i < end; i++) {
+          x[i] += alpha * p_[i];
+          r[i] -= alpha * q_[i];
+          sum += r[i] * r[i];
+        }
+        precondition_rows(r, z, begin, end);
+        DT rz_sum = 0;
+        for (int i = begin; i < end; i++) {
+          rz_sum += r[i] * z[i];
+        }
+        rz_partial_sums[split] = rz_sum;
+        return sum;
+      });
+      for (DT partial_sum : rz_partial_sums) {
+        rz_next += partial_sum;
+      }
+    } else {
+      r_norm2 = parallel_sum([&](int, int begin, int end) {
+        DT sum = 0;
+        for (int i = begin; i < end; i++) {
+          x[i] += alpha * p_[i];
+          r[i] -= alpha * q_[i];
+          sum += r[i] * r[i];
+        }
+        return sum;
+      });
+      if (preconditioner_ == CGPreconditioner::ic) {
+        precondition_ic(r, z);
+        rz_next = dot(r, z);
+      } else {
+        rz_next = r_norm2;
+      }
+    }
+
+    // p = z + beta p
+    const DT beta = rz_next / rz;
+    rz = rz_next;
+    parallel_sum([&](int, int begin, int end) {
+      for (int i = begin; i < end; i++) {
+        p_[i] = z[i] + beta * p_[i];
+      }
+      return DT(0);
+    });
+    num_iterations_++;
+  }
+}
+
+template class PreconditionedCG<float32>;
+template class PreconditionedCG<float64>;
+
+}  // namespace taichi::lang
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "taichi/common/core.h"
+#include "taichi/system/threading.h"
+
+namespace taichi::lang {
+
+enum class CGPreconditioner { none, jacobi, block_jacobi, ic };
+
+CGPreconditioner cg_preconditioner_from_name(const std::string &name);
+
+// Preconditioned conjugate gradient on the host, working in place on the
+// caller's vectors.
+//
+// The sparse matrix-vector product, the dot products and the vector updates
+// run on a ThreadPool (the one of the CPU backend when called from Python).
+// Rows are split by nonzeros, so that the threads get even shares of the
+// product. Every iteration takes three passes over the vectors: the product
+// fused with p.Ap, the updates of x and r fused with the preconditioner and
+// the two dot products, and the update of p. Dot products are summed per
+// split and then in split order, so results do not depend on scheduling.
+//
+// The matrix must be symmetric, which makes its CSR and CSC arrays the same;
+// either may be passed. Preconditioners:
+//   - jacobi: the inverse of the diagonal.
+//   - block_jacobi: the inverses of the diagonal blocks of |block_size|
+//     consecutive rows, kept as dense Cholesky factors.
+//   - ic: incomplete Cholesky with the pattern of the lower triangle, IC(0).
+//     Its triangular solves are sequential.
+//
+// In matrix-free mode the operator is a callback that computes Ap = A * p on
+// two buffers owned by the caller, which the solver uses as its search
+// direction and its product. This lets the operator be a Taichi kernel bound
+// to two ndarrays. Matrix-free solves are not preconditioned.
+template <typename DT>
+class PreconditionedCG {
+ public:
+  // |outer_ptr|, |inner_indices| and |values| are the compressed arrays of
+  // the symmetric n x n matrix. They must outlive the solver.
+  PreconditionedCG(int n,
+                   const int *outer_ptr,
+                   const int *inner_indices,
+                   const DT *values,
+                   CGPreconditioner preconditioner,
+                   int block_size);
+
+  PreconditionedCG(int n, DT *p, DT *Ap, std::function<void()> apply);
+
+  void set_thread_pool(ThreadPool *thread_pool) {
+    thread_pool_ = thread_pool;
+  }
+
+  // Solves A x = b until |r| <= max(rtol * |b|, atol). |x| holds the initial
+  // guess. Returns whether the solve converged.
+  bool solve(DT *x, const DT *b, int max_iters, DT rtol, DT atol);
+
+  int num_iterations() const {
+    return num_iterations_;
+  }
+
+  // |r| / |b| after the last solve
+  DT relative_residual() const {
+    return relative_residual_;
+  }
+
+ private:
+  void setup_jacobi();
+  void setup_block_jacobi(int block_size);
+  void setup_ic();
+  DT diagonal(int i) const;
+
+  // Applies the preconditioner to rows [begin, end): z = M^-1 r. Only for
+  // the preconditioners that act on blocks of rows.
+  void precondition_rows(const DT *r, DT *z, int begin, int end) const;
+  // z = (L L^T)^-1 r, sequential
+  void precondition_ic(const DT *r, DT *z) const;
+
+  // Runs f(split, begin, end) over the row splits and returns the sum of the
+  // values it returns, in split order.
+  template <typename F>
+  DT parallel_sum(const F &f);
+
+  int n_{0};
+  const int *outer_ptr_{nullptr};
+  const int *inner_indices_{nullptr};
+  const DT *values_{nullptr};
+  CGPreconditioner preconditioner_{CGPreconditioner::none};
+  ThreadPool *thread_pool_{nullptr};
+
+  // Matrix-free mode
+  std::function<void()> apply_;
+
+  // Row splits with about the same number of nonzeros. In matrix-free mode,
+  // even splits.
+  std::vector<int> row_splits_;
+
+  // Jacobi: the inverse diagonal. Block-Jacobi: the lower Cholesky factors of
+  // the diagonal blocks, row-major, block after block. IC: the values of L,
+  // whose pattern is the lower triangle of A in the L arrays.
+  int block_size_{1};
+  std::vector<DT> factor_;
+  std::vector<int> l_outer_ptr_;
+  std::vector<int> l_inner_indices_;
+
+  // Work vectors. In matrix-free mode p and Ap are the caller's buffers.
+  std::vector<DT> r_;
+  std::vector<DT> z_;
+  std::vector<DT> p_storage_;
+  std::vector<DT> q_storage_;
+  DT *p_{nullptr};
+  DT *q_{nullptr};
+
+  int num_iterations_{0};
+  DT relative_residual_{0};
+};
+
+}  // namespace taichi::lang
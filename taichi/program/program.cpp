@@ -198,6 +198,16 @@ const CompiledKernelData &Program::compile_kernel(
   return ckd;
 }
 
+void Program::prefetch_kernels(const CompileConfig &compile_config,
+                               const DeviceCapabilityConfig &caps,
+                               const std::vector<Kernel *> &kernel_defs) {
+  TI_AUTO_PROF;
+  auto &mgr = program_impl_->get_kernel_compilation_manager();
+  mgr.prefetch(compile_config, caps,
+               std::vector<const Kernel *>(kernel_defs.begin(),
+                                           kernel_defs.end()));
+}
+
 void Program::launch_kernel(const CompiledKernelData &compiled_kernel_data,
                             LaunchContextBuilder &ctx) {
   program_impl_->get_kernel_launcher().launch_kernel(compiled_kernel_data, ctx);
@@ -393,7 +403,8 @@ Ndarray *Program::create_ndarray(const DataType type,
   if (zero_fill) {
     Arch arch = compile_config().arch;
     if (arch_is_cpu(arch) || arch == Arch::cuda || arch == Arch::amdgpu) {
-      fill_ndarray_fast_u32(arr.get(), /*data=*/0);
+      program_impl_->fill_new_allocation_with_zeros(
+          arr->ndarray_alloc_, arr->get_element_size() * arr->get_nelement());
     } else if (arch != Arch::dx12) {
       // Device api support for dx12 backend are not complete yet
       Stream *stream =
@@ -411,6 +422,41 @@ Ndarray *Program::create_ndarray(const DataType type,
   return arr_ptr;
 }
 
+Ndarray *Program::create_ndarray_from_host_memory(
+    void *ptr,
+    const DataType type,
+    const std::vector<int> &shape,
+    const std::vector<int> &strides,
+    std::function<void()> release,
+    const DebugInfo &dbg_info) {
+  TI_ERROR_IF(!arch_is_cpu(compile_config().arch),
+              "Ndarrays can alias host memory only on the CPU backend, not "
+              "on {}",
+              arch_name(compile_config().arch));
+  // The extent of the memory, from the first scalar to past the last one
+  std::size_t size = data_type_size(type);
+  if (strides.empty()) {
+    for (int dim : shape) {
+      size *= dim;
+    }
+  } else {
+    std::size_t num_scalars = 1;
+    for (int dim : data_type_shape(type)) {
+      num_scalars *= dim;
+    }
+    for (int i = 0; i < (int)shape.size(); i++) {
+      num_scalars += (std::size_t)(shape[i] - 1) * strides[i];
+    }
+    size = num_scalars * data_type_size(type.get_element_type());
+  }
+  auto alloc = program_impl_->import_memory(ptr, size);
+  auto arr = std::make_unique<Ndarray>(this, alloc, type, shape, strides,
+                                       std::move(release), dbg_info);
+  auto arr_ptr = arr.get();
+  ndarrays_.insert({arr_ptr, std::move(arr)});
+  return arr_ptr;
+}
+
 ArgPack *Program::create_argpack(const DataType dt) {
   auto pack = std::make_unique<ArgPack>(this, dt);
   auto pack_ptr = pack.get();
@@ -485,6 +531,8 @@ intptr_t Program::get_ndarray_data_ptr_as_int(const Ndarray *ndarray) {
 }
 
 void Program::fill_ndarray_fast_u32(Ndarray *ndarray, uint32_t val) {
+  TI_ERROR_IF(ndarray->is_strided(),
+              "Strided ndarrays must be filled by a kernel");
   // This is a temporary solution to bypass device api.
   // Should be moved to CommandList once available in CUDA.
   program_impl_->fill_ndarray(
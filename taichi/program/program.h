@@ -130,6 +130,12 @@ class TI_DLL_EXPORT Program {
                                            const DeviceCapabilityConfig &caps,
                                            const Kernel &kernel_def);
 
+  // Compiles the kernels in the background; see
+  // KernelCompilationManager::prefetch().
+  void prefetch_kernels(const CompileConfig &compile_config,
+                        const DeviceCapabilityConfig &caps,
+                        const std::vector<Kernel *> &kernel_defs);
+
   void launch_kernel(const CompiledKernelData &compiled_kernel_data,
                      LaunchContextBuilder &ctx);
 
@@ -257,6 +263,18 @@ class TI_DLL_EXPORT Program {
       bool zero_fill = false,
       const DebugInfo &dbg_info = DebugInfo());
 
+  // Creates an Ndarray aliasing |ptr|, host memory owned by someone else,
+  // e.g. imported through DLPack. Only on the CPU backend. |strides| are in
+  // scalars, empty for a compact row-major array. |release| is called when
+  // the Ndarray is deleted.
+  Ndarray *create_ndarray_from_host_memory(
+      void *ptr,
+      const DataType type,
+      const std::vector<int> &shape,
+      const std::vector<int> &strides,
+      std::function<void()> release,
+      const DebugInfo &dbg_info = DebugInfo());
+
   ArgPack *create_argpack(const DataType dt);
 
   std::string get_kernel_return_data_layout() {
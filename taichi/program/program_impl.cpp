@@ -26,6 +26,8 @@ KernelCompilationManager &ProgramImpl::get_kernel_compilation_manager() {
   KernelCompilationManager::Config cfg;
   cfg.offline_cache_path = config->offline_cache_file_path;
   cfg.kernel_compiler = make_kernel_compiler();
+  cfg.use_cache_pack = config->offline_cache_layout == "pack";
+  cfg.num_prefetch_threads = config->num_compile_threads;
   kernel_com_mgr_ = std::make_unique<KernelCompilationManager>(std::move(cfg));
   return *kernel_com_mgr_;
 }
@@ -100,6 +100,13 @@ class ProgramImpl {
     return kDeviceNullAllocation;
   }
 
+  // Wraps |size| bytes at |ptr|, which the caller keeps alive, into an
+  // allocation of the compute device
+  virtual DeviceAllocation import_memory(void *ptr, std::size_t size) {
+    TI_ERROR("import_memory() not implemented on the current backend");
+    return kDeviceNullAllocation;
+  }
+
   virtual bool used_in_kernel(DeviceAllocationId) {
     return false;
   }
@@ -125,6 +132,13 @@ class ProgramImpl {
     TI_ERROR("fill_ndarray() not implemented on the current backend");
   }
 
+  // Zero-fills the |size| bytes of a buffer that was just returned by
+  // allocate_memory_on_device()
+  virtual void fill_new_allocation_with_zeros(const DeviceAllocation &alloc,
+                                              std::size_t size) {
+    fill_ndarray(alloc, size / sizeof(uint32_t), /*data=*/0);
+  }
+
   virtual void enqueue_compute_op_lambda(
       std::function<void(Device *device, CommandList *cmdlist)> op,
       const std::vector<ComputeOpImageRef> &image_refs) {
@@ -9,6 +9,10 @@
 #include "Eigen/Dense"
 #include "Eigen/SparseLU"
 
+#ifdef TI_WITH_LLVM
+#include "taichi/runtime/program_impls/llvm/llvm_program.h"
+#endif
+
 #define BUILD(TYPE)                                                         \
   {                                                                         \
     using T = Eigen::Triplet<float##TYPE>;                                  \
@@ -99,6 +103,7 @@ void SparseMatrixBuilder::create_ndarray(Program *prog) {
   ndarray_data_base_ptr_ = prog->create_ndarray(
       dtype_, std::vector<int>{3 * (int)max_num_triplets_ + 1});
   ndarray_data_ptr_ = prog->get_ndarray_data_ptr_as_int(ndarray_data_base_ptr_);
+  thread_pool_ = get_cpu_thread_pool(prog);
 }
 
 void SparseMatrixBuilder::delete_ndarray(Program *prog) {
@@ -160,17 +165,21 @@ intptr_t SparseMatrixBuilder::get_ndarray_data_ptr() const {
 
 template <typename T, typename G>
 void SparseMatrixBuilder::build_template(std::unique_ptr<SparseMatrix> &m) {
-  using V = Eigen::Triplet<T>;
-  std::vector<V> triplets;
   auto ptr = get_ndarray_data_ptr();
   G *data = reinterpret_cast<G *>(ptr);
   num_triplets_ = data[0];
   data += 1;
-  for (int i = 0; i < num_triplets_; i++) {
-    triplets.push_back(
-        V(data[i * 3], data[i * 3 + 1], taichi_union_cast<T>(data[i * 3 + 2])));
+  if (!assembler_) {
+    assembler_ = std::make_unique<SparseMatrixAssembler>(
+        rows_, cols_, storage_format_ == "row_major", thread_pool_);
   }
-  m->build_triplets(static_cast<void *>(&triplets));
+  std::vector<T> values;
+  bool reused = assembler_->assemble<T, G>(data, num_triplets_, values);
+  TI_TRACE("Assembled {} triplets into {} nonzeros (pattern reused: {})",
+           num_triplets_, assembler_->num_nonzeros(), reused);
+  m->build_compressed(assembler_->outer_ptr().data(),
+                      assembler_->inner_indices().data(), values.data(),
+                      assembler_->num_nonzeros());
   clear();
 }
 
@@ -205,31 +214,24 @@ std::unique_ptr<SparseMatrix> SparseMatrixBuilder::build_cuda() {
   CUDADriver::get_instance().memcpy_device_to_host(
       (void *)trips.data(), (void *)get_ndarray_data_ptr(),
       len * sizeof(float32));
-  std::unordered_map<int, std::tuple<int, int, float32>> entries;
-  for (auto i = 0; i < num_triplets_; i++) {
-    int row = taichi_union_cast<int>(trips[3 * i + 1]);
-    int col = taichi_union_cast<int>(trips[3 * i + 2]);
-    auto val = trips[i * 3 + 3];
-    auto e_idx = row * cols_ + col;
-    if (entries.find(e_idx) == entries.end()) {
-      entries[e_idx] = std::make_tuple(row, col, val);
-    } else {
-      auto [r, c, v] = entries[e_idx];
-      entries[e_idx] = std::make_tuple(r, c, v + val);
-    }
+  // The triplets are summed into CSR on the host, then uploaded as COO.
+  if (!assembler_) {
+    assembler_ = std::make_unique<SparseMatrixAssembler>(
+        rows_, cols_, /*row_major=*/true, thread_pool_);
   }
-  auto entry_size = entries.size();
-  int *row_host = (int *)malloc(sizeof(int) * entry_size);
-  int *col_host = (int *)malloc(sizeof(int) * entry_size);
-  float32 *value_host = (float32 *)malloc(sizeof(float32) * entry_size);
-  int count = 0;
-  for (auto entry : entries) {
-    auto [row, col, value] = entry.second;
-    row_host[count] = row;
-    col_host[count] = col;
-    value_host[count] = value;
-    count++;
+  std::vector<float32> values;
+  assembler_->assemble<float32, int32>((const int32 *)trips.data() + 1,
+                                       num_triplets_, values);
+  const auto &row_ptr = assembler_->outer_ptr();
+  auto entry_size = assembler_->num_nonzeros();
+  std::vector<int> rows(entry_size);
+  for (int row = 0; row < rows_; row++) {
+    std::fill(rows.begin() + row_ptr[row], rows.begin() + row_ptr[row + 1],
+              row);
   }
+  const int *row_host = rows.data();
+  const int *col_host = assembler_->inner_indices().data();
+  const float32 *value_host = values.data();
   void *row_device = nullptr, *col_device = nullptr, *value_device = nullptr;
   CUDADriver::get_instance().malloc(&row_device, entry_size * sizeof(int));
   CUDADriver::get_instance().malloc(&col_device, entry_size * sizeof(int));
@@ -243,9 +245,6 @@ std::unique_ptr<SparseMatrix> SparseMatrixBuilder::build_cuda() {
       value_device, (void *)value_host, entry_size * sizeof(float32));
   sm->build_csr_from_coo(row_device, col_device, value_device, entry_size);
   clear();
-  free(row_host);
-  free(col_host);
-  free(value_host);
 #endif
   return sm;
 }
@@ -293,6 +292,22 @@ void EigenSparseMatrix<EigenMatrix>::build_triplets(void *triplets_adr) {
   }
 }
 
+template <class EigenMatrix>
+void EigenSparseMatrix<EigenMatrix>::build_compressed(const int *outer_ptr,
+                                                      const int *inner_indices,
+                                                      const void *values,
+                                                      int nnz) {
+  using Scalar = typename EigenMatrix::Scalar;
+  TI_ASSERT(data_type_size(dtype_) == sizeof(Scalar));
+  matrix_.resize(rows_, cols_);
+  matrix_.resizeNonZeros(nnz);
+  std::copy(outer_ptr, outer_ptr + matrix_.outerSize() + 1,
+            matrix_.outerIndexPtr());
+  std::copy(inner_indices, inner_indices + nnz, matrix_.innerIndexPtr());
+  std::copy((const Scalar *)values, (const Scalar *)values + nnz,
+            matrix_.valuePtr());
+}
+
 template <class EigenMatrix>
 void EigenSparseMatrix<EigenMatrix>::spmv(Program *prog,
                                           const Ndarray &x,
@@ -900,4 +915,13 @@ void CuSparseMatrix::mmwrite(const std::string &filename) {
 #endif
 }
 
+ThreadPool *get_cpu_thread_pool(Program *prog) {
+#ifdef TI_WITH_LLVM
+  if (prog != nullptr && arch_is_cpu(prog->compile_config().arch)) {
+    return get_llvm_program(prog)->get_runtime_executor()->get_thread_pool();
+  }
+#endif
+  return nullptr;
+}
+
 }  // namespace taichi::lang
@@ -5,6 +5,7 @@
 #include "taichi/ir/type_utils.h"
 #include "taichi/program/ndarray.h"
 #include "taichi/program/program.h"
+#include "taichi/program/sparse_matrix_assembler.h"
 #include "taichi/rhi/cuda/cuda_driver.h"
 
 #include "Eigen/Sparse"
@@ -54,6 +55,9 @@ class SparseMatrixBuilder {
   bool built_{false};
   DataType dtype_{PrimitiveType::f32};
   std::string storage_format_{"col_major"};
+  ThreadPool *thread_pool_{nullptr};
+  // Kept across builds to reuse the sparsity pattern
+  std::unique_ptr<SparseMatrixAssembler> assembler_;
 };
 
 class SparseMatrix {
@@ -79,6 +83,16 @@ class SparseMatrix {
                                   int nnz) {
     TI_NOT_IMPLEMENTED;
   }
+
+  // Takes the compressed arrays (CSR or CSC, following the storage format)
+  // of an already assembled matrix. |values| has the matrix's data type.
+  virtual void build_compressed(const int *outer_ptr,
+                                const int *inner_indices,
+                                const void *values,
+                                int nnz) {
+    TI_NOT_IMPLEMENTED;
+  }
+
   inline const int num_rows() const {
     return rows_;
   }
@@ -140,6 +154,10 @@ class EigenSparseMatrix : public SparseMatrix {
   ~EigenSparseMatrix() override = default;
 
   void build_triplets(void *triplets_adr) override;
+  void build_compressed(const int *outer_ptr,
+                        const int *inner_indices,
+                        const void *values,
+                        int nnz) override;
   const std::string to_string() const override;
 
   // Write the sparse matrix to a Matrix Market file
@@ -348,4 +366,8 @@ std::unique_ptr<SparseMatrix> make_cu_sparse_matrix(cusparseSpMatDescr_t mat,
 void make_sparse_matrix_from_ndarray(Program *prog,
                                      SparseMatrix &sm,
                                      const Ndarray &ndarray);
+
+// The pool of the CPU backend, which the host-side sparse solvers share. Null
+// on other backends.
+ThreadPool *get_cpu_thread_pool(Program *prog);
 }  // namespace taichi::lang
@@ -0,0 +1,246 @@
+#include "taichi/program/sparse_matrix_assembler.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include "taichi/inc/constants.h"
+
+namespace taichi::lang {
+
+namespace {
+
+// Below this many items a phase runs on the calling thread.
+constexpr int kMinParallelWork = 1 << 15;
+
+int split_begin(int n, int num_splits, int i) {
+  return int((int64)n * i / num_splits);
+}
+
+// Sorts the entries of a bucket by inner index, keeping the order of
+// duplicates. Buckets are mostly as short as a matrix row, where an insertion
+// sort beats std::stable_sort and its temporary buffer.
+template <typename It>
+void stable_sort_bucket(It first, It last) {
+  if (last - first > 32) {
+    std::stable_sort(first, last, [](const auto &a, const auto &b) {
+      return a.inner < b.inner;
+    });
+    return;
+  }
+  for (It it = first + (first != last); it < last; ++it) {
+    auto entry = *it;
+    It hole = it;
+    for (; hole != first && entry.inner < (hole - 1)->inner; --hole) {
+      *hole = *(hole - 1);
+    }
+    *hole = entry;
+  }
+}
+
+}  // namespace
+
+SparseMatrixAssembler::SparseMatrixAssembler(int rows,
+                                             int cols,
+                                             bool row_major,
+                                             ThreadPool *thread_pool)
+    : rows_(rows),
+      cols_(cols),
+      row_major_(row_major),
+      outer_size_(row_major ? rows : cols),
+      thread_pool_(thread_pool) {
+  if (thread_pool_) {
+    num_threads_ = std::max(1, thread_pool_->get_max_num_threads());
+  }
+}
+
+template <typename F>
+void SparseMatrixAssembler::parallel_for(int n, int num_splits, const F &f) {
+  num_splits = std::max(1, std::min(num_splits, n));
+  if (n < kMinParallelWork || num_splits == 1 || !thread_pool_) {
+    for (int i = 0; i < num_splits; i++) {
+      f(i, split_begin(n, num_splits, i), split_begin(n, num_splits, i + 1));
+    }
+    return;
+  }
+  struct Task {
+    const F *f;
+    int n;
+    int num_splits;
+  } task{&f, n, num_splits};
+  thread_pool_->run(num_splits, num_threads_, &task,
+                    [](void *context, int thread_id, int i) {
+                      auto &task = *(Task *)context;
+                      (*task.f)(i, split_begin(task.n, task.num_splits, i),
+                                split_begin(task.n, task.num_splits, i + 1));
+                    });
+}
+
+template <typename T, typename G>
+void SparseMatrixAssembler::build_pattern(const G *triplets,
+                                          int num_triplets,
+                                          std::vector<T> &values) {
+  const int outer_index = row_major_ ? 0 : 1;
+  auto outer = [&](int t) { return int(triplets[t * 3 + outer_index]); };
+  auto inner = [&](int t) { return int(triplets[t * 3 + 1 - outer_index]); };
+
+  // Every chunk of triplets gets its own histogram of the outer indices.
+  // Their number is capped so that the histograms take no more memory than
+  // the triplets themselves.
+  const int num_chunks = std::clamp(
+      num_triplets / std::max(outer_size_, 1), 1, num_threads_);
+  const int outer_splits = num_threads_ * 4;
+  std::vector<int> offsets((std::size_t)num_chunks * outer_size_, 0);
+  std::atomic<bool> out_of_range{false};
+  parallel_for(num_triplets, num_chunks, [&](int chunk, int begin, int end) {
+    int *counts = offsets.data() + (std::size_t)chunk * outer_size_;
+    for (int t = begin; t < end; t++) {
+      const G row = triplets[t * 3];
+      const G col = triplets[t * 3 + 1];
+      if (row < 0 || row >= rows_ || col < 0 || col >= cols_) {
+        out_of_range = true;
+        return;
+      }
+      counts[outer(t)]++;
+    }
+  });
+  TI_ERROR_IF(out_of_range,
+              "Sparse matrix triplet index out of range for a {}x{} matrix",
+              rows_, cols_);
+
+  // Turn the histograms into the positions each chunk scatters to. Within a
+  // bucket, chunks keep their order, so the scatter is stable.
+  std::vector<int> bucket_ptr(outer_size_ + 1, 0);
+  parallel_for(outer_size_, outer_splits, [&](int, int begin, int end) {
+    for (int o = begin; o < end; o++) {
+      int total = 0;
+      for (int c = 0; c < num_chunks; c++) {
+        total += offsets[(std::size_t)c * outer_size_ + o];
+      }
+      bucket_ptr[o + 1] = total;
+    }
+  });
+  for (int o = 0; o < outer_size_; o++) {
+    bucket_ptr[o + 1] += bucket_ptr[o];
+  }
+  parallel_for(outer_size_, outer_splits, [&](int, int begin, int end) {
+    for (int o = begin; o < end; o++) {
+      int offset = bucket_ptr[o];
+      for (int c = 0; c < num_chunks; c++) {
+        auto &count = offsets[(std::size_t)c * outer_size_ + o];
+        const int next = offset + count;
+        count = offset;
+        offset = next;
+      }
+    }
+  });
+
+  // The values travel with the triplets, so that they are summed without
+  // another pass over the triplets.
+  std::vector<Entry<T>> entries(num_triplets);
+  parallel_for(num_triplets, num_chunks, [&](int chunk, int begin, int end) {
+    int *offset = offsets.data() + (std::size_t)chunk * outer_size_;
+    for (int t = begin; t < end; t++) {
+      entries[offset[outer(t)]++] = {inner(t), t,
+                                     taichi_union_cast<T>(triplets[t * 3 + 2])};
+    }
+  });
+  offsets = std::vector<int>();
+
+  // Sort every bucket and count its distinct inner indices.
+  outer_ptr_.assign(outer_size_ + 1, 0);
+  parallel_for(outer_size_, outer_splits, [&](int, int begin, int end) {
+    for (int o = begin; o < end; o++) {
+      auto first = entries.begin() + bucket_ptr[o];
+      auto last = entries.begin() + bucket_ptr[o + 1];
+      stable_sort_bucket(first, last);
+      int num_unique = 0;
+      for (auto it = first; it != last; ++it) {
+        if (it == first || it->inner != (it - 1)->inner) {
+          num_unique++;
+        }
+      }
+      outer_ptr_[o + 1] = num_unique;
+    }
+  });
+  for (int o = 0; o < outer_size_; o++) {
+    outer_ptr_[o + 1] += outer_ptr_[o];
+  }
+
+  const int nnz = outer_ptr_[outer_size_];
+  inner_indices_.resize(nnz);
+  segments_.resize(nnz + 1);
+  segments_[nnz] = num_triplets;
+  sorted_triplets_.resize(num_triplets);
+  values.resize(nnz);
+  parallel_for(outer_size_, outer_splits, [&](int, int begin, int end) {
+    for (int o = begin; o < end; o++) {
+      int k = outer_ptr_[o];
+      for (int j = bucket_ptr[o]; j < bucket_ptr[o + 1]; j++) {
+        const auto &entry = entries[j];
+        sorted_triplets_[j] = entry.triplet;
+        if (j == bucket_ptr[o] || entry.inner != inner_indices_[k - 1]) {
+          inner_indices_[k] = entry.inner;
+          segments_[k] = j;
+          values[k] = entry.value;
+          k++;
+        } else {
+          values[k - 1] += entry.value;
+        }
+      }
+    }
+  });
+  num_triplets_ = num_triplets;
+}
+
+template <typename T, typename G>
+bool SparseMatrixAssembler::gather_values(const G *triplets,
+                                          int num_triplets,
+                                          std::vector<T> &values) {
+  const int outer_index = row_major_ ? 0 : 1;
+  values.resize(inner_indices_.size());
+  // Every triplet is visited once, so this also verifies that the triplets
+  // still have the cached pattern.
+  std::atomic<bool> mismatch{false};
+  parallel_for(outer_size_, num_threads_ * 4, [&](int, int begin, int end) {
+    for (int o = begin; o < end && !mismatch; o++) {
+      for (int k = outer_ptr_[o]; k < outer_ptr_[o + 1]; k++) {
+        T sum = 0;
+        for (int j = segments_[k]; j < segments_[k + 1]; j++) {
+          const G *triplet = triplets + (std::size_t)sorted_triplets_[j] * 3;
+          if (triplet[outer_index] != o ||
+              triplet[1 - outer_index] != inner_indices_[k]) {
+            mismatch = true;
+            return;
+          }
+          const T value = taichi_union_cast<T>(triplet[2]);
+          sum = j == segments_[k] ? value : sum + value;
+        }
+        values[k] = sum;
+      }
+    }
+  });
+  return !mismatch;
+}
+
+template <typename T, typename G>
+bool SparseMatrixAssembler::assemble(const G *triplets,
+                                     int num_triplets,
+                                     std::vector<T> &values) {
+  if (num_triplets == num_triplets_ &&
+      gather_values(triplets, num_triplets, values)) {
+    return true;
+  }
+  build_pattern(triplets, num_triplets, values);
+  return false;
+}
+
+template bool SparseMatrixAssembler::assemble<float32, int32>(
+    const int32 *triplets,
+    int num_triplets,
+    std::vector<float32> &values);
+template bool SparseMatrixAssembler::assemble<float64, int64>(
+    const int64 *triplets,
+    int num_triplets,
+    std::vector<float64> &values);
+
+}  // namespace taichi::lang
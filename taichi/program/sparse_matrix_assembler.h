@@ -0,0 +1,93 @@
+#pragma once
+
+#include <vector>
+
+#include "taichi/common/core.h"
+#include "taichi/system/threading.h"
+
+namespace taichi::lang {
+
+// Assembles a compressed sparse matrix (CSR for row-major storage, CSC for
+// column-major storage) from the COO triplets filled by a
+// SparseMatrixBuilder, on multiple threads.
+//
+// Triplets are bucketed by their outer index (row for CSR, column for CSC)
+// with a parallel counting sort, then every bucket is sorted by inner index
+// and duplicates are summed. The sort is stable, so duplicates are summed in
+// the order the triplets were written, like Eigen's setFromTriplets().
+//
+// The resulting pattern is kept, along with where every triplet went. When
+// the next triplets have the same (row, col) sequence, their values are
+// gathered straight into the cached pattern, which skips the bucketing and
+// the sort. Assembly loops that write the same elements in the same order
+// every step, e.g. FEM solvers of fixed connectivity, hit this path.
+//
+// The phases run on |thread_pool|, usually the CPU thread pool of the
+// program. Without a pool everything runs on the calling thread.
+class SparseMatrixAssembler {
+ public:
+  SparseMatrixAssembler(int rows,
+                        int cols,
+                        bool row_major,
+                        ThreadPool *thread_pool);
+
+  // |triplets| holds |num_triplets| [row, col, value] triples of G words,
+  // with the value bit-cast to G. Fills |values| with the nonzeros in
+  // compressed order. Returns true if the pattern of the previous call was
+  // reused.
+  template <typename T, typename G>
+  bool assemble(const G *triplets, int num_triplets, std::vector<T> &values);
+
+  const std::vector<int> &outer_ptr() const {
+    return outer_ptr_;
+  }
+
+  const std::vector<int> &inner_indices() const {
+    return inner_indices_;
+  }
+
+  int num_nonzeros() const {
+    return (int)inner_indices_.size();
+  }
+
+ private:
+  // A triplet in a bucket
+  template <typename T>
+  struct Entry {
+    int inner;
+    int triplet;
+    T value;
+  };
+
+  template <typename T, typename G>
+  void build_pattern(const G *triplets,
+                     int num_triplets,
+                     std::vector<T> &values);
+
+  // Returns false if the triplets do not have the cached pattern.
+  template <typename T, typename G>
+  bool gather_values(const G *triplets,
+                     int num_triplets,
+                     std::vector<T> &values);
+
+  // Runs f(split, begin, end) over |num_splits| even slices of [0, n).
+  template <typename F>
+  void parallel_for(int n, int num_splits, const F &f);
+
+  int rows_{0};
+  int cols_{0};
+  bool row_major_{false};
+  int outer_size_{0};
+  int num_threads_{1};
+  ThreadPool *thread_pool_{nullptr};
+
+  // The cached pattern. Nonzero k sums the triplets
+  // sorted_triplets_[segments_[k]..segments_[k + 1]).
+  int num_triplets_{-1};
+  std::vector<int> outer_ptr_;
+  std::vector<int> inner_indices_;
+  std::vector<int> segments_;
+  std::vector<int> sorted_triplets_;
+};
+
+}  // namespace taichi::lang
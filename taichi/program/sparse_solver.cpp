@@ -173,6 +173,99 @@ INSTANTIATE_LLT_SOLVE_RF(float64, LDLT, AMD, Eigen::VectorXd)
 INSTANTIATE_LU_SOLVE_RF(float64, LU, AMD, Eigen::VectorXd)
 INSTANTIATE_LU_SOLVE_RF(float64, LU, COLAMD, Eigen::VectorXd)
 
+namespace {
+
+// The compressed column arrays of |sm|, copied into |storage| if |sm| is
+// row-major or not compressed
+template <typename DT>
+const Eigen::SparseMatrix<DT> &compressed_matrix(
+    const SparseMatrix &sm,
+    Eigen::SparseMatrix<DT> *storage) {
+  using RowMajorMatrix = Eigen::SparseMatrix<DT, Eigen::RowMajor>;
+  if (dynamic_cast<const EigenSparseMatrix<RowMajorMatrix> *>(&sm)) {
+    *storage = *(const RowMajorMatrix *)sm.get_matrix();
+  } else {
+    auto *mat = (const Eigen::SparseMatrix<DT> *)sm.get_matrix();
+    if (mat->isCompressed()) {
+      return *mat;
+    }
+    *storage = *mat;
+  }
+  storage->makeCompressed();
+  return *storage;
+}
+
+}  // namespace
+
+template <typename DT>
+SupernodalSparseSolver<DT>::SupernodalSparseSolver(bool ldlt,
+                                                   SupernodalOrdering ordering,
+                                                   ThreadPool *thread_pool)
+    : solver_(ldlt, ordering) {
+  solver_.set_thread_pool(thread_pool);
+}
+
+template <typename DT>
+bool SupernodalSparseSolver<DT>::compute(const SparseMatrix &sm) {
+  analyze_pattern(sm);
+  factorize(sm);
+  return info();
+}
+
+template <typename DT>
+void SupernodalSparseSolver<DT>::analyze_pattern(const SparseMatrix &sm) {
+  TI_ERROR_IF(sm.num_rows() != sm.num_cols(),
+              "The supernodal solver needs a square matrix, got {} x {}",
+              sm.num_rows(), sm.num_cols());
+  if (!is_initialized_) {
+    SparseSolver::init_solver(sm.num_rows(), sm.num_cols(), sm.get_data_type());
+  }
+  Eigen::SparseMatrix<DT> storage;
+  const auto &mat = compressed_matrix<DT>(sm, &storage);
+  solver_.analyze_pattern(mat.cols(), mat.outerIndexPtr(),
+                          mat.innerIndexPtr());
+}
+
+template <typename DT>
+void SupernodalSparseSolver<DT>::factorize(const SparseMatrix &sm) {
+  Eigen::SparseMatrix<DT> storage;
+  const auto &mat = compressed_matrix<DT>(sm, &storage);
+  if (!solver_.has_pattern(mat.cols(), mat.outerIndexPtr(),
+                           mat.innerIndexPtr())) {
+    TI_TRACE("The pattern of the matrix changed, analyzing it again");
+    analyze_pattern(sm);
+  }
+  solver_.factorize(mat.valuePtr());
+}
+
+template <typename DT>
+typename SupernodalSparseSolver<DT>::Vector SupernodalSparseSolver<DT>::solve(
+    const Vector &b) {
+  TI_ERROR_IF(b.size() != cols_, "Expected a vector of size {}, got {}",
+              cols_, b.size());
+  Vector x(rows_);
+  solver_.solve(b.data(), x.data());
+  return x;
+}
+
+template <typename DT>
+void SupernodalSparseSolver<DT>::solve_rf(Program *prog,
+                                          const SparseMatrix &sm,
+                                          const Ndarray &b,
+                                          const Ndarray &x) {
+  size_t db = prog->get_ndarray_data_ptr_as_int(&b);
+  size_t dX = prog->get_ndarray_data_ptr_as_int(&x);
+  solver_.solve((const DT *)db, (DT *)dX);
+}
+
+template <typename DT>
+bool SupernodalSparseSolver<DT>::info() {
+  return solver_.info();
+}
+
+template class SupernodalSparseSolver<float32>;
+template class SupernodalSparseSolver<float64>;
+
 CuSparseSolver::CuSparseSolver() {
   init_solver();
 }
@@ -575,6 +668,28 @@ std::unique_ptr<SparseSolver> make_sparse_solver(DataType dt,
     TI_ERROR("Not supported sparse solver type: {}", solver_type);
 }
 
+std::unique_ptr<SparseSolver> make_supernodal_sparse_solver(
+    Program *prog,
+    DataType dt,
+    const std::string &solver_type,
+    const std::string &ordering) {
+  if (solver_type != "LLT" && solver_type != "LDLT") {
+    TI_ERROR("Not supported supernodal solver type: {}", solver_type);
+  }
+  const bool ldlt = solver_type == "LDLT";
+  const auto order = supernodal_ordering_from_name(ordering);
+  ThreadPool *thread_pool = get_cpu_thread_pool(prog);
+  if (dt == PrimitiveType::f32) {
+    return std::make_unique<SupernodalSparseSolver<float32>>(ldlt, order,
+                                                             thread_pool);
+  } else if (dt == PrimitiveType::f64) {
+    return std::make_unique<SupernodalSparseSolver<float64>>(ldlt, order,
+                                                             thread_pool);
+  }
+  TI_ERROR("Not supported sparse solver data type: {}",
+           taichi::lang::data_type_name(dt));
+}
+
 CuSparseSolver::~CuSparseSolver() {
 #if defined(TI_WITH_CUDA)
   if (h_Q_ != nullptr)
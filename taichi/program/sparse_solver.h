@@ -5,6 +5,7 @@
 #include "taichi/ir/type.h"
 #include "taichi/rhi/cuda/cuda_driver.h"
 #include "taichi/program/program.h"
+#include "taichi/program/supernodal_cholesky.h"
 
 #define DECLARE_EIGEN_LLT_SOLVER(dt, type, order)                    \
   typedef EigenSparseSolver<                                         \
@@ -75,6 +76,32 @@ DECLARE_EIGEN_LLT_SOLVER(float64, LDLT, COLAMD);
 DECLARE_EIGEN_LU_SOLVER(float64, LU, AMD);
 DECLARE_EIGEN_LU_SOLVER(float64, LU, COLAMD);
 
+// Supernodal LL^T or LDL^T of a symmetric matrix on the threads of the CPU
+// backend, see SupernodalCholesky. analyze_pattern() is kept across
+// factorize() calls of matrices with the same pattern.
+template <typename DT>
+class SupernodalSparseSolver : public SparseSolver {
+ public:
+  using Vector = Eigen::Matrix<DT, Eigen::Dynamic, 1>;
+
+  SupernodalSparseSolver(bool ldlt,
+                         SupernodalOrdering ordering,
+                         ThreadPool *thread_pool);
+  ~SupernodalSparseSolver() override = default;
+  bool compute(const SparseMatrix &sm) override;
+  void analyze_pattern(const SparseMatrix &sm) override;
+  void factorize(const SparseMatrix &sm) override;
+  Vector solve(const Vector &b);
+  void solve_rf(Program *prog,
+                const SparseMatrix &sm,
+                const Ndarray &b,
+                const Ndarray &x);
+  bool info() override;
+
+ private:
+  SupernodalCholesky<DT> solver_;
+};
+
 class CuSparseSolver : public SparseSolver {
  public:
   enum class SolverType { Cholesky, LU };
@@ -143,6 +170,12 @@ std::unique_ptr<SparseSolver> make_sparse_solver(DataType dt,
                                                  const std::string &solver_type,
                                                  const std::string &ordering);
 
+std::unique_ptr<SparseSolver> make_supernodal_sparse_solver(
+    Program *prog,
+    DataType dt,
+    const std::string &solver_type,
+    const std::string &ordering);
+
 std::unique_ptr<SparseSolver> make_cusparse_solver(
     DataType dt,
     const std::string &solver_type,
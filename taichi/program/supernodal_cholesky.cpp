@@ -0,0 +1,684 @@
+#include "taichi/program/supernodal_cholesky.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include "Eigen/Dense"
+#include "Eigen/OrderingMethods"
+#include "Eigen/Sparse"
+
+namespace taichi::lang {
+
+namespace {
+
+// Relaxed amalgamation, as in CHOLMOD: a supernode is merged into its parent
+// when the merged supernode has up to kRelaxedWidths[i] columns and its
+// fraction of explicit zeros is below kRelaxedZeros[i]. Up to 4 columns, it
+// is always merged.
+constexpr int kAlwaysMergedWidth = 4;
+constexpr int kRelaxedWidths[] = {16, 48};
+constexpr double kRelaxedZeros[] = {0.8, 0.1, 0.05};
+
+// Columns of the update matrix, and rows of the triangular solve, per task
+// when a supernode is split across threads
+constexpr int kUpdateBlockWidth = 64;
+constexpr int kSolveBlockHeight = 256;
+
+template <typename DT>
+using DenseMatrix = Eigen::Matrix<DT, Eigen::Dynamic, Eigen::Dynamic>;
+
+template <typename DT>
+using Panel = Eigen::Map<DenseMatrix<DT>, 0, Eigen::OuterStride<>>;
+
+template <typename DT>
+using Vector = Eigen::Map<Eigen::Matrix<DT, Eigen::Dynamic, 1>>;
+
+bool merge_is_relaxed(int width, std::size_t zeros, std::size_t entries) {
+  if (width <= kAlwaysMergedWidth) {
+    return true;
+  }
+  const double fraction = double(zeros) / double(entries);
+  if (width <= kRelaxedWidths[0]) {
+    return fraction < kRelaxedZeros[0];
+  }
+  if (width <= kRelaxedWidths[1]) {
+    return fraction < kRelaxedZeros[1];
+  }
+  return fraction < kRelaxedZeros[2];
+}
+
+// Entries of a supernode panel below and on the diagonal
+std::size_t trapezoid_size(std::size_t width, std::size_t below) {
+  return width * (width + 1) / 2 + width * below;
+}
+
+}  // namespace
+
+SupernodalOrdering supernodal_ordering_from_name(const std::string &name) {
+  if (name == "natural") {
+    return SupernodalOrdering::natural;
+  } else if (name == "AMD") {
+    return SupernodalOrdering::amd;
+  } else if (name == "COLAMD") {
+    return SupernodalOrdering::colamd;
+  }
+  TI_ERROR(
+      "Unknown ordering \"{}\" for the supernodal solver, expected one of "
+      "natural, AMD and COLAMD",
+      name);
+}
+
+template <typename DT>
+SupernodalCholesky<DT>::SupernodalCholesky(bool ldlt,
+                                           SupernodalOrdering ordering)
+    : ldlt_(ldlt), ordering_(ordering) {
+}
+
+template <typename DT>
+template <typename F>
+void SupernodalCholesky<DT>::parallel_for(int n, const F &f) {
+  if (thread_pool_ == nullptr || n <= 1) {
+    for (int i = 0; i < n; i++) {
+      f(i);
+    }
+    return;
+  }
+  thread_pool_->run(n, thread_pool_->get_max_num_threads(), (void *)&f,
+                    [](void *context, int thread_id, int i) {
+                      (*(const F *)context)(i);
+                    });
+}
+
+template <typename DT>
+void SupernodalCholesky<DT>::build_permuted_lower(
+    const std::vector<int> &perm) {
+  const int *outer_ptr = pattern_outer_ptr_.data();
+  const int *inner_indices = pattern_inner_indices_.data();
+  std::vector<int> inverse_perm(n_);
+  for (int i = 0; i < n_; i++) {
+    inverse_perm[perm[i]] = i;
+  }
+  lower_ptr_.assign(n_ + 1, 0);
+  for (int j = 0; j < n_; j++) {
+    for (int k = outer_ptr[j]; k < outer_ptr[j + 1]; k++) {
+      if (inner_indices[k] >= j) {
+        const int col =
+            std::min(inverse_perm[inner_indices[k]], inverse_perm[j]);
+        lower_ptr_[col + 1]++;
+      }
+    }
+  }
+  for (int j = 0; j < n_; j++) {
+    lower_ptr_[j + 1] += lower_ptr_[j];
+  }
+  lower_rows_.resize(lower_ptr_[n_]);
+  lower_source_.resize(lower_ptr_[n_]);
+  std::vector<int> offset(lower_ptr_.begin(), lower_ptr_.end() - 1);
+  for (int j = 0; j < n_; j++) {
+    for (int k = outer_ptr[j]; k < outer_ptr[j + 1]; k++) {
+      const int i = inner_indices[k];
+      if (i >= j) {
+        const int row = std::max(inverse_perm[i], inverse_perm[j]);
+        const int col = std::min(inverse_perm[i], inverse_perm[j]);
+        lower_rows_[offset[col]] = row;
+        lower_source_[offset[col]++] = k;
+      }
+    }
+  }
+}
+
+template <typename DT>
+void SupernodalCholesky<DT>::build_etree(std::vector<int> *col_counts) {
+  // The rows of the lower triangle, i.e. the columns of the upper one
+  std::vector<int> row_ptr(n_ + 1, 0);
+  for (int row : lower_rows_) {
+    row_ptr[row + 1]++;
+  }
+  for (int i = 0; i < n_; i++) {
+    row_ptr[i + 1] += row_ptr[i];
+  }
+  std::vector<int> row_cols(lower_rows_.size());
+  std::vector<int> offset(row_ptr.begin(), row_ptr.end() - 1);
+  for (int j = 0; j < n_; j++) {
+    for (int k = lower_ptr_[j]; k < lower_ptr_[j + 1]; k++) {
+      row_cols[offset[lower_rows_[k]]++] = j;
+    }
+  }
+
+  // Liu's algorithm, with path compression through |ancestor|
+  parent_.assign(n_, -1);
+  std::vector<int> ancestor(n_, -1);
+  for (int k = 0; k < n_; k++) {
+    for (int p = row_ptr[k]; p < row_ptr[k + 1]; p++) {
+      int i = row_cols[p];
+      while (i != -1 && i < k) {
+        const int next = ancestor[i];
+        ancestor[i] = k;
+        if (next == -1) {
+          parent_[i] = k;
+        }
+        i = next;
+      }
+    }
+  }
+  if (col_counts == nullptr) {
+    return;
+  }
+
+  // Row k of L is the subtree of the etree spanned by the nonzeros of row k
+  // of A. Walking it counts the nonzeros of every column of L.
+  auto &counts = *col_counts;
+  counts.assign(n_, 1);
+  std::vector<int> mark(n_, -1);
+  for (int k = 0; k < n_; k++) {
+    mark[k] = k;
+    for (int p = row_ptr[k]; p < row_ptr[k + 1]; p++) {
+      for (int j = row_cols[p]; j != -1 && mark[j] != k; j = parent_[j]) {
+        mark[j] = k;
+        counts[j]++;
+      }
+    }
+  }
+}
+
+template <typename DT>
+void SupernodalCholesky<DT>::build_supernodes(
+    const std::vector<int> &col_counts) {
+  std::vector<int> num_children(n_, 0);
+  for (int j = 0; j < n_; j++) {
+    if (parent_[j] != -1) {
+      num_children[parent_[j]]++;
+    }
+  }
+  // Fundamental supernodes: chains of columns where every column is the only
+  // child of the next one and has the same structure below it.
+  std::vector<int> fundamental;
+  for (int j = 0; j < n_; j++) {
+    if (j == 0 || parent_[j - 1] != j || num_children[j] != 1 ||
+        col_counts[j - 1] != col_counts[j] + 1) {
+      fundamental.push_back(j);
+    }
+  }
+  fundamental.push_back(n_);
+
+  // Merge a supernode into the next one when it is the child ending right
+  // before it. Its rows below are then rows of the next one.
+  super_ptr_.assign(1, 0);
+  std::size_t nonzeros = 0;
+  for (int s = 0; s + 1 < (int)fundamental.size(); s++) {
+    const int begin = fundamental[s];
+    const int end = fundamental[s + 1];
+    std::size_t piece_nonzeros = 0;
+    for (int j = begin; j < end; j++) {
+      piece_nonzeros += col_counts[j];
+    }
+    const int first = super_ptr_.back();
+    if (begin > 0 && parent_[begin - 1] == begin) {
+      const int width = end - first;
+      const std::size_t entries =
+          trapezoid_size(width, col_counts[end - 1] - 1);
+      if (merge_is_relaxed(width, entries - (nonzeros + piece_nonzeros),
+                           entries)) {
+        nonzeros += piece_nonzeros;
+        continue;
+      }
+    }
+    if (begin > 0) {
+      super_ptr_.push_back(begin);
+    }
+    nonzeros = piece_nonzeros;
+  }
+  if (n_ > 0) {
+    super_ptr_.push_back(n_);
+  }
+}
+
+template <typename DT>
+void SupernodalCholesky<DT>::build_structure() {
+  const int num_supernodes = (int)super_ptr_.size() - 1;
+  std::vector<int> supernode_of(n_);
+  for (int s = 0; s < num_supernodes; s++) {
+    std::fill(supernode_of.begin() + super_ptr_[s],
+              supernode_of.begin() + super_ptr_[s + 1], s);
+  }
+  super_parent_.assign(num_supernodes, -1);
+  child_ptr_.assign(num_supernodes + 1, 0);
+  for (int s = 0; s < num_supernodes; s++) {
+    const int parent = parent_[super_ptr_[s + 1] - 1];
+    if (parent != -1) {
+      super_parent_[s] = supernode_of[parent];
+      child_ptr_[super_parent_[s] + 1]++;
+    }
+  }
+  for (int s = 0; s < num_supernodes; s++) {
+    child_ptr_[s + 1] += child_ptr_[s];
+  }
+  children_.resize(child_ptr_[num_supernodes]);
+  {
+    std::vector<int> offset(child_ptr_.begin(), child_ptr_.end() - 1);
+    for (int s = 0; s < num_supernodes; s++) {
+      if (super_parent_[s] != -1) {
+        children_[offset[super_parent_[s]]++] = s;
+      }
+    }
+  }
+
+  // The rows of a supernode are its columns, and the rows below them of the
+  // permuted A and of its children.
+  row_ptr_.assign(1, 0);
+  rows_.clear();
+  std::vector<int> mark(n_, -1);
+  std::vector<int> below;
+  for (int s = 0; s < num_supernodes; s++) {
+    const int first = super_ptr_[s];
+    const int last = super_ptr_[s + 1];
+    for (int j = first; j < last; j++) {
+      rows_.push_back(j);
+    }
+    below.clear();
+    for (int j = first; j < last; j++) {
+      for (int k = lower_ptr_[j]; k < lower_ptr_[j + 1]; k++) {
+        const int row = lower_rows_[k];
+        if (row >= last && mark[row] != s) {
+          mark[row] = s;
+          below.push_back(row);
+        }
+      }
+    }
+    for (int c = child_ptr_[s]; c < child_ptr_[s + 1]; c++) {
+      const int child = children_[c];
+      const int child_width = super_ptr_[child + 1] - super_ptr_[child];
+      for (int k = row_ptr_[child] + child_width; k < row_ptr_[child + 1];
+           k++) {
+        const int row = rows_[k];
+        if (row >= last && mark[row] != s) {
+          mark[row] = s;
+          below.push_back(row);
+        }
+      }
+    }
+    std::sort(below.begin(), below.end());
+    rows_.insert(rows_.end(), below.begin(), below.end());
+    row_ptr_.push_back((int)rows_.size());
+  }
+
+  factor_ptr_.assign(num_supernodes + 1, 0);
+  relative_ptr_.assign(num_supernodes + 1, 0);
+  for (int s = 0; s < num_supernodes; s++) {
+    const std::size_t width = super_ptr_[s + 1] - super_ptr_[s];
+    const std::size_t height = row_ptr_[s + 1] - row_ptr_[s];
+    factor_ptr_[s + 1] = factor_ptr_[s] + width * height;
+    relative_ptr_[s + 1] = relative_ptr_[s] + (height - width);
+  }
+
+  // Precompute where the entries of A and the updates of the children go
+  std::vector<int> position(n_);
+  lower_target_.resize(lower_rows_.size());
+  relative_rows_.resize(relative_ptr_[num_supernodes]);
+  for (int s = 0; s < num_supernodes; s++) {
+    const int first = super_ptr_[s];
+    const int height = row_ptr_[s + 1] - row_ptr_[s];
+    for (int k = row_ptr_[s]; k < row_ptr_[s + 1]; k++) {
+      position[rows_[k]] = k - row_ptr_[s];
+    }
+    for (int j = first; j < super_ptr_[s + 1]; j++) {
+      for (int k = lower_ptr_[j]; k < lower_ptr_[j + 1]; k++) {
+        lower_target_[k] = factor_ptr_[s] +
+                           (std::size_t)(j - first) * height +
+                           position[lower_rows_[k]];
+      }
+    }
+    for (int c = child_ptr_[s]; c < child_ptr_[s + 1]; c++) {
+      const int child = children_[c];
+      const int child_width = super_ptr_[child + 1] - super_ptr_[child];
+      int *relative = relative_rows_.data() + relative_ptr_[child];
+      for (int k = row_ptr_[child] + child_width; k < row_ptr_[child + 1];
+           k++) {
+        *relative++ = position[rows_[k]];
+      }
+    }
+  }
+
+  // Children come before their parent, so one pass computes the heights
+  std::vector<int> height(num_supernodes, 0);
+  int max_height = 0;
+  for (int s = 0; s < num_supernodes; s++) {
+    if (super_parent_[s] != -1) {
+      height[super_parent_[s]] =
+          std::max(height[super_parent_[s]], height[s] + 1);
+    }
+    max_height = std::max(max_height, height[s]);
+  }
+  level_ptr_.assign(num_supernodes > 0 ? max_height + 2 : 1, 0);
+  for (int s = 0; s < num_supernodes; s++) {
+    level_ptr_[height[s] + 1]++;
+  }
+  for (int l = 0; l + 1 < (int)level_ptr_.size(); l++) {
+    level_ptr_[l + 1] += level_ptr_[l];
+  }
+  levels_.resize(num_supernodes);
+  std::vector<int> offset(level_ptr_.begin(), level_ptr_.end() - 1);
+  for (int s = 0; s < num_supernodes; s++) {
+    levels_[offset[height[s]]++] = s;
+  }
+}
+
+template <typename DT>
+void SupernodalCholesky<DT>::analyze_pattern(int n,
+                                             const int *outer_ptr,
+                                             const int *inner_indices) {
+  n_ = n;
+  pattern_outer_ptr_.assign(outer_ptr, outer_ptr + n + 1);
+  pattern_inner_indices_.assign(inner_indices, inner_indices + outer_ptr[n]);
+  success_ = false;
+
+  std::vector<int> perm(n);
+  for (int i = 0; i < n; i++) {
+    perm[i] = i;
+  }
+  if (ordering_ != SupernodalOrdering::natural && n > 0) {
+    // Eigen's orderings take the full symmetric pattern. Their permutation
+    // maps new indices to old ones.
+    std::vector<DT> ones(outer_ptr[n], 1);
+    Eigen::Map<const Eigen::SparseMatrix<DT>> A(n, n, outer_ptr[n], outer_ptr,
+                                                inner_indices, ones.data());
+    Eigen::SparseMatrix<DT> full;
+    full = A.template selfadjointView<Eigen::Lower>();
+    full.makeCompressed();
+    Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> ordering;
+    if (ordering_ == SupernodalOrdering::amd) {
+      Eigen::AMDOrdering<int>()(full, ordering);
+    } else {
+      Eigen::COLAMDOrdering<int>()(full, ordering);
+    }
+    if (ordering.size() == n) {
+      std::copy(ordering.indices().data(), ordering.indices().data() + n,
+                perm.begin());
+    }
+  }
+
+  // Postorder the elimination tree, so that every subtree, and in particular
+  // every supernode, has contiguous columns
+  build_permuted_lower(perm);
+  build_etree(nullptr);
+  {
+    std::vector<int> head(n, -1), next(n, -1);
+    for (int j = n - 1; j >= 0; j--) {
+      if (parent_[j] != -1) {
+        next[j] = head[parent_[j]];
+        head[parent_[j]] = j;
+      }
+    }
+    std::vector<int> postorder;
+    postorder.reserve(n);
+    std::vector<int> stack;
+    for (int root = 0; root < n; root++) {
+      if (parent_[root] != -1) {
+        continue;
+      }
+      stack.push_back(root);
+      while (!stack.empty()) {
+        const int j = stack.back();
+        if (head[j] != -1) {
+          stack.push_back(head[j]);
+          head[j] = next[head[j]];
+        } else {
+          stack.pop_back();
+          postorder.push_back(j);
+        }
+      }
+    }
+    std::vector<int> postordered_perm(n);
+    for (int k = 0; k < n; k++) {
+      postordered_perm[k] = perm[postorder[k]];
+    }
+    perm_ = std::move(postordered_perm);
+  }
+
+  build_permuted_lower(perm_);
+  std::vector<int> col_counts;
+  build_etree(&col_counts);
+  build_supernodes(col_counts);
+  build_structure();
+  TI_TRACE("Supernodal analysis: {} columns, {} supernodes, {} entries in L",
+           n_, num_supernodes(), factor_size());
+}
+
+template <typename DT>
+bool SupernodalCholesky<DT>::has_pattern(int n,
+                                         const int *outer_ptr,
+                                         const int *inner_indices) const {
+  return n == n_ && !pattern_outer_ptr_.empty() &&
+         std::equal(outer_ptr, outer_ptr + n + 1,
+                    pattern_outer_ptr_.begin()) &&
+         std::equal(inner_indices, inner_indices + outer_ptr[n],
+                    pattern_inner_indices_.begin());
+}
+
+template <typename DT>
+bool SupernodalCholesky<DT>::factorize_supernode(int s,
+                                                 const DT *values,
+                                                 bool split) {
+  const int first = super_ptr_[s];
+  const int width = super_ptr_[s + 1] - first;
+  const int height = row_ptr_[s + 1] - row_ptr_[s];
+  const int below = height - width;
+  DT *panel = factor_.data() + factor_ptr_[s];
+
+  // Assemble the entries of A and the updates of the children
+  std::fill(panel, panel + (std::size_t)width * height, DT(0));
+  for (int k = lower_ptr_[first]; k < lower_ptr_[first + width]; k++) {
+    factor_[lower_target_[k]] = values[lower_source_[k]];
+  }
+  auto &update = updates_[s];
+  update.assign((std::size_t)below * below, DT(0));
+  for (int c = child_ptr_[s]; c < child_ptr_[s + 1]; c++) {
+    const int child = children_[c];
+    auto &child_update = updates_[child];
+    const int child_below =
+        int(relative_ptr_[child + 1] - relative_ptr_[child]);
+    const int *relative = relative_rows_.data() + relative_ptr_[child];
+    for (int jj = 0; jj < child_below; jj++) {
+      const int col = relative[jj];
+      const DT *src = child_update.data() + (std::size_t)jj * child_below;
+      if (col < width) {
+        DT *dst = panel + (std::size_t)col * height;
+        for (int ii = jj; ii < child_below; ii++) {
+          dst[relative[ii]] += src[ii];
+        }
+      } else {
+        // Rows of the update start past the columns of the supernode
+        DT *dst = update.data() + (std::size_t)(col - width) * below;
+        for (int ii = jj; ii < child_below; ii++) {
+          dst[relative[ii] - width] += src[ii];
+        }
+      }
+    }
+    child_update = std::vector<DT>();
+  }
+
+  Panel<DT> L11(panel, width, width, Eigen::OuterStride<>(height));
+  Panel<DT> L21(panel + width, below, width, Eigen::OuterStride<>(height));
+  if (!ldlt_) {
+    Eigen::LLT<Eigen::Ref<DenseMatrix<DT>>> llt(L11);
+    if (llt.info() != Eigen::Success) {
+      return false;
+    }
+  } else {
+    // Left-looking LDL^T of the diagonal block, D on the diagonal
+    Eigen::Matrix<DT, Eigen::Dynamic, 1> scaled(width);
+    for (int j = 0; j < width; j++) {
+      for (int k = 0; k < j; k++) {
+        scaled[k] = L11(j, k) * L11(k, k);
+      }
+      L11.col(j).tail(width - j).noalias() -=
+          L11.bottomLeftCorner(width - j, j) * scaled.head(j);
+      const DT d = L11(j, j);
+      if (d == 0 || !std::isfinite(d)) {
+        return false;
+      }
+      L11.col(j).tail(width - j - 1) /= d;
+    }
+  }
+  if (below == 0) {
+    return true;
+  }
+
+  // L21 = A21 L11^-T, by blocks of rows
+  const int num_row_blocks =
+      split ? (below + kSolveBlockHeight - 1) / kSolveBlockHeight : 1;
+  auto solve_rows = [&](int block) {
+    const int begin = int((int64)below * block / num_row_blocks);
+    const int end = int((int64)below * (block + 1) / num_row_blocks);
+    auto rows = L21.middleRows(begin, end - begin);
+    if (ldlt_) {
+      L11.template triangularView<Eigen::UnitLower>()
+          .transpose()
+          .template solveInPlace<Eigen::OnTheRight>(rows);
+    } else {
+      L11.template triangularView<Eigen::Lower>()
+          .transpose()
+          .template solveInPlace<Eigen::OnTheRight>(rows);
+    }
+  };
+  if (split) {
+    parallel_for(num_row_blocks, solve_rows);
+  } else {
+    solve_rows(0);
+  }
+
+  // The update is -L21 D L21^T, or -L21 L21^T. With LDL^T, L21 D is what the
+  // triangular solve left, and L21 is that scaled by D^-1.
+  DenseMatrix<DT> scaled_l21;
+  if (ldlt_) {
+    scaled_l21 = L21;
+    L21 = L21 * L11.diagonal().cwiseInverse().asDiagonal();
+  }
+  const Panel<DT> &right = ldlt_ ? Panel<DT>(scaled_l21.data(), below, width,
+                                             Eigen::OuterStride<>(below))
+                                 : L21;
+  Eigen::Map<DenseMatrix<DT>> U(update.data(), below, below);
+  // Lower triangle only, by blocks of columns. The upper triangles of the
+  // diagonal blocks are computed as well, and never read.
+  const int num_col_blocks =
+      (below + kUpdateBlockWidth - 1) / kUpdateBlockWidth;
+  auto update_cols = [&](int block) {
+    const int begin = block * kUpdateBlockWidth;
+    const int cols = std::min(kUpdateBlockWidth, below - begin);
+    U.block(begin, begin, below - begin, cols).noalias() -=
+        L21.middleRows(begin, below - begin) *
+        right.middleRows(begin, cols).transpose();
+  };
+  if (split) {
+    parallel_for(num_col_blocks, update_cols);
+  } else {
+    for (int block = 0; block < num_col_blocks; block++) {
+      update_cols(block);
+    }
+  }
+  return true;
+}
+
+template <typename DT>
+bool SupernodalCholesky<DT>::factorize(const DT *values) {
+  const int num_supernodes = this->num_supernodes();
+  factor_.resize(factor_size());
+  updates_.assign(std::max(num_supernodes, 0), {});
+  const int num_threads =
+      thread_pool_ ? thread_pool_->get_max_num_threads() : 1;
+  std::atomic<bool> success{true};
+  for (int l = 0; l + 1 < (int)level_ptr_.size() && success; l++) {
+    const int *level = levels_.data() + level_ptr_[l];
+    const int size = level_ptr_[l + 1] - level_ptr_[l];
+    if (size >= num_threads) {
+      parallel_for(size, [&](int i) {
+        if (success && !factorize_supernode(level[i], values, false)) {
+          success = false;
+        }
+      });
+    } else {
+      for (int i = 0; i < size && success; i++) {
+        success = factorize_supernode(level[i], values, true);
+      }
+    }
+  }
+  updates_.clear();
+  success_ = success;
+  return success_;
+}
+
+template <typename DT>
+void SupernodalCholesky<DT>::solve(const DT *b, DT *x) const {
+  TI_ERROR_IF(!success_, "The matrix has not been factorized successfully");
+  std::vector<DT> y(n_);
+  for (int i = 0; i < n_; i++) {
+    y[i] = b[perm_[i]];
+  }
+  std::vector<DT> gathered;
+  const int num_supernodes = this->num_supernodes();
+
+  // L y = P b, then D y = y
+  for (int s = 0; s < num_supernodes; s++) {
+    const int first = super_ptr_[s];
+    const int width = super_ptr_[s + 1] - first;
+    const int height = row_ptr_[s + 1] - row_ptr_[s];
+    const int below = height - width;
+    DT *panel = const_cast<DT *>(factor_.data() + factor_ptr_[s]);
+    Panel<DT> L11(panel, width, width, Eigen::OuterStride<>(height));
+    Panel<DT> L21(panel + width, below, width, Eigen::OuterStride<>(height));
+    Vector<DT> ys(y.data() + first, width);
+    if (ldlt_) {
+      L11.template triangularView<Eigen::UnitLower>().solveInPlace(ys);
+    } else {
+      L11.template triangularView<Eigen::Lower>().solveInPlace(ys);
+    }
+    if (below > 0) {
+      gathered.resize(below);
+      Vector<DT>(gathered.data(), below).noalias() = L21 * ys;
+      const int *rows = rows_.data() + row_ptr_[s] + width;
+      for (int i = 0; i < below; i++) {
+        y[rows[i]] -= gathered[i];
+      }
+    }
+    if (ldlt_) {
+      ys = ys.cwiseQuotient(L11.diagonal());
+    }
+  }
+
+  // L^T x = y
+  for (int s = num_supernodes - 1; s >= 0; s--) {
+    const int first = super_ptr_[s];
+    const int width = super_ptr_[s + 1] - first;
+    const int height = row_ptr_[s + 1] - row_ptr_[s];
+    const int below = height - width;
+    DT *panel = const_cast<DT *>(factor_.data() + factor_ptr_[s]);
+    Panel<DT> L11(panel, width, width, Eigen::OuterStride<>(height));
+    Panel<DT> L21(panel + width, below, width, Eigen::OuterStride<>(height));
+    Vector<DT> ys(y.data() + first, width);
+    if (below > 0) {
+      gathered.resize(below);
+      const int *rows = rows_.data() + row_ptr_[s] + width;
+      for (int i = 0; i < below; i++) {
+        gathered[i] = y[rows[i]];
+      }
+      ys.noalias() -= L21.transpose() * Vector<DT>(gathered.data(), below);
+    }
+    if (ldlt_) {
+      L11.template triangularView<Eigen::UnitLower>()
+          .transpose()
+          .solveInPlace(ys);
+    } else {
+      L11.template triangularView<Eigen::Lower>().transpose().solveInPlace(ys);
+    }
+  }
+
+  for (int i = 0; i < n_; i++) {
+    x[perm_[i]] = y[i];
+  }
+}
+
+template class SupernodalCholesky<float32>;
+template class SupernodalCholesky<float64>;
+
+}  // namespace taichi::lang
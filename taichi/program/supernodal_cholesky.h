@@ -0,0 +1,130 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "taichi/common/core.h"
+#include "taichi/system/threading.h"
+
+namespace taichi::lang {
+
+enum class SupernodalOrdering { natural, amd, colamd };
+
+SupernodalOrdering supernodal_ordering_from_name(const std::string &name);
+
+// Sparse Cholesky (LL^T) or LDL^T factorization of a symmetric matrix, with
+// supernodes and multiple threads.
+//
+// analyze_pattern() does the symbolic analysis: it computes the fill-reducing
+// ordering, postorders the elimination tree, groups columns into relaxed
+// supernodes and precomputes where every entry of A and every update goes.
+// The analysis is kept, so that factorizing matrices of the same pattern only
+// runs the numeric phase.
+//
+// The numeric phase is multifrontal. A supernode is a dense |rows| x |cols|
+// panel of L; factorizing it leaves an update matrix, which is added into
+// its parent's. Supernodes of the same height in the supernodal elimination
+// tree are independent, so a level of the tree runs on the thread pool one
+// supernode per task. Near the root, where a level has fewer supernodes than
+// threads, the triangular solve and the rank update of every supernode are
+// split across the threads instead. Dense blocks go through Eigen's kernels.
+//
+// LDL^T does not pivot, so it needs a matrix whose leading minors are
+// nonsingular, e.g. a positive or negative definite or quasi-definite matrix.
+template <typename DT>
+class SupernodalCholesky {
+ public:
+  SupernodalCholesky(bool ldlt, SupernodalOrdering ordering);
+
+  void set_thread_pool(ThreadPool *thread_pool) {
+    thread_pool_ = thread_pool;
+  }
+
+  // Takes the compressed column arrays of a symmetric n x n matrix. Only the
+  // entries on and below the diagonal are used.
+  void analyze_pattern(int n, const int *outer_ptr, const int *inner_indices);
+
+  // Whether a matrix has the pattern of the last analyze_pattern()
+  bool has_pattern(int n, const int *outer_ptr, const int *inner_indices) const;
+
+  // Factorizes a matrix of the analyzed pattern, whose nonzeros are
+  // |values|. Returns false if a pivot is not positive (LL^T) or zero
+  // (LDL^T).
+  bool factorize(const DT *values);
+
+  // x = A^-1 b. |x| may alias |b|.
+  void solve(const DT *b, DT *x) const;
+
+  bool info() const {
+    return success_;
+  }
+
+  int num_supernodes() const {
+    return (int)super_ptr_.size() - 1;
+  }
+
+  // Number of stored entries of L, including the zeros of relaxed supernodes
+  std::size_t factor_size() const {
+    return factor_ptr_.empty() ? 0 : factor_ptr_.back();
+  }
+
+ private:
+  // Builds the lower triangle of A permuted by |perm| (new to old).
+  void build_permuted_lower(const std::vector<int> &perm);
+  // Builds the elimination tree of the permuted lower triangle, and the
+  // number of nonzeros in every column of L if |col_counts| is not null.
+  void build_etree(std::vector<int> *col_counts);
+  void build_supernodes(const std::vector<int> &col_counts);
+  void build_structure();
+
+  bool factorize_supernode(int s, const DT *values, bool split);
+
+  // Runs f(i) for i in [0, n) on the thread pool
+  template <typename F>
+  void parallel_for(int n, const F &f);
+
+  bool ldlt_{false};
+  SupernodalOrdering ordering_{SupernodalOrdering::amd};
+  ThreadPool *thread_pool_{nullptr};
+
+  // The analyzed pattern
+  int n_{0};
+  std::vector<int> pattern_outer_ptr_;
+  std::vector<int> pattern_inner_indices_;
+
+  // perm_[new] = old
+  std::vector<int> perm_;
+  // The lower triangle of the permuted matrix in CSC. Entry k comes from
+  // entry lower_source_[k] of A.
+  std::vector<int> lower_ptr_;
+  std::vector<int> lower_rows_;
+  std::vector<int> lower_source_;
+  std::vector<int> parent_;
+
+  // Supernode s has the columns [super_ptr_[s], super_ptr_[s + 1]) and the
+  // rows rows_[row_ptr_[s]..row_ptr_[s + 1]), its own columns first. Its
+  // panel is stored column-major at factor_[factor_ptr_[s]].
+  std::vector<int> super_ptr_;
+  std::vector<int> super_parent_;
+  std::vector<int> child_ptr_;
+  std::vector<int> children_;
+  std::vector<int> row_ptr_;
+  std::vector<int> rows_;
+  std::vector<std::size_t> factor_ptr_;
+  // Where entry k of the permuted lower triangle goes in factor_
+  std::vector<std::size_t> lower_target_;
+  // For every supernode, the positions of its rows below its columns in the
+  // rows of its parent, starting at relative_ptr_[s]
+  std::vector<std::size_t> relative_ptr_;
+  std::vector<int> relative_rows_;
+  // Supernodes grouped by their height in the supernodal elimination tree
+  std::vector<int> level_ptr_;
+  std::vector<int> levels_;
+
+  // The numeric factorization
+  std::vector<DT> factor_;
+  std::vector<std::vector<DT>> updates_;
+  bool success_{false};
+};
+
+}  // namespace taichi::lang
@@ -28,6 +28,7 @@
 #include "taichi/program/sparse_matrix.h"
 #include "taichi/program/sparse_solver.h"
 #include "taichi/program/conjugate_gradient.h"
+#include "taichi/program/dlpack_funcs.h"
 #include "taichi/aot/graph_data.h"
 #include "taichi/ir/mesh.h"
 
@@ -35,6 +36,7 @@
 
 #if defined(TI_WITH_CUDA)
 #include "taichi/rhi/cuda/cuda_context.h"
+#include "taichi/rhi/common/host_memory_pool.h"
 #endif
 
 namespace taichi {
@@ -48,6 +50,23 @@ std::string libdevice_path();
 
 }  // namespace taichi::lang
 
+namespace {
+
+// DLPack capsules follow the Python array API: a capsule is named "dltensor"
+// until a consumer takes the tensor and renames it to "used_dltensor".
+// Deleting a capsule that was never consumed deletes its tensor.
+void delete_dlpack_capsule(PyObject *capsule) {
+  if (PyCapsule_IsValid(capsule, "dltensor")) {
+    auto *tensor =
+        (DLManagedTensor *)PyCapsule_GetPointer(capsule, "dltensor");
+    if (tensor->deleter) {
+      tensor->deleter(tensor);
+    }
+  }
+}
+
+}  // namespace
+
 namespace taichi {
 void export_lang(py::module &m) {
   using namespace taichi::lang;
@@ -71,6 +90,8 @@ void export_lang(py::module &m) {
 
   m.def("arch_name", arch_name);
   m.def("arch_from_name", arch_from_name);
+  m.def("host_memory_pool_report",
+        []() { return HostMemoryPool::get_instance().report(); });
 
   py::enum_<SNodeType>(m, "SNodeType", py::arithmetic())
 #define PER_SNODE(x) .value(#x, SNodeType::x)
@@ -188,6 +209,10 @@ void export_lang(py::module &m) {
                      &CompileConfig::default_cpu_block_dim)
       .def_readwrite("cpu_block_dim_adaptive",
                      &CompileConfig::cpu_block_dim_adaptive)
+      .def_readwrite("cpu_block_dim_adaptive_policy",
+                     &CompileConfig::cpu_block_dim_adaptive_policy)
+      .def_readwrite("cpu_numa_policy", &CompileConfig::cpu_numa_policy)
+      .def_readwrite("cpu_huge_pages", &CompileConfig::cpu_huge_pages)
       .def_readwrite("default_gpu_block_dim",
                      &CompileConfig::default_gpu_block_dim)
       .def_readwrite("gpu_max_reg", &CompileConfig::gpu_max_reg)
@@ -223,6 +248,9 @@ void export_lang(py::module &m) {
       .def_readwrite("half2_vectorization", &CompileConfig::half2_vectorization)
       .def_readwrite("make_cpu_multithreading_loop",
                      &CompileConfig::make_cpu_multithreading_loop)
+      .def_readwrite("vectorize_range_for",
+                     &CompileConfig::vectorize_range_for)
+      .def_readwrite("simd_width", &CompileConfig::simd_width)
       .def_readwrite("quant_opt_store_fusion",
                      &CompileConfig::quant_opt_store_fusion)
       .def_readwrite("quant_opt_atomic_demotion",
@@ -254,10 +282,17 @@ void export_lang(py::module &m) {
                      &CompileConfig::offline_cache_max_size_of_files)
       .def_readwrite("offline_cache_cleaning_factor",
                      &CompileConfig::offline_cache_cleaning_factor)
+      .def_readwrite("offline_cache_layout",
+                     &CompileConfig::offline_cache_layout)
+      .def_readwrite("offline_cache_key_hash",
+                     &CompileConfig::offline_cache_key_hash)
       .def_readwrite("num_compile_threads", &CompileConfig::num_compile_threads)
+      .def_readwrite("ir_arena", &CompileConfig::ir_arena)
       .def_readwrite("vk_api_version", &CompileConfig::vk_api_version)
       .def_readwrite("cuda_stack_limit", &CompileConfig::cuda_stack_limit)
-      .def_readwrite("flagos_chip", &CompileConfig::flagos_chip);
+      .def_readwrite("flagos_chip", &CompileConfig::flagos_chip)
+      .def_readwrite("flagos_num_compute_units",
+                     &CompileConfig::flagos_num_compute_units);
 
   m.def("reset_default_compile_config",
         [&]() { default_compile_config = CompileConfig(); });
@@ -288,7 +323,13 @@ void export_lang(py::module &m) {
       .def_readwrite("base_time", &KernelProfileTracedRecord::time_since_base)
       .def_readwrite("name", &KernelProfileTracedRecord::name)
       .def_readwrite("metric_values",
-                     &KernelProfileTracedRecord::metric_values);
+                     &KernelProfileTracedRecord::metric_values)
+      .def_readwrite("cpu_num_busy_threads",
+                     &KernelProfileTracedRecord::cpu_num_busy_threads)
+      .def_readwrite("cpu_max_busy_time",
+                     &KernelProfileTracedRecord::cpu_max_busy_time_in_ms)
+      .def_readwrite("cpu_avg_busy_time",
+                     &KernelProfileTracedRecord::cpu_avg_busy_time_in_ms);
 
   py::enum_<SNodeAccessFlag>(m, "SNodeAccessFlag", py::arithmetic())
       .value("block_local", SNodeAccessFlag::block_local)
@@ -450,6 +491,44 @@ void export_lang(py::module &m) {
           py::arg("zero_fill") = false, py::arg("dbg_info") = DebugInfo(),
           py::return_value_policy::reference)
       .def("delete_ndarray", &Program::delete_ndarray)
+      .def(
+          "ndarray_to_dlpack",
+          [](Program *program, py::object owner,
+             Ndarray *ndarray) -> py::object {
+            // The tensor keeps the Python ndarray, and thus its memory,
+            // alive. Consumers may delete it on any thread.
+            auto *owner_ref = new py::object(std::move(owner));
+            DLManagedTensor *tensor =
+                ndarray_to_dlpack(program, ndarray, [owner_ref]() {
+                  py::gil_scoped_acquire gil;
+                  delete owner_ref;
+                });
+            return py::reinterpret_steal<py::object>(
+                PyCapsule_New(tensor, "dltensor", delete_dlpack_capsule));
+          })
+      .def(
+          "ndarray_from_dlpack",
+          [](Program *program, py::capsule capsule,
+             const std::vector<int> &element_shape) -> Ndarray * {
+            if (!PyCapsule_IsValid(capsule.ptr(), "dltensor")) {
+              throw py::value_error(
+                  "Expected a DLPack capsule named \"dltensor\" that has not "
+                  "been consumed yet");
+            }
+            auto *tensor = (DLManagedTensor *)PyCapsule_GetPointer(
+                capsule.ptr(), "dltensor");
+            Ndarray *ndarray = ndarray_from_dlpack(
+                program, tensor, element_shape, [tensor]() {
+                  py::gil_scoped_acquire gil;
+                  if (tensor->deleter) {
+                    tensor->deleter(tensor);
+                  }
+                });
+            PyCapsule_SetName(capsule.ptr(), "used_dltensor");
+            return ndarray;
+          },
+          py::arg("capsule"), py::arg("element_shape") = std::vector<int>(),
+          py::return_value_policy::reference)
       .def(
           "create_argpack",
           [&](Program *program, const DataType &dt) -> ArgPack * {
@@ -485,6 +564,7 @@ void export_lang(py::module &m) {
            [](Program *program) { return program->get_graphics_device(); })
       .def("compile_kernel", &Program::compile_kernel,
            py::return_value_policy::reference)
+      .def("prefetch_kernels", &Program::prefetch_kernels)
       .def("launch_kernel", &Program::launch_kernel)
       .def("get_device_caps", &Program::get_device_caps);
 
@@ -515,7 +595,7 @@ void export_lang(py::module &m) {
            py::return_value_policy::reference)
       .def("hash",
            (SNode & (SNode::*)(const std::vector<Axis> &,
-                               const std::vector<int> &,
+                               const std::vector<int> &, int,
                                const DebugInfo &))(&SNode::hash),
            py::return_value_policy::reference)
       .def("dynamic", &SNode::dynamic, py::return_value_policy::reference)
@@ -595,8 +675,10 @@ void export_lang(py::module &m) {
       .def("total_shape", &Ndarray::total_shape)
       .def("element_shape", &Ndarray::get_element_shape)
       .def("element_data_type", &Ndarray::get_element_data_type)
+      .def("is_strided", &Ndarray::is_strided)
       .def_readonly("dtype", &Ndarray::dtype)
-      .def_readonly("shape", &Ndarray::shape);
+      .def_readonly("shape", &Ndarray::shape)
+      .def_readonly("strides", &Ndarray::strides);
 
   py::class_<ArgPack>(m, "ArgPack")
       .def("device_allocation_ptr", &ArgPack::get_device_allocation_ptr_as_int)
@@ -1033,7 +1115,8 @@ void export_lang(py::module &m) {
 
   m.def("make_external_tensor_expr",
         Expr::make<ExternalTensorExpression, const DataType &, int,
-                   const std::vector<int> &, bool, int, const BoundaryMode &>);
+                   const std::vector<int> &, bool, int, const BoundaryMode &,
+                   bool>);
 
   m.def("make_external_tensor_grad_expr",
         Expr::make<ExternalTensorExpression, Expr *>);
@@ -1113,6 +1196,11 @@ void export_lang(py::module &m) {
     return expr.cast<ExternalTensorExpression>()->needs_grad;
   });
 
+  m.def("get_external_tensor_strided", [](const Expr &expr) {
+    TI_ASSERT(expr.is<ExternalTensorExpression>());
+    return expr.cast<ExternalTensorExpression>()->strided;
+  });
+
   m.def("get_external_tensor_element_type", [](const Expr &expr) {
     TI_ASSERT(expr.is<ExternalTensorExpression>());
     auto external_tensor_expr = expr.cast<ExternalTensorExpression>();
@@ -1445,12 +1533,31 @@ void export_lang(py::module &m) {
       .def("solve_rf", &CuSparseSolver::solve_rf)
       .def("info", &CuSparseSolver::info);
 
+  py::class_<SupernodalSparseSolver<float32>, SparseSolver>(
+      m, "SupernodalSparseSolverf32")
+      .def("compute", &SupernodalSparseSolver<float32>::compute)
+      .def("analyze_pattern", &SupernodalSparseSolver<float32>::analyze_pattern)
+      .def("factorize", &SupernodalSparseSolver<float32>::factorize)
+      .def("solve", &SupernodalSparseSolver<float32>::solve)
+      .def("solve_rf", &SupernodalSparseSolver<float32>::solve_rf)
+      .def("info", &SupernodalSparseSolver<float32>::info);
+  py::class_<SupernodalSparseSolver<float64>, SparseSolver>(
+      m, "SupernodalSparseSolverf64")
+      .def("compute", &SupernodalSparseSolver<float64>::compute)
+      .def("analyze_pattern", &SupernodalSparseSolver<float64>::analyze_pattern)
+      .def("factorize", &SupernodalSparseSolver<float64>::factorize)
+      .def("solve", &SupernodalSparseSolver<float64>::solve)
+      .def("solve_rf", &SupernodalSparseSolver<float64>::solve_rf)
+      .def("info", &SupernodalSparseSolver<float64>::info);
+
   m.def("make_sparse_solver", &make_sparse_solver);
+  m.def("make_supernodal_sparse_solver", &make_supernodal_sparse_solver);
   m.def("make_cusparse_solver", &make_cusparse_solver);
 
   // Conjugate Gradient solver
   py::class_<CG<Eigen::VectorXf, float>>(m, "CGf")
-      .def(py::init<SparseMatrix &, int, float, bool>())
+      .def(py::init<SparseMatrix &, int, float, bool, const std::string &,
+                    int>())
       .def("solve", &CG<Eigen::VectorXf, float>::solve)
       .def("set_x", &CG<Eigen::VectorXf, float>::set_x)
       .def("get_x", &CG<Eigen::VectorXf, float>::get_x)
@@ -1459,7 +1566,8 @@ void export_lang(py::module &m) {
       .def("set_b_ndarray", &CG<Eigen::VectorXf, float>::set_b_ndarray)
       .def("is_success", &CG<Eigen::VectorXf, float>::is_success);
   py::class_<CG<Eigen::VectorXd, double>>(m, "CGd")
-      .def(py::init<SparseMatrix &, int, double, bool>())
+      .def(py::init<SparseMatrix &, int, double, bool, const std::string &,
+                    int>())
       .def("solve", &CG<Eigen::VectorXd, double>::solve)
       .def("set_x", &CG<Eigen::VectorXd, double>::set_x)
       .def("set_x_ndarray", &CG<Eigen::VectorXd, double>::set_x_ndarray)
@@ -1467,14 +1575,27 @@ void export_lang(py::module &m) {
       .def("set_b_ndarray", &CG<Eigen::VectorXd, double>::set_b_ndarray)
       .def("set_b", &CG<Eigen::VectorXd, double>::set_b)
       .def("is_success", &CG<Eigen::VectorXd, double>::is_success);
-  m.def("make_float_cg_solver", [](SparseMatrix &A, int max_iters, float tol,
-                                   bool verbose) {
-    return make_cg_solver<Eigen::VectorXf, float>(A, max_iters, tol, verbose);
-  });
-  m.def("make_double_cg_solver", [](SparseMatrix &A, int max_iters, float tol,
-                                    bool verbose) {
-    return make_cg_solver<Eigen::VectorXd, double>(A, max_iters, tol, verbose);
-  });
+  m.def("make_float_cg_solver",
+        [](SparseMatrix &A, int max_iters, float tol, bool verbose,
+           const std::string &preconditioner, int block_size) {
+          return make_cg_solver<Eigen::VectorXf, float>(
+              A, max_iters, tol, verbose, preconditioner, block_size);
+        });
+  m.def("make_double_cg_solver",
+        [](SparseMatrix &A, int max_iters, float tol, bool verbose,
+           const std::string &preconditioner, int block_size) {
+          return make_cg_solver<Eigen::VectorXd, double>(
+              A, max_iters, tol, verbose, preconditioner, block_size);
+        });
+
+  py::class_<MatrixFreeCG<float>>(m, "MatrixFreeCGf")
+      .def(py::init<Program *, Ndarray &, Ndarray &, std::function<void()>,
+                    int, float, bool>())
+      .def("solve", &MatrixFreeCG<float>::solve);
+  py::class_<MatrixFreeCG<double>>(m, "MatrixFreeCGd")
+      .def(py::init<Program *, Ndarray &, Ndarray &, std::function<void()>,
+                    int, float, bool>())
+      .def("solve", &MatrixFreeCG<double>::solve);
 
   py::class_<CUCG>(m, "CUCG").def("solve", &CUCG::solve);
   m.def("make_cucg_solver", make_cucg_solver);
@@ -9,6 +9,7 @@
 #include "taichi/common/core.h"
 #include "taichi/common/interface.h"
 #include "taichi/common/task.h"
+#include "taichi/compilation_manager/kernel_compilation_manager.h"
 #include "taichi/math/math.h"
 #include "taichi/platform/cuda/detect_cuda.h"
 #include "taichi/program/py_print_buffer.h"
@@ -19,6 +20,7 @@
 #include "taichi/system/hacked_signal_handler.h"
 #include "taichi/system/profiler.h"
 #include "taichi/util/offline_cache.h"
+#include "taichi/util/offline_cache_pack.h"
 #if defined(TI_WITH_CUDA)
 #include "taichi/rhi/cuda/cuda_driver.h"
 #endif
@@ -174,6 +176,16 @@ void export_misc(py::module &m) {
 
   m.def("clean_offline_cache_files",
         lang::offline_cache::clean_offline_cache_files);
+  m.def("list_offline_cache_pack", [](const std::string &path) {
+    // (key, size in bytes) of every kernel in the pack under |path|
+    std::vector<std::pair<std::string, std::size_t>> result;
+    lang::offline_cache::CachePack pack(
+        path, lang::KernelCompilationManager::kMetadataLockName);
+    for (const auto &e : pack.list_entries()) {
+      result.emplace_back(e.key, e.size);
+    }
+    return result;
+  });
 
   py::class_<HackedSignalRegister>(m, "HackedSignalRegister").def(py::init<>());
 }
@@ -11,7 +11,8 @@
 namespace taichi::lang {
 
 HostMemoryPool::HostMemoryPool() {
-  allocator_ = std::unique_ptr<UnifiedAllocator>(new UnifiedAllocator());
+  allocators_.emplace_back(new UnifiedAllocator(this));
+  allocator_ = allocators_.back().get();
 
   TI_TRACE("Memory pool created. Default buffer size per allocator = {} MB",
            UnifiedAllocator::default_allocator_size / 1024 / 1024);
@@ -20,27 +21,40 @@ HostMemoryPool::HostMemoryPool() {
 void *HostMemoryPool::allocate(std::size_t size,
                                std::size_t alignment,
                                bool exclusive) {
-  std::lock_guard<std::mutex> _(mut_allocation_);
-
-  if (!allocator_) {
-    TI_ERROR("Memory pool is already destroyed");
+  if (!exclusive) {
+    // Small allocations are mostly served by the cache of this thread,
+    // without taking the lock. The allocator stays alive even if reset()
+    // replaces it meanwhile, see reset().
+    UnifiedAllocator *allocator = allocator_.load(std::memory_order_acquire);
+    if (void *ret = allocator->allocate_from_thread_cache(size, alignment)) {
+      return ret;
+    }
   }
-  void *ret = allocator_->allocate(size, alignment, exclusive);
+
+  std::lock_guard<std::mutex> _(mut_allocation_);
+  void *ret = allocator_.load(std::memory_order_relaxed)
+                  ->allocate(size, alignment, exclusive);
   return ret;
 }
 
 void HostMemoryPool::release(std::size_t size, void *ptr) {
+  UnifiedAllocator *allocator = allocator_.load(std::memory_order_acquire);
+  if (allocator->release_to_thread_cache(ptr)) {
+    return;
+  }
+
   std::lock_guard<std::mutex> _(mut_allocation_);
+  allocator_.load(std::memory_order_relaxed)->release(size, ptr);
+}
 
-  if (!allocator_) {
-    TI_ERROR("Memory pool is already destroyed");
-  }
+UnifiedAllocator::Stats HostMemoryPool::get_stats() {
+  std::lock_guard<std::mutex> _(mut_allocation_);
+  return allocator_.load(std::memory_order_relaxed)->get_stats();
+}
 
-  if (allocator_->release(size, ptr)) {
-    if (dynamic_cast<UnifiedAllocator *>(allocator_.get())) {
-      deallocate_raw_memory(ptr);  // release raw memory as well
-    }
-  }
+std::string HostMemoryPool::report() {
+  std::lock_guard<std::mutex> _(mut_allocation_);
+  return allocator_.load(std::memory_order_relaxed)->report();
 }
 
 void *HostMemoryPool::allocate_raw_memory(std::size_t size) {
@@ -111,9 +125,41 @@ void HostMemoryPool::deallocate_raw_memory(void *ptr) {
   raw_memory_chunks_.erase(ptr);
 }
 
+void HostMemoryPool::discard_raw_memory(void *ptr, std::size_t size) {
+  // Gives the pages back to the OS. They read as zeros when touched again.
+#if defined(TI_PLATFORM_UNIX)
+  void *ret = mmap(ptr, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+  TI_ERROR_IF(ret != ptr, "Failed to discard virtual memory ({} B)", size);
+#else
+  TI_ERROR_IF(!VirtualFree(ptr, size, MEM_DECOMMIT),
+              "Failed to discard virtual memory ({} B)", size);
+#endif
+}
+
+void HostMemoryPool::commit_raw_memory(void *ptr, std::size_t size) {
+#if !defined(TI_PLATFORM_UNIX)
+  // Decommitted pages have to be committed again before they are used
+  TI_ERROR_IF(!VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE),
+              "Failed to commit virtual memory ({} B)", size);
+#endif
+}
+
 void HostMemoryPool::reset() {
+  /*
+    reset() frees all the memory of the pool, so it must not race with
+    allocate()/release() calls whose memory is still in use.
+
+    The thread caches are not flushed first, and need not be: the allocator
+    being replaced is retired, so the blocks cached for it are dropped when a
+    thread next touches its cache (see UnifiedAllocator::ThreadCache::flush).
+    It is not deleted, since allocate()/release() may have read |allocator_|
+    without the lock just before it is replaced.
+  */
   std::lock_guard<std::mutex> _(mut_allocation_);
-  allocator_ = std::unique_ptr<UnifiedAllocator>(new UnifiedAllocator());
+  allocators_.back()->retire();
+  allocators_.emplace_back(new UnifiedAllocator(this));
+  allocator_.store(allocators_.back().get(), std::memory_order_release);
 
   const auto ptr_map_copied = raw_memory_chunks_;
   for (auto &ptr : ptr_map_copied) {
@@ -2,9 +2,11 @@
 #include "taichi/common/core.h"
 #include "taichi/rhi/common/unified_allocator.h"
 #include "taichi/rhi/device.h"
+#include <atomic>
 #include <mutex>
 #include <vector>
 #include <memory>
+#include <string>
 #include <thread>
 
 namespace taichi::lang {
@@ -22,18 +24,31 @@ class TI_DLL_EXPORT HostMemoryPool {
                  bool exclusive = false);
   void release(std::size_t size, void *ptr);
   void reset();
+
+  UnifiedAllocator::Stats get_stats();
+  // A human-readable summary of get_stats(), with the use of each size class
+  std::string report();
+
   HostMemoryPool();
   ~HostMemoryPool();
 
  protected:
   void *allocate_raw_memory(std::size_t size);
   void deallocate_raw_memory(void *ptr);
+  // Gives the pages of a range of raw memory back to the OS, zero-filling
+  // them, and takes them back before they are reused
+  void discard_raw_memory(void *ptr, std::size_t size);
+  void commit_raw_memory(void *ptr, std::size_t size);
 
   // All the raw memory allocated from OS/Driver
   // We need to keep track of them to guarantee that they are freed
   std::map<void *, std::size_t> raw_memory_chunks_;
 
-  std::unique_ptr<UnifiedAllocator> allocator_;
+  // The allocator in use, the last one of |allocators_|. It is read without
+  // the lock on the paths through the thread caches. The allocators replaced
+  // by reset() are kept until the pool is destroyed, see reset().
+  std::atomic<UnifiedAllocator *> allocator_{nullptr};
+  std::vector<std::unique_ptr<UnifiedAllocator>> allocators_;
   std::mutex mut_allocation_;
 
   friend class UnifiedAllocator;
@@ -2,110 +2,482 @@
 
 #include "taichi/rhi/common/unified_allocator.h"
 #include "taichi/rhi/common/host_memory_pool.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <string>
+#include <thread>
+#include <unordered_map>
 
 namespace taichi::lang {
 
 std::size_t UnifiedAllocator::default_allocator_size =
     1 << 30;  // 1 GB per allocator
 
-template <typename T>
-static void swap_erase_vector(std::vector<T> &vec, size_t idx) {
-  bool is_last = idx == vec.size() - 1;
-  TI_ASSERT(idx < vec.size());
+namespace {
+
+constexpr int kPageBits = 12;
+constexpr std::size_t kPageSize = std::size_t(1) << kPageBits;
+
+// 16 to 128 bytes in steps of 16, then 4 classes per power of two up to
+// kMaxSmallSize. Every size is a multiple of 16, and the powers of two are
+// classes, so any alignment up to a page is served by some class.
+std::vector<std::size_t> make_class_sizes() {
+  std::vector<std::size_t> sizes;
+  for (std::size_t size = 16; size <= 128; size += 16) {
+    sizes.push_back(size);
+  }
+  for (std::size_t base = 128; base < UnifiedAllocator::kMaxSmallSize;
+       base *= 2) {
+    for (int i = 1; i <= 4; i++) {
+      sizes.push_back(base + base / 4 * i);
+    }
+  }
+  return sizes;
+}
+
+const std::vector<std::size_t> &class_sizes() {
+  static const std::vector<std::size_t> sizes = make_class_sizes();
+  return sizes;
+}
+
+std::size_t round_up(std::size_t size, std::size_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+std::atomic<uint64_t> next_allocator_id{1};
+
+// The live allocators by id, so that a thread can give its cached blocks
+// back to the allocator they came from. The lock of a pool is taken before
+// this one. Both are leaked, as the caches of the threads may be flushed
+// after static destructors have run.
+std::mutex &allocators_mutex() {
+  static auto *mutex = new std::mutex();
+  return *mutex;
+}
+
+std::unordered_map<uint64_t, UnifiedAllocator *> &allocators() {
+  static auto *allocators =
+      new std::unordered_map<uint64_t, UnifiedAllocator *>();
+  return *allocators;
+}
+
+}  // namespace
+
+// Freed small blocks kept by a thread for its next allocations, so that most
+// allocations and releases do not take the lock of the pool. The blocks
+// belong to the allocator |owner|. They are given back to it when the thread
+// exits or switches to another allocator.
+struct UnifiedAllocator::ThreadCache {
+  static constexpr int kMaxBlocks = 64;
+  // Bound the bytes cached per class
+  static constexpr std::size_t kMaxBytesPerClass = 128 << 10;
+
+  struct Bin {
+    int count{0};
+    void *blocks[kMaxBlocks];
+  };
+
+  uint64_t owner{0};
+  std::vector<Bin> bins;
+
+  ~ThreadCache() {
+    flush(/*wait=*/true);
+  }
+
+  // Returns whether the cache can be used for |allocator_id|. |locked| tells
+  // whether the caller holds the lock of a pool.
+  bool claim(uint64_t allocator_id, bool locked) {
+    if (owner != allocator_id) {
+      flush(/*wait=*/!locked);
+      owner = allocator_id;
+      bins.assign(class_sizes().size(), Bin());
+    }
+    return true;
+  }
+
+  // Puts the cached blocks back on the free lists of their allocator, under
+  // the lock of its pool. Nothing is left to do if the allocator is gone,
+  // its memory went with it. Without |wait|, i.e. when the caller already
+  // holds the lock of another pool, the blocks are dropped instead of
+  // waiting for the lock, to avoid a deadlock between two pools.
+  void flush(bool wait) {
+    if (owner == 0) {
+      return;
+    }
+    while (true) {
+      std::unique_lock<std::mutex> allocators_lock(allocators_mutex());
+      auto it = allocators().find(owner);
+      if (it == allocators().end()) {
+        break;
+      }
+      UnifiedAllocator *allocator = it->second;
+      // The lock of the pool comes first, so only try it here
+      std::unique_lock<std::mutex> pool_lock(allocator->pool_mutex(),
+                                             std::try_to_lock);
+      if (pool_lock.owns_lock()) {
+        for (int cls = 0; cls < (int)bins.size(); cls++) {
+          auto &bin = bins[cls];
+          while (bin.count > 0) {
+            allocator->release_small(cls, bin.blocks[--bin.count]);
+          }
+        }
+        break;
+      }
+      if (!wait) {
+        break;
+      }
+      allocators_lock.unlock();
+      std::this_thread::yield();
+    }
+    owner = 0;
+    bins.clear();
+  }
 
-  if (!is_last) {
-    std::swap(vec[idx], vec.back());
+  static int capacity(int size_class) {
+    auto size = class_sizes()[size_class];
+    return (int)std::clamp<std::size_t>(kMaxBytesPerClass / size, 2,
+                                        kMaxBlocks);
   }
+};
+
+thread_local UnifiedAllocator::ThreadCache UnifiedAllocator::thread_cache_;
 
-  vec.pop_back();
+UnifiedAllocator::UnifiedAllocator(HostMemoryPool *pool)
+    : pool_(pool), id_(next_allocator_id++), classes_(class_sizes().size()) {
+  std::lock_guard<std::mutex> _(allocators_mutex());
+  allocators()[id_] = this;
+}
 
-  // There's no need to swap back since we'll iterate the memory chunks to
-  // search for reusable memory
+UnifiedAllocator::~UnifiedAllocator() {
+  {
+    std::lock_guard<std::mutex> _(allocators_mutex());
+    allocators().erase(id_);
+  }
+  // The chunks themselves are released by the pool
+  for (auto &leaf : page_map_) {
+    std::free(leaf.load());
+  }
 }
 
-UnifiedAllocator::UnifiedAllocator() {
+std::mutex &UnifiedAllocator::pool_mutex() const {
+  return pool_->mut_allocation_;
+}
+
+void UnifiedAllocator::retire() {
+  std::lock_guard<std::mutex> _(allocators_mutex());
+  allocators().erase(id_);
+}
+
+int UnifiedAllocator::size_class(std::size_t size, std::size_t alignment) {
+  if (size > kMaxSmallSize || alignment > kPageSize) {
+    return -1;
+  }
+  const auto &sizes = class_sizes();
+  auto it = std::lower_bound(sizes.begin(), sizes.end(),
+                             std::max(size, (std::size_t)1));
+  while (it != sizes.end() && *it % alignment != 0) {
+    ++it;
+  }
+  return it == sizes.end() ? -1 : (int)(it - sizes.begin());
+}
+
+std::size_t UnifiedAllocator::class_size(int size_class) {
+  return class_sizes()[size_class];
+}
+
+std::size_t UnifiedAllocator::span_size(int size_class) {
+  // At least 8 blocks per span
+  return std::max<std::size_t>(64 << 10,
+                               round_up(8 * class_size(size_class), kPageSize));
 }
 
 void *UnifiedAllocator::allocate(std::size_t size,
                                  std::size_t alignment,
                                  bool exclusive) {
-  // UnifiedAllocator never reuses the previously allocated memory
-  // just move the head forward util depleting all the free memory
-
   // Note: put mutex on MemoryPool instead of Allocator, since Allocators are
   // transparent to user code
-  if (!chunks_.empty() && !exclusive) {
-    // Search for a non-exclusive chunk that has enough space
-    for (size_t chunk_id = 0; chunk_id < chunks_.size(); chunk_id++) {
-      auto &chunk = chunks_[chunk_id];
-      if (chunk.is_exclusive) {
-        continue;
-      }
-      auto head = (std::size_t)chunk.head;
-      auto tail = (std::size_t)chunk.tail;
-      auto data = (std::size_t)chunk.data;
-      auto ret = head + alignment - 1 - (head + alignment - 1) % alignment;
-      TI_TRACE("UM [data={}] allocate() request={} remain={}", (intptr_t)data,
-               size, (tail - head));
-      head = ret + size;
-      if (head <= tail) {
-        // success
-        TI_ASSERT(ret % alignment == 0);
-        chunk.head = (void *)head;
-        return (void *)ret;
-      }
+  if (exclusive) {
+    // A mapping of its own, which is unmapped when it is released
+    void *ptr = pool_->allocate_raw_memory(std::max(size, (std::size_t)1));
+    TI_ASSERT(uint64(ptr) % alignment == 0);
+    exclusive_allocations_[ptr] = size;
+    return ptr;
+  }
+
+  int cls = size_class(size, alignment);
+  if (cls >= 0) {
+    // Take a batch of blocks, keep all but the first one in the cache of
+    // this thread. They are pushed in reverse so that they are handed out in
+    // address order.
+    thread_cache_.claim(id_, /*locked=*/true);
+    auto &bin = thread_cache_.bins[cls];
+    const int batch = std::max(1, ThreadCache::capacity(cls) / 2 - bin.count);
+    std::vector<void *> blocks(batch);
+    for (int i = 0; i < batch; i++) {
+      blocks[i] = allocate_small(cls);
+    }
+    for (int i = batch - 1; i >= 1; i--) {
+      bin.blocks[bin.count++] = blocks[i];
     }
+    std::memset(blocks[0], 0, size);
+    return blocks[0];
   }
 
-  // Allocate a new chunk
-  MemoryChunk chunk;
+  // A run of pages. Alignments above a page are obtained by allocating more
+  // pages and skipping the first ones.
+  std::size_t run_size = round_up(std::max(size, (std::size_t)1), kPageSize);
+  if (alignment > kPageSize) {
+    run_size += alignment - kPageSize;
+  }
+  char *run = (char *)allocate_pages(run_size);
+  char *ptr = (char *)round_up((std::size_t)run, alignment);
+  large_allocations_[ptr] = {run, run_size};
+  TI_TRACE("UM allocate() request={} run={}", size, run_size);
+  return ptr;
+}
 
-  std::size_t allocation_size = size;
-  if (!exclusive) {
-    // Do not allocate large memory chunks for "exclusive" allocation
-    // to increate memory & performance efficiency
-    allocation_size = std::max(allocation_size, default_allocator_size);
+bool UnifiedAllocator::release(size_t sz, void *ptr) {
+  if (auto it = exclusive_allocations_.find(ptr);
+      it != exclusive_allocations_.end()) {
+    exclusive_allocations_.erase(it);
+    pool_->deallocate_raw_memory(ptr);
+    return true;
+  }
+  if (auto it = large_allocations_.find(ptr); it != large_allocations_.end()) {
+    auto [run, run_size] = it->second;
+    large_allocations_.erase(it);
+    release_pages(run, run_size);
+    return true;
+  }
+  int cls = page_class(ptr);
+  if (cls < 0) {
+    return false;
   }
+  release_small(cls, ptr);
+  // We got here because the cache of this thread is full: hand half of it
+  // back as well
+  if (thread_cache_.owner == id_) {
+    auto &bin = thread_cache_.bins[cls];
+    const int keep = ThreadCache::capacity(cls) / 2;
+    while (bin.count > keep) {
+      release_small(cls, bin.blocks[--bin.count]);
+    }
+  }
+  return true;
+}
 
+void *UnifiedAllocator::allocate_from_thread_cache(std::size_t size,
+                                                   std::size_t alignment) {
+  int cls = size_class(size, alignment);
+  if (cls < 0 || thread_cache_.owner != id_) {
+    return nullptr;
+  }
+  auto &bin = thread_cache_.bins[cls];
+  if (bin.count == 0) {
+    return nullptr;
+  }
+  void *ptr = bin.blocks[--bin.count];
+  std::memset(ptr, 0, size);
+  return ptr;
+}
+
+bool UnifiedAllocator::release_to_thread_cache(void *ptr) {
+  int cls = page_class(ptr);
+  if (cls < 0) {
+    return false;
+  }
+  thread_cache_.claim(id_, /*locked=*/false);
+  auto &bin = thread_cache_.bins[cls];
+  if (bin.count >= ThreadCache::capacity(cls)) {
+    return false;
+  }
+  bin.blocks[bin.count++] = ptr;
+  return true;
+}
+
+void *UnifiedAllocator::allocate_small(int cls) {
+  auto &c = classes_[cls];
+  if (c.free_list) {
+    void *ptr = c.free_list;
+    c.free_list = *(void **)ptr;
+    c.num_free--;
+    return ptr;
+  }
+  const std::size_t size = class_size(cls);
+  if ((std::size_t)(c.span_tail - c.span_head) < size) {
+    // Start a new span. What is left of the previous one is too small for a
+    // block and stays unused.
+    const std::size_t span = span_size(cls);
+    c.span_head = (char *)allocate_pages(span);
+    c.span_tail = c.span_head + span;
+    c.span_bytes += span;
+    set_page_class(c.span_head, span, cls);
+  }
+  void *ptr = c.span_head;
+  c.span_head += size;
+  return ptr;
+}
+
+void UnifiedAllocator::release_small(int cls, void *ptr) {
+  auto &c = classes_[cls];
+  *(void **)ptr = c.free_list;
+  c.free_list = ptr;
+  c.num_free++;
+}
+
+void *UnifiedAllocator::allocate_pages(std::size_t size) {
+  auto it = free_runs_by_size_.lower_bound({size, nullptr});
+  if (it == free_runs_by_size_.end()) {
+    add_chunk(std::max(size, round_up(default_allocator_size, kPageSize)));
+    it = free_runs_by_size_.lower_bound({size, nullptr});
+    TI_ASSERT(it != free_runs_by_size_.end());
+  }
+  // Best fit, split from the start of the run
+  auto [run_size, run] = *it;
+  erase_free_run(free_runs_.find(run));
+  if (run_size > size) {
+    insert_free_run(run + size, run_size - size);
+  }
+  pool_->commit_raw_memory(run, size);
+  return run;
+}
+
+void UnifiedAllocator::release_pages(char *ptr, std::size_t size) {
+  // Free runs are kept zero-filled, and give their memory back to the OS
+  pool_->discard_raw_memory(ptr, size);
+
+  auto chunk = std::prev(chunks_.upper_bound(ptr));
+  char *chunk_begin = chunk->first;
+  char *chunk_end = chunk->first + chunk->second;
+  // Coalesce with the free runs right before and after, in the same chunk
+  if (auto next = free_runs_.find(ptr + size);
+      next != free_runs_.end() && ptr + size < chunk_end) {
+    size += next->second;
+    erase_free_run(next);
+  }
+  if (auto prev = free_runs_.lower_bound(ptr);
+      ptr > chunk_begin && prev != free_runs_.begin()) {
+    --prev;
+    if (prev->first + prev->second == ptr) {
+      ptr = prev->first;
+      size += prev->second;
+      erase_free_run(prev);
+    }
+  }
+  if (ptr == chunk_begin && size == chunk->second && chunks_.size() > 1) {
+    // Keep one chunk around, release the others once they are entirely free
+    TI_TRACE("Releasing a chunk of {} MB", size / 1024 / 1024);
+    chunks_.erase(chunk);
+    pool_->deallocate_raw_memory(ptr);
+    return;
+  }
+  insert_free_run(ptr, size);
+}
+
+void UnifiedAllocator::add_chunk(std::size_t size) {
   TI_TRACE("Allocating virtual address space of size {} MB",
-           allocation_size / 1024 / 1024);
+           size / 1024 / 1024);
+  char *ptr = (char *)pool_->allocate_raw_memory(size);
+  TI_ASSERT(ptr != nullptr);
+  TI_ASSERT(uint64(ptr) % kPageSize == 0);
+  chunks_[ptr] = size;
+  insert_free_run(ptr, size);
+}
 
-  void *ptr =
-      HostMemoryPool::get_instance().allocate_raw_memory(allocation_size);
-  chunk.data = ptr;
-  chunk.head = (void *)((std::size_t)chunk.data + size);
-  chunk.tail = (void *)((std::size_t)chunk.head + allocation_size);
-  chunk.is_exclusive = exclusive;
+void UnifiedAllocator::insert_free_run(char *ptr, std::size_t size) {
+  free_runs_[ptr] = size;
+  free_runs_by_size_.insert({size, ptr});
+}
 
-  TI_ASSERT(chunk.data != nullptr);
-  TI_ASSERT(uint64(chunk.data) % HostMemoryPool::page_size == 0);
+void UnifiedAllocator::erase_free_run(
+    std::map<char *, std::size_t>::iterator it) {
+  free_runs_by_size_.erase({it->second, it->first});
+  free_runs_.erase(it);
+}
 
-  chunks_.emplace_back(std::move(chunk));
-  return ptr;
+int UnifiedAllocator::page_class(const void *ptr) const {
+  const uint64_t page = (uint64_t)ptr >> kPageBits;
+  const uint64_t root = page >> kPageMapLeafBits;
+  if (root >= page_map_.size()) {
+    return -1;
+  }
+  const uint8_t *leaf = page_map_[root].load(std::memory_order_acquire);
+  if (!leaf) {
+    return -1;
+  }
+  return (int)leaf[page & ((1 << kPageMapLeafBits) - 1)] - 1;
 }
 
-bool UnifiedAllocator::release(size_t sz, void *ptr) {
-  // UnifiedAllocator is special in that it never reuses the previously
-  // allocated memory We have to release the entire memory chunk to avoid memory
-  // leak
-  int remove_idx = -1;
-  for (size_t chunk_idx = 0; chunk_idx < chunks_.size(); chunk_idx++) {
-    auto &chunk = chunks_[chunk_idx];
-
-    if (chunk.data == ptr) {
-      TI_ASSERT(chunk.is_exclusive);
-      remove_idx = chunk_idx;
+void UnifiedAllocator::set_page_class(const void *begin,
+                                      std::size_t size,
+                                      int size_class) {
+  const uint64_t first = (uint64_t)begin >> kPageBits;
+  const uint64_t last = ((uint64_t)begin + size - 1) >> kPageBits;
+  for (uint64_t page = first; page <= last; page++) {
+    const uint64_t root = page >> kPageMapLeafBits;
+    TI_ASSERT(root < page_map_.size());
+    uint8_t *leaf = page_map_[root].load(std::memory_order_relaxed);
+    if (!leaf) {
+      leaf = (uint8_t *)std::calloc(1 << kPageMapLeafBits, 1);
+      TI_ERROR_IF(!leaf, "Failed to allocate the page map");
+      page_map_[root].store(leaf, std::memory_order_release);
     }
+    leaf[page & ((1 << kPageMapLeafBits) - 1)] = (uint8_t)(size_class + 1);
   }
+}
 
-  if (remove_idx != -1) {
-    swap_erase_vector<MemoryChunk>(chunks_, remove_idx);
-    // MemoryPool is responsible for releasing the raw memory
-    return true;
+UnifiedAllocator::Stats UnifiedAllocator::get_stats() const {
+  Stats stats;
+  for (auto &[ptr, size] : chunks_) {
+    stats.reserved_bytes += size;
+  }
+  for (auto &[ptr, size] : exclusive_allocations_) {
+    stats.exclusive_bytes += round_up(size, kPageSize);
   }
+  stats.reserved_bytes += stats.exclusive_bytes;
+  for (auto &[ptr, run] : large_allocations_) {
+    stats.large_bytes += run.second;
+  }
+  for (int i = 0; i < (int)classes_.size(); i++) {
+    stats.small_span_bytes += classes_[i].span_bytes;
+    stats.small_free_bytes += classes_[i].num_free * class_size(i);
+  }
+  for (auto &[ptr, size] : free_runs_) {
+    stats.free_run_bytes += size;
+    stats.largest_free_run_bytes = std::max(stats.largest_free_run_bytes, size);
+  }
+  stats.num_free_runs = free_runs_.size();
+  return stats;
+}
 
-  return false;
+std::string UnifiedAllocator::report() const {
+  auto mb = [](std::size_t bytes) { return bytes / 1048576.0; };
+  const Stats stats = get_stats();
+  std::string result = fmt::format(
+      "Host memory pool: {:.1f} MB reserved\n"
+      "  exclusive allocations: {:.1f} MB\n"
+      "  large allocations: {:.1f} MB in {} runs\n"
+      "  size classes: {:.1f} MB of spans, {:.1f} MB of free blocks\n"
+      "  free page runs: {:.1f} MB in {} runs, largest {:.1f} MB, "
+      "fragmentation {:.1f}%\n",
+      mb(stats.reserved_bytes), mb(stats.exclusive_bytes),
+      mb(stats.large_bytes), large_allocations_.size(),
+      mb(stats.small_span_bytes), mb(stats.small_free_bytes),
+      mb(stats.free_run_bytes), stats.num_free_runs,
+      mb(stats.largest_free_run_bytes), stats.fragmentation() * 100);
+  for (int i = 0; i < (int)classes_.size(); i++) {
+    const auto &c = classes_[i];
+    if (c.span_bytes == 0) {
+      continue;
+    }
+    const std::size_t total = c.span_bytes / span_size(i) *
+                              (span_size(i) / class_size(i));
+    result += fmt::format("  class {:>6} B: {:>7} blocks, {:>7} free\n",
+                          class_size(i), total, c.num_free);
+  }
+  return result;
 }
 
 }  // namespace taichi::lang
@@ -1,8 +1,12 @@
 #pragma once
+#include <array>
+#include <atomic>
 #include <mutex>
 #include <vector>
 #include <memory>
 #include <map>
+#include <set>
+#include <string>
 
 #include "taichi/rhi/arch.h"
 #include "taichi/rhi/device.h"
@@ -11,28 +15,136 @@ namespace taichi::lang {
 
 class HostMemoryPool;
 
-// This class can only be accessed by MemoryPool
+// The allocator behind HostMemoryPool. All of its memory comes from chunks of
+// at least default_allocator_size bytes of virtual memory, reserved with
+// HostMemoryPool::allocate_raw_memory().
+//
+// * Small allocations (up to kMaxSmallSize bytes) are rounded up to a size
+//   class and carved out of spans of pages dedicated to that class. Freed
+//   blocks are reused for the same class, through a small cache per thread
+//   which is accessed without taking the lock of the pool.
+// * Large allocations are runs of pages. Freed runs are coalesced with the
+//   free runs around them and their pages are given back to the OS, and
+//   chunks that become entirely free are released.
+// * Exclusive allocations get their own mapping, released with them.
+//
+// The memory returned is always zero-filled, which the LLVM runtime relies
+// on. Free page runs are kept zero-filled, and reused small blocks are
+// cleared when they are handed out again.
+//
+// This class can only be accessed by HostMemoryPool
 class UnifiedAllocator {
  public:
-  struct MemoryChunk {
-    bool is_exclusive;
-    void *data;
-    void *head;
-    void *tail;
+  struct Stats {
+    // Virtual memory reserved from the OS, including exclusive allocations
+    std::size_t reserved_bytes{0};
+    // Bytes of the live exclusive and large allocations, rounded up to pages
+    std::size_t exclusive_bytes{0};
+    std::size_t large_bytes{0};
+    // Bytes of the spans of the size classes, and of the blocks on the free
+    // lists of the classes. Blocks in the caches of the threads count as
+    // used.
+    std::size_t small_span_bytes{0};
+    std::size_t small_free_bytes{0};
+    // Free page runs
+    std::size_t free_run_bytes{0};
+    std::size_t largest_free_run_bytes{0};
+    std::size_t num_free_runs{0};
+
+    // The share of the free page runs that cannot serve an allocation of
+    // the size of the largest one, in [0, 1]
+    double fragmentation() const {
+      return free_run_bytes == 0 ? 0.0
+                                 : 1.0 - (double)largest_free_run_bytes /
+                                             (double)free_run_bytes;
+    }
   };
 
+  static constexpr std::size_t kMaxSmallSize = 64 << 10;
+
+  ~UnifiedAllocator();
+
  private:
   static std::size_t default_allocator_size;
 
-  UnifiedAllocator();
+  explicit UnifiedAllocator(HostMemoryPool *pool);
 
+  // Must be called with the lock of the pool held
   void *allocate(std::size_t size,
                  std::size_t alignment,
                  bool exclusive = false);
-
   bool release(size_t sz, void *ptr);
 
-  std::vector<MemoryChunk> chunks_;
+  // The lock-free paths through the cache of the calling thread. They return
+  // nullptr/false when the lock has to be taken.
+  void *allocate_from_thread_cache(std::size_t size, std::size_t alignment);
+  bool release_to_thread_cache(void *ptr);
+
+  // Must be called with the lock of the pool held
+  Stats get_stats() const;
+  std::string report() const;
+
+  static int size_class(std::size_t size, std::size_t alignment);
+  static std::size_t class_size(int size_class);
+  static std::size_t span_size(int size_class);
+
+  void *allocate_small(int size_class);
+  void release_small(int size_class, void *ptr);
+  void *allocate_pages(std::size_t size);
+  void release_pages(char *ptr, std::size_t size);
+  void add_chunk(std::size_t size);
+  void insert_free_run(char *ptr, std::size_t size);
+  void erase_free_run(std::map<char *, std::size_t>::iterator it);
+
+  // The size class of the page containing |ptr|, -1 if it is not a page of a
+  // span. Lock-free.
+  int page_class(const void *ptr) const;
+  void set_page_class(const void *begin, std::size_t size, int size_class);
+
+  // The lock of the pool this allocator belongs to
+  std::mutex &pool_mutex() const;
+
+  // Unregisters this allocator once its memory is gone, so that the blocks
+  // the thread caches still hold for it are dropped instead of given back.
+  // Must be called with the lock of the pool held.
+  void retire();
+
+  // Freed small blocks kept by a thread, see unified_allocator.cpp
+  struct ThreadCache;
+  static thread_local ThreadCache thread_cache_;
+
+  HostMemoryPool *const pool_;
+  // The id of this allocator, telling the caches of the threads which
+  // allocator their blocks belong to
+  const uint64_t id_;
+
+  // Chunks of virtual memory, as begin -> size
+  std::map<char *, std::size_t> chunks_;
+  // Free page runs, by address and by size
+  std::map<char *, std::size_t> free_runs_;
+  std::set<std::pair<std::size_t, char *>> free_runs_by_size_;
+  // Live large allocations: returned pointer -> (run, run size)
+  std::map<void *, std::pair<char *, std::size_t>> large_allocations_;
+  // Live exclusive allocations
+  std::map<void *, std::size_t> exclusive_allocations_;
+
+  struct SizeClass {
+    // Freed blocks, linked through their first word
+    void *free_list{nullptr};
+    std::size_t num_free{0};
+    // The unused part of the last span
+    char *span_head{nullptr};
+    char *span_tail{nullptr};
+    std::size_t span_bytes{0};
+  };
+  std::vector<SizeClass> classes_;
+
+  // A two-level map from page numbers to size classes (plus one, 0 for
+  // pages not in a span), with leaves allocated on demand. Leaves are never
+  // freed until the allocator is destroyed.
+  static constexpr int kPageMapLeafBits = 24;
+  static constexpr int kPageMapRootBits = 48 - 12 - kPageMapLeafBits;
+  std::array<std::atomic<uint8_t *>, (1 << kPageMapRootBits)> page_map_{};
 
   friend class HostMemoryPool;
   friend class HostMemoryPoolTestHelper;
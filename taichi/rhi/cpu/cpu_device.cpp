@@ -25,8 +25,10 @@ RhiResult CpuDevice::allocate_memory(const AllocParams &params,
   if (info.size == 0) {
     info.ptr = nullptr;
   } else {
+    // Freed allocations are reused by the pool, instead of mapping and
+    // unmapping memory for each of them
     info.ptr = HostMemoryPool::get_instance().allocate(
-        params.size, HostMemoryPool::page_size, true /*exclusive*/);
+        params.size, HostMemoryPool::page_size);
 
     if (info.ptr == nullptr) {
       return RhiResult::out_of_memory;
@@ -67,7 +69,9 @@ void CpuDevice::dealloc_memory(DeviceAllocation handle) {
   if (info.ptr == nullptr) {
     TI_ERROR("the DeviceAllocation is already deallocated");
   }
-  if (!info.use_cached) {
+  if (info.imported) {
+    info.ptr = nullptr;
+  } else if (!info.use_cached) {
     HostMemoryPool::get_instance().release(info.size, info.ptr);
     info.ptr = nullptr;
   }
@@ -151,6 +155,7 @@ DeviceAllocation CpuDevice::import_memory(void *ptr, size_t size) {
   AllocInfo info;
   info.ptr = ptr;
   info.size = size;
+  info.imported = true;
 
   DeviceAllocation alloc;
   alloc.alloc_id = allocations_.size();
@@ -80,6 +80,8 @@ class CpuDevice : public LlvmDevice {
     void *ptr{nullptr};
     size_t size{0};
     bool use_cached{false};
+    // Memory owned by someone else, see import_memory()
+    bool imported{false};
   };
 
   AllocInfo get_alloc_info(const DeviceAllocation handle);
@@ -1,4 +1,5 @@
 #include "taichi/rhi/flagos/flagos_device.h"
+#include "taichi/rhi/flagos/flagos_sim.h"
 #include "taichi/rhi/llvm/device_memory_pool.h"
 
 #include "taichi/jit/jit_module.h"
@@ -15,14 +16,25 @@ struct FlagosDevice::FlagosContextWrapper {
   // This will be replaced with actual FlagOS SDK calls
   bool initialized{false};
 
-  void initialize(const std::string &chip_name) {
+  // Set for the "sim" chip, which runs on the host instead of FlagTree
+  std::unique_ptr<SimContext> sim;
+
+  void initialize(const std::string &chip_name, int num_threads) {
     TI_INFO("Initializing FlagOS backend with chip: {}", chip_name);
-    // TODO: Call FlagOS SDK initialization
-    // flagos_init(chip_name.c_str());
+    if (chip_name == "sim") {
+      sim = std::make_unique<SimContext>(SimContext::default_capacity(),
+                                         num_threads);
+    } else {
+      // TODO: Call FlagOS SDK initialization
+      // flagos_init(chip_name.c_str());
+    }
     initialized = true;
   }
 
   void *allocate_memory(size_t size, bool managed) {
+    if (sim) {
+      return sim->allocate_memory(size);
+    }
     // TODO: Use FlagOS memory allocation
     // return flagos_malloc(size, managed);
     TI_NOT_IMPLEMENTED;
@@ -30,40 +42,74 @@ struct FlagosDevice::FlagosContextWrapper {
   }
 
   void free_memory(void *ptr) {
+    if (sim) {
+      sim->free_memory(ptr);
+    }
     // TODO: Use FlagOS memory deallocation
     // flagos_free(ptr);
   }
 
   void memcpy_host_to_device(void *dst, const void *src, size_t size) {
+    if (sim) {
+      sim->memcpy_host_to_device(dst, src, size);
+      return;
+    }
     // TODO: Use FlagOS H2D copy
     TI_NOT_IMPLEMENTED;
   }
 
   void memcpy_device_to_host(void *dst, const void *src, size_t size) {
+    if (sim) {
+      sim->memcpy_device_to_host(dst, src, size);
+      return;
+    }
     // TODO: Use FlagOS D2H copy
     TI_NOT_IMPLEMENTED;
   }
 
   void memcpy_device_to_device(void *dst, const void *src, size_t size) {
+    if (sim) {
+      sim->memcpy_device_to_device(dst, src, size);
+      return;
+    }
     // TODO: Use FlagOS D2D copy
     TI_NOT_IMPLEMENTED;
   }
 
   void memset(void *ptr, int value, size_t size) {
+    if (sim) {
+      sim->memset(ptr, value, size);
+      return;
+    }
     // TODO: Use FlagOS memset
     TI_NOT_IMPLEMENTED;
   }
 
   void synchronize() {
+    if (sim) {
+      // Simulated launches are synchronous
+      return;
+    }
     // TODO: Use FlagOS synchronization
     TI_NOT_IMPLEMENTED;
   }
 
   size_t get_total_memory() {
+    if (sim) {
+      return sim->get_total_memory();
+    }
     // TODO: Query FlagOS device memory
     return 0;
   }
 
+  int get_num_compute_units() {
+    if (sim) {
+      return sim->get_num_threads();
+    }
+    // TODO: Query FlagOS for the number of compute units
+    return 0;
+  }
+
   void launch_kernel(const std::string &kernel_name,
                      void **args,
                      uint32_t grid_dim,
@@ -91,9 +137,22 @@ FlagosDevice::~FlagosDevice() {
   clear();
 }
 
-void FlagosDevice::initialize(const std::string &chip_name) {
+void FlagosDevice::initialize(const std::string &chip_name, int num_threads) {
+  if (context_->initialized) {
+    TI_ERROR_IF(chip_name != target_chip_,
+                "FlagOS device already initialized for chip {}", target_chip_);
+    return;
+  }
   target_chip_ = chip_name;
-  context_->initialize(chip_name);
+  context_->initialize(chip_name, num_threads);
+}
+
+bool FlagosDevice::is_simulated() const {
+  return context_->sim != nullptr;
+}
+
+int FlagosDevice::get_num_compute_units() const {
+  return context_->get_num_compute_units();
 }
 
 FlagosDevice::AllocInfo FlagosDevice::get_alloc_info(
@@ -116,7 +175,7 @@ RhiResult FlagosDevice::allocate_memory(const AllocParams &params,
     ptr = context_->allocate_memory(params.size, managed);
   }
 
-  if (ptr == nullptr) {
+  if (ptr == nullptr && !is_simulated()) {
     ptr = mem_pool.allocate(params.size, DeviceMemoryPool::page_size, managed);
   }
 
@@ -151,6 +210,16 @@ RhiResult FlagosDevice::allocate_memory(const AllocParams &params,
 
 DeviceAllocation FlagosDevice::allocate_memory_runtime(
     const LlvmRuntimeAllocParams &params) {
+  if (is_simulated()) {
+    // Like on CPUs, the runtime memory is allocated as any other memory
+    DeviceAllocation alloc;
+    RhiResult res = allocate_memory(params, &alloc);
+    TI_ERROR_IF(res != RhiResult::success,
+                "Failed to allocate {} B of FlagOS simulator memory",
+                params.size);
+    return alloc;
+  }
+
   AllocInfo info;
   info.size = taichi::iroundup(params.size, taichi_page_size);
   if (params.host_read || params.host_write) {
@@ -182,6 +251,11 @@ uint64_t *FlagosDevice::allocate_llvm_runtime_memory_jit(
       "runtime_memory_allocate_aligned", params.runtime, params.size,
       taichi_page_size, params.result_buffer);
 
+  if (is_simulated()) {
+    // The result buffer of the host runtime lives in host memory
+    return reinterpret_cast<uint64_t *>(params.result_buffer[0]);
+  }
+
   wait_idle();
 
   uint64 *ret{nullptr};
@@ -217,8 +291,26 @@ void FlagosDevice::dealloc_memory(DeviceAllocation handle) {
   info.ptr = nullptr;
 }
 
+RhiResult FlagosDevice::map_range(DevicePtr ptr,
+                                  uint64_t size,
+                                  void **mapped_ptr) {
+  validate_device_alloc(ptr);
+  AllocInfo &info = allocations_[ptr.alloc_id];
+  if (!is_simulated() || ptr.offset + size > info.size) {
+    return RhiResult::not_supported;
+  }
+  // The simulator memory is host memory
+  *mapped_ptr = static_cast<char *>(info.ptr) + ptr.offset;
+  return RhiResult::success;
+}
+
 RhiResult FlagosDevice::map(DeviceAllocation alloc, void **mapped_ptr) {
+  validate_device_alloc(alloc);
   AllocInfo &info = allocations_[alloc.alloc_id];
+  if (is_simulated()) {
+    *mapped_ptr = info.ptr;
+    return RhiResult::success;
+  }
   size_t size = info.size;
   info.mapped = new char[size];
 
@@ -232,6 +324,9 @@ RhiResult FlagosDevice::map(DeviceAllocation alloc, void **mapped_ptr) {
 
 void FlagosDevice::unmap(DeviceAllocation alloc) {
   AllocInfo &info = allocations_[alloc.alloc_id];
+  if (is_simulated()) {
+    return;
+  }
 
   if (context_->initialized) {
     context_->memcpy_host_to_device(info.ptr, info.mapped, info.size);
@@ -283,6 +378,7 @@ void FlagosDevice::wait_idle() {
 
 void FlagosDevice::clear() {
   allocations_.clear();
+  context_->sim.reset();
   context_->initialized = false;
 }
 
@@ -329,17 +425,28 @@ void FlagosDevice::launch_kernel(const std::string &kernel_name,
   }
 }
 
+void FlagosDevice::launch_kernel(void *func,
+                                 void *context,
+                                 uint32_t grid_dim,
+                                 uint32_t block_dim) {
+  TI_ERROR_IF(!is_simulated(),
+              "Launching host functions requires the FlagOS simulator");
+  context_->sim->launch((SimContext::TaskFunc *)func, context, int(grid_dim),
+                        int(block_dim));
+}
+
 bool FlagosDevice::is_chip_supported(const std::string &chip_name) {
   // TODO: Query FlagOS for supported chips
   static const std::set<std::string> supported_chips = {
-      "mlu370", "mlu590", "ascend910", "ascend310", "dcu", "gcu", "generic"};
+      "mlu370", "mlu590", "ascend910", "ascend310",
+      "dcu",    "gcu",    "generic",   "sim"};
   return supported_chips.count(chip_name) > 0;
 }
 
 std::vector<std::string> FlagosDevice::get_supported_chips() {
   // TODO: Query FlagOS for available chips
   return {"mlu370", "mlu590", "ascend910", "ascend310",
-          "dcu",    "gcu",    "generic"};
+          "dcu",    "gcu",    "generic",   "sim"};
 }
 
 }  // namespace flagos
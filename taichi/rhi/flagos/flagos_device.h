@@ -172,8 +172,19 @@ class FlagosDevice : public LlvmDevice {
   /**
    * @brief Initialize FlagOS backend with specific chip target
    * @param chip_name Target chip name (e.g., "mlu370", "ascend910", "dcu")
+   * @param num_threads Host threads of the "sim" chip, 0 for all cores
    */
-  void initialize(const std::string &chip_name);
+  void initialize(const std::string &chip_name, int num_threads = 0);
+
+  /**
+   * @brief Whether the device is emulated on the host (the "sim" chip)
+   */
+  bool is_simulated() const;
+
+  /**
+   * @brief Number of blocks the device runs concurrently, 0 if unknown
+   */
+  int get_num_compute_units() const;
 
   /**
    * @brief Get the target chip name
@@ -200,6 +211,14 @@ class FlagosDevice : public LlvmDevice {
                      uint32_t grid_dim,
                      uint32_t block_dim);
 
+  /**
+   * @brief Launch a host function taking |context| on the simulator
+   */
+  void launch_kernel(void *func,
+                     void *context,
+                     uint32_t grid_dim,
+                     uint32_t block_dim);
+
  private:
   std::vector<AllocInfo> allocations_;
   std::string target_chip_{"generic"};
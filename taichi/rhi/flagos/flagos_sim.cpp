@@ -0,0 +1,209 @@
+#include "taichi/rhi/flagos/flagos_sim.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#include "taichi/math/arithmetic.h"
+
+namespace taichi {
+namespace lang {
+
+namespace flagos {
+
+namespace {
+
+thread_local SimContext::LaunchDims current_launch_dims;
+
+int sim_thread_idx() {
+  return current_launch_dims.thread_idx;
+}
+
+int sim_block_idx() {
+  return current_launch_dims.block_idx;
+}
+
+int sim_block_dim() {
+  return current_launch_dims.block_dim;
+}
+
+int sim_grid_dim() {
+  return current_launch_dims.grid_dim;
+}
+
+struct BlockTaskContext {
+  SimContext::TaskFunc *func{nullptr};
+  void *context{nullptr};
+  int grid_dim{1};
+  int block_dim{1};
+};
+
+void run_block(void *task_context, int thread_id, int block_idx) {
+  auto &task = *(BlockTaskContext *)task_context;
+  auto &dims = current_launch_dims;
+  const auto saved_dims = dims;
+  dims.block_idx = block_idx;
+  dims.block_dim = task.block_dim;
+  dims.grid_dim = task.grid_dim;
+  for (int i = 0; i < task.block_dim; i++) {
+    dims.thread_idx = i;
+    task.func(task.context);
+  }
+  dims = saved_dims;
+}
+
+}  // namespace
+
+SimContext::SimContext(std::size_t capacity, int num_threads)
+    : capacity_(capacity) {
+  if (num_threads <= 0) {
+    num_threads = std::max(1, int(std::thread::hardware_concurrency()));
+  }
+  thread_pool_ = std::make_unique<ThreadPool>(num_threads);
+  TI_TRACE("FlagOS simulator: {:.2f} MB of device memory, {} threads",
+           1.0 * capacity_ / (1UL << 20), num_threads);
+}
+
+SimContext::~SimContext() {
+  std::lock_guard<std::mutex> _(mut_);
+  for (auto &[base, size] : allocations_) {
+    ::operator delete((void *)base, std::align_val_t(kAlignment));
+  }
+  allocations_.clear();
+}
+
+void *SimContext::allocate_memory(std::size_t size) {
+  const std::size_t aligned_size =
+      std::max<std::size_t>(iroundup(size, kAlignment), kAlignment);
+  std::lock_guard<std::mutex> _(mut_);
+  if (used_ + aligned_size > capacity_) {
+    TI_TRACE("FlagOS simulator out of memory: {} B requested, {} B free",
+             aligned_size, capacity_ - used_);
+    return nullptr;
+  }
+  void *ptr = ::operator new(aligned_size, std::align_val_t(kAlignment),
+                             std::nothrow);
+  if (ptr == nullptr) {
+    return nullptr;
+  }
+  used_ += aligned_size;
+  allocations_[(std::uintptr_t)ptr] = aligned_size;
+  return ptr;
+}
+
+void SimContext::free_memory(void *ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  std::lock_guard<std::mutex> _(mut_);
+  auto it = allocations_.find((std::uintptr_t)ptr);
+  if (it == allocations_.end()) {
+    TI_ERROR("FlagOS simulator: freeing {} which is not a device allocation",
+             ptr);
+  }
+  used_ -= it->second;
+  allocations_.erase(it);
+  ::operator delete(ptr, std::align_val_t(kAlignment));
+}
+
+void SimContext::check_device_range(const void *ptr, std::size_t size) const {
+  const auto begin = (std::uintptr_t)ptr;
+  // The last allocation starting at or before |ptr|
+  auto it = allocations_.upper_bound(begin);
+  if (it != allocations_.begin()) {
+    --it;
+    if (begin + size <= it->first + it->second) {
+      return;
+    }
+  }
+  TI_ERROR(
+      "FlagOS simulator: [{}, {}) is out of the bounds of device memory",
+      ptr, (const void *)(begin + size));
+}
+
+void SimContext::memcpy_host_to_device(void *dst,
+                                       const void *src,
+                                       std::size_t size) {
+  {
+    std::lock_guard<std::mutex> _(mut_);
+    check_device_range(dst, size);
+  }
+  std::memcpy(dst, src, size);
+}
+
+void SimContext::memcpy_device_to_host(void *dst,
+                                       const void *src,
+                                       std::size_t size) {
+  {
+    std::lock_guard<std::mutex> _(mut_);
+    check_device_range(src, size);
+  }
+  std::memcpy(dst, src, size);
+}
+
+void SimContext::memcpy_device_to_device(void *dst,
+                                         const void *src,
+                                         std::size_t size) {
+  {
+    std::lock_guard<std::mutex> _(mut_);
+    check_device_range(dst, size);
+    check_device_range(src, size);
+  }
+  std::memmove(dst, src, size);
+}
+
+void SimContext::memset(void *ptr, int value, std::size_t size) {
+  {
+    std::lock_guard<std::mutex> _(mut_);
+    check_device_range(ptr, size);
+  }
+  std::memset(ptr, value, size);
+}
+
+void SimContext::launch(TaskFunc *func,
+                        void *context,
+                        int grid_dim,
+                        int block_dim) {
+  TI_ERROR_IF(grid_dim <= 0 || block_dim <= 0,
+              "FlagOS simulator: invalid launch dimensions {}x{}", grid_dim,
+              block_dim);
+  BlockTaskContext task;
+  task.func = func;
+  task.context = context;
+  task.grid_dim = grid_dim;
+  task.block_dim = block_dim;
+  thread_pool_->run(grid_dim, thread_pool_->get_max_num_threads(), &task,
+                    run_block);
+}
+
+std::size_t SimContext::get_used_memory() const {
+  std::lock_guard<std::mutex> _(mut_);
+  return used_;
+}
+
+const SimContext::LaunchDims &SimContext::current_dims() {
+  return current_launch_dims;
+}
+
+std::vector<std::pair<std::string, void *>> SimContext::builtin_symbols() {
+  return {{"taichi_flagos_sim_thread_idx", (void *)&sim_thread_idx},
+          {"taichi_flagos_sim_block_idx", (void *)&sim_block_idx},
+          {"taichi_flagos_sim_block_dim", (void *)&sim_block_dim},
+          {"taichi_flagos_sim_grid_dim", (void *)&sim_grid_dim}};
+}
+
+std::size_t SimContext::default_capacity() {
+  std::size_t megabytes = 4096;
+  if (const char *env = std::getenv("TI_FLAGOS_SIM_MEMORY_MB")) {
+    megabytes = std::strtoull(env, nullptr, 10);
+    TI_ERROR_IF(megabytes == 0, "Invalid TI_FLAGOS_SIM_MEMORY_MB \"{}\"", env);
+  }
+  return megabytes << 20;
+}
+
+}  // namespace flagos
+
+}  // namespace lang
+
+}  // namespace taichi
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "taichi/common/core.h"
+#include "taichi/system/threading.h"
+
+namespace taichi {
+namespace lang {
+
+namespace flagos {
+
+/**
+ * @brief Host emulation of a FlagOS device ("sim" chip)
+ *
+ * Stands in for the FlagTree runtime when no AI chip is available, so that
+ * the FlagOS backend can be developed and tested on any machine.
+ *
+ * - Device memory is a bounded arena of host memory. Copies and memsets are
+ *   checked against the live allocations, so that out-of-bounds transfers
+ *   fail loudly instead of corrupting the host heap.
+ * - Kernels are launched with the SPMD semantics of the real chips: every
+ *   block of the grid is a task of a host thread pool, and the threads of a
+ *   block run one after another on that host thread. The builtins below
+ *   report the coordinates of the thread being run.
+ *
+ * Since the threads of a block are serialized, intra-block barriers and warp
+ * intrinsics cannot be emulated. Kernels relying on them must not be launched
+ * with more than one thread per block.
+ */
+class SimContext {
+ public:
+  // A kernel entry, called once per simulated thread.
+  using TaskFunc = void(void *context);
+
+  struct LaunchDims {
+    int thread_idx{0};
+    int block_idx{0};
+    int block_dim{1};
+    int grid_dim{1};
+  };
+
+  static constexpr std::size_t kAlignment = 256;
+
+  /**
+   * @param capacity Size of the device memory in bytes
+   * @param num_threads Number of host threads running the blocks
+   */
+  SimContext(std::size_t capacity, int num_threads);
+  ~SimContext();
+
+  // Returns nullptr when the device is out of memory.
+  void *allocate_memory(std::size_t size);
+  void free_memory(void *ptr);
+
+  void memcpy_host_to_device(void *dst, const void *src, std::size_t size);
+  void memcpy_device_to_host(void *dst, const void *src, std::size_t size);
+  void memcpy_device_to_device(void *dst, const void *src, std::size_t size);
+  void memset(void *ptr, int value, std::size_t size);
+
+  void launch(TaskFunc *func, void *context, int grid_dim, int block_dim);
+
+  std::size_t get_total_memory() const {
+    return capacity_;
+  }
+
+  std::size_t get_used_memory() const;
+
+  // The blocks of a launch run concurrently on this many host threads.
+  int get_num_threads() const {
+    return thread_pool_->get_max_num_threads();
+  }
+
+  // Coordinates of the simulated thread running on the calling host thread.
+  // Outside of a launch, the host thread is the only thread of a 1x1 grid.
+  static const LaunchDims &current_dims();
+
+  // The builtins the host runtime module calls instead of the hardware
+  // registers, see TaichiLLVMContext::module_from_file.
+  static std::vector<std::pair<std::string, void *>> builtin_symbols();
+
+  // Reads the device memory size from TI_FLAGOS_SIM_MEMORY_MB.
+  static std::size_t default_capacity();
+
+ private:
+  // Must be called with mut_ held
+  void check_device_range(const void *ptr, std::size_t size) const;
+
+  std::size_t capacity_{0};
+  std::size_t used_{0};
+  mutable std::mutex mut_;
+  // Base address -> size of the live allocations
+  std::map<std::uintptr_t, std::size_t> allocations_;
+  std::unique_ptr<ThreadPool> thread_pool_;
+};
+
+}  // namespace flagos
+
+}  // namespace lang
+
+}  // namespace taichi
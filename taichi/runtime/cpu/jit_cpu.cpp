@@ -50,6 +50,10 @@
 #include "taichi/util/file_sequence_writer.h"
 #include "taichi/runtime/llvm/llvm_context.h"
 
+#if defined(TI_WITH_FLAGOS)
+#include "taichi/rhi/flagos/flagos_sim.h"
+#endif
+
 namespace taichi::lang {
 
 #ifdef TI_WITH_LLVM
@@ -103,8 +107,10 @@ class JITSessionCPU : public JITSession {
   MangleAndInterner mangle_;
   std::mutex mut_;
   std::vector<llvm::orc::JITDylib *> all_libs_;
+  std::vector<llvm::orc::JITDylib *> shared_libs_;
   int module_counter_;
   SectionMemoryManager *memory_manager_;
+  JITTargetMachineBuilder jtmb_;
 
  public:
   JITSessionCPU(TaichiLLVMContext *tlctx,
@@ -130,7 +136,8 @@ class JITSessionCPU : public JITSession {
         dl_(DL),
         mangle_(es_, this->dl_),
         module_counter_(0),
-        memory_manager_(nullptr) {
+        memory_manager_(nullptr),
+        jtmb_(JTMB) {
     if (JTMB.getTargetTriple().isOSBinFormatCOFF()) {
       object_layer_.setOverrideObjectFlagsWithResponsibilityFlags(true);
       object_layer_.setAutoClaimResponsibilityForObjectSymbols(true);
@@ -151,25 +158,41 @@ class JITSessionCPU : public JITSession {
 
   JITModule *add_module(std::unique_ptr<llvm::Module> M, int max_reg) override {
     TI_ASSERT(max_reg == 0);  // No need to specify max_reg on CPUs
-    TI_ASSERT(M);
+    return add_module_to_new_dylib(std::move(M), /*shared=*/false);
+  }
+
+  JITModule *add_shared_module(std::unique_ptr<llvm::Module> M) override {
+    return add_module_to_new_dylib(std::move(M), /*shared=*/true);
+  }
+
+  std::string compile_to_object(llvm::Module &M) override {
+    // Same as the ConcurrentIRCompiler of compile_layer_
+    auto tm = jtmb_.createTargetMachine();
+    if (!tm) {
+      TI_ERROR("Failed to create the target machine: {}",
+               toString(tm.takeError()));
+    }
+    llvm::SmallVector<char, 0> buffer;
+    llvm::raw_svector_ostream os(buffer);
+    llvm::legacy::PassManager pass_manager;
+    MCContext *mc_context = nullptr;
+    TI_ERROR_IF((*tm)->addPassesToEmitMC(pass_manager, mc_context, os),
+                "Target does not support MC emission.");
+    pass_manager.run(M);
+    return std::string(buffer.begin(), buffer.end());
+  }
+
+  JITModule *add_object(std::unique_ptr<llvm::MemoryBuffer> &&obj) override {
+    TI_ASSERT(obj);
     std::lock_guard<std::mutex> _(mut_);
-    auto dylib_expect = es_.createJITDylib(fmt::format("{}", module_counter_));
-    TI_ASSERT(dylib_expect);
-    auto &dylib = dylib_expect.get();
-    dylib.addGenerator(
-        cantFail(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
-            dl_.getGlobalPrefix())));
-    auto *thread_safe_context =
-        this->tlctx_->get_this_thread_thread_safe_context();
-    cantFail(compile_layer_.add(
-        dylib,
-        llvm::orc::ThreadSafeModule(std::move(M), *thread_safe_context)));
-    all_libs_.push_back(&dylib);
-    auto new_module = std::make_unique<JITModuleCPU>(this, &dylib);
-    auto new_module_raw_ptr = new_module.get();
-    modules.push_back(std::move(new_module));
-    module_counter_++;
-    return new_module_raw_ptr;
+    auto &dylib = create_dylib();
+    cantFail(object_layer_.add(dylib, std::move(obj)));
+    return add_jit_module(dylib, /*shared=*/false);
+  }
+
+  std::string target_id() const override {
+    return fmt::format("{}/{}/{}", jtmb_.getTargetTriple().str(),
+                       jtmb_.getCPU(), jtmb_.getFeatures().getString());
   }
 
   void *lookup(const std::string Name) override {
@@ -195,6 +218,61 @@ class JITSessionCPU : public JITSession {
       TI_ERROR("Function \"{}\" not found", Name);
     return (void *)(symbol->getAddress());
   }
+
+ private:
+  JITModule *add_module_to_new_dylib(std::unique_ptr<llvm::Module> M,
+                                     bool shared) {
+    TI_ASSERT(M);
+    std::lock_guard<std::mutex> _(mut_);
+    auto &dylib = create_dylib();
+    auto *thread_safe_context =
+        this->tlctx_->get_this_thread_thread_safe_context();
+    cantFail(compile_layer_.add(
+        dylib,
+        llvm::orc::ThreadSafeModule(std::move(M), *thread_safe_context)));
+    return add_jit_module(dylib, shared);
+  }
+
+  // Must be called with mut_ held
+  JITDylib &create_dylib() {
+    auto dylib_expect = es_.createJITDylib(fmt::format("{}", module_counter_));
+    TI_ASSERT(dylib_expect);
+    auto &dylib = dylib_expect.get();
+    // Symbols left undefined by a module are looked up in the shared modules
+    // first, then in the process.
+    for (auto *shared_lib : shared_libs_) {
+      dylib.addToLinkOrder(*shared_lib);
+    }
+    dylib.addGenerator(
+        cantFail(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+            dl_.getGlobalPrefix())));
+#if defined(TI_WITH_FLAGOS)
+    if (config_.arch == Arch::flagos) {
+      // The SPMD builtins of the FlagOS simulator are not exported by the
+      // taichi library, so they are defined by address.
+      SymbolMap builtins;
+      for (auto &[name, address] : flagos::SimContext::builtin_symbols()) {
+        builtins[mangle_(name)] = JITEvaluatedSymbol(
+            pointerToJITTargetAddress(address), JITSymbolFlags::Exported);
+      }
+      cantFail(dylib.define(absoluteSymbols(std::move(builtins))));
+    }
+#endif
+    return dylib;
+  }
+
+  // Must be called with mut_ held
+  JITModule *add_jit_module(JITDylib &dylib, bool shared) {
+    all_libs_.push_back(&dylib);
+    if (shared) {
+      shared_libs_.push_back(&dylib);
+    }
+    auto new_module = std::make_unique<JITModuleCPU>(this, &dylib);
+    auto new_module_raw_ptr = new_module.get();
+    modules.push_back(std::move(new_module));
+    module_counter_++;
+    return new_module_raw_ptr;
+  }
 };
 
 void *JITModuleCPU::lookup_function(const std::string &name) {
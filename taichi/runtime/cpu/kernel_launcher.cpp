@@ -1,6 +1,8 @@
 #include "taichi/runtime/cpu/kernel_launcher.h"
 #include "taichi/rhi/arch.h"
 
+#include "llvm/Support/MemoryBuffer.h"
+
 namespace taichi::lang {
 namespace cpu {
 
@@ -72,36 +74,53 @@ KernelLauncher::Handle KernelLauncher::register_llvm_kernel(
   TI_ASSERT(arch_is_cpu(compiled.arch()));
 
   if (!compiled.get_handle()) {
-    auto handle = make_handle();
-    auto index = handle.get_launch_id();
-    contexts_.resize(index + 1);
-
-    auto &ctx = contexts_[index];
     auto *executor = get_runtime_executor();
 
     auto data = compiled.get_internal_data().compiled_data.clone();
-    auto parameters = compiled.get_internal_data().args;
     auto *jit_module = executor->create_jit_module(std::move(data.module));
-
-    // Construct task_funcs
-    using TaskFunc = int32 (*)(void *);
-    std::vector<TaskFunc> task_funcs;
-    task_funcs.reserve(data.tasks.size());
-    for (auto &task : data.tasks) {
-      auto *func_ptr = jit_module->lookup_function(task.name);
-      TI_ASSERT_INFO(func_ptr, "Offloaded datum function {} not found",
-                     task.name);
-      task_funcs.push_back((TaskFunc)(func_ptr));
-    }
-
-    // Populate ctx
-    ctx.parameters = std::move(parameters);
-    ctx.task_funcs = std::move(task_funcs);
+    auto handle = register_tasks(jit_module, data.tasks,
+                                 compiled.get_internal_data().args);
 
     compiled.set_handle(handle);
   }
   return *compiled.get_handle();
 }
 
+KernelLauncher::Handle KernelLauncher::register_native_kernel(
+    const std::vector<std::pair<std::vector<int>, Callable::Parameter>>
+        &parameters,
+    const std::vector<OffloadedTask> &tasks,
+    std::unique_ptr<llvm::MemoryBuffer> &&object) {
+  auto *executor = get_runtime_executor();
+  auto *jit_module = executor->create_jit_module(std::move(object));
+  return register_tasks(jit_module, tasks, parameters);
+}
+
+KernelLauncher::Handle KernelLauncher::register_tasks(
+    JITModule *jit_module,
+    const std::vector<OffloadedTask> &tasks,
+    std::vector<std::pair<std::vector<int>, Callable::Parameter>> parameters) {
+  auto handle = make_handle();
+  auto index = handle.get_launch_id();
+  contexts_.resize(index + 1);
+  auto &ctx = contexts_[index];
+
+  // Construct task_funcs
+  using TaskFunc = int32 (*)(void *);
+  std::vector<TaskFunc> task_funcs;
+  task_funcs.reserve(tasks.size());
+  for (auto &task : tasks) {
+    auto *func_ptr = jit_module->lookup_function(task.name);
+    TI_ASSERT_INFO(func_ptr, "Offloaded datum function {} not found",
+                   task.name);
+    task_funcs.push_back((TaskFunc)(func_ptr));
+  }
+
+  // Populate ctx
+  ctx.parameters = std::move(parameters);
+  ctx.task_funcs = std::move(task_funcs);
+  return handle;
+}
+
 }  // namespace cpu
 }  // namespace taichi::lang
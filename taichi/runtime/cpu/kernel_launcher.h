@@ -21,8 +21,19 @@ class KernelLauncher : public LLVM::KernelLauncher {
   void launch_llvm_kernel(Handle handle, LaunchContextBuilder &ctx) override;
   Handle register_llvm_kernel(
       const LLVM::CompiledKernelData &compiled) override;
+  Handle register_native_kernel(
+      const std::vector<std::pair<std::vector<int>, Callable::Parameter>>
+          &parameters,
+      const std::vector<OffloadedTask> &tasks,
+      std::unique_ptr<llvm::MemoryBuffer> &&object) override;
 
  private:
+  Handle register_tasks(
+      JITModule *jit_module,
+      const std::vector<OffloadedTask> &tasks,
+      std::vector<std::pair<std::vector<int>, Callable::Parameter>>
+          parameters);
+
   std::vector<Context> contexts_;
 };
 
@@ -22,6 +22,16 @@ class KernelLauncher : public lang::KernelLauncher {
   virtual Handle register_llvm_kernel(
       const LLVM::CompiledKernelData &compiled) = 0;
 
+  // Registers a kernel whose tasks are compiled into a native object file
+  // already (see LlvmAotModuleBuilder). Only supported on CPUs.
+  virtual Handle register_native_kernel(
+      const std::vector<std::pair<std::vector<int>, Callable::Parameter>>
+          &parameters,
+      const std::vector<OffloadedTask> &tasks,
+      std::unique_ptr<llvm::MemoryBuffer> &&object) {
+    TI_NOT_IMPLEMENTED
+  }
+
  protected:
   Handle make_handle() {
     Handle handle;
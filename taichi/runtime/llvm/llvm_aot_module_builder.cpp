@@ -1,6 +1,9 @@
 #include "taichi/runtime/llvm/llvm_aot_module_builder.h"
 
 #include <algorithm>
+#include <fstream>
+
+#include "llvm/Transforms/Utils/Cloning.h"
 #include "taichi/runtime/program_impls/llvm/llvm_program.h"
 #include "taichi/runtime/llvm/aot_graph_data.h"
 #include "taichi/codegen/llvm/compiled_kernel_data.h"
@@ -9,8 +12,12 @@ namespace taichi::lang {
 
 void LlvmAotModuleBuilder::dump(const std::string &output_dir,
                                 const std::string &filename) const {
+  if (arch_is_cpu(compile_config_.arch)) {
+    dump_native_objects(output_dir);
+  }
   LlvmOfflineCacheFileWriter writer;
   writer.set_data(std::move(cache_));
+  writer.set_no_mangle();  // Done by add_per_backend()
   writer.dump(output_dir);
 
   dump_graph(output_dir);
@@ -22,6 +29,14 @@ void LlvmAotModuleBuilder::add_per_backend(const std::string &identifier,
   LlvmOfflineCache::KernelCacheData kcache;
   kcache.kernel_key = identifier;
   kcache.compiled_data = std::move(compiled);
+  // The task names must be final before dump() compiles the native objects
+  for (auto &task : kcache.compiled_data.tasks) {
+    auto mangled_name = offline_cache::mangle_name(task.name, identifier);
+    auto *func = kcache.compiled_data.module->getFunction(task.name);
+    TI_ASSERT(func != nullptr);
+    func->setName(mangled_name);
+    task.name = mangled_name;
+  }
   kcache.args.reserve(kernel->nested_parameters.size());
   for (const auto &p : kernel->nested_parameters)
     kcache.args.push_back(p);
@@ -67,6 +82,23 @@ void LlvmAotModuleBuilder::add_field_per_backend(const std::string &identifier,
   cache_.fields[snode_tree_id] = std::move(field_cache);
 }
 
+void LlvmAotModuleBuilder::dump_native_objects(
+    const std::string &output_dir) const {
+  auto *jit_session = prog_->get_runtime_executor()->get_jit_session();
+  taichi::create_directories(output_dir);
+  for (const auto &[key, kcache] : cache_.kernels) {
+    // Code generation may modify the module, which is dumped afterwards
+    auto module = llvm::CloneModule(*kcache.compiled_data.module);
+    auto object = jit_session->compile_to_object(*module);
+    const std::string filename = taichi::join_path(
+        output_dir, key + "." + offline_cache::kLlvmCacheFilenameObjExt);
+    std::ofstream os(filename, std::ios::out | std::ios::binary);
+    TI_ERROR_IF(!os.is_open(), "File {} open failed", filename);
+    os.write(object.data(), object.size());
+  }
+  cache_.native_target_id = jit_session->target_id();
+}
+
 LLVMCompiledKernel LlvmAotModuleBuilder::compile_kernel(Kernel *kernel) {
   const auto &ckd =
       compilation_manager_.load_or_compile(compile_config_, {}, *kernel);
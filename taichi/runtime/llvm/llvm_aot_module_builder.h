@@ -33,6 +33,10 @@ class LlvmAotModuleBuilder : public AotModuleBuilder {
  private:
   LLVMCompiledKernel compile_kernel(Kernel *kernel);
 
+  // Compiles each kernel for the host CPU, so that loading the module on a
+  // matching host only has to link the objects.
+  void dump_native_objects(const std::string &output_dir) const;
+
   mutable LlvmOfflineCache cache_;
   KernelCompilationManager &compilation_manager_;
   const CompileConfig &compile_config_;
@@ -1,6 +1,8 @@
 #include "taichi/runtime/llvm/llvm_aot_module_loader.h"
 #include "taichi/runtime/llvm/aot_graph_data.h"
 
+#include "llvm/Support/MemoryBuffer.h"
+
 namespace taichi::lang {
 namespace LLVM {
 
@@ -29,11 +31,56 @@ LlvmOfflineCache::KernelCacheData LlvmAotModule::load_kernel_from_cache(
 
 std::unique_ptr<aot::Kernel> LlvmAotModule::make_new_kernel(
     const std::string &name) {
+  if (use_native_objects_) {
+    if (auto kernel = make_new_native_kernel(name)) {
+      return kernel;
+    }
+    TI_DEBUG("Falling back to the bitcode of kernel={}", name);
+  }
   auto kernel_cache = load_kernel_from_cache(name);
   auto fn = convert_module_to_function(name, kernel_cache.clone());
   return std::make_unique<llvm_aot::KernelImpl>(fn, std::move(kernel_cache));
 }
 
+std::unique_ptr<aot::Kernel> LlvmAotModule::make_new_native_kernel(
+    const std::string &name) {
+  LlvmOfflineCache::KernelCacheData kernel_cache;
+  if (!cache_reader_->get_kernel_metadata(kernel_cache, name)) {
+    return nullptr;
+  }
+  auto object = cache_reader_->load_native_object(name);
+  if (!object) {
+    return nullptr;
+  }
+  auto *launcher = kernel_launcher_.get();
+  auto handle = launcher->register_native_kernel(
+      kernel_cache.args, kernel_cache.compiled_data.tasks, std::move(object));
+  FunctionType fn = [handle, launcher](LaunchContextBuilder &ctx) {
+    launcher->launch_llvm_kernel(handle, ctx);
+  };
+  ++num_native_kernels_;
+  return std::make_unique<llvm_aot::KernelImpl>(fn, std::move(kernel_cache));
+}
+
+bool LlvmAotModule::can_use_native_objects() const {
+  if (!arch_is_cpu(arch()) || cache_reader_ == nullptr) {
+    return false;
+  }
+  const auto &module_target = cache_reader_->get_native_target_id();
+  if (module_target.empty()) {
+    return false;
+  }
+  const auto host_target = executor_->get_jit_session()->target_id();
+  if (module_target != host_target) {
+    TI_INFO(
+        "The AOT module is compiled for {}, not for this host ({}). Its "
+        "kernels will be compiled from bitcode.",
+        module_target, host_target);
+    return false;
+  }
+  return true;
+}
+
 std::unique_ptr<aot::Field> LlvmAotModule::make_new_field(
     const std::string &name) {
   // Check if "name" represents snode_tree_id.
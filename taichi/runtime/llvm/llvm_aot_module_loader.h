@@ -27,6 +27,7 @@ class LlvmAotModule final : public aot::Module {
 
     const std::string graph_path = fmt::format("{}/graphs.tcb", module_path);
     read_from_binary_file(graphs_, graph_path);
+    use_native_objects_ = can_use_native_objects();
   }
 
   Arch arch() const override {
@@ -60,6 +61,12 @@ class LlvmAotModule final : public aot::Module {
   std::unique_ptr<aot::CompiledGraph> get_graph(
       const std::string &name) override;
 
+  // Number of kernels made so far that were linked from their native objects
+  // rather than compiled from bitcode
+  std::size_t get_num_native_kernels() const {
+    return num_native_kernels_;
+  }
+
  protected:
   FunctionType convert_module_to_function(
       const std::string &name,
@@ -71,6 +78,12 @@ class LlvmAotModule final : public aot::Module {
   std::unique_ptr<aot::Kernel> make_new_kernel(
       const std::string &name) override;
 
+  // Links the native object of kernel |name|, skipping LLVM optimization and
+  // code generation. Returns nullptr if there is no usable object.
+  std::unique_ptr<aot::Kernel> make_new_native_kernel(const std::string &name);
+
+  bool can_use_native_objects() const;
+
   std::unique_ptr<aot::KernelTemplate> make_new_kernel_template(
       const std::string &name) override {
     TI_NOT_IMPLEMENTED;
@@ -86,6 +99,8 @@ class LlvmAotModule final : public aot::Module {
   LlvmRuntimeExecutor *const executor_{nullptr};
   std::unique_ptr<LLVM::KernelLauncher> kernel_launcher_{nullptr};
   std::unique_ptr<LlvmOfflineCacheFileReader> cache_reader_{nullptr};
+  bool use_native_objects_{false};
+  std::size_t num_native_kernels_{0};
 
   // To prevent repeated SNodeTree initialization
   std::unordered_set<int> initialized_snode_tree_ids;
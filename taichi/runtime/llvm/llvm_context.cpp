@@ -129,11 +129,9 @@ TaichiLLVMContext::TaichiLLVMContext(const CompileConfig &config, Arch arch)
   }
 
   data_layout_ = TaichiLLVMContext::get_data_layout(arch);
-  linking_context_data = std::make_unique<ThreadLocalData>(
-      std::make_unique<llvm::orc::ThreadSafeContext>(
-          std::make_unique<llvm::LLVMContext>()));
-  linking_context_data->runtime_module = clone_module_to_context(
-      get_this_thread_runtime_module(), linking_context_data->llvm_context);
+  if (shares_runtime_module()) {
+    collect_shared_runtime_symbols(get_this_thread_runtime_module());
+  }
 
   TI_TRACE("Taichi llvm context created.");
 }
@@ -568,6 +566,26 @@ std::unique_ptr<llvm::Module> TaichiLLVMContext::module_from_file(
     }
   }
 
+  if (config_.arch == Arch::flagos && arch_is_cpu(arch_)) {
+    // The FlagOS simulator runs the host runtime module. Instead of the
+    // hardware registers, its SPMD builtins read the coordinates of the
+    // simulated thread, see flagos::SimContext.
+    for (std::string name :
+         {"thread_idx", "block_idx", "block_dim", "grid_dim"}) {
+      auto func = module->getFunction(name);
+      if (!func) {
+        continue;
+      }
+      func->deleteBody();
+      auto builtin = module->getOrInsertFunction("taichi_flagos_sim_" + name,
+                                                 func->getFunctionType());
+      auto bb = llvm::BasicBlock::Create(*ctx, "entry", func);
+      IRBuilder<> builder(bb);
+      builder.CreateRet(builder.CreateCall(builtin));
+      TaichiLLVMContext::mark_inline(func);
+    }
+  }
+
   return module;
 }
 
@@ -679,15 +697,16 @@ void TaichiLLVMContext::add_struct_module(std::unique_ptr<Module> module,
     TI_ERROR("module broken");
   }
 
-  linking_context_data->struct_modules[tree_id] =
-      clone_module_to_context(module.get(), linking_context_data->llvm_context);
-
-  for (auto &[id, data] : per_thread_data_) {
-    if (id == std::this_thread::get_id()) {
-      continue;
-    }
-    data->struct_modules[tree_id] =
-        clone_module_to_context(module.get(), data->llvm_context);
+  {
+    // Other threads pick the module up in fetch_this_thread_struct_module().
+    std::lock_guard<std::mutex> _(struct_modules_mut_);
+    auto &entry = struct_module_bitcodes_[tree_id];
+    entry.bitcode.clear();
+    llvm::raw_string_ostream sos(entry.bitcode);
+    llvm::WriteBitcodeToFile(*module, sos);
+    sos.flush();
+    entry.version = ++struct_module_version_;
+    this_thread_data->struct_module_versions[tree_id] = entry.version;
   }
 
   this_thread_data->struct_modules[tree_id] = std::move(module);
@@ -959,25 +978,178 @@ void TaichiLLVMContext::init_runtime_module(llvm::Module *runtime_module) {
 #endif
   }
 
-  eliminate_unused_functions(runtime_module, [](std::string func_name) {
+  if (shares_runtime_module()) {
+    // Kernel modules may refer to any shared symbol, whether the runtime uses
+    // it itself or not.
+    for (auto &gv : runtime_module->global_values()) {
+      if (shared_runtime_symbols_.count(gv.getName().str()) &&
+          gv.hasLinkOnceLinkage()) {
+        gv.setLinkage(gv.hasLinkOnceODRLinkage()
+                          ? llvm::GlobalValue::WeakODRLinkage
+                          : llvm::GlobalValue::WeakAnyLinkage);
+      }
+    }
+  }
+
+  eliminate_unused_functions(runtime_module, [&](std::string func_name) {
     return starts_with(func_name, "runtime_") ||
-           starts_with(func_name, "LLVMRuntime_");
+           starts_with(func_name, "LLVMRuntime_") ||
+           shared_runtime_symbols_.count(func_name);
   });
+
+  if (shares_runtime_module()) {
+    optimize_shared_runtime_module(runtime_module);
+  }
+}
+
+void TaichiLLVMContext::collect_shared_runtime_symbols(
+    llvm::Module *runtime_module) {
+  // Small runtime functions (most of them are accessors) are still linked
+  // into every kernel that uses them so that they can be inlined. Only the
+  // larger ones, e.g. the parallel-for drivers and listgen, are shared.
+  // Symbols with local linkage cannot be referred to from another module and
+  // are never shared.
+  constexpr int kMaxImportedFunctionSize = 100;
+  for (auto &f : *runtime_module) {
+    if (!f.isDeclaration() && !f.hasLocalLinkage() &&
+        num_instructions(&f) > kMaxImportedFunctionSize) {
+      shared_runtime_symbols_.insert(f.getName().str());
+    }
+  }
+  // Mutable globals must have a single instance.
+  for (auto &var : runtime_module->globals()) {
+    if (!var.isDeclaration() && !var.hasLocalLinkage() && !var.isConstant()) {
+      shared_runtime_symbols_.insert(var.getName().str());
+    }
+  }
+}
+
+void TaichiLLVMContext::optimize_shared_runtime_module(
+    llvm::Module *runtime_module) {
+  TI_AUTO_PROF
+  // The runtime bitcode is not optimized: kernels used to optimize runtime
+  // functions after inlining them. Shared functions are no longer inlined, so
+  // the shared module has to be optimized on its own.
+  auto expected_jtmb = llvm::orc::JITTargetMachineBuilder::detectHost();
+  if (!expected_jtmb)
+    TI_ERROR("LLVM TargetMachineBuilder has failed.");
+  auto expected_target_machine = expected_jtmb->createTargetMachine();
+  if (!expected_target_machine)
+    TI_ERROR("LLVM TargetMachineBuilder has failed to create the machine.");
+  auto target_machine = std::move(*expected_target_machine);
+
+  llvm::LoopAnalysisManager lam;
+  llvm::FunctionAnalysisManager fam;
+  llvm::CGSCCAnalysisManager cgam;
+  llvm::ModuleAnalysisManager mam;
+  llvm::PassBuilder pb(target_machine.get());
+  pb.registerModuleAnalyses(mam);
+  pb.registerCGSCCAnalyses(cgam);
+  pb.registerFunctionAnalyses(fam);
+  pb.registerLoopAnalyses(lam);
+  pb.crossRegisterProxies(lam, fam, cgam, mam);
+  auto manager = pb.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O3);
+  manager.run(*runtime_module, mam);
+}
+
+std::unique_ptr<llvm::Module> TaichiLLVMContext::import_runtime_functions(
+    const llvm::Module &kernel_module) {
+  TI_AUTO_PROF
+  // Collects the runtime definitions |kernel_module| transitively depends on,
+  // stopping at shared symbols.
+  auto *runtime_module = get_this_thread_runtime_module();
+  std::unordered_set<const llvm::GlobalValue *> imported;
+  std::vector<const llvm::GlobalValue *> worklist;
+  auto import = [&](const llvm::GlobalValue *gv) {
+    if (gv && !gv->isDeclaration() &&
+        !shared_runtime_symbols_.count(gv->getName().str()) &&
+        imported.insert(gv).second) {
+      worklist.push_back(gv);
+    }
+  };
+  std::function<void(const llvm::Value *)> import_referenced =
+      [&](const llvm::Value *value) {
+        if (auto *gv = llvm::dyn_cast<llvm::GlobalValue>(value)) {
+          import(gv);
+        } else if (auto *c = llvm::dyn_cast<llvm::Constant>(value)) {
+          for (auto &op : c->operands()) {
+            import_referenced(op);
+          }
+        }
+      };
+
+  for (auto &gv : kernel_module.global_values()) {
+    if (gv.isDeclaration()) {
+      import(runtime_module->getNamedValue(gv.getName()));
+    }
+  }
+  while (!worklist.empty()) {
+    auto *gv = worklist.back();
+    worklist.pop_back();
+    if (auto *f = llvm::dyn_cast<llvm::Function>(gv)) {
+      for (auto &bb : *f) {
+        for (auto &inst : bb) {
+          for (auto &op : inst.operands()) {
+            import_referenced(op);
+          }
+        }
+      }
+    } else if (auto *var = llvm::dyn_cast<llvm::GlobalVariable>(gv)) {
+      if (var->hasInitializer()) {
+        import_referenced(var->getInitializer());
+      }
+    }
+  }
+
+  // Everything else, including the shared symbols, is cloned as a
+  // declaration.
+  llvm::ValueToValueMapTy vmap;
+  return llvm::CloneModule(*runtime_module, vmap,
+                           [&](const llvm::GlobalValue *gv) {
+                             return imported.count(gv) != 0;
+                           });
 }
 
 void TaichiLLVMContext::delete_snode_tree(int id) {
-  TI_ASSERT(linking_context_data->struct_modules.erase(id));
-  for (auto &[thread_id, data] : per_thread_data_) {
-    TI_ASSERT(data->struct_modules.erase(id));
+  TI_ASSERT(std::this_thread::get_id() == main_thread_id_);
+  {
+    std::lock_guard<std::mutex> _(struct_modules_mut_);
+    TI_ASSERT(struct_module_bitcodes_.erase(id));
   }
+  TI_ASSERT(main_thread_data_->struct_modules.erase(id));
+  main_thread_data_->struct_module_versions.erase(id);
 }
 
 void TaichiLLVMContext::fetch_this_thread_struct_module() {
   ThreadLocalData *data = get_this_thread_data();
-  if (data->struct_modules.empty()) {
-    for (auto &[id, mod] : main_thread_data_->struct_modules) {
-      data->struct_modules[id] = clone_module_to_this_thread_context(mod.get());
+  if (data == main_thread_data_) {
+    return;
+  }
+  std::lock_guard<std::mutex> _(struct_modules_mut_);
+  for (auto it = data->struct_modules.begin();
+       it != data->struct_modules.end();) {
+    if (struct_module_bitcodes_.find(it->first) ==
+        struct_module_bitcodes_.end()) {
+      data->struct_module_versions.erase(it->first);
+      it = data->struct_modules.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  for (auto &[id, entry] : struct_module_bitcodes_) {
+    auto &version = data->struct_module_versions[id];
+    if (version == entry.version) {
+      continue;
+    }
+    auto cloned = parseBitcodeFile(
+        llvm::MemoryBufferRef(entry.bitcode, "struct_bitcode"),
+        *data->llvm_context);
+    if (!cloned) {
+      auto error = cloned.takeError();
+      TI_ERROR("Bitcode cloned failed.");
     }
+    data->struct_modules[id] = std::move(cloned.get());
+    version = entry.version;
   }
 }
 
@@ -1036,7 +1208,11 @@ LLVMCompiledKernel TaichiLLVMContext::link_compiled_tasks(
   std::unordered_set<int> used_tree_ids;
   std::unordered_set<int> tls_sizes;
   std::unordered_set<std::string> offloaded_names;
-  auto mod = new_module("kernel", linking_context_data->llvm_context);
+  // Kernels are linked in the context of the calling thread, so that kernels
+  // compiled on different threads do not contend for a single context.
+  fetch_this_thread_struct_module();
+  auto *data = get_this_thread_data();
+  auto mod = new_module("kernel", data->llvm_context);
   llvm::Linker linker(*mod);
   for (auto &datum : data_list) {
     for (auto tree_id : datum->used_tree_ids) {
@@ -1049,22 +1225,34 @@ LLVMCompiledKernel TaichiLLVMContext::link_compiled_tasks(
       offloaded_names.insert(task.name);
       linked.tasks.push_back(std::move(task));
     }
-    linker.linkInModule(clone_module_to_context(
-        datum->module.get(), linking_context_data->llvm_context));
+    if (&datum->module->getContext() == data->llvm_context) {
+      linker.linkInModule(std::move(datum->module));
+    } else {
+      linker.linkInModule(
+          clone_module_to_context(datum->module.get(), data->llvm_context));
+    }
   }
   for (auto tree_id : used_tree_ids) {
     linker.linkInModule(
-        llvm::CloneModule(*linking_context_data->struct_modules[tree_id]),
+        llvm::CloneModule(*data->struct_modules[tree_id]),
         llvm::Linker::LinkOnlyNeeded | llvm::Linker::OverrideFromSrc);
   }
-  auto runtime_module =
-      llvm::CloneModule(*linking_context_data->runtime_module);
-  for (auto tls_size : tls_sizes) {
-    add_struct_for_func(runtime_module.get(), tls_size);
+  if (shares_runtime_module()) {
+    // Struct-fors on CPUs take the TLS size as an argument, so there is no
+    // per-kernel runtime function to generate.
+    TI_ASSERT(tls_sizes.empty());
+    linker.linkInModule(
+        import_runtime_functions(*mod),
+        llvm::Linker::LinkOnlyNeeded | llvm::Linker::OverrideFromSrc);
+  } else {
+    auto runtime_module = llvm::CloneModule(*get_this_thread_runtime_module());
+    for (auto tls_size : tls_sizes) {
+      add_struct_for_func(runtime_module.get(), tls_size);
+    }
+    linker.linkInModule(
+        std::move(runtime_module),
+        llvm::Linker::LinkOnlyNeeded | llvm::Linker::OverrideFromSrc);
   }
-  linker.linkInModule(
-      std::move(runtime_module),
-      llvm::Linker::LinkOnlyNeeded | llvm::Linker::OverrideFromSrc);
   eliminate_unused_functions(mod.get(), [&](std::string func_name) -> bool {
     return offloaded_names.count(func_name);
   });
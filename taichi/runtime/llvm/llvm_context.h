@@ -8,6 +8,7 @@
 #include <mutex>
 #include <functional>
 #include <thread>
+#include <unordered_set>
 
 #include "taichi/util/lang_util.h"
 #include "taichi/runtime/llvm/llvm_fwd.h"
@@ -31,6 +32,9 @@ class TaichiLLVMContext {
     llvm::LLVMContext *llvm_context{nullptr};
     std::unique_ptr<llvm::Module> runtime_module{nullptr};
     std::unordered_map<int, std::unique_ptr<llvm::Module>> struct_modules;
+    // Version (see struct_module_bitcodes_) of each struct module, used to
+    // refresh the copies of threads other than the main one.
+    std::unordered_map<int, uint64> struct_module_versions;
     explicit ThreadLocalData(std::unique_ptr<llvm::orc::ThreadSafeContext> ctx);
     ~ThreadLocalData();
   };
@@ -39,8 +43,6 @@ class TaichiLLVMContext {
  public:
   // main_thread is defined to be the thread that runs the initializer
 
-  std::unique_ptr<ThreadLocalData> linking_context_data{nullptr};
-
   TaichiLLVMContext(const CompileConfig &config, Arch arch);
 
   virtual ~TaichiLLVMContext();
@@ -65,6 +67,15 @@ class TaichiLLVMContext {
    */
   std::unique_ptr<llvm::Module> clone_runtime_module();
 
+  /**
+   * Whether kernel modules resolve the larger runtime functions against a
+   * single JIT compiled copy of the runtime module (see init_runtime_module)
+   * instead of linking in their own copies. True on CPUs.
+   */
+  bool shares_runtime_module() const {
+    return arch_is_cpu(arch_);
+  }
+
   std::unique_ptr<llvm::Module> module_from_file(const std::string &file);
 
   llvm::Type *get_data_type(DataType dt);
@@ -143,6 +154,13 @@ class TaichiLLVMContext {
 
   static int num_instructions(llvm::Function *func);
 
+  void collect_shared_runtime_symbols(llvm::Module *runtime_module);
+
+  void optimize_shared_runtime_module(llvm::Module *runtime_module);
+
+  std::unique_ptr<llvm::Module> import_runtime_functions(
+      const llvm::Module &kernel_module);
+
   void insert_nvvm_annotation(llvm::Function *func, std::string key, int val);
 
   std::unique_ptr<llvm::Module> clone_module_to_this_thread_context(
@@ -161,6 +179,20 @@ class TaichiLLVMContext {
   std::mutex thread_map_mut_;
 
   std::unordered_map<int, std::vector<std::string>> snode_tree_funcs_;
+
+  // Runtime symbols that kernel modules only declare when the runtime module
+  // is shared.
+  std::unordered_set<std::string> shared_runtime_symbols_;
+
+  struct StructModuleBitcode {
+    std::string bitcode;
+    uint64 version{0};
+  };
+  // Serialized struct modules, from which threads other than the main one
+  // create their own copies without touching the main thread's context.
+  std::unordered_map<int, StructModuleBitcode> struct_module_bitcodes_;
+  uint64 struct_module_version_{0};
+  std::mutex struct_modules_mut_;
 };
 
 class LlvmModuleBitcodeLoader {
@@ -10,6 +10,7 @@ class DataLayout;
 class StructType;
 class JITSymbol;
 class ExitOnError;
+class MemoryBuffer;
 namespace orc {
 class ThreadSafeContext;
 }
@@ -40,6 +40,7 @@ static std::vector<std::string> get_possible_llvm_cache_filename_by_key(
   return {
       key + "." + offline_cache::kLlvmCacheFilenameLLExt,
       key + "." + offline_cache::kLlvmCacheFilenameBCExt,
+      key + "." + offline_cache::kLlvmCacheFilenameObjExt,
   };
 }
 
@@ -90,12 +91,24 @@ struct CacheCleanerUtils<LlvmOfflineCache> {
   static bool is_valid_cache_file(const CacheCleanerConfig &config,
                                   const std::string &name) {
     std::string ext = filename_extension(name);
-    return ext == kLlvmCacheFilenameLLExt || ext == kLlvmCacheFilenameBCExt;
+    return ext == kLlvmCacheFilenameLLExt || ext == kLlvmCacheFilenameBCExt ||
+           ext == kLlvmCacheFilenameObjExt;
   }
 };
 
 }  // namespace offline_cache
 
+// static
+LlvmOfflineCache LlvmOfflineCache::from_legacy(LegacyMetadata &&legacy) {
+  LlvmOfflineCache result;
+  std::copy(std::begin(legacy.version), std::end(legacy.version),
+            std::begin(result.version));
+  result.size = legacy.size;
+  result.fields = std::move(legacy.fields);
+  result.kernels = std::move(legacy.kernels);
+  return result;
+}
+
 // static
 std::unique_ptr<LlvmOfflineCacheFileReader> LlvmOfflineCacheFileReader::make(
     const std::string &path,
@@ -210,6 +223,38 @@ bool LlvmOfflineCacheFileReader::get_kernel_cache(
   return verified;
 }
 
+bool LlvmOfflineCacheFileReader::get_kernel_metadata(
+    LlvmOfflineCache::KernelCacheData &res,
+    const std::string &key) {
+  auto itr = data_.kernels.find(key);
+  if (itr == data_.kernels.end()) {
+    TI_DEBUG("Cannot find kernel={}", key);
+    return false;
+  }
+  auto &kernel_data = itr->second;
+  kernel_data.last_used_at = std::time(nullptr);
+  res = kernel_data.clone();
+  res.compiled_data.module = nullptr;
+  return true;
+}
+
+std::unique_ptr<llvm::MemoryBuffer>
+LlvmOfflineCacheFileReader::load_native_object(const std::string &key) const {
+  TI_AUTO_PROF;
+  if (data_.native_target_id.empty()) {
+    return nullptr;
+  }
+  const std::string filename = taichi::join_path(
+      path_, key + "." + offline_cache::kLlvmCacheFilenameObjExt);
+  auto buffer = llvm::MemoryBuffer::getFile(filename, /*IsText=*/false,
+                                            /*RequiresNullTerminator=*/false);
+  if (!buffer) {
+    TI_DEBUG("Fail to read {}: {}", filename, buffer.getError().message());
+    return nullptr;
+  }
+  return std::move(*buffer);
+}
+
 std::unique_ptr<llvm::Module> LlvmOfflineCacheFileReader::load_module(
     const std::string &path_prefix,
     const std::string &key,
@@ -4,6 +4,7 @@
 
 #ifdef TI_WITH_LLVM
 #include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "taichi/common/core.h"
 #include "taichi/common/serialization.h"
 #include "taichi/program/kernel.h"
@@ -80,31 +81,18 @@ struct LlvmOfflineCache {
 
     TI_IO_DEF(tree_id, root_id, root_size, snode_metas);
 
-    // TODO(zhanlue): refactor llvm::Modules
-    //
-    // struct_module will eventually get cloned into each kernel_module,
-    // so there's no need to serialize it here.
+    // struct_module is linked into each kernel_module when the kernel is
+    // compiled, so there's no need to serialize it here.
     //
     // We have three different types of llvm::Module
     // 1. runtime_module: contains runtime functions.
     // 2. struct_module: contains compiled SNodeTree in llvm::Type.
     // 3. kernel_modules: contains compiled kernel codes.
     //
-    // The way those modules work rely on a recursive clone mechanism:
-    //   runtime_module = load("runtime.bc")
-    //   struct_module = clone(runtime_module) + compiled-SNodeTree
-    //   kernel_module = clone(struct_module) + compiled-Kernel
-    //
-    // As a result, every kernel_module contains a copy of struct_module +
-    // runtime_module.
-    //
-    // This recursive clone mechanism is super fragile,
-    // which potentially causes inconsistency between modules if not handled
-    // properly.
-    //
-    // Let's turn to use llvm::link to bind the modules,
-    // and make runtime_module, struct_module, kernel_module independent of each
-    // other
+    // A kernel_module only links in the runtime functions it (transitively)
+    // uses. On CPUs, the larger ones are not linked in either: they are
+    // resolved against a single JIT compiled copy of runtime_module when the
+    // kernel_module is loaded (see TaichiLLVMContext::shares_runtime_module).
   };
 
   using KernelMetadata = KernelCacheData;  // Required by CacheCleaner
@@ -121,8 +109,26 @@ struct LlvmOfflineCache {
   std::unordered_map<std::string, KernelCacheData>
       kernels;  // key = kernel_name
 
+  // CPU AOT modules also store each kernel as a native object file, compiled
+  // for the JIT target identified here (see JITSession::target_id). Empty if
+  // there are no object files.
+  std::string native_target_id;
+
   // NOTE: The "version" must be the first field to be serialized
-  TI_IO_DEF(version, size, fields, kernels);
+  TI_IO_DEF(version, size, fields, kernels, native_target_id);
+
+  // The layout written before native_target_id was added, within the same
+  // Taichi version. Such modules have no native objects.
+  struct LegacyMetadata {
+    Version version{};
+    std::size_t size{0};
+    std::unordered_map<int, FieldCacheData> fields;
+    std::unordered_map<std::string, KernelCacheData> kernels;
+
+    TI_IO_DEF(version, size, fields, kernels);
+  };
+
+  static LlvmOfflineCache from_legacy(LegacyMetadata &&legacy);
 };
 
 class LlvmOfflineCacheFileReader {
@@ -131,6 +137,18 @@ class LlvmOfflineCacheFileReader {
                         const std::string &key,
                         llvm::LLVMContext &llvm_ctx);
 
+  // Same as get_kernel_cache(), but leaves res.compiled_data.module empty
+  bool get_kernel_metadata(LlvmOfflineCache::KernelCacheData &res,
+                           const std::string &key);
+
+  // Returns nullptr if the kernel has no native object file
+  std::unique_ptr<llvm::MemoryBuffer> load_native_object(
+      const std::string &key) const;
+
+  const std::string &get_native_target_id() const {
+    return data_.native_target_id;
+  }
+
   bool get_field_cache(LlvmOfflineCache::FieldCacheData &res,
                        int snode_tree_id);
 
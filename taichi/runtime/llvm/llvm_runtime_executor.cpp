@@ -1,5 +1,7 @@
 #include "taichi/runtime/llvm/llvm_runtime_executor.h"
 
+#include "llvm/Support/MemoryBuffer.h"
+
 #include "taichi/rhi/common/host_memory_pool.h"
 #include "taichi/runtime/llvm/llvm_offline_cache.h"
 #include "taichi/rhi/cpu/cpu_device.h"
@@ -7,6 +9,7 @@
 #include "taichi/platform/cuda/detect_cuda.h"
 #include "taichi/rhi/cuda/cuda_driver.h"
 #include "taichi/rhi/llvm/device_memory_pool.h"
+#include "taichi/system/numa.h"
 
 #if defined(TI_WITH_CUDA)
 #include "taichi/rhi/cuda/cuda_context.h"
@@ -19,6 +22,10 @@
 #include "taichi/rhi/amdgpu/amdgpu_context.h"
 #endif
 
+#if defined(TI_WITH_FLAGOS)
+#include "taichi/rhi/flagos/flagos_device.h"
+#endif
+
 namespace taichi::lang {
 namespace {
 void assert_failed_host(const char *msg) {
@@ -79,6 +86,9 @@ LlvmRuntimeExecutor::LlvmRuntimeExecutor(CompileConfig &config,
 
   snode_tree_buffer_manager_ = std::make_unique<SNodeTreeBufferManager>(this);
   thread_pool_ = std::make_unique<ThreadPool>(config.cpu_max_num_threads);
+  if (arch_is_cpu(config.arch) && profiler_) {
+    profiler_->set_cpu_thread_pool(thread_pool_.get());
+  }
 
   llvm_runtime_ = nullptr;
 
@@ -162,13 +172,30 @@ LlvmRuntimeExecutor::LlvmRuntimeExecutor(CompileConfig &config,
     config.max_block_dim = 1024;
     device_ = std::make_shared<cpu::CpuDevice>();
   }
+#endif
+#if defined(TI_WITH_FLAGOS)
+  else if (config.arch == Arch::flagos) {
+    auto device = std::make_shared<flagos::FlagosDevice>();
+    device->initialize(config.flagos_chip, config.cpu_max_num_threads);
+    int num_compute_units = device->get_num_compute_units();
+    if (num_compute_units == 0) {
+      num_compute_units = config.flagos_num_compute_units;
+    }
+    if (config.max_block_dim == 0) {
+      config.max_block_dim = 1024;
+    }
+    if (config.saturating_grid_dim == 0) {
+      config.saturating_grid_dim = num_compute_units * 4;
+    }
+    device_ = std::move(device);
+  }
 #endif
   else {
     TI_NOT_IMPLEMENTED
   }
-  llvm_context_ = std::make_unique<TaichiLLVMContext>(
-      config_, arch_is_cpu(config.arch) ? host_arch() : config.arch);
-  jit_session_ = JITSession::create(llvm_context_.get(), config, config.arch);
+  const Arch runtime_arch = uses_host_runtime() ? host_arch() : config.arch;
+  llvm_context_ = std::make_unique<TaichiLLVMContext>(config_, runtime_arch);
+  jit_session_ = JITSession::create(llvm_context_.get(), config, runtime_arch);
   init_runtime_jit_module(llvm_context_->clone_runtime_module());
 }
 
@@ -181,13 +208,18 @@ JITModule *LlvmRuntimeExecutor::create_jit_module(
   return jit_session_->add_module(std::move(module));
 }
 
+JITModule *LlvmRuntimeExecutor::create_jit_module(
+    std::unique_ptr<llvm::MemoryBuffer> object) {
+  return jit_session_->add_object(std::move(object));
+}
+
 JITModule *LlvmRuntimeExecutor::get_runtime_jit_module() {
   return runtime_jit_module_;
 }
 
 void LlvmRuntimeExecutor::print_list_manager_info(void *list_manager,
                                                   uint64 *result_buffer) {
-  auto list_manager_len = runtime_query<int32>("ListManager_get_num_elements",
+  auto list_manager_len = runtime_query<int64>("ListManager_get_num_elements",
                                                result_buffer, list_manager);
 
   auto element_size = runtime_query<int32>("ListManager_get_element_size",
@@ -202,10 +234,14 @@ void LlvmRuntimeExecutor::print_list_manager_info(void *list_manager,
 
   auto size_MB = 1e-6f * num_active_chunks * elements_per_chunk * element_size;
 
+  auto overhead = runtime_query<int64>("ListManager_get_overhead_bytes",
+                                       result_buffer, list_manager);
+
   fmt::print(
-      " length={:n}     {:n} chunks x [{:n} x {:n} B]  total={:.4f} MB\n",
+      " length={:n}     {:n} chunks x [{:n} x {:n} B]  total={:.4f} MB  "
+      "overhead={:n} B\n",
       list_manager_len, num_active_chunks, elements_per_chunk, element_size,
-      size_MB);
+      size_MB, overhead);
 }
 
 void LlvmRuntimeExecutor::synchronize() {
@@ -265,7 +301,7 @@ std::size_t LlvmRuntimeExecutor::get_snode_num_dynamically_allocated(
   auto data_list = runtime_query<void *>("NodeManager_get_data_list",
                                          result_buffer, node_allocator);
 
-  return (std::size_t)runtime_query<int32>("ListManager_get_num_elements",
+  return (std::size_t)runtime_query<int64>("ListManager_get_num_elements",
                                            result_buffer, data_list);
 }
 
@@ -339,19 +375,28 @@ void LlvmRuntimeExecutor::print_memory_profiler_info(
             runtime_query<void *>("LLVMRuntime_get_node_allocators",
                                   result_buffer, llvm_runtime_, snode->id);
 
+        // The runtime objects kept for this SNode, excluding the chunks
+        auto overhead = runtime_query<int64>("ListManager_get_overhead_bytes",
+                                             result_buffer, element_list);
+        if (node_allocator) {
+          overhead += runtime_query<int64>("NodeManager_get_overhead_bytes",
+                                           result_buffer, node_allocator);
+        }
+        fmt::print("  runtime overhead:    {:n} B\n", overhead);
+
         if (node_allocator) {
           auto free_list = runtime_query<void *>("NodeManager_get_free_list",
                                                  result_buffer, node_allocator);
           auto recycled_list = runtime_query<void *>(
               "NodeManager_get_recycled_list", result_buffer, node_allocator);
 
-          auto free_list_len = runtime_query<int32>(
+          auto free_list_len = runtime_query<int64>(
               "ListManager_get_num_elements", result_buffer, free_list);
 
-          auto recycled_list_len = runtime_query<int32>(
+          auto recycled_list_len = runtime_query<int64>(
               "ListManager_get_num_elements", result_buffer, recycled_list);
 
-          auto free_list_used = runtime_query<int32>(
+          auto free_list_used = runtime_query<int64>(
               "NodeManager_get_free_list_used", result_buffer, node_allocator);
 
           auto data_list = runtime_query<void *>("NodeManager_get_data_list",
@@ -381,6 +426,15 @@ void LlvmRuntimeExecutor::print_memory_profiler_info(
   fmt::print(
       "Total requested dynamic memory (excluding alignment padding): {:n} B\n",
       total_requested_memory);
+
+  auto object_bytes = runtime_query<int64>("LLVMRuntime_get_object_bytes",
+                                           result_buffer, llvm_runtime_);
+  auto object_slab_bytes = runtime_query<int64>(
+      "LLVMRuntime_get_object_slab_bytes", result_buffer, llvm_runtime_);
+  fmt::print(
+      "Runtime objects (list/node managers, chunk tables): {:n} B live in {:n} "
+      "B of slabs\n",
+      object_bytes, object_slab_bytes);
 }
 
 DevicePtr LlvmRuntimeExecutor::get_snode_tree_device_ptr(int tree_id) {
@@ -430,6 +484,12 @@ void LlvmRuntimeExecutor::initialize_llvm_runtime_snodes(
 #else
     TI_NOT_IMPLEMENTED;
 #endif
+  } else if (arch_is_cpu(config_.arch)) {
+    // The host memory pool hands out zero-filled memory: only place its
+    // pages, in parallel, instead of clearing them all on this thread
+    place_host_memory(thread_pool_.get(), root_buffer, rounded_size,
+                      numa_policy_from_name(config_.cpu_numa_policy),
+                      config_.cpu_huge_pages);
   } else {
     std::memset(root_buffer, 0, rounded_size);
   }
@@ -448,12 +508,13 @@ void LlvmRuntimeExecutor::initialize_llvm_runtime_snodes(
       const auto snode_id = snode_metas[i].id;
       std::size_t node_size;
       auto element_size = snode_metas[i].cell_size_bytes;
-      if (snode_metas[i].type == SNodeType::pointer) {
-        // pointer. Allocators are for single elements
+      if (snode_metas[i].type == SNodeType::pointer ||
+          snode_metas[i].type == SNodeType::hash) {
+        // pointer or hash. Allocators are for single elements
         node_size = element_size;
       } else {
         // dynamic. Allocators are for the chunks
-        node_size = sizeof(void *) + element_size * snode_metas[i].chunk_size;
+        node_size = element_size * snode_metas[i].chunk_size;
       }
       TI_TRACE("Initializing allocator for snode {} (node size {})", snode_id,
                node_size);
@@ -497,6 +558,20 @@ void LlvmRuntimeExecutor::deallocate_memory_on_device(DeviceAllocation handle) {
   allocated_runtime_memory_allocs_.erase(handle.alloc_id);
 }
 
+void LlvmRuntimeExecutor::fill_new_allocation_with_zeros(
+    const DeviceAllocation &alloc,
+    std::size_t size) {
+  if (arch_is_cpu(config_.arch)) {
+    // Already zero-filled by the host memory pool
+    place_host_memory(thread_pool_.get(),
+                      (void *)get_device_alloc_info_ptr(alloc), size,
+                      numa_policy_from_name(config_.cpu_numa_policy),
+                      config_.cpu_huge_pages);
+  } else {
+    fill_ndarray(alloc, size / sizeof(uint32_t), /*data=*/0);
+  }
+}
+
 void LlvmRuntimeExecutor::fill_ndarray(const DeviceAllocation &alloc,
                                        std::size_t size,
                                        uint32_t data) {
@@ -537,6 +612,15 @@ uint64_t *LlvmRuntimeExecutor::get_device_alloc_info_ptr(
         .ptr;
 #else
     TI_NOT_IMPLEMENTED;
+#endif
+  } else if (config_.arch == Arch::flagos) {
+#if defined(TI_WITH_FLAGOS)
+    return (uint64_t *)llvm_device()
+        ->as<flagos::FlagosDevice>()
+        ->get_alloc_info(alloc)
+        .ptr;
+#else
+    TI_NOT_IMPLEMENTED;
 #endif
   }
 
@@ -649,6 +733,9 @@ void LlvmRuntimeExecutor::materialize_runtime(KernelProfilerBase *profiler,
 #else
     TI_NOT_IMPLEMENTED
 #endif
+  } else if (config_.arch == Arch::flagos) {
+    // The random state is picked by the SPMD thread index
+    num_rand_states = config_.saturating_grid_dim * config_.max_block_dim;
   } else {
     num_rand_states = config_.cpu_max_num_threads;
   }
@@ -733,7 +820,7 @@ void LlvmRuntimeExecutor::materialize_runtime(KernelProfilerBase *profiler,
                                    llvm_runtime_, starting_rand_state);
   }
 
-  if (arch_use_host_memory(config_.arch)) {
+  if (uses_host_runtime()) {
     runtime_jit->call<void *, void *, void *>(
         "LLVMRuntime_initialize_thread_pool", llvm_runtime_, thread_pool_.get(),
         (void *)ThreadPool::static_run);
@@ -756,6 +843,17 @@ void LlvmRuntimeExecutor::materialize_runtime(KernelProfilerBase *profiler,
 }
 
 void LlvmRuntimeExecutor::destroy_snode_tree(SNodeTree *snode_tree) {
+  // Hand the list and node managers of the tree back to the runtime, for the
+  // trees created later
+  auto *const runtime_jit = get_runtime_jit_module();
+  std::function<void(SNode *)> destroy_runtime_objects = [&](SNode *snode) {
+    runtime_jit->call<void *, int>("runtime_destroy_snode", llvm_runtime_,
+                                   snode->id);
+    for (const auto &ch : snode->ch) {
+      destroy_runtime_objects(ch.get());
+    }
+  };
+  destroy_runtime_objects(snode_tree->root());
   get_llvm_context()->delete_snode_tree(snode_tree->id());
   snode_tree_buffer_manager_->destroy(snode_tree);
 }
@@ -771,7 +869,13 @@ LLVMRuntime *LlvmRuntimeExecutor::get_llvm_runtime() {
 void LlvmRuntimeExecutor::init_runtime_jit_module(
     std::unique_ptr<llvm::Module> module) {
   llvm_context_->init_runtime_module(module.get());
-  runtime_jit_module_ = create_jit_module(std::move(module));
+  if (llvm_context_->shares_runtime_module()) {
+    // Kernel modules resolve the runtime functions they do not link in
+    // against this module.
+    runtime_jit_module_ = jit_session_->add_shared_module(std::move(module));
+  } else {
+    runtime_jit_module_ = create_jit_module(std::move(module));
+  }
 }
 
 }  // namespace taichi::lang
@@ -53,6 +53,12 @@ class LlvmRuntimeExecutor {
 
   void deallocate_memory_on_device(DeviceAllocation handle);
 
+  // Zero-fills the |size| bytes of a buffer that was just returned by
+  // allocate_memory_on_device(). On CPU, the memory is already zero and its
+  // pages are only placed on the NUMA nodes.
+  void fill_new_allocation_with_zeros(const DeviceAllocation &alloc,
+                                      std::size_t size);
+
   void check_runtime_error(uint64 *result_buffer);
 
   uint64_t *get_device_alloc_info_ptr(const DeviceAllocation &alloc);
@@ -65,8 +71,21 @@ class LlvmRuntimeExecutor {
 
   JITModule *create_jit_module(std::unique_ptr<llvm::Module> module);
 
+  // Links a native object compiled by get_jit_session()->compile_to_object()
+  JITModule *create_jit_module(std::unique_ptr<llvm::MemoryBuffer> object);
+
+  JITSession *get_jit_session() {
+    return jit_session_.get();
+  }
+
   JITModule *get_runtime_jit_module();
 
+  // The pool CPU kernels run on. Host-side solvers share it, so that they do
+  // not oversubscribe the cores.
+  ThreadPool *get_thread_pool() {
+    return thread_pool_.get();
+  }
+
   LLVMRuntime *get_llvm_runtime();
 
   Device *get_compute_device();
@@ -79,6 +98,13 @@ class LlvmRuntimeExecutor {
     return use_device_memory_pool_;
   }
 
+  // Whether kernels run on the host with the host runtime module: on CPUs
+  // and on the FlagOS simulator.
+  bool uses_host_runtime() const {
+    return arch_is_cpu(config_.arch) ||
+           (config_.arch == Arch::flagos && config_.flagos_chip == "sim");
+  }
+
  private:
   /* ----------------------- */
   /* ------ Allocation ----- */
@@ -74,6 +74,53 @@ i32 test_list_manager(RuntimeContext *context) {
   for (int i = 0; i < 320; i++) {
     TI_TEST_CHECK(list->get<i32>(i) == i + 5, runtime);
   }
+
+  // Indices past 2^31 only touch the chunk they live in.
+  auto big_list = context->runtime->create<ListManager>(runtime, 1, 1 << 20);
+  const i64 big_index = (i64(3) << 30) + 7;
+  *big_list->touch_and_get(big_index) = 42;
+  big_list->resize(big_index + 1);
+  TI_TEST_CHECK(big_list->size() == big_index + 1, runtime);
+  TI_TEST_CHECK(big_list->get<u8>(big_index) == 42, runtime);
+  TI_TEST_CHECK(big_list->get_num_active_chunks() == 1, runtime);
+  return 0;
+}
+
+i32 test_runtime_object_allocator(RuntimeContext *context) {
+  auto runtime = context->runtime;
+  const i64 live_bytes = runtime->object_bytes;
+  auto list = runtime->create<ListManager>(runtime, 4, 16);
+  const i64 list_bytes = runtime->object_bytes - live_bytes;
+  TI_TEST_CHECK(list->get_overhead_bytes() == list_bytes, runtime);
+  TI_TEST_CHECK(list_bytes < 4096, runtime);
+
+  // Chunk 1000 lives in the second chunk table, the only one allocated
+  *(i32 *)list->touch_and_get(16 * 1000) = 1;
+  TI_TEST_CHECK(list->get_num_active_chunks() == 1, runtime);
+  const i64 table_bytes = ListManager::chunk_table_size * sizeof(Ptr);
+  TI_TEST_CHECK(list->get_overhead_bytes() == list_bytes + table_bytes,
+                runtime);
+  TI_TEST_CHECK(runtime->object_bytes == live_bytes + list_bytes + table_bytes,
+                runtime);
+
+  // Destroyed objects are handed out again, cleared
+  runtime->destroy(list);
+  TI_TEST_CHECK(runtime->object_bytes == live_bytes, runtime);
+  auto list2 = runtime->create<ListManager>(runtime, 4, 16);
+  TI_TEST_CHECK(list2 == list, runtime);
+  TI_TEST_CHECK(list2->get_num_active_chunks() == 0, runtime);
+  for (int i = 0; i < 100; i++) {
+    list2->append(&i);
+  }
+  for (int i = 0; i < 100; i++) {
+    TI_TEST_CHECK(list2->get<i32>(i) == i, runtime);
+  }
+
+  auto nodes = runtime->create<NodeManager>(runtime, sizeof(i64), 4);
+  TI_TEST_CHECK(*(i64 *)nodes->allocate() == 0, runtime);
+  runtime->destroy(nodes);
+  runtime->destroy(list2);
+  TI_TEST_CHECK(runtime->object_bytes == live_bytes, runtime);
   return 0;
 }
 
@@ -148,12 +195,57 @@ i32 test_node_allocator_gc_cpu(RuntimeContext *context) {
   }
   nodes->gc_serial();
   // After GC, all items should be returned to |free_list|.
-  taichi_printf(runtime, "free_list_size=%d\n", nodes->free_list->size());
+  taichi_printf(runtime, "free_list_size=%d\n",
+                (int)nodes->free_list->size());
   TI_TEST_CHECK(nodes->free_list->size() == kN, runtime);
 
   return 0;
 }
 
+i32 test_node_allocator_gc_parallel_cpu(RuntimeContext *context) {
+  auto runtime = context->runtime;
+  // Large enough elements so that NodeManager::gc_parallel_cpu() does not fall
+  // back to gc_serial().
+  constexpr int kElementSize = 4096;
+  constexpr int kN = 1000;
+  auto nodes = runtime->create<NodeManager>(runtime, kElementSize, 64);
+  Ptr ptrs[kN];
+  for (int round = 0; round < 3; round++) {
+    for (int i = 0; i < kN; i++) {
+      ptrs[i] = nodes->allocate();
+      TI_TEST_CHECK(ptrs[i][kElementSize - 1] == 0, runtime);
+      std::memset(ptrs[i], round + 1, kElementSize);
+    }
+    // Keep part of the free list unused across the GC.
+    for (int i = 0; i < kN; i += 3) {
+      nodes->recycle(ptrs[i]);
+    }
+    nodes->gc_parallel_cpu();
+    for (int i = 1; i < kN; i += 3) {
+      nodes->recycle(ptrs[i]);
+    }
+    for (int i = 2; i < kN; i += 3) {
+      nodes->recycle(ptrs[i]);
+    }
+    nodes->gc_parallel_cpu();
+    TI_TEST_CHECK(nodes->recycled_list->size() == 0, runtime);
+    TI_TEST_CHECK(nodes->free_list_used == 0, runtime);
+    TI_TEST_CHECK(nodes->free_list->size() == kN, runtime);
+    // Every node shows up exactly once in the free list.
+    for (int i = 0; i < kN; i++) {
+      auto idx = nodes->locate(nodes->free_list->get<Ptr>(i));
+      TI_TEST_CHECK(0 <= idx && idx < kN, runtime);
+      auto node = nodes->data_list->get_element_ptr(idx);
+      TI_TEST_CHECK(node[0] == 0, runtime);
+      node[0] = 1;
+    }
+    for (int i = 0; i < kN; i++) {
+      nodes->data_list->get_element_ptr(i)[0] = 0;
+    }
+  }
+  return 0;
+}
+
 i32 test_active_mask(RuntimeContext *context) {
   auto rt = context->runtime;
   taichi_printf(rt, "%d activemask %x\n", thread_idx(), cuda_active_mask());
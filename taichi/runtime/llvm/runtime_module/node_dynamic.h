@@ -13,31 +13,79 @@ struct DynamicMeta : public StructMeta {
 
 STRUCT_FIELD(DynamicMeta, chunk_size);
 
+// The chunks of a dynamic node are indexed by a chunk directory, so that
+// element i lives at offset (i % chunk_size) of chunk (i / chunk_size) and
+// every access takes constant time. `DynamicNode::ptr` points to
+//
+//   i64 capacity;
+//   Ptr chunks[capacity];
+//
+// The directory grows geometrically under the node lock. A grown directory
+// replaces the old one, which stays valid (with the same entries) for threads
+// that still hold it. When the node is deactivated, its chunks are recycled
+// but the directory is kept for reuse, so the memory spent on directories is
+// bounded by twice the largest directory ever needed.
+constexpr i64 dynamic_min_directory_capacity = 4;
+
+i64 &Dynamic_directory_capacity(Ptr directory) {
+  return *(i64 *)directory;
+}
+
+Ptr *Dynamic_directory_chunks(Ptr directory) {
+  return (Ptr *)(directory + sizeof(i64));
+}
+
+// Returns chunk c of the node, allocating it (and growing the directory) if
+// necessary.
+Ptr Dynamic_touch_chunk(DynamicMeta *meta, DynamicNode *node, int c) {
+  Ptr directory = node->ptr;
+  if (directory != nullptr && c < Dynamic_directory_capacity(directory)) {
+    Ptr chunk = Dynamic_directory_chunks(directory)[c];
+    if (chunk != nullptr) {
+      return chunk;
+    }
+  }
+  locked_task(Ptr(&node->lock), [&] {
+    auto rt = meta->context->runtime;
+    directory = node->ptr;
+    i64 capacity = directory ? Dynamic_directory_capacity(directory) : 0;
+    if (c >= capacity) {
+      auto max_num_chunks =
+          (meta->max_num_elements + meta->chunk_size - 1) / meta->chunk_size;
+      auto new_capacity = max_i64(capacity * 2, dynamic_min_directory_capacity);
+      while (new_capacity <= c) {
+        new_capacity *= 2;
+      }
+      new_capacity = max_i64(min_i64(new_capacity, max_num_chunks), c + 1);
+      auto new_directory = rt->allocate_aligned(
+          rt->runtime_memory_chunk, sizeof(i64) + sizeof(Ptr) * new_capacity,
+          sizeof(Ptr), true /*request*/);
+      Dynamic_directory_capacity(new_directory) = new_capacity;
+      auto new_chunks = Dynamic_directory_chunks(new_directory);
+      for (i64 j = 0; j < new_capacity; j++) {
+        new_chunks[j] = j < capacity ? Dynamic_directory_chunks(directory)[j]
+                                     : nullptr;
+      }
+      grid_memfence();
+      atomic_exchange_u64((u64 *)&node->ptr, (u64)new_directory);
+      directory = new_directory;
+    }
+    auto &chunk = Dynamic_directory_chunks(directory)[c];
+    if (chunk == nullptr) {
+      auto alloc = rt->node_allocators[meta->snode_id];
+      atomic_exchange_u64((u64 *)&chunk, (u64)alloc->allocate());
+    }
+  });
+  return Dynamic_directory_chunks(directory)[c];
+}
+
 void Dynamic_activate(Ptr meta_, Ptr node_, int i) {
   auto meta = (DynamicMeta *)(meta_);
   auto node = (DynamicNode *)(node_);
   // We need to not only update node->n, but also make sure the chunk containing
   // element i is allocated.
   atomic_max_i32(&node->n, i + 1);
-  int chunk_start = 0;
-  auto p_chunk_ptr = &node->ptr;
-  auto chunk_size = meta->chunk_size;
-  while (true) {
-    if (*p_chunk_ptr == nullptr) {
-      locked_task(Ptr(&node->lock), [&] {
-        if (*p_chunk_ptr == nullptr) {
-          auto rt = meta->context->runtime;
-          auto alloc = rt->node_allocators[meta->snode_id];
-          *p_chunk_ptr = alloc->allocate();
-        }
-      });
-    }
-    if (i < chunk_start + chunk_size) {
-      return;
-    }
-    p_chunk_ptr = (Ptr *)*p_chunk_ptr;
-    chunk_start += chunk_size;
-  }
+  Dynamic_touch_chunk(meta, node, i / meta->chunk_size);
 }
 
 void Dynamic_deactivate(Ptr meta_, Ptr node_) {
@@ -46,14 +94,19 @@ void Dynamic_deactivate(Ptr meta_, Ptr node_) {
   if (node->n > 0) {
     locked_task(Ptr(&node->lock), [&] {
       node->n = 0;
-      auto p_chunk_ptr = &node->ptr;
+      auto directory = node->ptr;
+      if (directory == nullptr) {
+        return;
+      }
       auto rt = meta->context->runtime;
       auto alloc = rt->node_allocators[meta->snode_id];
-      while (*p_chunk_ptr) {
-        alloc->recycle(*p_chunk_ptr);
-        p_chunk_ptr = (Ptr *)*p_chunk_ptr;
+      auto chunks = Dynamic_directory_chunks(directory);
+      for (i64 c = 0; c < Dynamic_directory_capacity(directory); c++) {
+        if (chunks[c] != nullptr) {
+          alloc->recycle(chunks[c]);
+          chunks[c] = nullptr;
+        }
       }
-      node->ptr = nullptr;
     });
   }
 }
@@ -64,27 +117,8 @@ Ptr Dynamic_allocate(Ptr meta_, Ptr node_, i32 *len) {
   auto chunk_size = meta->chunk_size;
   auto i = atomic_add_i32(&node->n, 1);
   *len = i;
-  int chunk_start = 0;
-  auto p_chunk_ptr = &node->ptr;
-  while (true) {
-    if (*p_chunk_ptr == nullptr) {
-      locked_task(Ptr(&node->lock), [&] {
-        if (*p_chunk_ptr == nullptr) {
-          auto rt = meta->context->runtime;
-          auto alloc = rt->node_allocators[meta->snode_id];
-          *p_chunk_ptr = alloc->allocate();
-        }
-      });
-    }
-    if (i < chunk_start + chunk_size) {
-      return *p_chunk_ptr + sizeof(Ptr) +
-             (i - chunk_start) * meta->element_size;
-    }
-    p_chunk_ptr = (Ptr *)(*p_chunk_ptr);
-    chunk_start += chunk_size;
-  }
-  // Unreachable
-  return nullptr;
+  auto chunk = Dynamic_touch_chunk(meta, node, i / chunk_size);
+  return chunk + (i % chunk_size) * meta->element_size;
 }
 
 u1 Dynamic_is_active(Ptr meta_, Ptr node_, int i) {
@@ -96,18 +130,9 @@ Ptr Dynamic_lookup_element(Ptr meta_, Ptr node_, int i) {
   auto meta = (DynamicMeta *)(meta_);
   auto node = (DynamicNode *)(node_);
   if (Dynamic_is_active(meta_, node_, i)) {
-    int chunk_start = 0;
-    auto chunk_ptr = node->ptr;
     auto chunk_size = meta->chunk_size;
-    while (true) {
-      if (i < chunk_start + chunk_size) {
-        auto addr =
-            chunk_ptr + sizeof(Ptr) + (i - chunk_start) * meta->element_size;
-        return addr;
-      }
-      chunk_ptr = *(Ptr *)chunk_ptr;
-      chunk_start += chunk_size;
-    }
+    auto chunk = Dynamic_directory_chunks(node->ptr)[i / chunk_size];
+    return chunk + (i % chunk_size) * meta->element_size;
   } else {
     return (meta->context->runtime)->ambient_elements[meta->snode_id];
   }
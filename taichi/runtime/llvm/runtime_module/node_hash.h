@@ -0,0 +1,301 @@
+#pragma once
+
+// A hash node maps the (linearized) indices of its active cells to cells
+// allocated by the node allocator, using an open-addressing table with linear
+// probing. The table has a power-of-two number of slots, laid out as
+//
+//   i32 keys[table_size];   // index + 1 of the cell owning the slot,
+//                           // 0 = empty, -1 = deleted (tombstone)
+//   i32 locks[table_size];
+//   i32 num_deleted;        // number of tombstones
+//   i32 padding;
+//   Ptr data[table_size];   // nullptr = inactive
+//
+// Insertions of an index are serialized by the lock of its home slot, so that
+// concurrent activations of the same index can never end up in two different
+// slots. An insertion claims the first empty or deleted slot on its probe
+// sequence with a CAS on its key. Deactivation recycles the cell and turns
+// the key into a tombstone, both under the lock of the slot, so the capacity
+// of the table only bounds the number of indices active at the same time.
+// Slots never become empty again while kernels may access the table, which
+// keeps the probe sequences of the keys in the table unbroken. Tombstones
+// lengthen the probe sequences of misses, so the GC task that follows
+// deactivations rehashes the table in place once too many have piled up.
+//
+// Iterating over a hash node (listgen and struct-fors) walks the slots instead
+// of the index space, so its cost is proportional to the table size rather
+// than to the (possibly huge) bounding box.
+
+// Specialized Attributes and functions
+struct HashMeta : public StructMeta {
+  int table_size;
+};
+
+STRUCT_FIELD(HashMeta, table_size);
+
+constexpr i32 kHashEmptyKey = 0;
+constexpr i32 kHashDeletedKey = -1;
+
+i32 Hash_get_num_elements(Ptr meta, Ptr node) {
+  return ((HashMeta *)meta)->table_size;
+}
+
+i32 *Hash_keys(Ptr meta, Ptr node) {
+  return (i32 *)node;
+}
+
+Ptr Hash_lock(Ptr meta, Ptr node, int slot) {
+  return node + 4 * (((HashMeta *)meta)->table_size + slot);
+}
+
+i32 *Hash_num_deleted(Ptr meta, Ptr node) {
+  return Hash_keys(meta, node) + 2 * ((HashMeta *)meta)->table_size;
+}
+
+Ptr *Hash_data(Ptr meta, Ptr node, int slot) {
+  return (Ptr *)(node + 8 * (((HashMeta *)meta)->table_size + 1 + slot));
+}
+
+u32 Hash_home_slot(Ptr meta, int i) {
+  // The finalizer of MurmurHash3, so that indices sharing their low bits do
+  // not pile up in the same cluster.
+  u32 h = (u32)i;
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h & (u32)(((HashMeta *)meta)->table_size - 1);
+}
+
+i32 Hash_load_key(Ptr meta, Ptr node, int slot) {
+  return __atomic_load_n(&Hash_keys(meta, node)[slot], __ATOMIC_ACQUIRE);
+}
+
+// Returns the slot of index i, or -1 if i is not in the table.
+i32 Hash_find_slot(Ptr meta, Ptr node, int i) {
+  auto table_size = ((HashMeta *)meta)->table_size;
+  auto key = i + 1;
+  auto slot = Hash_home_slot(meta, i);
+  for (int probe = 0; probe < table_size; probe++) {
+    auto k = Hash_load_key(meta, node, slot);
+    if (k == key) {
+      return slot;
+    }
+    if (k == kHashEmptyKey) {
+      return -1;
+    }
+    slot = (slot + 1) & (table_size - 1);
+  }
+  return -1;
+}
+
+// Same as Hash_find_slot, except that a missing index is inserted into the
+// first empty or deleted slot on its probe sequence. Returns -1 if the table
+// is full.
+i32 Hash_insert_slot(Ptr meta, Ptr node, int i) {
+  auto slot = Hash_find_slot(meta, node, i);
+  if (slot != -1) {
+    return slot;
+  }
+  auto table_size = ((HashMeta *)meta)->table_size;
+  auto keys = Hash_keys(meta, node);
+  auto key = i + 1;
+  auto home = Hash_home_slot(meta, i);
+  locked_task(Hash_lock(meta, node, home), [&] {
+    // Another activation of i may have inserted it in the meantime
+    slot = Hash_find_slot(meta, node, i);
+    if (slot != -1) {
+      return;
+    }
+    auto s = home;
+    for (int probe = 0; probe < table_size; probe++) {
+      auto k = Hash_load_key(meta, node, s);
+      // Other indices may claim the same slot concurrently
+      if ((k == kHashEmptyKey || k == kHashDeletedKey) &&
+          __atomic_compare_exchange_n(&keys[s], &k, key, false,
+                                      __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        if (k == kHashDeletedKey) {
+          __atomic_fetch_sub(Hash_num_deleted(meta, node), 1,
+                             __ATOMIC_RELAXED);
+        }
+        slot = s;
+        return;
+      }
+      s = (s + 1) & (table_size - 1);
+    }
+  });
+  return slot;
+}
+
+void Hash_activate(Ptr meta_, Ptr node, int i) {
+  auto meta = (StructMeta *)meta_;
+  auto key = i + 1;
+  // Retried if the slot is deleted by a concurrent deactivation of i before
+  // its cell is allocated
+  while (true) {
+    auto slot = Hash_insert_slot(meta_, node, i);
+    if (slot == -1) {
+      taichi_assert_runtime(
+          meta->context->runtime, false,
+          "Hash SNode is full. Please increase its capacity.");
+      return;
+    }
+    volatile Ptr *data_ptr = Hash_data(meta_, node, slot);
+    bool deleted = false;
+    locked_task(
+        Hash_lock(meta_, node, slot),
+        [&] {
+          if (Hash_load_key(meta_, node, slot) != key) {
+            deleted = true;
+            return;
+          }
+          if (*data_ptr == nullptr) {
+            auto rt = meta->context->runtime;
+            auto alloc = rt->node_allocators[meta->snode_id];
+            auto allocated = (u64)alloc->allocate();
+            atomic_exchange_u64((u64 *)data_ptr, allocated);
+          }
+        },
+        [&]() {
+          return *data_ptr == nullptr ||
+                 Hash_load_key(meta_, node, slot) != key;
+        });
+    if (!deleted) {
+      return;
+    }
+  }
+}
+
+void Hash_deactivate(Ptr meta, Ptr node, int i) {
+  auto slot = Hash_find_slot(meta, node, i);
+  if (slot == -1) {
+    return;
+  }
+  auto key = i + 1;
+  locked_task(Hash_lock(meta, node, slot), [&] {
+    // The slot may have been deleted and claimed by another index since
+    if (Hash_load_key(meta, node, slot) != key) {
+      return;
+    }
+    Ptr &data_ptr = *Hash_data(meta, node, slot);
+    if (data_ptr != nullptr) {
+      auto smeta = (StructMeta *)meta;
+      auto rt = smeta->context->runtime;
+      auto alloc = rt->node_allocators[smeta->snode_id];
+      alloc->recycle(data_ptr);
+      data_ptr = nullptr;
+    }
+    __atomic_store_n(&Hash_keys(meta, node)[slot], kHashDeletedKey,
+                     __ATOMIC_RELEASE);
+    __atomic_fetch_add(Hash_num_deleted(meta, node), 1, __ATOMIC_RELAXED);
+  });
+}
+
+// Clears the tombstones of the table once they take up 1/8 of its slots, by
+// rehashing the live keys in place. Must not run concurrently with any other
+// access to the node, which holds for the GC task of the hash SNode.
+void Hash_gc(Ptr meta, Ptr node) {
+  auto table_size = ((HashMeta *)meta)->table_size;
+  auto num_deleted = Hash_num_deleted(meta, node);
+  if (*num_deleted * 8 < table_size) {
+    return;
+  }
+  auto keys = Hash_keys(meta, node);
+  // Keys still to be placed are marked by negating them. Tombstones are gone
+  // at this point, so the marks cannot be mistaken for them.
+  for (int s = 0; s < table_size; s++) {
+    keys[s] = keys[s] == kHashDeletedKey ? kHashEmptyKey : -keys[s];
+  }
+  for (int s = 0; s < table_size; s++) {
+    while (keys[s] < 0) {
+      auto key = -keys[s];
+      // The first slot on the probe sequence of the key that no placed key
+      // occupies. Since placed keys never move again, their probe sequences
+      // only ever pass over placed keys.
+      auto t = Hash_home_slot(meta, key - 1);
+      while (t != s && keys[t] > 0) {
+        t = (t + 1) & (table_size - 1);
+      }
+      if (t == s) {
+        keys[s] = key;
+        break;
+      }
+      auto data = *Hash_data(meta, node, s);
+      *Hash_data(meta, node, s) = *Hash_data(meta, node, t);
+      *Hash_data(meta, node, t) = data;
+      // Swapped with either an empty slot or a key still to be placed, which
+      // is placed next.
+      keys[s] = keys[t];
+      keys[t] = key;
+    }
+  }
+  *num_deleted = 0;
+}
+
+u1 Hash_is_active(Ptr meta, Ptr node, int i) {
+  auto slot = Hash_find_slot(meta, node, i);
+  return slot != -1 && *Hash_data(meta, node, slot) != nullptr;
+}
+
+Ptr Hash_lookup_element(Ptr meta, Ptr node, int i) {
+  auto slot = Hash_find_slot(meta, node, i);
+  Ptr data_ptr = slot == -1 ? nullptr : *Hash_data(meta, node, slot);
+  if (data_ptr == nullptr) {
+    auto smeta = (StructMeta *)meta;
+    auto context = smeta->context;
+    data_ptr = (context->runtime)->ambient_elements[smeta->snode_id];
+  }
+  return data_ptr;
+}
+
+// Returns the index of the cell held by |slot|, or -1 if the slot is empty,
+// deleted or its cell is inactive.
+i32 Hash_slot_index(Ptr meta, Ptr node, int slot) {
+  auto key = Hash_load_key(meta, node, slot);
+  if (key == kHashEmptyKey || key == kHashDeletedKey ||
+      *Hash_data(meta, node, slot) == nullptr) {
+    return -1;
+  }
+  return key - 1;
+}
+
+// Same as element_listgen_nonroot, except that the loop bounds of a hash
+// element range over table slots.
+void element_listgen_hash(LLVMRuntime *runtime,
+                          StructMeta *parent,
+                          StructMeta *child) {
+  auto parent_list = runtime->element_lists[parent->snode_id];
+  i64 num_parent_elements = parent_list->size();
+  auto child_list = runtime->element_lists[child->snode_id];
+  auto parent_refine_coordinates = parent->refine_coordinates;
+  auto child_get_num_elements = child->get_num_elements;
+  auto child_from_parent_element = child->from_parent_element;
+  for (i64 i = 0; i < num_parent_elements; i++) {
+    auto element = parent_list->get<Element>(i);
+    for (int slot = element.loop_bounds[0]; slot < element.loop_bounds[1];
+         slot++) {
+      auto index = Hash_slot_index((Ptr)parent, element.element, slot);
+      if (index == -1) {
+        continue;
+      }
+      PhysicalCoordinates refined_coord;
+      parent_refine_coordinates(&element.pcoord, &refined_coord, index);
+      auto ch_element = *Hash_data((Ptr)parent, element.element, slot);
+      ch_element = child_from_parent_element((Ptr)ch_element);
+      auto ch_num_elements = child_get_num_elements((Ptr)child, ch_element);
+      auto ch_element_size =
+          std::min(ch_num_elements, taichi_listgen_max_element_size);
+      for (int ch_lower = 0; ch_lower < ch_num_elements;
+           ch_lower += ch_element_size) {
+        Element elem;
+        elem.element = ch_element;
+        elem.loop_bounds[0] = ch_lower;
+        elem.loop_bounds[1] =
+            std::min(ch_lower + ch_element_size, ch_num_elements);
+        elem.pcoord = refined_coord;
+        child_list->append(&elem);
+      }
+    }
+  }
+}
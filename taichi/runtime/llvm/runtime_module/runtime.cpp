@@ -419,18 +419,26 @@ bool is_power_of_two(uint32 x) {
 /*
 A simple list data structure that is infinitely long.
 Data are organized in chunks, where each chunk is allocated on demand.
-*/
+Element indices and the list length are 64-bit, so a list may hold more than
+2^31 elements as long as they fit in max_num_chunks chunks.
 
-// TODO: there are many i32 types in this class, which may be an issue if there
-// are >= 2 ** 31 elements.
+The chunks are found through a two-level table: |chunk_tables| points to
+tables of chunk_table_size chunk pointers, each allocated when a chunk in its
+range is first touched. A list with a few chunks thus costs a few KB instead
+of a flat table of max_num_chunks pointers.
+*/
 struct ListManager {
-  static constexpr std::size_t max_num_chunks = 128 * 1024;
-  Ptr chunks[max_num_chunks];
+  static constexpr int log2_chunk_table_size = 9;
+  static constexpr std::size_t chunk_table_size = 1 << log2_chunk_table_size;
+  static constexpr std::size_t num_chunk_tables = 256;
+  static constexpr std::size_t max_num_chunks =
+      chunk_table_size * num_chunk_tables;
+  Ptr *chunk_tables[num_chunk_tables];
   std::size_t element_size{0};
   std::size_t max_num_elements_per_chunk;
   i32 log2chunk_num_elements;
   i32 lock;
-  i32 num_elements;
+  i64 num_elements;
   LLVMRuntime *runtime;
 
   ListManager(LLVMRuntime *runtime,
@@ -444,17 +452,26 @@ struct ListManager {
     lock = 0;
     num_elements = 0;
     log2chunk_num_elements = taichi::log2int(num_elements_per_chunk);
+    for (int i = 0; i < num_chunk_tables; i++) {
+      chunk_tables[i] = nullptr;
+    }
   }
 
+  // Releases the chunk tables. The chunks themselves are not returned.
+  ~ListManager();
+
   void append(void *data_ptr);
 
-  i32 reserve_new_element() {
-    auto i = atomic_add_i32(&num_elements, 1);
-    auto chunk_id = i >> log2chunk_num_elements;
-    touch_chunk(chunk_id);
+  i64 reserve_new_element() {
+    auto i = atomic_add_i64(&num_elements, 1);
+    touch_chunk(chunk_of(i));
     return i;
   }
 
+  int chunk_of(i64 i) {
+    return int(i >> log2chunk_num_elements);
+  }
+
   template <typename T>
   void push_back(const T &t) {
     this->append((void *)&t);
@@ -464,48 +481,74 @@ struct ListManager {
 
   void touch_chunk(int chunk_id);
 
+  // Null if the chunk has not been touched yet
+  Ptr get_chunk(int chunk_id) {
+    auto table = chunk_tables[chunk_id >> log2_chunk_table_size];
+    return table ? table[chunk_id & (chunk_table_size - 1)] : nullptr;
+  }
+
   i32 get_num_active_chunks() {
     i32 counter = 0;
-    for (int i = 0; i < max_num_chunks; i++) {
-      counter += (chunks[i] != nullptr);
+    for (int t = 0; t < num_chunk_tables; t++) {
+      if (chunk_tables[t]) {
+        for (int i = 0; i < chunk_table_size; i++) {
+          counter += (chunk_tables[t][i] != nullptr);
+        }
+      }
     }
     return counter;
   }
 
+  // Bytes of runtime objects used by this list: the list itself and its
+  // chunk tables, excluding the chunks
+  i64 get_overhead_bytes();
+
   void clear() {
     num_elements = 0;
   }
 
-  void resize(i32 n) {
+  void resize(i64 n) {
+    num_elements = n;
+  }
+
+  // Resizes the list to n elements and allocates the chunks they occupy, so
+  // that the new elements can be written concurrently with get().
+  void resize_and_touch(i64 n) {
+    for (i64 c = 0; c < n; c += max_num_elements_per_chunk) {
+      touch_chunk(chunk_of(c));
+    }
     num_elements = n;
   }
 
-  Ptr get_element_ptr(i32 i) {
-    return chunks[i >> log2chunk_num_elements] +
-           element_size * (i & ((1 << log2chunk_num_elements) - 1));
+  Ptr get_element_ptr(i64 i) {
+    const int chunk_id = chunk_of(i);
+    return chunk_tables[chunk_id >> log2_chunk_table_size]
+                       [chunk_id & (chunk_table_size - 1)] +
+           element_size * (i & ((i64(1) << log2chunk_num_elements) - 1));
   }
 
   template <typename T>
-  T &get(i32 i) {
+  T &get(i64 i) {
     return *(T *)get_element_ptr(i);
   }
 
-  Ptr touch_and_get(i32 i) {
-    touch_chunk(i >> log2chunk_num_elements);
+  Ptr touch_and_get(i64 i) {
+    touch_chunk(chunk_of(i));
     return get_element_ptr(i);
   }
 
-  i32 size() {
+  i64 size() {
     return num_elements;
   }
 
-  i32 ptr2index(Ptr ptr) {
+  i64 ptr2index(Ptr ptr) {
     auto chunk_size = max_num_elements_per_chunk * element_size;
     for (int i = 0; i < max_num_chunks; i++) {
-      taichi_assert_runtime(runtime, chunks[i] != nullptr, "ptr not found.");
-      if (chunks[i] <= ptr && ptr < chunks[i] + chunk_size) {
-        return (i << log2chunk_num_elements) +
-               i32((ptr - chunks[i]) / element_size);
+      auto chunk = get_chunk(i);
+      taichi_assert_runtime(runtime, chunk != nullptr, "ptr not found.");
+      if (chunk <= ptr && ptr < chunk + chunk_size) {
+        return (i64(i) << log2chunk_num_elements) +
+               i64((ptr - chunk) / element_size);
       }
     }
     return -1;
@@ -549,6 +592,15 @@ struct PreallocatedMemoryChunk {
   std::size_t preallocated_size = 0;
 };
 
+// Runtime objects (list and node managers, chunk tables) are carved out of
+// slabs in size classes of runtime_object_granularity bytes. Destroyed objects
+// go to the free list of their class and are handed out again.
+constexpr std::size_t runtime_object_granularity = 64;
+constexpr int runtime_object_num_classes = 128;
+constexpr std::size_t runtime_object_max_size =
+    runtime_object_granularity * runtime_object_num_classes;
+constexpr std::size_t runtime_object_slab_size = 64 * 1024;
+
 struct LLVMRuntime {
   PreallocatedMemoryChunk runtime_objects_chunk;
   PreallocatedMemoryChunk runtime_memory_chunk;
@@ -564,6 +616,10 @@ struct LLVMRuntime {
 
   Ptr thread_pool;
   parallel_for_type parallel_for;
+  // Per-thread TLS slots of CPU parallel-fors, see cpu_tls_launch_context.
+  Ptr cpu_tls_buffer;
+  std::size_t cpu_tls_buffer_size;
+  i64 cpu_tls_launch_id;
   ListManager *element_lists[taichi_max_num_snodes];
   NodeManager *node_allocators[taichi_max_num_snodes];
   Ptr ambient_elements[taichi_max_num_snodes];
@@ -596,6 +652,22 @@ struct LLVMRuntime {
 
   i64 total_requested_memory;
 
+  // See allocate_object()
+  Ptr object_free_lists[runtime_object_num_classes];
+  Ptr object_slab_head;
+  Ptr object_slab_tail;
+  i32 object_lock;
+  // Bytes of the live runtime objects, rounded up to their size class, and
+  // of the slabs they are carved from
+  i64 object_bytes;
+  i64 object_slab_bytes;
+
+  // Zero-filled memory for runtime objects, aligned to
+  // runtime_object_granularity. Objects larger than runtime_object_max_size
+  // are allocated directly and never reused.
+  Ptr allocate_object(std::size_t size);
+  void release_object(Ptr ptr, std::size_t size);
+
   template <typename T>
   void set_result(std::size_t i, T t) {
     static_assert(sizeof(T) <= sizeof(uint64));
@@ -605,11 +677,16 @@ struct LLVMRuntime {
 
   template <typename T, typename... Args>
   T *create(Args &&...args) {
-    auto ptr = (T *)allocate_aligned(runtime_memory_chunk, sizeof(T), 4096,
-                                     true /*request*/);
+    auto ptr = (T *)allocate_object(sizeof(T));
     new (ptr) T(std::forward<Args>(args)...);
     return ptr;
   }
+
+  template <typename T>
+  void destroy(T *ptr) {
+    ptr->~T();
+    release_object((Ptr)ptr, sizeof(T));
+  }
 };
 
 // TODO: are these necessary?
@@ -625,20 +702,44 @@ STRUCT_FIELD(LLVMRuntime, profiler);
 STRUCT_FIELD(LLVMRuntime, profiler_start);
 STRUCT_FIELD(LLVMRuntime, profiler_stop);
 
+i64 ListManager::get_overhead_bytes() {
+  i64 bytes = taichi::iroundup(sizeof(ListManager), runtime_object_granularity);
+  for (int t = 0; t < num_chunk_tables; t++) {
+    if (chunk_tables[t]) {
+      bytes += chunk_table_size * sizeof(Ptr);
+    }
+  }
+  return bytes;
+}
+
+ListManager::~ListManager() {
+  for (int t = 0; t < num_chunk_tables; t++) {
+    if (chunk_tables[t]) {
+      runtime->release_object((Ptr)chunk_tables[t],
+                              chunk_table_size * sizeof(Ptr));
+      chunk_tables[t] = nullptr;
+    }
+  }
+}
+
 // NodeManager of node S (hash, pointer) managers the memory allocation of S_ch
 // It makes use of three ListManagers.
+//
+// The free and recycled lists hold element pointers rather than indices into
+// |data_list|, so recycling a node never has to map its address back to an
+// index.
 struct NodeManager {
   LLVMRuntime *runtime;
   i32 lock;
 
   i32 element_size;
   i32 chunk_num_elements;
-  i32 free_list_used;
+  i64 free_list_used;
 
   ListManager *free_list, *recycled_list, *data_list;
-  i32 recycle_list_size_backup;
+  i64 recycle_list_size_backup;
 
-  using list_data_type = i32;
+  using list_data_type = Ptr;
 
   NodeManager(LLVMRuntime *runtime,
               i32 element_size,
@@ -663,47 +764,61 @@ struct NodeManager {
         runtime->create<ListManager>(runtime, element_size, chunk_num_elements);
   }
 
+  ~NodeManager() {
+    runtime->destroy(free_list);
+    runtime->destroy(recycled_list);
+    runtime->destroy(data_list);
+  }
+
+  // Bytes of runtime objects used by this manager and its lists, excluding
+  // the chunks of the lists
+  i64 get_overhead_bytes() {
+    return taichi::iroundup(sizeof(NodeManager), runtime_object_granularity) +
+           free_list->get_overhead_bytes() +
+           recycled_list->get_overhead_bytes() +
+           data_list->get_overhead_bytes();
+  }
+
   Ptr allocate() {
-    int old_cursor = atomic_add_i32(&free_list_used, 1);
-    i32 l;
+    i64 old_cursor = atomic_add_i64(&free_list_used, 1);
     if (old_cursor >= free_list->size()) {
       // running out of free list. allocate new.
-      l = data_list->reserve_new_element();
+      return data_list->get_element_ptr(data_list->reserve_new_element());
     } else {
       // reuse
-      l = free_list->get<list_data_type>(old_cursor);
+      return free_list->get<list_data_type>(old_cursor);
     }
-    return data_list->get_element_ptr(l);
   }
 
-  i32 locate(Ptr ptr) {
+  // Only used for debugging and testing.
+  i64 locate(Ptr ptr) {
     return data_list->ptr2index(ptr);
   }
 
   void recycle(Ptr ptr) {
-    auto index = locate(ptr);
-    recycled_list->append(&index);
+    recycled_list->push_back(ptr);
   }
 
   void gc_serial() {
     // compact free list
-    for (int i = free_list_used; i < free_list->size(); i++) {
+    for (i64 i = free_list_used; i < free_list->size(); i++) {
       free_list->get<list_data_type>(i - free_list_used) =
           free_list->get<list_data_type>(i);
     }
-    const i32 num_unused = max_i32(free_list->size() - free_list_used, 0);
+    const i64 num_unused = max_i64(free_list->size() - free_list_used, 0);
     free_list_used = 0;
     free_list->resize(num_unused);
 
     // zero-fill recycled and push to free list
-    for (int i = 0; i < recycled_list->size(); i++) {
-      auto idx = recycled_list->get<list_data_type>(i);
-      auto ptr = data_list->get_element_ptr(idx);
+    for (i64 i = 0; i < recycled_list->size(); i++) {
+      auto ptr = recycled_list->get<list_data_type>(i);
       std::memset(ptr, 0, element_size);
-      free_list->push_back(idx);
+      free_list->push_back(ptr);
     }
     recycled_list->clear();
   }
+
+  void gc_parallel_cpu();
 };
 
 extern "C" {
@@ -749,6 +864,20 @@ void runtime_ListManager_get_num_active_chunks(LLVMRuntime *runtime,
 RUNTIME_STRUCT_FIELD_ARRAY(LLVMRuntime, node_allocators);
 RUNTIME_STRUCT_FIELD_ARRAY(LLVMRuntime, element_lists);
 RUNTIME_STRUCT_FIELD(LLVMRuntime, total_requested_memory);
+RUNTIME_STRUCT_FIELD(LLVMRuntime, object_bytes);
+RUNTIME_STRUCT_FIELD(LLVMRuntime, object_slab_bytes);
+
+void runtime_ListManager_get_overhead_bytes(LLVMRuntime *runtime,
+                                            ListManager *list_manager) {
+  runtime->set_result(taichi_result_buffer_runtime_query_id,
+                      list_manager->get_overhead_bytes());
+}
+
+void runtime_NodeManager_get_overhead_bytes(LLVMRuntime *runtime,
+                                            NodeManager *node_manager) {
+  runtime->set_result(taichi_result_buffer_runtime_query_id,
+                      node_manager->get_overhead_bytes());
+}
 
 RUNTIME_STRUCT_FIELD(NodeManager, free_list);
 RUNTIME_STRUCT_FIELD(NodeManager, recycled_list);
@@ -873,6 +1002,51 @@ Ptr LLVMRuntime::allocate_from_reserved_memory(
   return ret;
 }
 
+Ptr LLVMRuntime::allocate_object(std::size_t size) {
+  size = taichi::iroundup(size, runtime_object_granularity);
+  if (size > runtime_object_max_size) {
+    atomic_add_i64(&object_bytes, size);
+    return allocate_aligned(runtime_memory_chunk, size,
+                            runtime_object_granularity, true /*request*/);
+  }
+  const int size_class = size / runtime_object_granularity - 1;
+  Ptr ret = nullptr;
+  locked_task(&object_lock, [&] {
+    if (object_free_lists[size_class]) {
+      ret = object_free_lists[size_class];
+      object_free_lists[size_class] = *(Ptr *)ret;
+      std::memset(ret, 0, size);
+    } else {
+      if (object_slab_head + size > object_slab_tail) {
+        // The rest of the current slab is left unused
+        object_slab_head =
+            allocate_aligned(runtime_memory_chunk, runtime_object_slab_size,
+                             taichi_page_size, true /*request*/);
+        object_slab_tail = object_slab_head + runtime_object_slab_size;
+        object_slab_bytes += runtime_object_slab_size;
+      }
+      ret = object_slab_head;
+      object_slab_head += size;
+    }
+    object_bytes += size;
+  });
+  return ret;
+}
+
+void LLVMRuntime::release_object(Ptr ptr, std::size_t size) {
+  size = taichi::iroundup(size, runtime_object_granularity);
+  if (size > runtime_object_max_size) {
+    atomic_add_i64(&object_bytes, -i64(size));
+    return;
+  }
+  const int size_class = size / runtime_object_granularity - 1;
+  locked_task(&object_lock, [&] {
+    *(Ptr *)ptr = object_free_lists[size_class];
+    object_free_lists[size_class] = ptr;
+    object_bytes -= size;
+  });
+}
+
 // External API
 // [ON HOST] CPU backend
 // [ON DEVICE] CUDA/AMDGPU backend
@@ -949,6 +1123,15 @@ void runtime_initialize(
 
   runtime->total_requested_memory = 0;
 
+  for (int i = 0; i < runtime_object_num_classes; i++) {
+    runtime->object_free_lists[i] = nullptr;
+  }
+  runtime->object_slab_head = nullptr;
+  runtime->object_slab_tail = nullptr;
+  runtime->object_lock = 0;
+  runtime->object_bytes = 0;
+  runtime->object_slab_bytes = 0;
+
   runtime->temporaries = (Ptr)runtime->allocate_aligned(
       runtime->runtime_objects_chunk, taichi_global_tmp_buffer_size,
       taichi_page_size);
@@ -1021,6 +1204,9 @@ void LLVMRuntime_initialize_thread_pool(LLVMRuntime *runtime,
                                         void *parallel_for) {
   runtime->thread_pool = (Ptr)thread_pool;
   runtime->parallel_for = (parallel_for_type)parallel_for;
+  runtime->cpu_tls_buffer = nullptr;
+  runtime->cpu_tls_buffer_size = 0;
+  runtime->cpu_tls_launch_id = 0;
 }
 
 void runtime_NodeAllocator_initialize(LLVMRuntime *runtime,
@@ -1030,6 +1216,19 @@ void runtime_NodeAllocator_initialize(LLVMRuntime *runtime,
       runtime->create<NodeManager>(runtime, node_size, 1024 * 16);
 }
 
+// Destroys the element list and the node manager of an SNode, when its tree
+// is destroyed. Their objects are reused by the trees created later.
+void runtime_destroy_snode(LLVMRuntime *runtime, int snode_id) {
+  if (runtime->element_lists[snode_id]) {
+    runtime->destroy(runtime->element_lists[snode_id]);
+    runtime->element_lists[snode_id] = nullptr;
+  }
+  if (runtime->node_allocators[snode_id]) {
+    runtime->destroy(runtime->node_allocators[snode_id]);
+    runtime->node_allocators[snode_id] = nullptr;
+  }
+}
+
 void runtime_allocate_ambient(LLVMRuntime *runtime,
                               int snode_id,
                               std::size_t size) {
@@ -1265,6 +1464,28 @@ DEFINE_REDUCTION(and, i32);
 DEFINE_REDUCTION(or, i32);
 DEFINE_REDUCTION(xor, i32);
 
+// The reductions of the FlagOS backend are plain atomics until FlagTree lowers
+// them to the reduction instructions of the chips. The host simulator has no
+// warps to reduce within anyway.
+#define DEFINE_FLAGOS_REDUCTION(op, dtype)                       \
+  dtype flagos_reduce_##op##_##dtype(dtype *result, dtype val) { \
+    atomic_##op##_##dtype(result, val);                          \
+    return val;                                                  \
+  }
+
+DEFINE_FLAGOS_REDUCTION(add, i32);
+DEFINE_FLAGOS_REDUCTION(add, f32);
+
+DEFINE_FLAGOS_REDUCTION(min, i32);
+DEFINE_FLAGOS_REDUCTION(min, f32);
+
+DEFINE_FLAGOS_REDUCTION(max, i32);
+DEFINE_FLAGOS_REDUCTION(max, f32);
+
+DEFINE_FLAGOS_REDUCTION(and, i32);
+DEFINE_FLAGOS_REDUCTION(or, i32);
+DEFINE_FLAGOS_REDUCTION(xor, i32);
+
 // "Element", "component" are different concepts
 
 void clear_list(LLVMRuntime *runtime, StructMeta *parent, StructMeta *child) {
@@ -1332,7 +1553,7 @@ void element_listgen_nonroot(LLVMRuntime *runtime,
                              StructMeta *parent,
                              StructMeta *child) {
   auto parent_list = runtime->element_lists[parent->snode_id];
-  int num_parent_elements = parent_list->size();
+  i64 num_parent_elements = parent_list->size();
   auto child_list = runtime->element_lists[child->snode_id];
   // Cache the func pointers here for better compiler optimization
   auto parent_refine_coordinates = parent->refine_coordinates;
@@ -1342,18 +1563,18 @@ void element_listgen_nonroot(LLVMRuntime *runtime,
   auto child_from_parent_element = child->from_parent_element;
 #if ARCH_cuda || ARCH_amdgpu
   // Each block processes a slice of a parent container
-  int i_start = block_idx();
-  int i_step = grid_dim();
+  i64 i_start = block_idx();
+  i64 i_step = grid_dim();
   // Each thread processes an element of the parent container
   int j_start = thread_idx();
   int j_step = block_dim();
 #else
-  int i_start = 0;
-  int i_step = 1;
+  i64 i_start = 0;
+  i64 i_step = 1;
   int j_start = 0;
   int j_step = 1;
 #endif
-  for (int i = i_start; i < num_parent_elements; i += i_step) {
+  for (i64 i = i_start; i < num_parent_elements; i += i_step) {
     auto element = parent_list->get<Element>(i);
     int j_lower = element.loop_bounds[0] + j_start;
     int j_higher = element.loop_bounds[1];
@@ -1384,41 +1605,148 @@ void element_listgen_nonroot(LLVMRuntime *runtime,
 
 using BlockTask = void(RuntimeContext *, char *, Element *, int, int);
 
+using range_for_xlogue = void (*)(RuntimeContext *, /*TLS*/ char *tls_base);
+using mesh_for_xlogue = void (*)(RuntimeContext *,
+                                 /*TLS*/ char *tls_base,
+                                 uint32_t patch_idx);
+
+// Thread-local storage of CPU parallel-fors.
+//
+// Instead of a fresh TLS buffer for every block, each CPU thread owns a slot
+// in runtime->cpu_tls_buffer that lives as long as the runtime (and thus the
+// thread pool). The TLS prologue runs when a thread picks up its first block
+// in a launch, and the epilogue (e.g. the atomic flush of a reduction) runs
+// once per participating thread after the launch, instead of once per block.
+//
+// Every slot starts with a header holding the id of the last launch that ran
+// the prologue on it. Only the owning thread touches a slot during a launch.
+constexpr std::size_t cpu_tls_slot_header_size = 64;
+
+struct cpu_tls_launch_context {
+  RuntimeContext *context;
+  range_for_xlogue prologue;
+  Ptr base;
+  std::size_t stride;
+  i64 launch_id;
+  int num_slots;
+
+  void begin(RuntimeContext *context,
+             range_for_xlogue prologue,
+             std::size_t tls_size,
+             int num_threads) {
+    auto runtime = context->runtime;
+    this->context = context;
+    this->prologue = prologue;
+    // Keep slots on separate cache lines.
+    stride = cpu_tls_slot_header_size +
+             taichi::iroundup(std::max(tls_size, (std::size_t)1),
+                              cpu_tls_slot_header_size);
+    num_slots = std::max(num_threads, 1);
+    auto required = stride * num_slots;
+    if (runtime->cpu_tls_buffer_size < required) {
+      // Grows rarely: TLS sizes are fixed at compile time.
+      runtime->cpu_tls_buffer = runtime->allocate_aligned(
+          runtime->runtime_memory_chunk, required, cpu_tls_slot_header_size);
+      runtime->cpu_tls_buffer_size = required;
+      for (int i = 0; i < num_slots; i++) {
+        *(i64 *)(runtime->cpu_tls_buffer + i * stride) = 0;
+      }
+    }
+    base = runtime->cpu_tls_buffer;
+    launch_id = ++runtime->cpu_tls_launch_id;
+  }
+
+  char *acquire(int thread_id) {
+    auto slot = base + thread_id * stride;
+    auto tls = (char *)slot + cpu_tls_slot_header_size;
+    if (*(i64 *)slot != launch_id) {
+      *(i64 *)slot = launch_id;
+      if (prologue)
+        prologue(context, tls);
+    }
+    return tls;
+  }
+
+  void end(range_for_xlogue epilogue) {
+    if (!epilogue)
+      return;
+    for (int i = 0; i < num_slots; i++) {
+      auto slot = base + i * stride;
+      if (*(i64 *)slot == launch_id)
+        epilogue(context, (char *)slot + cpu_tls_slot_header_size);
+    }
+  }
+};
+
 struct cpu_block_task_helper_context {
   RuntimeContext *context;
   BlockTask *task;
   ListManager *list;
   int element_size;
   int element_split;
-  std::size_t tls_buffer_size;
+  // Number of (element, part) pairs, and how many of them each thread pool
+  // task covers. The latter is only above 1 when the pairs would not fit in
+  // the 32-bit task ids of the thread pool.
+  i64 num_parts;
+  i64 parts_per_task;
+  cpu_tls_launch_context tls;
 };
 
 // TODO: To enforce inlining, we need to create in LLVM a new function that
 // calls block_helper and the BLS xlogues, and pass that function to the
 // scheduler.
 
-// TODO: TLS should be directly passed to the scheduler, so that it lives
-// with the threads (instead of blocks).
-
-void cpu_struct_for_block_helper(void *ctx_, int thread_id, int i) {
+void cpu_struct_for_block_helper(void *ctx_, int thread_id, int task_id) {
   auto ctx = (cpu_block_task_helper_context *)(ctx_);
-  int element_id = i / ctx->element_split;
   int part_size = ctx->element_size / ctx->element_split;
-  int part_id = i % ctx->element_split;
-  auto &e = ctx->list->get<Element>(element_id);
-  int lower = e.loop_bounds[0] + part_id * part_size;
-  int upper = e.loop_bounds[0] + (part_id + 1) * part_size;
-  upper = std::min(upper, e.loop_bounds[1]);
-  alignas(8) char tls_buffer[ctx->tls_buffer_size];
-
   RuntimeContext this_thread_context = *ctx->context;
   this_thread_context.cpu_thread_id = thread_id;
-  if (lower < upper) {
-    (*ctx->task)(&this_thread_context, tls_buffer,
-                 &ctx->list->get<Element>(element_id), lower, upper);
+  const i64 begin = task_id * ctx->parts_per_task;
+  const i64 end = min_i64(begin + ctx->parts_per_task, ctx->num_parts);
+  for (i64 i = begin; i < end; i++) {
+    i64 element_id = i / ctx->element_split;
+    int part_id = int(i % ctx->element_split);
+    auto &e = ctx->list->get<Element>(element_id);
+    int lower = e.loop_bounds[0] + part_id * part_size;
+    int upper = e.loop_bounds[0] + (part_id + 1) * part_size;
+    upper = std::min(upper, e.loop_bounds[1]);
+    if (lower < upper) {
+      (*ctx->task)(&this_thread_context, ctx->tls.acquire(thread_id), &e,
+                   lower, upper);
+    }
   }
 }
 
+void cpu_parallel_struct_for(RuntimeContext *context,
+                             int snode_id,
+                             int element_size,
+                             int element_split,
+                             BlockTask *task,
+                             range_for_xlogue prologue,
+                             range_for_xlogue epilogue,
+                             std::size_t tls_buffer_size,
+                             int num_threads) {
+  auto runtime = context->runtime;
+  auto list = runtime->element_lists[snode_id];
+  auto list_tail = list->size();
+  cpu_block_task_helper_context ctx;
+  ctx.context = context;
+  ctx.task = task;
+  ctx.list = list;
+  ctx.element_size = element_size;
+  ctx.element_split = element_split;
+  ctx.num_parts = list_tail * element_split;
+  // Keep the number of thread pool tasks within int range.
+  constexpr i64 max_num_tasks = 1 << 30;
+  ctx.parts_per_task = (ctx.num_parts + max_num_tasks - 1) / max_num_tasks;
+  ctx.tls.begin(context, prologue, tls_buffer_size, num_threads);
+  runtime->parallel_for(
+      runtime->thread_pool,
+      int((ctx.num_parts + ctx.parts_per_task - 1) / ctx.parts_per_task),
+      num_threads, &ctx, cpu_struct_for_block_helper);
+  ctx.tls.end(epilogue);
+}
+
 void parallel_struct_for(RuntimeContext *context,
                          int snode_id,
                          int element_size,
@@ -1429,7 +1757,7 @@ void parallel_struct_for(RuntimeContext *context,
   auto list = (context->runtime)->element_lists[snode_id];
   auto list_tail = list->size();
 #if ARCH_cuda || ARCH_amdgpu
-  int i = block_idx();
+  i64 i = block_idx();
   // Note: CUDA requires compile-time constant local array sizes.
   // We use "1" here and modify it during codegen to tls_buffer_size.
   alignas(8) char tls_buffer[1];
@@ -1437,7 +1765,7 @@ void parallel_struct_for(RuntimeContext *context,
   element_split = 1;
   const auto part_size = element_size / element_split;
   while (true) {
-    int element_id = i / element_split;
+    i64 element_id = i / element_split;
     if (element_id >= list_tail)
       break;
     auto part_id = i % element_split;
@@ -1450,30 +1778,17 @@ void parallel_struct_for(RuntimeContext *context,
     i += grid_dim();
   }
 #else
-  cpu_block_task_helper_context ctx;
-  ctx.context = context;
-  ctx.task = task;
-  ctx.list = list;
-  ctx.element_size = element_size;
-  ctx.element_split = element_split;
-  ctx.tls_buffer_size = tls_buffer_size;
-  auto runtime = context->runtime;
-  runtime->parallel_for(runtime->thread_pool, list_tail * element_split,
-                        num_threads, &ctx, cpu_struct_for_block_helper);
+  // The CPU codegen calls cpu_parallel_struct_for directly. Tasks reaching
+  // here run their TLS xlogues inside the block body.
+  cpu_parallel_struct_for(context, snode_id, element_size, element_split, task,
+                          nullptr, nullptr, tls_buffer_size, num_threads);
 #endif
 }
 
-using range_for_xlogue = void (*)(RuntimeContext *, /*TLS*/ char *tls_base);
-using mesh_for_xlogue = void (*)(RuntimeContext *,
-                                 /*TLS*/ char *tls_base,
-                                 uint32_t patch_idx);
-
 struct range_task_helper_context {
   RuntimeContext *context;
-  range_for_xlogue prologue{nullptr};
   RangeForTaskFunc *body{nullptr};
-  range_for_xlogue epilogue{nullptr};
-  std::size_t tls_size{1};
+  cpu_tls_launch_context tls;
   int begin;
   int end;
   int block_size;
@@ -1483,11 +1798,8 @@ struct range_task_helper_context {
 void cpu_parallel_range_for_task(void *range_context,
                                  int thread_id,
                                  int task_id) {
-  auto ctx = *(range_task_helper_context *)range_context;
-  alignas(8) char tls_buffer[ctx.tls_size];
-  auto tls_ptr = &tls_buffer[0];
-  if (ctx.prologue)
-    ctx.prologue(ctx.context, tls_ptr);
+  auto &ctx = *(range_task_helper_context *)range_context;
+  auto tls_ptr = ctx.tls.acquire(thread_id);
 
   RuntimeContext this_thread_context = *ctx.context;
   this_thread_context.cpu_thread_id = thread_id;
@@ -1504,8 +1816,6 @@ void cpu_parallel_range_for_task(void *range_context,
       ctx.body(&this_thread_context, tls_ptr, i);
     }
   }
-  if (ctx.epilogue)
-    ctx.epilogue(ctx.context, tls_ptr);
 }
 
 void cpu_parallel_range_for(RuntimeContext *context,
@@ -1520,10 +1830,7 @@ void cpu_parallel_range_for(RuntimeContext *context,
                             std::size_t tls_size) {
   range_task_helper_context ctx;
   ctx.context = context;
-  ctx.prologue = prologue;
-  ctx.tls_size = tls_size;
   ctx.body = body;
-  ctx.epilogue = epilogue;
   ctx.begin = begin;
   ctx.end = end;
   ctx.step = step;
@@ -1532,10 +1839,98 @@ void cpu_parallel_range_for(RuntimeContext *context,
     exit(-1);
   }
   ctx.block_size = block_dim;
+  ctx.tls.begin(context, prologue, tls_size, num_threads);
   auto runtime = context->runtime;
   runtime->parallel_for(runtime->thread_pool,
                         (end - begin + block_dim - 1) / block_dim, num_threads,
                         &ctx, cpu_parallel_range_for_task);
+  ctx.tls.end(epilogue);
+}
+
+// Guided self-scheduling of CPU range-fors. Instead of fixed blocks, every
+// thread repeatedly grabs max(min_chunk, remaining / (2 * num_threads))
+// iterations from a shared cursor: chunks start large and shrink as the range
+// runs out, so threads hitting expensive iterations late in the launch do not
+// hold up everyone else with a large static block.
+struct guided_range_task_helper_context {
+  RuntimeContext *context;
+  RangeForTaskFunc *body{nullptr};
+  cpu_tls_launch_context tls;
+  int begin;
+  int end;
+  int step;
+  int num_threads;
+  int min_chunk;
+  // Number of iterations already handed out.
+  i32 cursor;
+};
+
+void cpu_parallel_range_for_guided_task(void *range_context,
+                                        int thread_id,
+                                        int task_id) {
+  auto &ctx = *(guided_range_task_helper_context *)range_context;
+  auto tls_ptr = ctx.tls.acquire(thread_id);
+
+  RuntimeContext this_thread_context = *ctx.context;
+  this_thread_context.cpu_thread_id = thread_id;
+  const i32 total = ctx.end - ctx.begin;
+  while (true) {
+    i32 chunk_begin = __atomic_load_n(&ctx.cursor, __ATOMIC_RELAXED);
+    i32 chunk_end;
+    do {
+      if (chunk_begin >= total)
+        return;
+      auto chunk = std::max((total - chunk_begin) / (2 * ctx.num_threads),
+                            ctx.min_chunk);
+      chunk_end = std::min(chunk_begin + chunk, total);
+    } while (!__atomic_compare_exchange(
+        &ctx.cursor, &chunk_begin, &chunk_end, true,
+        std::memory_order::memory_order_relaxed,
+        std::memory_order::memory_order_relaxed));
+    if (ctx.step == 1) {
+      for (int i = ctx.begin + chunk_begin; i < ctx.begin + chunk_end; i++) {
+        ctx.body(&this_thread_context, tls_ptr, i);
+      }
+    } else {
+      for (int i = ctx.end - 1 - chunk_begin; i >= ctx.end - chunk_end; i--) {
+        ctx.body(&this_thread_context, tls_ptr, i);
+      }
+    }
+  }
+}
+
+void cpu_parallel_range_for_guided(RuntimeContext *context,
+                                   int num_threads,
+                                   int begin,
+                                   int end,
+                                   int step,
+                                   int min_chunk,
+                                   range_for_xlogue prologue,
+                                   RangeForTaskFunc *body,
+                                   range_for_xlogue epilogue,
+                                   std::size_t tls_size) {
+  guided_range_task_helper_context ctx;
+  ctx.context = context;
+  ctx.body = body;
+  ctx.begin = begin;
+  ctx.end = end;
+  ctx.step = step;
+  if (step != 1 && step != -1) {
+    taichi_printf(context->runtime, "step must not be %d\n", step);
+    exit(-1);
+  }
+  if (end <= begin)
+    return;
+  ctx.num_threads = std::max(num_threads, 1);
+  ctx.min_chunk = std::max(min_chunk, 1);
+  ctx.cursor = 0;
+  ctx.tls.begin(context, prologue, tls_size, num_threads);
+  auto runtime = context->runtime;
+  // One task per thread; each task keeps grabbing chunks until the range is
+  // exhausted.
+  runtime->parallel_for(runtime->thread_pool, ctx.num_threads, num_threads,
+                        &ctx, cpu_parallel_range_for_guided_task);
+  ctx.tls.end(epilogue);
 }
 
 void gpu_parallel_range_for(RuntimeContext *context,
@@ -1658,21 +2053,30 @@ i32 linear_thread_idx(RuntimeContext *context) {
 #include "node_dense.h"
 #include "node_dynamic.h"
 #include "node_pointer.h"
+#include "node_hash.h"
 #include "node_root.h"
 #include "node_bitmasked.h"
 
 void ListManager::touch_chunk(int chunk_id) {
   taichi_assert_runtime(runtime, chunk_id < max_num_chunks,
                         "List manager out of chunks.");
-  if (!chunks[chunk_id]) {
+  if (!get_chunk(chunk_id)) {
     locked_task(&lock, [&] {
       // may have been allocated during lock contention
-      if (!chunks[chunk_id]) {
+      auto &table = chunk_tables[chunk_id >> log2_chunk_table_size];
+      if (!table) {
+        auto table_ptr =
+            runtime->allocate_object(chunk_table_size * sizeof(Ptr));
+        grid_memfence();
+        atomic_exchange_u64((u64 *)&table, (u64)table_ptr);
+      }
+      auto &chunk = table[chunk_id & (chunk_table_size - 1)];
+      if (!chunk) {
         grid_memfence();
         auto chunk_ptr = runtime->allocate_aligned(
             runtime->runtime_memory_chunk,
             max_num_elements_per_chunk * element_size, 4096, true /*request*/);
-        atomic_exchange_u64((u64 *)&chunks[chunk_id], (u64)chunk_ptr);
+        atomic_exchange_u64((u64 *)&chunk, (u64)chunk_ptr);
       }
     });
   }
@@ -1688,8 +2092,95 @@ Ptr ListManager::allocate() {
   return get_element_ptr(i);
 }
 
+// Parallel GC on the CPU thread pool, in two launches:
+//  1. Compaction: the unused tail [free_list_used, size) of the free list is
+//     moved to the front. Like gc_parallel_impl_0, only the entries that do not
+//     already sit in the new range are moved, so sources and destinations
+//     never overlap.
+//  2. Recycling: recycled element k is zero-filled and stored at position
+//     num_unused + k of the free list.
+struct node_gc_cpu_context {
+  NodeManager *allocator;
+  i64 num_to_move;
+  i64 move_src;
+  i64 num_unused;
+  i64 num_recycled;
+  i64 items_per_task;
+};
+
+void node_gc_cpu_compact_task(void *ctx_, int thread_id, int task_id) {
+  auto ctx = (node_gc_cpu_context *)ctx_;
+  auto free_list = ctx->allocator->free_list;
+  using T = NodeManager::list_data_type;
+  auto begin = task_id * ctx->items_per_task;
+  auto end = min_i64(begin + ctx->items_per_task, ctx->num_to_move);
+  for (i64 i = begin; i < end; i++) {
+    free_list->get<T>(i) = free_list->get<T>(ctx->move_src + i);
+  }
+}
+
+void node_gc_cpu_recycle_task(void *ctx_, int thread_id, int task_id) {
+  auto ctx = (node_gc_cpu_context *)ctx_;
+  auto allocator = ctx->allocator;
+  using T = NodeManager::list_data_type;
+  auto begin = task_id * ctx->items_per_task;
+  auto end = min_i64(begin + ctx->items_per_task, ctx->num_recycled);
+  for (i64 i = begin; i < end; i++) {
+    auto ptr = allocator->recycled_list->get<T>(i);
+    std::memset(ptr, 0, allocator->element_size);
+    allocator->free_list->get<T>(ctx->num_unused + i) = ptr;
+  }
+}
+
+void NodeManager::gc_parallel_cpu() {
+  // Below this many bytes of work, waking up the thread pool costs more than
+  // it saves.
+  constexpr i64 min_parallel_bytes = 256 * 1024;
+  constexpr i64 bytes_per_task = 32 * 1024;
+  const i64 free_list_size = free_list->size();
+  const i64 num_unused = max_i64(free_list_size - free_list_used, 0);
+  const i64 num_recycled = recycled_list->size();
+  if (runtime->thread_pool == nullptr ||
+      (i64)num_recycled * element_size < min_parallel_bytes) {
+    gc_serial();
+    return;
+  }
+
+  node_gc_cpu_context ctx;
+  ctx.allocator = this;
+  if (num_unused > 0 && free_list_used > 0) {
+    if (free_list_used >= num_unused) {
+      ctx.num_to_move = num_unused;
+      ctx.move_src = free_list_used;
+    } else {
+      ctx.num_to_move = free_list_used;
+      ctx.move_src = num_unused;
+    }
+    ctx.items_per_task = bytes_per_task / sizeof(list_data_type);
+    int splits =
+        int((ctx.num_to_move + ctx.items_per_task - 1) / ctx.items_per_task);
+    runtime->parallel_for(runtime->thread_pool, splits, splits, &ctx,
+                          node_gc_cpu_compact_task);
+  }
+
+  free_list_used = 0;
+  free_list->resize_and_touch(num_unused + num_recycled);
+  ctx.num_unused = num_unused;
+  ctx.num_recycled = num_recycled;
+  ctx.items_per_task = max_i64(bytes_per_task / element_size, 1);
+  int splits =
+      int((num_recycled + ctx.items_per_task - 1) / ctx.items_per_task);
+  runtime->parallel_for(runtime->thread_pool, splits, splits, &ctx,
+                        node_gc_cpu_recycle_task);
+  recycled_list->clear();
+}
+
 void node_gc(LLVMRuntime *runtime, int snode_id) {
+#if ARCH_x64 || ARCH_arm64
+  runtime->node_allocators[snode_id]->gc_parallel_cpu();
+#else
   runtime->node_allocators[snode_id]->gc_serial();
+#endif
 }
 
 void gc_parallel_impl_0(RuntimeContext *context, NodeManager *allocator) {
@@ -1699,7 +2190,7 @@ void gc_parallel_impl_0(RuntimeContext *context, NodeManager *allocator) {
   using T = NodeManager::list_data_type;
 
   // Move unused elements to the beginning of the free_list
-  int i = linear_thread_idx(context);
+  i64 i = linear_thread_idx(context);
   if (free_list_used * 2 > free_list_size) {
     // Directly copy. Dst and src does not overlap
     auto items_to_copy = free_list_size - free_list_used;
@@ -1726,8 +2217,8 @@ void gc_parallel_0(RuntimeContext *context, int snode_id) {
 void gc_parallel_impl_1(NodeManager *allocator) {
   auto free_list = allocator->free_list;
 
-  const i32 num_unused =
-      max_i32(free_list->size() - allocator->free_list_used, 0);
+  const i64 num_unused =
+      max_i64(free_list->size() - allocator->free_list_used, 0);
   free_list->resize(num_unused);
 
   allocator->free_list_used = 0;
@@ -1744,15 +2235,13 @@ void gc_parallel_impl_2(NodeManager *allocator) {
   auto elements = allocator->recycle_list_size_backup;
   auto free_list = allocator->free_list;
   auto recycled_list = allocator->recycled_list;
-  auto data_list = allocator->data_list;
   auto element_size = allocator->element_size;
   using T = NodeManager::list_data_type;
-  auto i = block_idx();
+  i64 i = block_idx();
   while (i < elements) {
-    auto idx = recycled_list->get<T>(i);
-    auto ptr = data_list->get_element_ptr(idx);
+    auto ptr = recycled_list->get<T>(i);
     if (thread_idx() == 0) {
-      free_list->push_back(idx);
+      free_list->push_back(ptr);
     }
     // memset
     auto ptr_stop = ptr + element_size;
@@ -1,7 +1,6 @@
 #pragma once
 
 #include "taichi/codegen/llvm/kernel_compiler.h"
-#include "taichi/codegen/flagos/codegen_flagos.h"
 
 namespace taichi {
 namespace lang {
@@ -10,45 +9,19 @@ namespace flagos {
 /**
  * @brief FlagOS Kernel Compiler
  *
- * Compiles Taichi kernels to LLVM IR for FlagOS backend.
- * Uses FlagTree to compile LLVM IR to target chip code.
+ * Compiles Taichi kernels to LLVM IR for FlagOS backend. The code generator
+ * is picked by KernelCodeGen::create() from the arch, so the compilation
+ * itself is shared with the other LLVM backends.
+ *
+ * TODO: Use FlagTree to compile LLVM IR to target chip code. Until then, the
+ * modules are only executed on the "sim" chip, which JITs them for the host.
  */
 
 class KernelCompiler : public LLVM::KernelCompiler {
  public:
-  using IRNode = taichi::lang::IRNode;
   using Config = LLVM::KernelCompiler::Config;
 
   explicit KernelCompiler(Config config);
-
-  /**
-   * @brief Compile a kernel to FlagOS executable format
-   */
-  LLVM::CompiledKernelData compile(const CompileConfig &compile_config,
-                                   const DeviceCapabilityConfig &device_caps,
-                                   const Kernel &kernel,
-                                   IRNode *ir) override;
-
-  /**
-   * @brief Compile a kernel with cached data
-   */
-  LLVM::CompiledKernelData compile(
-      const CompileConfig &compile_config,
-      const DeviceCapabilityConfig &device_caps,
-      const Kernel &kernel,
-      IRNode *ir,
-      const LLVM::CompiledKernelData &cached_data) override;
-
- private:
-  Config config_;
-
-  /**
-   * @brief Compile kernel using FlagTree
-   */
-  LLVM::CompiledKernelData compile_with_flagtree(
-      const CompileConfig &compile_config,
-      const Kernel &kernel,
-      IRNode *ir);
 };
 
 }  // namespace flagos
@@ -1,57 +1,204 @@
 #include "taichi/runtime/program_impls/flagos/flagos_kernel_launcher.h"
 
 #include "taichi/rhi/flagos/flagos_device.h"
+#include "taichi/rhi/flagos/flagos_sim.h"
 #include "taichi/runtime/llvm/llvm_runtime_executor.h"
-#include "taichi/program/kernel.h"
 
 namespace taichi {
 namespace lang {
 namespace flagos {
 
-KernelLauncher::KernelLauncher(Config config) : config_(std::move(config)) {
+namespace {
+
+using TaskFunc = void (*)(RuntimeContext *);
+
+struct SimTaskContext {
+  TaskFunc func{nullptr};
+  RuntimeContext *context{nullptr};
+};
+
+// Runs one simulated thread of a task. Every thread gets its own copy of the
+// context, whose cpu_thread_id is the linear SPMD thread index: the host
+// runtime picks the random states of a thread by it.
+void run_sim_thread(void *task_context) {
+  auto &task = *(SimTaskContext *)task_context;
+  const auto &dims = SimContext::current_dims();
+  RuntimeContext context = *task.context;
+  context.cpu_thread_id = dims.block_idx * dims.block_dim + dims.thread_idx;
+  task.func(&context);
+}
+
+DeviceAllocation copy_to_device(LlvmRuntimeExecutor *executor,
+                                const void *data,
+                                std::size_t size,
+                                uint64 *result_buffer) {
+  auto devalloc = executor->allocate_memory_on_device(size, result_buffer);
+  DevicePtr dst = devalloc.get_ptr(0);
+  TI_ASSERT(devalloc.device->upload_data(&dst, &data, &size) ==
+            RhiResult::success);
+  return devalloc;
 }
 
-void KernelLauncher::launch_kernel(
-    LlvmLaunchArgBuilder &arg_builder,
-    Kernel *kernel,
-    const LLVM::CompiledKernelData &compiled_kernel) {
-  // Get the FlagOS device
-  auto *device =
-      static_cast<FlagosDevice *>(config_.executor->get_compute_device());
-  TI_ASSERT(device);
+void copy_to_host(void *data, DeviceAllocation devalloc, std::size_t size) {
+  DevicePtr src = devalloc.get_ptr(0);
+  TI_ASSERT(devalloc.device->readback_data(&src, &data, &size) ==
+            RhiResult::success);
+}
+
+}  // namespace
+
+void KernelLauncher::launch_llvm_kernel(Handle handle,
+                                        LaunchContextBuilder &ctx) {
+  TI_ASSERT(handle.get_launch_id() < contexts_.size());
+  const auto &launcher_ctx = contexts_[handle.get_launch_id()];
+  auto *executor = get_runtime_executor();
+  auto *device = executor->llvm_device()->as<FlagosDevice>();
+  TI_ERROR_IF(!device->is_simulated(),
+              "Launching kernels on FlagOS chip {} requires FlagTree",
+              device->get_target_chip());
 
-  // Get kernel data
-  const auto &kernel_data = compiled_kernel.get_internal_data();
-  const auto &task_funcs = kernel_data.tasks;
-  const auto &args = kernel_data.args;
+  ctx.get_context().runtime = executor->get_llvm_runtime();
+  auto *result_buffer = (uint64 *)ctx.get_context().result_buffer;
 
-  // Prepare launch arguments
-  std::vector<void *> arg_pointers;
-  arg_pointers.reserve(args.size());
+  // External arrays live on the host. They are copied into temporary device
+  // allocations, and back once the kernel finishes. Key is the index of the
+  // data or grad pointer, value is [host_ptr, temporary_device_alloc].
+  std::unordered_map<std::vector<int>, std::pair<void *, DeviceAllocation>,
+                     hashing::Hasher<std::vector<int>>>
+      transfers;
 
-  for (const auto &arg : args) {
-    arg_pointers.push_back(const_cast<void *>(arg.data));
+  const auto &parameters = launcher_ctx.parameters;
+  for (int i = 0; i < (int)parameters.size(); i++) {
+    const auto &kv = parameters[i];
+    const auto &key = kv.first;
+    const auto &parameter = kv.second;
+    if (parameter.is_array) {
+      const auto arr_sz = ctx.array_runtime_sizes[key];
+      if (arr_sz == 0) {
+        continue;
+      }
+      std::vector<int> data_ptr_idx = key;
+      data_ptr_idx.push_back(TypeFactory::DATA_PTR_POS_IN_NDARRAY);
+      std::vector<int> grad_ptr_idx = key;
+      grad_ptr_idx.push_back(TypeFactory::GRAD_PTR_POS_IN_NDARRAY);
+      void *data_ptr = ctx.array_ptrs[data_ptr_idx];
+      void *grad_ptr = ctx.array_ptrs[grad_ptr_idx];
+
+      uint64 device_data_ptr = 0;
+      uint64 device_grad_ptr = 0;
+      if (ctx.device_allocation_type[key] ==
+          LaunchContextBuilder::DevAllocType::kNone) {
+        // External array
+        auto devalloc =
+            copy_to_device(executor, data_ptr, arr_sz, result_buffer);
+        transfers[data_ptr_idx] = {data_ptr, devalloc};
+        device_data_ptr = (uint64)executor->get_device_alloc_info_ptr(devalloc);
+        if (grad_ptr != nullptr) {
+          auto grad_devalloc =
+              copy_to_device(executor, grad_ptr, arr_sz, result_buffer);
+          transfers[grad_ptr_idx] = {grad_ptr, grad_devalloc};
+          device_grad_ptr =
+              (uint64)executor->get_device_alloc_info_ptr(grad_devalloc);
+        }
+      } else {
+        // Ndarray
+        device_data_ptr = (uint64)executor->get_device_alloc_info_ptr(
+            *static_cast<DeviceAllocation *>(data_ptr));
+        if (grad_ptr != nullptr) {
+          device_grad_ptr = (uint64)executor->get_device_alloc_info_ptr(
+              *static_cast<DeviceAllocation *>(grad_ptr));
+        }
+      }
+      ctx.set_ndarray_ptrs(key, device_data_ptr, device_grad_ptr);
+    } else if (parameter.is_argpack) {
+      auto *argpack = ctx.argpack_ptrs[key];
+      auto device_ptr = (uint64)executor->get_device_alloc_info_ptr(
+          argpack->get_device_allocation());
+      if (key.size() == 1) {
+        ctx.set_argpack_ptr(key, device_ptr);
+      } else {
+        auto key_parent = key;
+        key_parent.pop_back();
+        auto *argpack_parent = ctx.argpack_ptrs[key_parent];
+        argpack_parent->set_arg_nested_argpack_ptr(key.back(), device_ptr);
+      }
+    }
   }
 
-  // Launch each task (offloaded kernel)
-  for (const auto &task : task_funcs) {
-    const std::string &kernel_name = task.name;
-    uint32_t grid_dim = task.grid_dim;
-    uint32_t block_dim = task.block_dim;
+  // The argument and result buffers are moved to the device as well
+  char *host_arg_buffer = ctx.get_context().arg_buffer;
+  DeviceAllocation device_arg_buffer;
+  if (ctx.arg_buffer_size > 0) {
+    device_arg_buffer = copy_to_device(executor, host_arg_buffer,
+                                       ctx.arg_buffer_size, result_buffer);
+    ctx.get_context().arg_buffer =
+        (char *)executor->get_device_alloc_info_ptr(device_arg_buffer);
+  }
+  DeviceAllocation device_result_buffer;
+  if (ctx.result_buffer_size > 0) {
+    device_result_buffer =
+        executor->allocate_memory_on_device(ctx.result_buffer_size,
+                                            result_buffer);
+    ctx.get_context().result_buffer =
+        executor->get_device_alloc_info_ptr(device_result_buffer);
+  }
 
-    TI_TRACE("Launching FlagOS kernel: {}, grid_dim: {}, block_dim: {}",
-             kernel_name, grid_dim, block_dim);
+  for (int i = 0; i < (int)launcher_ctx.offloaded_tasks.size(); i++) {
+    const auto &task = launcher_ctx.offloaded_tasks[i];
+    TI_TRACE("Launching kernel {}<<<{}, {}>>> on the FlagOS simulator",
+             task.name, task.grid_dim, task.block_dim);
+    SimTaskContext sim_task;
+    sim_task.func = (TaskFunc)launcher_ctx.task_funcs[i];
+    sim_task.context = &ctx.get_context();
+    device->launch_kernel((void *)&run_sim_thread, &sim_task, task.grid_dim,
+                          task.block_dim);
+  }
 
-    // Launch kernel via FlagOS device
-    // This will call FlagTree to compile and execute the kernel
-    device->launch_kernel(kernel_name, arg_pointers.data(), grid_dim,
-                          block_dim);
+  ctx.get_context().arg_buffer = host_arg_buffer;
+  if (ctx.arg_buffer_size > 0) {
+    executor->deallocate_memory_on_device(device_arg_buffer);
+  }
+  ctx.get_context().result_buffer = result_buffer;
+  if (ctx.result_buffer_size > 0) {
+    copy_to_host(result_buffer, device_result_buffer, ctx.result_buffer_size);
+    executor->deallocate_memory_on_device(device_result_buffer);
   }
+  for (auto &[idx, transfer] : transfers) {
+    auto arg_id = idx;
+    arg_id.pop_back();
+    copy_to_host(transfer.first, transfer.second,
+                 ctx.array_runtime_sizes[arg_id]);
+    executor->deallocate_memory_on_device(transfer.second);
+  }
+}
+
+KernelLauncher::Handle KernelLauncher::register_llvm_kernel(
+    const LLVM::CompiledKernelData &compiled) {
+  TI_ASSERT(compiled.arch() == Arch::flagos);
+
+  if (!compiled.get_handle()) {
+    auto handle = make_handle();
+    auto index = handle.get_launch_id();
+    contexts_.resize(index + 1);
+
+    auto &ctx = contexts_[index];
+    auto *executor = get_runtime_executor();
+
+    auto data = compiled.get_internal_data().compiled_data.clone();
+    // TODO: Hand the module over to FlagTree on the chips
+    auto *jit_module = executor->create_jit_module(std::move(data.module));
+    for (auto &task : data.tasks) {
+      auto *func_ptr = jit_module->lookup_function(task.name);
+      TI_ASSERT_INFO(func_ptr, "Offloaded task function {} not found",
+                     task.name);
+      ctx.task_funcs.push_back(func_ptr);
+    }
+    ctx.parameters = compiled.get_internal_data().args;
+    ctx.offloaded_tasks = std::move(data.tasks);
 
-  // Synchronize if needed
-  if (kernel->program->compile_config().sync_after_kernel_launch) {
-    device->wait_idle();
+    compiled.set_handle(handle);
   }
+  return *compiled.get_handle();
 }
 
 }  // namespace flagos
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "taichi/codegen/llvm/compiled_kernel_data.h"
 #include "taichi/runtime/llvm/kernel_launcher.h"
 
 namespace taichi {
@@ -11,23 +12,31 @@ namespace flagos {
  *
  * This class handles kernel launching for FlagOS-supported AI chips.
  * It integrates with the FlagOS runtime to execute compiled kernels.
+ *
+ * On the "sim" chip, the kernels are JIT-compiled for the host and each
+ * offloaded task is launched on the simulator with its grid and block
+ * dimensions. Arguments go through the simulated device memory like they do
+ * on the chips.
  */
 
 class KernelLauncher : public LLVM::KernelLauncher {
- public:
-  using Config = LLVM::KernelLauncher::Config;
+  using Base = LLVM::KernelLauncher;
 
-  explicit KernelLauncher(Config config);
+  struct Context {
+    std::vector<std::pair<std::vector<int>, Callable::Parameter>> parameters;
+    std::vector<OffloadedTask> offloaded_tasks;
+    std::vector<void *> task_funcs;
+  };
+
+ public:
+  using Base::Base;
 
-  /**
-   * @brief Launch a kernel on FlagOS device
-   */
-  void launch_kernel(LlvmLaunchArgBuilder &arg_builder,
-                     Kernel *kernel,
-                     const LLVM::CompiledKernelData &compiled_kernel) override;
+  void launch_llvm_kernel(Handle handle, LaunchContextBuilder &ctx) override;
+  Handle register_llvm_kernel(
+      const LLVM::CompiledKernelData &compiled) override;
 
  private:
-  Config config_;
+  std::vector<Context> contexts_;
 };
 
 }  // namespace flagos
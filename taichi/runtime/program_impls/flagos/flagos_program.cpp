@@ -14,17 +14,8 @@ namespace lang {
 FlagosProgramImpl::FlagosProgramImpl(CompileConfig &config,
                                      KernelProfilerBase *profiler)
     : LlvmProgramImpl(config, profiler) {
-  // Initialize FlagOS-specific settings
-  if (config.flagos_chip.empty()) {
-    // Try to get from environment variable
-    const char *chip_env = std::getenv("TI_FLAGOS_CHIP");
-    if (chip_env) {
-      config.flagos_chip = chip_env;
-    } else {
-      config.flagos_chip = "generic";  // Default chip
-    }
-  }
-
+  // TI_FLAGOS_CHIP has been applied by CompileConfig::fit(), and the device
+  // is initialized for the chip by the runtime executor.
   TI_INFO("FlagosProgramImpl created with chip: {}", config.flagos_chip);
 
   // Validate chip name
@@ -37,15 +28,7 @@ FlagosProgramImpl::~FlagosProgramImpl() {
   // Cleanup is handled by base class
 }
 
-void FlagosProgramImpl::initialize_flagos_backend() {
-  auto *device = static_cast<flagos::FlagosDevice *>(llvm_device());
-  if (device) {
-    device->initialize(config_.flagos_chip);
-    TI_INFO("FlagOS backend initialized for chip: {}", config_.flagos_chip);
-  }
-}
-
-bool FlagosProgramImpl::is_initialized() const {
+bool FlagosProgramImpl::is_initialized() {
   auto *device = static_cast<flagos::FlagosDevice *>(llvm_device());
   if (device) {
     return flagos::FlagosDevice::is_chip_supported(device->get_target_chip());
@@ -60,24 +43,14 @@ void FlagosProgramImpl::compile_snode_tree_types(SNodeTree *tree) {
 
 void FlagosProgramImpl::materialize_snode_tree(SNodeTree *tree,
                                                uint64 *result_buffer) {
-  // Initialize FlagOS backend on first materialization
-  static bool flagos_initialized = false;
-  if (!flagos_initialized) {
-    initialize_flagos_backend();
-    flagos_initialized = true;
-  }
-
   // Delegate to base class implementation
   LlvmProgramImpl::materialize_snode_tree(tree, result_buffer);
 }
 
 void FlagosProgramImpl::materialize_runtime(KernelProfilerBase *profiler,
                                             uint64 **result_buffer_ptr) {
-  // First initialize base LLVM runtime
+  // The FlagOS device has been initialized along with the runtime executor
   LlvmProgramImpl::materialize_runtime(profiler, result_buffer_ptr);
-
-  // Then initialize FlagOS-specific context
-  initialize_flagos_backend();
 }
 
 std::unique_ptr<KernelCompiler> FlagosProgramImpl::make_kernel_compiler() {
@@ -97,7 +70,7 @@ std::unique_ptr<AotModuleBuilder> FlagosProgramImpl::make_aot_module_builder(
   // Use LLVM AOT module builder for now
   // TODO: Create FlagOS-specific AOT module builder
   return std::make_unique<LlvmAotModuleBuilder>(
-      get_kernel_compilation_manager(), config_, this);
+      get_kernel_compilation_manager(), *config, this);
 }
 
 FlagosProgramImpl *get_flagos_program(Program *prog) {
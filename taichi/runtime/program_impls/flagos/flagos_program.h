@@ -64,20 +64,20 @@ class FlagosProgramImpl : public LlvmProgramImpl {
    * @brief Get the target chip for this program
    */
   std::string get_target_chip() const {
-    return config_.flagos_chip;
+    return config->flagos_chip;
   }
 
   /**
    * @brief Set the target chip for this program
    */
   void set_target_chip(const std::string &chip) {
-    config_.flagos_chip = chip;
+    config->flagos_chip = chip;
   }
 
   /**
    * @brief Check if FlagOS backend is properly initialized
    */
-  bool is_initialized() const;
+  bool is_initialized();
 
   ~FlagosProgramImpl() override;
 
@@ -86,9 +86,6 @@ class FlagosProgramImpl : public LlvmProgramImpl {
   std::unique_ptr<KernelLauncher> make_kernel_launcher() override;
   std::unique_ptr<AotModuleBuilder> make_aot_module_builder(
       const DeviceCapabilityConfig &caps) override;
-
- private:
-  void initialize_flagos_backend();
 };
 
 /**
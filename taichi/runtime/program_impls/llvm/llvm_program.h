@@ -121,11 +121,20 @@ class LlvmProgramImpl : public ProgramImpl {
     return runtime_exec_->fill_ndarray(alloc, size, data);
   }
 
+  void fill_new_allocation_with_zeros(const DeviceAllocation &alloc,
+                                      std::size_t size) override {
+    return runtime_exec_->fill_new_allocation_with_zeros(alloc, size);
+  }
+
   DeviceAllocation allocate_memory_on_device(std::size_t alloc_size,
                                              uint64 *result_buffer) override {
     return runtime_exec_->allocate_memory_on_device(alloc_size, result_buffer);
   }
 
+  DeviceAllocation import_memory(void *ptr, std::size_t size) override {
+    return llvm_device()->import_memory(ptr, size);
+  }
+
   Device *get_compute_device() override {
     return runtime_exec_->get_compute_device();
   }
@@ -0,0 +1,125 @@
+#include "taichi/system/numa.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+
+#include "taichi/common/core.h"
+#include "taichi/system/threading.h"
+
+#if defined(TI_PLATFORM_LINUX)
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace taichi {
+
+namespace {
+
+constexpr std::size_t kPageSize = 4096;
+// Buffers smaller than this are left to be placed by the kernels using them.
+// They may share pages with other allocations of the host memory pool.
+constexpr std::size_t kMinPlacedSize = 4 << 20;
+
+struct FirstTouchContext {
+  char *begin;
+  std::size_t size;
+  int num_slices;
+};
+
+void first_touch_slice(void *context, int thread_id, int i) {
+  auto &ctx = *(FirstTouchContext *)context;
+  // Page-aligned slices, in order, like the blocks of a range-for
+  std::size_t num_pages = ctx.size / kPageSize;
+  std::size_t begin = num_pages * i / ctx.num_slices * kPageSize;
+  std::size_t end = num_pages * (i + 1) / ctx.num_slices * kPageSize;
+  if (i == ctx.num_slices - 1) {
+    end = ctx.size;
+  }
+  for (std::size_t offset = begin; offset < end; offset += kPageSize) {
+    // The memory is already zero: writing a zero allocates the page without
+    // changing its contents
+    ((volatile char *)ctx.begin)[offset] = 0;
+  }
+}
+
+#if defined(TI_PLATFORM_LINUX)
+bool interleave_pages(void *ptr, std::size_t size, int num_nodes) {
+  constexpr int kMpolInterleave = 3;
+  constexpr int kMaxNodes = 64;
+  if (num_nodes > kMaxNodes) {
+    return false;
+  }
+  unsigned long node_mask =
+      num_nodes == kMaxNodes ? ~0ul : ((1ul << num_nodes) - 1);
+  return syscall(SYS_mbind, ptr, size, kMpolInterleave, &node_mask,
+                 kMaxNodes + 1, 0) == 0;
+}
+#endif
+
+}  // namespace
+
+NumaPolicy numa_policy_from_name(const std::string &name) {
+  if (name == "none") {
+    return NumaPolicy::none;
+  } else if (name == "first_touch") {
+    return NumaPolicy::first_touch;
+  } else if (name == "interleave") {
+    return NumaPolicy::interleave;
+  }
+  TI_ERROR(
+      "Unknown NUMA policy \"{}\", expected \"none\", \"first_touch\" or "
+      "\"interleave\"",
+      name);
+}
+
+int num_numa_nodes() {
+  static const int num_nodes = []() {
+    int count = 0;
+#if defined(TI_PLATFORM_LINUX)
+    if (DIR *dir = opendir("/sys/devices/system/node")) {
+      while (auto *entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() > 4 && name.compare(0, 4, "node") == 0 &&
+            std::all_of(name.begin() + 4, name.end(), ::isdigit)) {
+          count++;
+        }
+      }
+      closedir(dir);
+    }
+#endif
+    return std::max(count, 1);
+  }();
+  return num_nodes;
+}
+
+void place_host_memory(ThreadPool *thread_pool,
+                       void *ptr,
+                       std::size_t size,
+                       NumaPolicy policy,
+                       bool huge_pages) {
+  TI_ASSERT((uint64_t)ptr % kPageSize == 0);
+  if (size < kMinPlacedSize) {
+    return;
+  }
+#if defined(TI_PLATFORM_LINUX)
+  if (huge_pages && madvise(ptr, size, MADV_HUGEPAGE) != 0) {
+    TI_TRACE("madvise(MADV_HUGEPAGE) failed for {} bytes", size);
+  }
+  if (policy == NumaPolicy::interleave && num_numa_nodes() > 1 &&
+      interleave_pages(ptr, size, num_numa_nodes())) {
+    // The pages are placed by the kernel when they are touched
+    return;
+  }
+#endif
+  if (policy == NumaPolicy::none || thread_pool == nullptr) {
+    return;
+  }
+  FirstTouchContext ctx{(char *)ptr, size,
+                        thread_pool->get_max_num_threads()};
+  thread_pool->run(ctx.num_slices, ctx.num_slices, &ctx, first_touch_slice);
+}
+
+}  // namespace taichi
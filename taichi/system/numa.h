@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace taichi {
+
+class ThreadPool;
+
+// How the pages of large host buffers (SNode root buffers, ndarrays) are
+// placed on the NUMA nodes of the machine.
+enum class NumaPolicy {
+  // Leave the pages alone: each one lands on the node of the thread that
+  // first touches it, usually in the first kernel using the buffer.
+  none,
+  // Touch the pages in parallel from the thread pool, with the same
+  // contiguous partition as the CPU range-fors, so that each page lands on
+  // the node of the thread that will mostly work on it.
+  first_touch,
+  // Interleave the pages over all the nodes, for buffers without a stable
+  // access partition. Falls back to first_touch where unsupported.
+  interleave,
+};
+
+NumaPolicy numa_policy_from_name(const std::string &name);
+
+// The number of NUMA nodes with memory, 1 when it cannot be determined
+int num_numa_nodes();
+
+// Places the pages of [ptr, ptr + size) according to |policy|, if the range
+// is large enough to be worth it (a few MB). The memory
+// must be zero-filled and page-aligned, e.g. fresh from the host memory pool,
+// and keeps its contents: it is only written with zeros. With |huge_pages|,
+// the range is also advised to be backed by transparent huge pages (Linux
+// only).
+void place_host_memory(ThreadPool *thread_pool,
+                       void *ptr,
+                       std::size_t size,
+                       NumaPolicy policy,
+                       bool huge_pages);
+
+}  // namespace taichi
@@ -4,14 +4,37 @@
 *******************************************************************************/
 
 #include "taichi/system/threading.h"
+#include "taichi/system/timer.h"
 
 #include <algorithm>
 #include <condition_variable>
 #include <thread>
 #include <vector>
 
+#if defined(TI_ARCH_x64) || defined(TI_ARCH_x86)
+#include <immintrin.h>
+#endif
+
 namespace taichi {
 
+namespace {
+
+inline void cpu_relax() {
+#if defined(TI_ARCH_x64) || defined(TI_ARCH_x86)
+  _mm_pause();
+#elif defined(TI_ARCH_ARM) && (defined(__GNUC__) || defined(__clang__))
+  __asm__ __volatile__("yield");
+#else
+  std::this_thread::yield();
+#endif
+}
+
+constexpr uint64 kActiveMask = (1ULL << 16) - 1;
+constexpr int kNumThreadsShift = 16;
+constexpr uint64 kNumThreadsMask = (1ULL << 15) - 1;
+
+}  // namespace
+
 bool test_threading() {
   auto tp = ThreadPool(20);
   for (int j = 0; j < 100; j++) {
@@ -26,18 +49,15 @@ bool test_threading() {
   return true;
 }
 
-ThreadPool::ThreadPool(int max_num_threads) : max_num_threads(max_num_threads) {
-  exiting = false;
-  started = false;
-  running_threads = 0;
-  timestamp = 1;
-  last_finished = 0;
-  task_head = 0;
-  task_tail = 0;
-  thread_counter = 0;
-  threads.resize((std::size_t)max_num_threads);
-  for (int i = 0; i < max_num_threads; i++) {
-    threads[i] = std::thread([this] { this->target(); });
+ThreadPool::ThreadPool(int max_num_threads)
+    : max_num_threads_(std::max(1, max_num_threads)) {
+  TI_ASSERT(uint64(max_num_threads_) <= kNumThreadsMask);
+  queues_ = std::make_unique<TaskQueue[]>(max_num_threads_);
+  // The thread calling run() is thread 0, so only (max_num_threads - 1)
+  // workers are spawned.
+  threads_.reserve(max_num_threads_ - 1);
+  for (int i = 1; i < max_num_threads_; i++) {
+    threads_.emplace_back([this, i] { this->target(i); });
   }
 }
 
@@ -45,94 +65,196 @@ void ThreadPool::run(int splits,
                      int desired_num_threads,
                      void *range_for_task_context,
                      RangeForTaskFunc *func) {
-  {
-    std::lock_guard _(mutex);
-    this->range_for_task_context = range_for_task_context;
-    this->func = func;
-    this->desired_num_threads = std::min(desired_num_threads, max_num_threads);
-    TI_ASSERT(this->desired_num_threads > 0);
-    // TI_P(this->desired_num_threads);
-    started = false;
-    task_head = 0;
-    task_tail = splits;
-    timestamp++;
-    TI_ASSERT(timestamp < (1LL << 62));  // avoid overflowing here
+  TI_ASSERT(desired_num_threads > 0);
+  if (splits <= 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> _(launch_mutex_);
+  const int num_threads =
+      std::min({desired_num_threads, max_num_threads_, splits});
+  if (num_threads == 1) {
+    // Nothing to distribute; skip waking up the workers altogether.
+    const double start = busy_time_tracking_ ? Time::get_time() : 0;
+    for (int i = 0; i < splits; i++) {
+      func(range_for_task_context, 0, i);
+    }
+    if (busy_time_tracking_) {
+      queues_[0].busy_time += Time::get_time() - start;
+    }
+    return;
   }
 
-  // wake up all slaves
-  slave_cv.notify_all();
-  {
-    std::unique_lock<std::mutex> lock(mutex);
-    // TODO: the workers may have finished before master waiting on master_cv
-    master_cv.wait(lock, [this] { return started && running_threads == 0; });
+  func_ = func;
+  range_for_task_context_ = range_for_task_context;
+  desired_num_threads_ = num_threads;
+  for (int i = 0; i < num_threads; i++) {
+    const auto begin = uint32(int64(splits) * i / num_threads);
+    const auto end = uint32(int64(splits) * (i + 1) / num_threads);
+    queues_[i].range.store(pack_range(begin, end), std::memory_order_relaxed);
   }
-  TI_ASSERT(task_head >= task_tail);
-}
 
-void ThreadPool::target() {
-  uint64 last_timestamp = 0;
-  int thread_id;
-  {
-    std::lock_guard<std::mutex> lock(mutex);
-    thread_id = thread_counter++;
+  // Open the launch. Everything written above is published by this store.
+  const uint64 epoch =
+      ((launch_state_.load(std::memory_order_relaxed) >> 32) + 1) << 32;
+  const uint64 opened = epoch | (uint64(num_threads) << kNumThreadsShift);
+  launch_state_.store(opened, std::memory_order_seq_cst);
+  if (num_parked_.load(std::memory_order_seq_cst) > 0) {
+    std::lock_guard<std::mutex> lock(park_mutex_);
+    park_cv_.notify_all();
   }
+
+  execute_tasks(0);
+
+  // Close the launch once every worker that joined it has left. Workers only
+  // leave after finding all the queues empty, so at this point every task has
+  // been executed.
+  uint64 expected = opened;
+  int spins = 0;
+  while (!launch_state_.compare_exchange_weak(
+      expected, opened | kLaunchClosed, std::memory_order_acq_rel,
+      std::memory_order_relaxed)) {
+    expected = opened;
+    if (++spins < kSpinIterations) {
+      cpu_relax();
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+bool ThreadPool::pop_task(int thread_id, int &task_id) {
+  auto &range = queues_[thread_id].range;
+  uint64 r = range.load(std::memory_order_relaxed);
   while (true) {
-    {
-      std::unique_lock<std::mutex> lock(mutex);
-      slave_cv.wait(lock, [this, last_timestamp, thread_id] {
-        return (timestamp > last_timestamp &&
-                thread_id < desired_num_threads) ||
-               this->exiting;
-      });
-      last_timestamp = timestamp;
-      if (exiting) {
-        break;
-      } else {
-        if (last_finished >= last_timestamp) {
-          continue;
-          // This could happen when part of the desired threads wake up and
-          // finish all the task, and then this thread wake up finding nothing
-          // to do. Should skip this task directly.
-        } else {
-          started = true;
-          running_threads++;
-        }
-      }
+    const auto begin = uint32(r);
+    const auto end = uint32(r >> 32);
+    if (begin >= end) {
+      return false;
+    }
+    if (range.compare_exchange_weak(r, pack_range(begin + 1, end),
+                                    std::memory_order_acquire,
+                                    std::memory_order_relaxed)) {
+      task_id = int(begin);
+      return true;
     }
+  }
+}
 
+bool ThreadPool::steal_tasks(int thread_id) {
+  const int n = desired_num_threads_;
+  for (int k = 1; k < n; k++) {
+    auto &victim = queues_[(thread_id + k) % n].range;
+    uint64 r = victim.load(std::memory_order_relaxed);
     while (true) {
-      // For a single parallel task
-      int task_id;
-      {
-        task_id = task_head.fetch_add(1, std::memory_order_relaxed);
-        if (task_id >= task_tail)
-          break;
+      const auto begin = uint32(r);
+      const auto end = uint32(r >> 32);
+      if (begin >= end) {
+        break;
+      }
+      // Take the upper half, rounding up so that a single remaining task can
+      // be stolen as well.
+      const uint32 mid = end - (end - begin + 1) / 2;
+      if (victim.compare_exchange_weak(r, pack_range(begin, mid),
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+        // Our own queue is empty at this point, and only its owner may ever
+        // refill it.
+        queues_[thread_id].range.store(pack_range(mid, end),
+                                       std::memory_order_release);
+        return true;
       }
+    }
+  }
+  return false;
+}
+
+void ThreadPool::execute_tasks(int thread_id) {
+  const double start = busy_time_tracking_ ? Time::get_time() : 0;
+  int task_id;
+  do {
+    while (pop_task(thread_id, task_id)) {
+      func_(range_for_task_context_, thread_id, task_id);
+    }
+  } while (steal_tasks(thread_id));
+  if (busy_time_tracking_) {
+    queues_[thread_id].busy_time += Time::get_time() - start;
+  }
+}
+
+std::vector<double> ThreadPool::pop_busy_times() {
+  std::lock_guard<std::mutex> _(launch_mutex_);
+  std::vector<double> busy_times(max_num_threads_);
+  for (int i = 0; i < max_num_threads_; i++) {
+    busy_times[i] = queues_[i].busy_time;
+    queues_[i].busy_time = 0;
+  }
+  return busy_times;
+}
 
-      func(this->range_for_task_context, thread_id, task_id);
+bool ThreadPool::try_join(uint64 epoch) {
+  uint64 state = launch_state_.load(std::memory_order_relaxed);
+  while (true) {
+    if ((state >> 32) != epoch || (state & kLaunchClosed)) {
+      return false;
+    }
+    TI_ASSERT((state & kActiveMask) < kActiveMask);
+    if (launch_state_.compare_exchange_weak(state, state + 1,
+                                            std::memory_order_acquire,
+                                            std::memory_order_relaxed)) {
+      return true;
     }
+  }
+}
 
-    bool all_finished = false;
-    {
-      std::lock_guard<std::mutex> lock(mutex);
-      running_threads--;
-      if (running_threads == 0) {
-        all_finished = true;
-        last_finished = last_timestamp;
+void ThreadPool::target(int thread_id) {
+  uint64 last_epoch = 0;
+  while (true) {
+    uint64 state;
+    int spins = 0;
+    while (true) {
+      state = launch_state_.load(std::memory_order_acquire);
+      if ((state >> 32) != last_epoch ||
+          exiting_.load(std::memory_order_relaxed)) {
+        break;
+      }
+      if (++spins < kSpinIterations) {
+        cpu_relax();
+        continue;
+      }
+      // Nothing showed up while spinning; park until the next launch.
+      num_parked_.fetch_add(1, std::memory_order_seq_cst);
+      {
+        std::unique_lock<std::mutex> lock(park_mutex_);
+        park_cv_.wait(lock, [this, last_epoch] {
+          return (launch_state_.load(std::memory_order_seq_cst) >> 32) !=
+                     last_epoch ||
+                 exiting_.load();
+        });
       }
+      num_parked_.fetch_sub(1, std::memory_order_relaxed);
+      spins = 0;
+    }
+    if (exiting_.load()) {
+      break;
+    }
+    last_epoch = state >> 32;
+    const int num_threads = int((state >> kNumThreadsShift) & kNumThreadsMask);
+    if (thread_id >= num_threads || !try_join(last_epoch)) {
+      // Either this launch does not need us, or it is already over.
+      continue;
     }
-    if (all_finished)
-      master_cv.notify_one();
+    execute_tasks(thread_id);
+    launch_state_.fetch_sub(1, std::memory_order_release);
   }
 }
 
 ThreadPool::~ThreadPool() {
+  exiting_ = true;
   {
-    std::lock_guard<std::mutex> lg(mutex);
-    exiting = true;
+    std::lock_guard<std::mutex> lock(park_mutex_);
+    park_cv_.notify_all();
   }
-  slave_cv.notify_all();
-  for (auto &th : threads)
+  for (auto &th : threads_)
     th.join();
 }
 
@@ -10,6 +10,7 @@
 #include <atomic>
 #include <condition_variable>
 #include <functional>
+#include <memory>
 #include <thread>
 
 namespace taichi {
@@ -17,28 +18,20 @@ namespace taichi {
 using RangeForTaskFunc = void(void *, int thread_id, int i);
 using ParallelFor = void(int n, int num_threads, void *, RangeForTaskFunc func);
 
+// A work-stealing scheduler for CPU kernel launches.
+//
+// Each launch partitions its task ids into one contiguous range per
+// participating thread. Every thread pops tasks from the front of its own
+// range; once it runs dry it steals the upper half of another thread's range.
+// Both operations are a single CAS on a packed [begin, end) word, so no lock
+// is taken on the launch path.
+//
+// The thread calling run() takes part in the work as thread 0, so a launch
+// whose tasks finish before any worker wakes up never blocks. Idle workers
+// spin for a short while before parking on a condition variable, which keeps
+// back-to-back small launches off the kernel wake-up path.
 class ThreadPool {
  public:
-  std::vector<std::thread> threads;
-  std::condition_variable slave_cv;
-  std::condition_variable master_cv;
-  std::mutex mutex;
-  std::atomic<int> task_head;
-  int task_tail;
-  int running_threads;
-  int max_num_threads;
-  int desired_num_threads;
-  uint64 timestamp;
-  uint64 last_finished;
-  bool started;
-  bool exiting;
-  RangeForTaskFunc *func;
-  void *range_for_task_context;  // Note: this is a pointer to a
-                                 // range_task_helper_context defined in the
-                                 // LLVM runtime, which is different from
-                                 // taichi::lang::Context.
-  int thread_counter;
-
   explicit ThreadPool(int max_num_threads);
 
   void run(int splits,
@@ -54,9 +47,69 @@ class ThreadPool {
     return pool->run(splits, desired_num_threads, range_for_task_context, func);
   }
 
-  void target();
+  int get_max_num_threads() const {
+    return max_num_threads_;
+  }
+
+  // Per-thread busy time is only measured while tracking is enabled (by the
+  // kernel profiler). Must not be toggled during a launch.
+  void set_busy_time_tracking(bool enabled) {
+    busy_time_tracking_ = enabled;
+  }
+
+  // Returns the time (in seconds) each thread spent executing tasks since the
+  // last call, and resets the counters.
+  std::vector<double> pop_busy_times();
 
   ~ThreadPool();
+
+ private:
+  // A per-thread deque of task ids. Since the tasks of one launch are
+  // contiguous integers, the deque degenerates to a [begin, end) range packed
+  // into one 64-bit word: the owner pops from `begin`, thieves split off the
+  // upper half of the range.
+  struct alignas(64) TaskQueue {
+    std::atomic<uint64> range{0};
+    // Only written by the owning thread during a launch.
+    double busy_time{0};
+  };
+
+  static uint64 pack_range(uint32 begin, uint32 end) {
+    return (uint64(end) << 32) | begin;
+  }
+
+  bool pop_task(int thread_id, int &task_id);
+  bool steal_tasks(int thread_id);
+  void execute_tasks(int thread_id);
+  bool try_join(uint64 epoch);
+  void target(int thread_id);
+
+  static constexpr uint64 kLaunchClosed = 1ULL << 31;
+  static constexpr int kSpinIterations = 1 << 14;
+
+  int max_num_threads_;
+  std::vector<std::thread> threads_;
+  std::unique_ptr<TaskQueue[]> queues_;
+
+  // High 32 bits: launch epoch. Bit 31: set once the launch is closed and no
+  // more workers may join. Low bits: number of workers inside the launch.
+  std::atomic<uint64> launch_state_{kLaunchClosed};
+  int desired_num_threads_{0};
+  RangeForTaskFunc *func_{nullptr};
+  void *range_for_task_context_{nullptr};  // Note: this is a pointer to a
+                                           // range_task_helper_context
+                                           // defined in the LLVM runtime,
+                                           // which is different from
+                                           // taichi::lang::Context.
+
+  // Serializes concurrent run() calls from different host threads.
+  std::mutex launch_mutex_;
+
+  std::mutex park_mutex_;
+  std::condition_variable park_cv_;
+  std::atomic<int> num_parked_{0};
+  std::atomic<bool> exiting_{false};
+  bool busy_time_tracking_{false};
 };
 
 }  // namespace taichi
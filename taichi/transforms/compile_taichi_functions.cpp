@@ -19,6 +19,9 @@ class CompileTaichiFunctions : public BasicStmtVisitor {
     auto *func = stmt->func;
     const auto ir_type = func->ir_stage();
     if (ir_type < target_stage_) {
+      // The function outlives the kernel being compiled, so its IR must not
+      // come from the arena of the kernel
+      IRArenaScope heap_scope(/*enabled=*/false);
       irpass::compile_function(func->ir.get(), compile_config_, func,
                                /*autodiff_mode=*/AutodiffMode::kNone,
                                /*verbose=*/compile_config_.print_ir,
@@ -195,7 +195,9 @@ void offload_to_executable(IRNode *ir,
     irpass::analysis::verify(ir);
   }
 
-  if (config.make_cpu_multithreading_loop && arch_is_cpu(config.arch)) {
+  // Guided range-fors are chunked by the runtime instead.
+  if (config.make_cpu_multithreading_loop && arch_is_cpu(config.arch) &&
+      !config.cpu_guided_range_for()) {
     irpass::make_cpu_multithreaded_range_for(ir, config);
     irpass::type_check(ir, config);
     print("Make CPU multithreaded range-for");
@@ -306,6 +308,12 @@ void offload_to_executable(IRNode *ir,
     }
   }
 
+  if (config.vectorize_range_for && arch_is_cpu(config.arch)) {
+    if (irpass::vectorize_range_for(ir, config)) {
+      print("Range-for vectorized");
+    }
+  }
+
   // Final field registration correctness & type checking
   irpass::type_check(ir, config);
   irpass::analysis::verify(ir);
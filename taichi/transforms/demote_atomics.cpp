@@ -36,6 +36,11 @@ class DemoteAtomics : public BasicStmtVisitor {
       if (stmt->dest->is<ThreadLocalPtrStmt>()) {
         demote = true;
       }
+      if (stmt->dest->is<BlockLocalPtrStmt>() &&
+          arch_is_cpu(current_offloaded->device)) {
+        // On CPU, a block and its BLS buffer belong to a single thread
+        demote = true;
+      }
       if (current_offloaded->task_type == OffloadedTaskType::serial) {
         demote = true;
       }
@@ -587,6 +587,20 @@ class IRPrinter : public IRVisitor {
     dbg_info_printer_(stmt);
   }
 
+  void visit(VectorLoadStmt *stmt) override {
+    std::string mask = stmt->mask ? ", mask=" + stmt->mask->name() : "";
+    print("{}{} = vector load {}{}", stmt->type_hint(), stmt->name(),
+          stmt->src->name(), mask);
+    dbg_info_printer_(stmt);
+  }
+
+  void visit(VectorStoreStmt *stmt) override {
+    std::string mask = stmt->mask ? ", mask=" + stmt->mask->name() : "";
+    print("{}{} : vector store [{} <- {}]{}", stmt->type_hint(), stmt->name(),
+          stmt->dest->name(), stmt->val->name(), mask);
+    dbg_info_printer_(stmt);
+  }
+
   void visit(RangeAssumptionStmt *stmt) override {
     print("{}{} = assume_in_range({}{:+d} <= {} < {}{:+d})", stmt->type_hint(),
           stmt->name(), stmt->base->name(), stmt->low, stmt->input->name(),
@@ -9,6 +9,10 @@ namespace taichi::lang {
 
 namespace {
 
+// The largest BLS footprint per block staged on CPU, about the size of an L2
+// cache
+constexpr std::size_t kMaxCpuBlsSize = 256 << 10;
+
 void make_block_local_offload(OffloadedStmt *offload,
                               const CompileConfig &config,
                               const std::string &kernel_name,
@@ -54,6 +58,23 @@ void make_block_local_offload(OffloadedStmt *offload,
 
   auto pads = irpass::initialize_scratch_pad(offload);
 
+  // On CPU, a block is processed by one thread, and its BLS buffer lives in
+  // the TLS of that thread. Only use it when the footprint of the block stays
+  // in the L1/L2 caches, otherwise the staging costs more than it saves.
+  const bool on_cpu = arch_is_cpu(config.arch);
+  if (on_cpu) {
+    std::size_t footprint_in_bytes = 0;
+    for (auto &pad : pads->pads) {
+      footprint_in_bytes += data_type_size(pad.first->dt.ptr_removed()) *
+                            pad.second.pad_size_linear();
+    }
+    if (footprint_in_bytes > kMaxCpuBlsSize) {
+      TI_TRACE("(kernel={}) Skipping BLS: {} B of footprint per block",
+               kernel_name, footprint_in_bytes);
+      return;
+    }
+  }
+
   std::size_t bls_offset_in_bytes = 0;
 
   for (auto &pad : pads->pads) {
@@ -93,12 +114,83 @@ void make_block_local_offload(OffloadedStmt *offload,
     bls_offset_in_bytes +=
         (dtype_size - bls_offset_in_bytes % dtype_size) % dtype_size;
 
+    using XlogueOperation =
+        std::function<void(Block * element_block,
+                           std::vector<Stmt *> global_indices,
+                           Stmt * bls_element_offset_bytes)>;
+
+    // The CPU version of create_xlogue below: the thread processing the block
+    // walks the whole footprint, with a serial loop per axis
+    auto create_cpu_xlogue = [&](std::unique_ptr<Block> &block,
+                                 const XlogueOperation &operation) {
+      if (block == nullptr) {
+        block = std::make_unique<Block>();
+        block->set_parent_stmt(offload);
+      }
+      std::vector<RangeForStmt *> loops(dim);
+      Block *loop_block = block.get();
+      for (int i = 0; i < dim; i++) {
+        auto begin = loop_block->push_back<ConstStmt>(TypedConstant(0));
+        auto end = loop_block->push_back<ConstStmt>(
+            TypedConstant(pad.second.pad_size[i]));
+        loops[i] = loop_block
+                       ->push_back<RangeForStmt>(
+                           begin, end, std::make_unique<Block>(),
+                           /*is_bit_vectorized=*/false, /*num_cpu_threads=*/1,
+                           /*block_dim=*/1, /*strictly_serialized=*/true)
+                       ->as<RangeForStmt>();
+        loop_block = loops[i]->body.get();
+      }
+
+      std::vector<Stmt *> global_indices(dim);
+      Stmt *bls_element_id = nullptr;
+      for (int i = 0; i < dim; i++) {
+        auto bls_coord = loop_block->push_back<LoopIndexStmt>(loops[i], 0);
+        if (bls_element_id == nullptr) {
+          bls_element_id = bls_coord;
+        } else {
+          bls_element_id = loop_block->push_back<BinaryOpStmt>(
+              BinaryOpType::add,
+              loop_block->push_back<BinaryOpStmt>(
+                  BinaryOpType::mul, bls_element_id,
+                  loop_block->push_back<ConstStmt>(
+                      TypedConstant(pad.second.pad_size[i]))),
+              bls_coord);
+        }
+
+        auto global_index_this_dim = loop_block->push_back<BinaryOpStmt>(
+            BinaryOpType::add, bls_coord,
+            loop_block->push_back<ConstStmt>(
+                TypedConstant(pad.second.bounds[i].low)));
+        Stmt *block_corner =
+            loop_block->push_back<BlockCornerIndexStmt>(offload, i);
+        if (pad.second.coefficients[i] > 1) {
+          block_corner = loop_block->push_back<BinaryOpStmt>(
+              BinaryOpType::mul, block_corner,
+              loop_block->push_back<ConstStmt>(
+                  TypedConstant(pad.second.coefficients[i])));
+        }
+        global_indices[i] = loop_block->push_back<BinaryOpStmt>(
+            BinaryOpType::add, global_index_this_dim, block_corner);
+      }
+
+      auto bls_element_offset_bytes = loop_block->push_back<BinaryOpStmt>(
+          BinaryOpType::add,
+          loop_block->push_back<BinaryOpStmt>(
+              BinaryOpType::mul, bls_element_id,
+              loop_block->push_back<ConstStmt>(TypedConstant(dtype_size))),
+          loop_block->push_back<ConstStmt>(
+              TypedConstant((int32)bls_offset_in_bytes)));
+      operation(loop_block, global_indices, bls_element_offset_bytes);
+    };
+
     // This lambda is used for both BLS prologue and epilogue creation
     auto create_xlogue =
-        [&](std::unique_ptr<Block> &block,
-            const std::function<void(
-                Block * element_block, std::vector<Stmt *> global_indices,
-                Stmt * bls_element_offset_bytes)> &operation) {
+        [&](std::unique_ptr<Block> &block, const XlogueOperation &operation) {
+          if (on_cpu) {
+            create_cpu_xlogue(block, operation);
+            return;
+          }
           if (block == nullptr) {
             block = std::make_unique<Block>();
             block->set_parent_stmt(offload);
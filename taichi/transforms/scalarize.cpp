@@ -1285,13 +1285,13 @@ class FuseMatrixPtr : public BasicStmtVisitor {
       // Note: Update base_ptr's ret_type so that it matches the ExternalPtrStmt
       // with flattened indices. Main goal is to keep all the hacks in a single
       // place so that they're easier to remove
-      auto members = origin->base_ptr->as<ArgLoadStmt>()
-                         ->ret_type.ptr_removed()
-                         ->as<StructType>()
-                         ->elements();
+      DataType struct_type =
+          origin->base_ptr->as<ArgLoadStmt>()->ret_type.ptr_removed();
+      auto members = struct_type->as<StructType>()->elements();
       bool needs_grad = members.size() > TypeFactory::GRAD_PTR_POS_IN_NDARRAY;
+      bool strided = TypeFactory::is_strided_ndarray_struct(struct_type);
       auto type = TypeFactory::get_instance().get_ndarray_struct_type(
-          fused->ret_type.ptr_removed(), origin->ndim, needs_grad);
+          fused->ret_type.ptr_removed(), origin->ndim, needs_grad, strided);
       origin->base_ptr->as<ArgLoadStmt>()->ret_type =
           TypeFactory::get_instance().get_pointer_type((Type *)type);
       stmt->replace_usages_with(fused.get());
@@ -0,0 +1,955 @@
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "taichi/ir/ir.h"
+#include "taichi/ir/snode.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+#include "taichi/ir/type_factory.h"
+#include "taichi/system/profiler.h"
+
+namespace taichi::lang {
+
+namespace {
+
+/* This pass vectorizes the serial inner loops that
+ * make_cpu_multithreaded_range_for creates in CPU range-for offloads. Every
+ * iteration of such a loop comes from the same parallel range-for, so W
+ * consecutive iterations can run in the W lanes of a vector loop:
+ *
+ *   for i in range(block_begin, block_end):
+ *     body(i)
+ *
+ * becomes
+ *
+ *   num_vectors = max(block_end - block_begin, 0) >> log2(W)
+ *   for j in range(0, num_vectors):
+ *     body_vectorized(block_begin + (j << log2(W)))
+ *   <reduce the accumulators of body_vectorized>
+ *   for i in range(block_begin + (num_vectors << log2(W)), block_end):
+ *     body(i)
+ *
+ * The vector values are TensorType values of W elements, which are LLVM
+ * vectors when the matrices are not scalarized. Each scalar statement of the
+ * body is either
+ *   - uniform: the same in all lanes, e.g. a loop invariant. It stays scalar;
+ *   - affine: an integer or pointer whose lanes increase by a constant
+ *     stride, e.g. i * 4 or the address of x[i] for a dense SNode or a scalar
+ *     ndarray. Its lane-0 value stays scalar, so that accessing consecutive
+ *     elements becomes a VectorLoadStmt / VectorStoreStmt;
+ *   - varying: anything else, which becomes a vector operation.
+ * Branches are if-converted: the statements of an IfStmt are emitted under a
+ * mask of the active lanes, which predicates the loads and stores and selects
+ * the values written to local variables. Atomics on a uniform address whose
+ * result is not used (and their demoted "load; op; store" form, e.g. TLS
+ * reductions) are accumulated in a vector, which is reduced and written back
+ * once after the vector loop.
+ *
+ * The loop is left untouched if its body contains anything else, e.g. nested
+ * loops, function calls, gathers or scatters, or math functions implemented
+ * in the runtime. It is also left untouched if it has no such reduction:
+ * LLVM vectorizes element-wise loops on its own, but not the "load; op;
+ * store" on a loop-invariant address that a TLS reduction becomes.
+ */
+
+// How a scalar statement of the loop body varies across the lanes
+struct LaneInfo {
+  bool varying{false};
+  // The difference between two consecutive lanes when !varying, in bytes for
+  // pointers. 0 means uniform.
+  int64 stride{0};
+
+  static LaneInfo uniform() {
+    return {false, 0};
+  }
+
+  static LaneInfo affine(int64 stride) {
+    return {false, stride};
+  }
+
+  static LaneInfo vector() {
+    return {true, 0};
+  }
+
+  bool is_uniform() const {
+    return !varying && stride == 0;
+  }
+};
+
+bool is_reduction_op(BinaryOpType op) {
+  return op == BinaryOpType::add || op == BinaryOpType::min ||
+         op == BinaryOpType::max || op == BinaryOpType::bit_and ||
+         op == BinaryOpType::bit_or || op == BinaryOpType::bit_xor;
+}
+
+bool is_reduction_type(DataType dt, BinaryOpType op) {
+  if (dt->is_primitive(PrimitiveTypeID::f32) ||
+      dt->is_primitive(PrimitiveTypeID::f64)) {
+    return op == BinaryOpType::add || op == BinaryOpType::min ||
+           op == BinaryOpType::max;
+  }
+  return dt->is_primitive(PrimitiveTypeID::i32) ||
+         dt->is_primitive(PrimitiveTypeID::i64) ||
+         dt->is_primitive(PrimitiveTypeID::u32) ||
+         dt->is_primitive(PrimitiveTypeID::u64);
+}
+
+TypedConstant reduction_identity(BinaryOpType op, DataType dt) {
+  if (op == BinaryOpType::add || op == BinaryOpType::bit_or ||
+      op == BinaryOpType::bit_xor) {
+    return TypedConstant(dt, 0);
+  }
+  if (op == BinaryOpType::bit_and) {
+    return TypedConstant(dt, -1);
+  }
+  const bool is_min = op == BinaryOpType::min;
+  if (is_real(dt)) {
+    const auto inf = std::numeric_limits<float64>::infinity();
+    return TypedConstant(dt, is_min ? inf : -inf);
+  }
+  if (!is_signed(dt)) {
+    // All bits set is the maximum
+    return TypedConstant(dt, is_min ? int64(-1) : int64(0));
+  }
+  const int64 max = dt->is_primitive(PrimitiveTypeID::i64)
+                        ? std::numeric_limits<int64>::max()
+                        : std::numeric_limits<int32>::max();
+  return TypedConstant(dt, is_min ? max : -max - 1);
+}
+
+AtomicOpType binary_to_atomic_op_type(BinaryOpType op) {
+  switch (op) {
+#define REGISTER_TYPE(i)  \
+  case BinaryOpType::i: \
+    return AtomicOpType::i;
+
+    REGISTER_TYPE(add);
+    REGISTER_TYPE(max);
+    REGISTER_TYPE(min);
+    REGISTER_TYPE(bit_and);
+    REGISTER_TYPE(bit_or);
+    REGISTER_TYPE(bit_xor);
+
+#undef REGISTER_TYPE
+    default:
+      TI_NOT_IMPLEMENTED
+  }
+}
+
+// Element types of the vector values, excluding f16 which has no vector
+// support in the LLVM codegen
+bool is_lane_type(DataType dt) {
+  if (!dt->is<PrimitiveType>() || dt->is_primitive(PrimitiveTypeID::f16)) {
+    return false;
+  }
+  return is_real(dt) || is_integral(dt);
+}
+
+class RangeForVectorizer {
+ public:
+  RangeForVectorizer(RangeForStmt *loop, int width)
+      : loop_(loop), width_(width) {
+    while ((1 << log2_width_) < width_) {
+      log2_width_++;
+    }
+    TI_ASSERT((1 << log2_width_) == width_);
+  }
+
+  // Returns false, leaving the IR untouched, if the loop is not vectorized.
+  bool run() {
+    if (loop_->reversed || !scan_block(loop_->body.get())) {
+      return false;
+    }
+    find_reductions();
+    if (reduction_ops_.empty()) {
+      // LLVM's loop vectorizer already handles element-wise loops, and
+      // interleaves several vectors, which beats a single vector loop
+      return false;
+    }
+
+    // The vector loop
+    out_ = &pre_;
+    auto *begin = loop_->begin;
+    auto *zero = make_const(PrimitiveType::i32, 0);
+    auto *log2_width = make_const(PrimitiveType::i32, log2_width_);
+    auto *num_iterations = push<BinaryOpStmt>(
+        PrimitiveType::i32, BinaryOpType::sub, loop_->end, begin);
+    num_iterations = push<BinaryOpStmt>(PrimitiveType::i32, BinaryOpType::max,
+                                        num_iterations, zero);
+    auto *num_vectors = push<BinaryOpStmt>(
+        PrimitiveType::i32, BinaryOpType::bit_sar, num_iterations, log2_width);
+    auto vector_loop = Stmt::make_typed<RangeForStmt>(
+        zero, num_vectors, std::make_unique<Block>(),
+        /*is_bit_vectorized*/ false, /*num_cpu_threads*/ 1, /*block_dim*/ 1,
+        /*strictly_serialized*/ true, loop_->range_hint);
+
+    out_ = &body_;
+    Stmt *index = push<LoopIndexStmt>(PrimitiveType::i32, vector_loop.get(), 0);
+    index = push<BinaryOpStmt>(PrimitiveType::i32, BinaryOpType::bit_shl,
+                               index, log2_width);
+    base_index_ = push<BinaryOpStmt>(PrimitiveType::i32, BinaryOpType::add,
+                                     begin, index);
+    if (!vectorize_block(loop_->body.get())) {
+      return false;
+    }
+    vector_loop->body->set_statements(std::move(body_));
+
+    // Reduce the accumulators
+    out_ = &post_;
+    for (auto &reduction : reductions_) {
+      emit_reduction(reduction);
+    }
+
+    // The remaining iterations run in the original loop
+    auto *tail_begin = push<BinaryOpStmt>(
+        PrimitiveType::i32, BinaryOpType::bit_shl, num_vectors, log2_width);
+    tail_begin = push<BinaryOpStmt>(PrimitiveType::i32, BinaryOpType::add,
+                                    begin, tail_begin);
+
+    pre_.push_back(std::move(vector_loop));
+    for (auto &stmt : post_.stmts) {
+      pre_.push_back(std::move(stmt));
+    }
+    loop_->parent->insert_before(loop_, std::move(pre_));
+    loop_->begin = tail_begin;
+    return true;
+  }
+
+ private:
+  struct Reduction {
+    Stmt *dest;
+    BinaryOpType op;
+    bool atomic{false};
+    AllocaStmt *accumulator{nullptr};
+    Stmt *identity{nullptr};
+  };
+
+  // Gathers the statements of the loop body and the number of their uses.
+  bool scan_block(Block *block) {
+    for (auto &stmt : block->statements) {
+      if (stmt->is_container_statement() && !stmt->is<IfStmt>()) {
+        return false;
+      }
+      body_stmts_.insert(stmt.get());
+      for (auto *op : stmt->get_operands()) {
+        if (op != nullptr) {
+          num_uses_[op]++;
+        }
+      }
+      if (auto *if_stmt = stmt->cast<IfStmt>()) {
+        if ((if_stmt->true_statements &&
+             !scan_block(if_stmt->true_statements.get())) ||
+            (if_stmt->false_statements &&
+             !scan_block(if_stmt->false_statements.get()))) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  // Finds the atomics and "load; op; store" sequences that can be turned into
+  // vector reductions. A destination qualifies only if all the accesses to it
+  // in the loop are such reductions with the same op.
+  void find_reductions() {
+    std::unordered_map<Stmt *, std::vector<Stmt *>> accesses;
+    std::unordered_map<Stmt *, BinaryOpType> candidates;
+    for (auto *stmt : body_stmts_) {
+      if (auto *load = stmt->cast<GlobalLoadStmt>()) {
+        accesses[load->src].push_back(load);
+      } else if (auto *store = stmt->cast<GlobalStoreStmt>()) {
+        accesses[store->dest].push_back(store);
+        auto *bin = store->val->cast<BinaryOpStmt>();
+        if (!bin || !is_reduction_op(bin->op_type) || num_uses_[bin] != 1 ||
+            bin->parent != store->parent) {
+          continue;
+        }
+        auto *load = bin->lhs->cast<GlobalLoadStmt>();
+        if (!load || load->src != store->dest) {
+          load = bin->rhs->cast<GlobalLoadStmt>();
+        }
+        if (load && load->src == store->dest && bin->lhs != bin->rhs &&
+            num_uses_[load] == 1 && load->parent == store->parent) {
+          candidates[store] = bin->op_type;
+          candidates[bin] = bin->op_type;
+          candidates[load] = bin->op_type;
+        }
+      } else if (auto *atomic = stmt->cast<AtomicOpStmt>()) {
+        accesses[atomic->dest].push_back(atomic);
+        if (atomic->op_type != AtomicOpType::sub &&
+            atomic->op_type != AtomicOpType::mul && num_uses_[atomic] == 0) {
+          auto op = atomic_to_binary_op_type(atomic->op_type);
+          if (is_reduction_op(op)) {
+            candidates[atomic] = op;
+          }
+        }
+      }
+    }
+    for (auto &[dest, stmts] : accesses) {
+      if (!is_loop_invariant(dest)) {
+        continue;
+      }
+      auto first = candidates.find(stmts[0]);
+      bool ok = first != candidates.end();
+      for (auto *stmt : stmts) {
+        auto it = candidates.find(stmt);
+        ok = ok && it != candidates.end() && it->second == first->second;
+      }
+      if (ok) {
+        for (auto *stmt : stmts) {
+          reduction_ops_[stmt] = candidates[stmt];
+          if (auto *store = stmt->cast<GlobalStoreStmt>()) {
+            reduction_ops_[store->val] = candidates[store];
+          }
+        }
+      }
+    }
+  }
+
+  bool in_body(Stmt *stmt) const {
+    return body_stmts_.find(stmt) != body_stmts_.end();
+  }
+
+  LaneInfo info(Stmt *stmt) const {
+    auto it = info_.find(stmt);
+    return it == info_.end() ? LaneInfo::uniform() : it->second;
+  }
+
+  DataType vector_type(DataType dt) const {
+    return TypeFactory::create_tensor_type({width_}, dt);
+  }
+
+  template <typename T, typename... Args>
+  T *push(DataType ret_type, Args &&...args) {
+    auto *stmt = out_->push_back<T>(std::forward<Args>(args)...);
+    stmt->ret_type = ret_type;
+    return stmt;
+  }
+
+  template <typename T>
+  Stmt *make_const(DataType dt, const T &value) {
+    return push<ConstStmt>(dt, TypedConstant(dt, value));
+  }
+
+  Stmt *broadcast(Stmt *scalar) {
+    return push<MatrixInitStmt>(vector_type(scalar->ret_type),
+                                std::vector<Stmt *>(width_, scalar));
+  }
+
+  // The lane-0 value of a uniform or affine statement
+  Stmt *scalar(Stmt *stmt) {
+    auto it = scalars_.find(stmt);
+    return it == scalars_.end() ? stmt : it->second;
+  }
+
+  // The value of a statement in all the lanes
+  Stmt *vector(Stmt *stmt) {
+    if (auto it = vectors_.find(stmt); it != vectors_.end()) {
+      return it->second;
+    }
+    auto lanes = info(stmt);
+    TI_ASSERT(!lanes.varying);
+    auto *vec = broadcast(scalar(stmt));
+    if (lanes.stride != 0) {
+      auto dt = stmt->ret_type;
+      std::vector<Stmt *> offsets;
+      for (int i = 0; i < width_; i++) {
+        offsets.push_back(make_const(dt, lanes.stride * i));
+      }
+      auto *offset = push<MatrixInitStmt>(vector_type(dt), offsets);
+      vec = push<BinaryOpStmt>(vector_type(dt), BinaryOpType::add, vec, offset);
+    }
+    vectors_[stmt] = vec;
+    return vec;
+  }
+
+  // Clones a uniform or affine statement, computing its lane-0 value.
+  void clone_scalar(Stmt *stmt, LaneInfo lanes) {
+    auto clone = stmt->clone();
+    for (int i = 0; i < clone->num_operands(); i++) {
+      if (auto *op = clone->operand(i)) {
+        clone->set_operand(i, scalar(op));
+      }
+    }
+    clone->ret_type = stmt->ret_type;
+    scalars_[stmt] = out_->push_back(std::move(clone));
+    info_[stmt] = lanes;
+  }
+
+  // Clones a uniform address computation of the loop body after the vector
+  // loop, where it is used to write the reductions back.
+  Stmt *clone_after_loop(Stmt *stmt) {
+    if (!in_body(stmt)) {
+      return stmt;
+    }
+    if (auto it = post_clones_.find(stmt); it != post_clones_.end()) {
+      return it->second;
+    }
+    auto clone = stmt->clone();
+    for (int i = 0; i < clone->num_operands(); i++) {
+      if (auto *op = clone->operand(i)) {
+        clone->set_operand(i, clone_after_loop(op));
+      }
+    }
+    clone->ret_type = stmt->ret_type;
+    return post_clones_[stmt] = out_->push_back(std::move(clone));
+  }
+
+  // Whether a statement neither depends on the loop index nor reads memory, so
+  // that it can be recomputed after the loop.
+  bool is_loop_invariant(Stmt *stmt) const {
+    if (!in_body(stmt)) {
+      return true;
+    }
+    if (!(stmt->is<ConstStmt>() || stmt->is<BinaryOpStmt>() ||
+          stmt->is<UnaryOpStmt>() || stmt->is<GetRootStmt>() ||
+          stmt->is<LinearizeStmt>() || stmt->is<SNodeLookupStmt>() ||
+          stmt->is<GetChStmt>() || stmt->is<ExternalPtrStmt>() ||
+          stmt->is<ArgLoadStmt>() || stmt->is<GlobalTemporaryStmt>() ||
+          stmt->is<ThreadLocalPtrStmt>() ||
+          stmt->is<ExternalTensorShapeAlongAxisStmt>())) {
+      return false;
+    }
+    for (auto *op : stmt->get_operands()) {
+      if (op && !is_loop_invariant(op)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool vectorize_block(Block *block) {
+    for (auto &stmt : block->statements) {
+      if (!vectorize(stmt.get())) {
+        TI_TRACE("Range-for not vectorized because of {}", stmt->type());
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool vectorize(Stmt *stmt) {
+    if (stmt->is<DecorationStmt>()) {
+      return true;
+    }
+    if (stmt->ret_type->is<TensorType>()) {
+      return false;
+    }
+    if (auto *if_stmt = stmt->cast<IfStmt>()) {
+      return vectorize_if(if_stmt);
+    }
+    if (reduction_ops_.count(stmt)) {
+      return vectorize_reduction(stmt);
+    }
+    if (stmt->is<ConstStmt>() || stmt->is<GetRootStmt>() ||
+        stmt->is<ArgLoadStmt>() || stmt->is<GlobalTemporaryStmt>() ||
+        stmt->is<ThreadLocalPtrStmt>() ||
+        stmt->is<ExternalTensorShapeAlongAxisStmt>()) {
+      clone_scalar(stmt, LaneInfo::uniform());
+      return true;
+    }
+    if (auto *loop_index = stmt->cast<LoopIndexStmt>()) {
+      if (loop_index->loop == loop_) {
+        scalars_[stmt] = base_index_;
+        info_[stmt] = LaneInfo::affine(1);
+      } else {
+        clone_scalar(stmt, LaneInfo::uniform());
+      }
+      return true;
+    }
+    if (stmt->is<LinearizeStmt>() || stmt->is<SNodeLookupStmt>() ||
+        stmt->is<GetChStmt>() || stmt->is<ExternalPtrStmt>()) {
+      return vectorize_address(stmt);
+    }
+    if (auto *bin = stmt->cast<BinaryOpStmt>()) {
+      return vectorize_binary(bin);
+    }
+    if (auto *unary = stmt->cast<UnaryOpStmt>()) {
+      return vectorize_unary(unary);
+    }
+    if (auto *select = stmt->cast<TernaryOpStmt>()) {
+      if (all_uniform(select)) {
+        clone_scalar(select, LaneInfo::uniform());
+        return true;
+      }
+      return select->op_type == TernaryOpType::select &&
+             emit_vector_op(select, select->ret_type);
+    }
+    if (auto *load = stmt->cast<GlobalLoadStmt>()) {
+      return vectorize_load(load);
+    }
+    if (auto *store = stmt->cast<GlobalStoreStmt>()) {
+      return vectorize_store(store);
+    }
+    if (auto *alloca = stmt->cast<AllocaStmt>()) {
+      auto dt = alloca->ret_type.ptr_removed();
+      if (!is_lane_type(dt)) {
+        return false;
+      }
+      // Allocas are zero-initialized
+      locals_[alloca] = broadcast(make_const(dt, 0));
+      return true;
+    }
+    if (auto *local_load = stmt->cast<LocalLoadStmt>()) {
+      auto it = locals_.find(local_load->src);
+      if (it == locals_.end()) {
+        return false;
+      }
+      vectors_[stmt] = it->second;
+      info_[stmt] = LaneInfo::vector();
+      return true;
+    }
+    if (auto *local_store = stmt->cast<LocalStoreStmt>()) {
+      auto it = locals_.find(local_store->dest);
+      auto dt = local_store->dest->ret_type.ptr_removed();
+      if (it == locals_.end() || local_store->val->ret_type != dt) {
+        return false;
+      }
+      auto *val = vector(local_store->val);
+      if (mask_) {
+        val = push<TernaryOpStmt>(val->ret_type, TernaryOpType::select, mask_,
+                                  val, it->second);
+      }
+      it->second = val;
+      return true;
+    }
+    return false;
+  }
+
+  bool all_uniform(Stmt *stmt) const {
+    for (auto *op : stmt->get_operands()) {
+      if (op && !info(op).is_uniform()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Emits |stmt| as a vector operation on the vectors of its operands.
+  bool emit_vector_op(Stmt *stmt, DataType element_type) {
+    if (!is_lane_type(element_type)) {
+      return false;
+    }
+    for (auto *op : stmt->get_operands()) {
+      if (!op || op->ret_type->is<PointerType>() ||
+          !is_lane_type(op->ret_type)) {
+        return false;
+      }
+    }
+    auto clone = stmt->clone();
+    for (int i = 0; i < clone->num_operands(); i++) {
+      clone->set_operand(i, vector(stmt->operand(i)));
+    }
+    clone->ret_type = vector_type(element_type);
+    vectors_[stmt] = out_->push_back(std::move(clone));
+    info_[stmt] = LaneInfo::vector();
+    return true;
+  }
+
+  bool vectorize_address(Stmt *stmt) {
+    for (auto *op : stmt->get_operands()) {
+      if (op && info(op).varying) {
+        // Gathers and scatters are not supported
+        return false;
+      }
+    }
+    if (all_uniform(stmt)) {
+      clone_scalar(stmt, LaneInfo::uniform());
+      return true;
+    }
+    int64 stride = 0;
+    if (auto *linearized = stmt->cast<LinearizeStmt>()) {
+      // The value is sum(inputs[i] * prod(strides[i + 1:]))
+      for (int i = 0; i < (int)linearized->inputs.size(); i++) {
+        stride = stride * linearized->strides[i] +
+                 info(linearized->inputs[i]).stride;
+      }
+    } else if (auto *lookup = stmt->cast<SNodeLookupStmt>()) {
+      auto *snode = lookup->snode;
+      if (snode->type != SNodeType::dense || snode->cell_size_bytes == 0) {
+        return false;
+      }
+      stride = info(lookup->input_snode).stride +
+               info(lookup->input_index).stride *
+                   (int64)snode->cell_size_bytes;
+    } else if (auto *get_ch = stmt->cast<GetChStmt>()) {
+      if (get_ch->input_snode->type == SNodeType::quant_array ||
+          get_ch->input_snode->type == SNodeType::bit_struct ||
+          get_ch->ret_type->as<PointerType>()->is_bit_pointer()) {
+        return false;
+      }
+      stride = info(get_ch->input_ptr).stride;
+    } else if (auto *external_ptr = stmt->cast<ExternalPtrStmt>()) {
+      // Only the last index of a compact scalar ndarray may vary, its stride
+      // is then the size of an element.
+      auto dt = external_ptr->ret_type.ptr_removed();
+      auto &indices = external_ptr->indices;
+      if (!external_ptr->element_shape.empty() || !is_lane_type(dt) ||
+          TypeFactory::is_strided_ndarray_struct(
+              external_ptr->base_ptr->ret_type.ptr_removed())) {
+        return false;
+      }
+      for (int i = 0; i + 1 < (int)indices.size(); i++) {
+        if (info(indices[i]).stride != 0) {
+          return false;
+        }
+      }
+      stride = info(indices.back()).stride * data_type_size(dt);
+    }
+    clone_scalar(stmt, LaneInfo::affine(stride));
+    return true;
+  }
+
+  bool vectorize_binary(BinaryOpStmt *bin) {
+    auto op = bin->op_type;
+    auto lhs = info(bin->lhs), rhs = info(bin->rhs);
+    // Integer divisions of the inactive lanes must not trap
+    const bool may_trap =
+        (op == BinaryOpType::div || op == BinaryOpType::mod) &&
+        is_integral(bin->ret_type);
+    if (lhs.is_uniform() && rhs.is_uniform() && !(may_trap && mask_)) {
+      clone_scalar(bin, LaneInfo::uniform());
+      return true;
+    }
+    if (!lhs.varying && !rhs.varying && is_integral(bin->ret_type)) {
+      std::optional<int64> stride;
+      if (op == BinaryOpType::add) {
+        stride = lhs.stride + rhs.stride;
+      } else if (op == BinaryOpType::sub) {
+        stride = lhs.stride - rhs.stride;
+      } else if (op == BinaryOpType::mul) {
+        if (auto *c = bin->rhs->cast<ConstStmt>()) {
+          stride = lhs.stride * c->val.val_as_int64();
+        } else if (auto *c = bin->lhs->cast<ConstStmt>()) {
+          stride = rhs.stride * c->val.val_as_int64();
+        }
+      } else if (op == BinaryOpType::bit_shl) {
+        if (auto *c = bin->rhs->cast<ConstStmt>()) {
+          stride = lhs.stride << c->val.val_as_int64();
+        }
+      }
+      if (stride.has_value()) {
+        clone_scalar(bin, LaneInfo::affine(*stride));
+        return true;
+      }
+    }
+    switch (op) {
+      case BinaryOpType::add:
+      case BinaryOpType::sub:
+      case BinaryOpType::mul:
+      case BinaryOpType::div:
+      case BinaryOpType::bit_and:
+      case BinaryOpType::bit_or:
+      case BinaryOpType::bit_xor:
+      case BinaryOpType::bit_shl:
+      case BinaryOpType::bit_sar:
+      case BinaryOpType::cmp_lt:
+      case BinaryOpType::cmp_le:
+      case BinaryOpType::cmp_gt:
+      case BinaryOpType::cmp_ge:
+      case BinaryOpType::cmp_eq:
+      case BinaryOpType::cmp_ne:
+      case BinaryOpType::logical_and:
+      case BinaryOpType::logical_or:
+        break;
+      case BinaryOpType::mod:
+        if (!is_integral(bin->ret_type)) {
+          return false;
+        }
+        break;
+      case BinaryOpType::min:
+      case BinaryOpType::max:
+        // Integer min/max are only implemented for 16 bits and wider
+        if (is_integral(bin->ret_type) && data_type_bits(bin->ret_type) < 16) {
+          return false;
+        }
+        break;
+      default:
+        return false;
+    }
+    if (!may_trap || !mask_) {
+      return emit_vector_op(bin, bin->ret_type);
+    }
+    if (!is_lane_type(bin->lhs->ret_type) ||
+        !is_lane_type(bin->rhs->ret_type)) {
+      return false;
+    }
+    auto *lhs_vec = vector(bin->lhs);
+    auto *rhs_vec = vector(bin->rhs);
+    auto *one = broadcast(make_const(bin->rhs->ret_type, 1));
+    rhs_vec = push<TernaryOpStmt>(rhs_vec->ret_type, TernaryOpType::select,
+                                  mask_, rhs_vec, one);
+    vectors_[bin] = push<BinaryOpStmt>(vector_type(bin->ret_type), op, lhs_vec,
+                                       rhs_vec);
+    info_[bin] = LaneInfo::vector();
+    return true;
+  }
+
+  bool vectorize_unary(UnaryOpStmt *unary) {
+    if (all_uniform(unary)) {
+      clone_scalar(unary, LaneInfo::uniform());
+      return true;
+    }
+    auto from = unary->operand->ret_type;
+    auto to = unary->ret_type;
+    switch (unary->op_type) {
+      case UnaryOpType::neg:
+      case UnaryOpType::logic_not:
+        break;
+      case UnaryOpType::sqrt:
+      case UnaryOpType::round:
+      case UnaryOpType::floor:
+      case UnaryOpType::ceil:
+        if (!is_real(from)) {
+          return false;
+        }
+        break;
+      case UnaryOpType::bit_not:
+      case UnaryOpType::popcnt:
+        if (!is_integral(from)) {
+          return false;
+        }
+        break;
+      case UnaryOpType::cast_value:
+      case UnaryOpType::cast_bits:
+        // Casting a vector to u1 would truncate instead of comparing with 0
+        if (to->is_primitive(PrimitiveTypeID::u1) ||
+            !is_lane_type(unary->cast_type)) {
+          return false;
+        }
+        break;
+      default:
+        return false;
+    }
+    if (!emit_vector_op(unary, to)) {
+      return false;
+    }
+    if (unary->is_cast()) {
+      vectors_[unary]->as<UnaryOpStmt>()->cast_type = vector_type(to);
+    }
+    return true;
+  }
+
+  bool vectorize_load(GlobalLoadStmt *load) {
+    auto lanes = info(load->src);
+    auto dt = load->ret_type;
+    if (lanes.varying) {
+      return false;
+    }
+    if (lanes.is_uniform()) {
+      // Loading under a mask may read an address that is only valid in the
+      // active lanes.
+      if (mask_) {
+        return false;
+      }
+      clone_scalar(load, LaneInfo::uniform());
+      return true;
+    }
+    if (!is_lane_type(dt) || dt->is_primitive(PrimitiveTypeID::u1) ||
+        lanes.stride != data_type_size(dt)) {
+      return false;
+    }
+    vectors_[load] = push<VectorLoadStmt>(vector_type(dt), scalar(load->src),
+                                          mask_);
+    info_[load] = LaneInfo::vector();
+    return true;
+  }
+
+  bool vectorize_store(GlobalStoreStmt *store) {
+    auto lanes = info(store->dest);
+    auto dt = store->dest->ret_type.ptr_removed();
+    if (lanes.varying || lanes.is_uniform() || !is_lane_type(dt) ||
+        dt->is_primitive(PrimitiveTypeID::u1) ||
+        lanes.stride != data_type_size(dt) || store->val->ret_type != dt) {
+      return false;
+    }
+    push<VectorStoreStmt>(PrimitiveType::unknown, scalar(store->dest),
+                          vector(store->val), mask_);
+    return true;
+  }
+
+  bool vectorize_if(IfStmt *if_stmt) {
+    auto *cond = if_stmt->cond;
+    if (!is_lane_type(cond->ret_type) || !is_integral(cond->ret_type)) {
+      return false;
+    }
+    auto *cond_vec = vector(cond);
+    auto *zero = broadcast(make_const(cond->ret_type, 0));
+    auto mask_type = vector_type(PrimitiveType::u1);
+    Stmt *true_mask = push<BinaryOpStmt>(mask_type, BinaryOpType::cmp_ne,
+                                         cond_vec, zero);
+    Stmt *false_mask = push<BinaryOpStmt>(mask_type, BinaryOpType::cmp_eq,
+                                          cond_vec, zero);
+    auto *outer_mask = mask_;
+    if (outer_mask) {
+      true_mask = push<BinaryOpStmt>(mask_type, BinaryOpType::bit_and,
+                                     outer_mask, true_mask);
+      false_mask = push<BinaryOpStmt>(mask_type, BinaryOpType::bit_and,
+                                      outer_mask, false_mask);
+    }
+    bool ok = true;
+    if (if_stmt->true_statements) {
+      mask_ = true_mask;
+      ok = vectorize_block(if_stmt->true_statements.get());
+    }
+    if (ok && if_stmt->false_statements) {
+      mask_ = false_mask;
+      ok = vectorize_block(if_stmt->false_statements.get());
+    }
+    mask_ = outer_mask;
+    return ok;
+  }
+
+  // Accumulates an atomic or the store of a "load; op; store" reduction into
+  // the vector accumulator of its destination. The load and the op are
+  // absorbed.
+  bool vectorize_reduction(Stmt *stmt) {
+    if (stmt->is<GlobalLoadStmt>() || stmt->is<BinaryOpStmt>()) {
+      return true;
+    }
+    auto op = reduction_ops_[stmt];
+    Stmt *dest = nullptr, *val = nullptr;
+    bool atomic = false;
+    if (auto *atomic_stmt = stmt->cast<AtomicOpStmt>()) {
+      dest = atomic_stmt->dest;
+      val = atomic_stmt->val;
+      atomic = true;
+    } else {
+      auto *store = stmt->as<GlobalStoreStmt>();
+      auto *bin = store->val->as<BinaryOpStmt>();
+      dest = store->dest;
+      val = bin->lhs->is<GlobalLoadStmt>() &&
+                    bin->lhs->as<GlobalLoadStmt>()->src == dest
+                ? bin->rhs
+                : bin->lhs;
+    }
+    auto dt = dest->ret_type.ptr_removed();
+    if (!info(dest).is_uniform() || !is_loop_invariant(dest) ||
+        !is_reduction_type(dt, op) || val->ret_type != dt) {
+      return false;
+    }
+    auto it = std::find_if(reductions_.begin(), reductions_.end(),
+                           [&](const Reduction &r) { return r.dest == dest; });
+    if (it == reductions_.end()) {
+      Reduction reduction{dest, op};
+      auto *body = out_;
+      out_ = &pre_;
+      reduction.identity = broadcast(push<ConstStmt>(
+          dt, reduction_identity(op, dt)));
+      reduction.accumulator = push<AllocaStmt>(
+          TypeFactory::get_instance().get_pointer_type(vector_type(dt)),
+          std::vector<int>{width_}, dt);
+      push<LocalStoreStmt>(PrimitiveType::unknown, reduction.accumulator,
+                           reduction.identity);
+      out_ = body;
+      reductions_.push_back(reduction);
+      it = reductions_.end() - 1;
+    }
+    it->atomic = it->atomic || atomic;
+    auto *vec = vector(val);
+    if (mask_) {
+      vec = push<TernaryOpStmt>(vec->ret_type, TernaryOpType::select, mask_,
+                                vec, it->identity);
+    }
+    Stmt *acc = push<LocalLoadStmt>(vector_type(dt), it->accumulator);
+    acc = push<BinaryOpStmt>(vector_type(dt), op, acc, vec);
+    push<LocalStoreStmt>(PrimitiveType::unknown, it->accumulator, acc);
+    return true;
+  }
+
+  void emit_reduction(const Reduction &reduction) {
+    auto dt = reduction.dest->ret_type.ptr_removed();
+    Stmt *sum = nullptr;
+    for (int i = 0; i < width_; i++) {
+      auto *lane = push<MatrixPtrStmt>(reduction.accumulator->ret_type,
+                                       reduction.accumulator,
+                                       make_const(PrimitiveType::i32, i));
+      lane->ret_type = TypeFactory::get_instance().get_pointer_type(dt);
+      Stmt *val = push<LocalLoadStmt>(dt, lane);
+      sum = sum ? push<BinaryOpStmt>(dt, reduction.op, sum, val) : val;
+    }
+    auto *dest = clone_after_loop(reduction.dest);
+    if (reduction.atomic) {
+      push<AtomicOpStmt>(dt, binary_to_atomic_op_type(reduction.op), dest,
+                         sum);
+    } else {
+      auto *old = push<GlobalLoadStmt>(dt, dest);
+      push<GlobalStoreStmt>(PrimitiveType::unknown, dest,
+                            push<BinaryOpStmt>(dt, reduction.op, old, sum));
+    }
+  }
+
+  RangeForStmt *loop_;
+  int width_;
+  int log2_width_{0};
+
+  std::unordered_set<Stmt *> body_stmts_;
+  std::unordered_map<Stmt *, int> num_uses_;
+  // Reduction statements => op
+  std::unordered_map<Stmt *, BinaryOpType> reduction_ops_;
+
+  // Statements before the vector loop, in its body and after it
+  VecStatement pre_, body_, post_;
+  VecStatement *out_{nullptr};
+
+  Stmt *base_index_{nullptr};
+  // Lane masks are vectors of u1, nullptr if all the lanes are active
+  Stmt *mask_{nullptr};
+  std::unordered_map<Stmt *, LaneInfo> info_;
+  std::unordered_map<Stmt *, Stmt *> scalars_;
+  std::unordered_map<Stmt *, Stmt *> vectors_;
+  // AllocaStmt => its current value
+  std::unordered_map<Stmt *, Stmt *> locals_;
+  std::unordered_map<Stmt *, Stmt *> post_clones_;
+  std::vector<Reduction> reductions_;
+};
+
+}  // namespace
+
+namespace irpass {
+
+bool vectorize_range_for(IRNode *root, const CompileConfig &config) {
+  TI_AUTO_PROF;
+  // The loops to vectorize are made by make_cpu_multithreaded_range_for, and
+  // the vectors need the TensorType values to be LLVM vectors.
+  if (!arch_is_cpu(config.arch) || !config.make_cpu_multithreading_loop ||
+      config.cpu_guided_range_for() || config.real_matrix_scalarize ||
+      config.force_scalarize_matrix || config.debug) {
+    return false;
+  }
+  int width = 1;
+  while (width * 2 <= std::min(config.simd_width, config.max_vector_width)) {
+    width *= 2;
+  }
+  if (width < 2) {
+    return false;
+  }
+
+  std::vector<RangeForStmt *> loops;
+  auto *block = root->as<Block>();
+  for (auto &stmt : block->statements) {
+    auto *offload = stmt->cast<OffloadedStmt>();
+    if (!offload ||
+        offload->task_type != OffloadedStmt::TaskType::range_for) {
+      continue;
+    }
+    for (auto &s : offload->body->statements) {
+      if (auto *loop = s->cast<RangeForStmt>();
+          loop && loop->strictly_serialized) {
+        loops.push_back(loop);
+      }
+    }
+  }
+
+  bool modified = false;
+  for (auto *loop : loops) {
+    modified |= RangeForVectorizer(loop, width).run();
+  }
+  return modified;
+}
+
+}  // namespace irpass
+
+}  // namespace taichi::lang
@@ -9,39 +9,6 @@
 
 namespace taichi::lang {
 
-// A helper class to maintain WholeKernelCSE::visited
-class MarkUndone : public BasicStmtVisitor {
- private:
-  std::unordered_set<int> *const visited_;
-  Stmt *const modified_operand_;
-
- public:
-  using BasicStmtVisitor::visit;
-
-  MarkUndone(std::unordered_set<int> *visited, Stmt *modified_operand)
-      : visited_(visited), modified_operand_(modified_operand) {
-    allow_undefined_visitor = true;
-    invoke_default_visitor = true;
-  }
-
-  void visit(Stmt *stmt) override {
-    if (stmt->has_operand(modified_operand_)) {
-      visited_->erase(stmt->instance_id);
-    }
-  }
-
-  void preprocess_container_stmt(Stmt *stmt) override {
-    if (stmt->has_operand(modified_operand_)) {
-      visited_->erase(stmt->instance_id);
-    }
-  }
-
-  static void run(std::unordered_set<int> *visited, Stmt *modified_operand) {
-    MarkUndone marker(visited, modified_operand);
-    modified_operand->get_ir_root()->accept(&marker);
-  }
-};
-
 // Whole Kernel Common Subexpression Elimination
 class WholeKernelCSE : public BasicStmtVisitor {
  private:
@@ -49,6 +16,10 @@ class WholeKernelCSE : public BasicStmtVisitor {
   // each scope corresponds to an unordered_set
   std::vector<std::unordered_map<std::size_t, std::unordered_set<Stmt *> > >
       visible_stmts_;
+  // Gathered before each sweep, so that eliminating a statement only touches
+  // its users instead of walking the whole IR.
+  std::unordered_map<Stmt *, std::vector<std::pair<Stmt *, int> > >
+      stmt_usages_;
   DelayedIRModifier modifier_;
 
  public:
@@ -67,6 +38,18 @@ class WholeKernelCSE : public BasicStmtVisitor {
     visited_.insert(stmt->instance_id);
   }
 
+  // The users of old_stmt have a new operand, so they are checked again.
+  void replace_usages_with(Stmt *old_stmt, Stmt *new_stmt) {
+    auto &usages = stmt_usages_[old_stmt];
+    for (auto &[usage, i] : usages) {
+      usage->set_operand(i, new_stmt);
+      visited_.erase(usage->instance_id);
+    }
+    auto &new_usages = stmt_usages_[new_stmt];
+    new_usages.insert(new_usages.end(), usages.begin(), usages.end());
+    usages.clear();
+  }
+
   static std::size_t operand_hash(const Stmt *stmt) {
     std::size_t hash_code{0};
     auto hash_type =
@@ -134,8 +117,7 @@ class WholeKernelCSE : public BasicStmtVisitor {
     for (auto &scope : visible_stmts_) {
       for (auto &prev_stmt : scope[hash_value]) {
         if (common_statement_eliminable(stmt, prev_stmt)) {
-          MarkUndone::run(&visited_, stmt);
-          stmt->replace_usages_with(prev_stmt);
+          replace_usages_with(stmt, prev_stmt);
           modifier_.erase(stmt);
           return;
         }
@@ -207,6 +189,7 @@ class WholeKernelCSE : public BasicStmtVisitor {
     WholeKernelCSE eliminator;
     bool modified = false;
     while (true) {
+      eliminator.stmt_usages_ = irpass::analysis::gather_statement_usages(node);
       node->accept(&eliminator);
       if (eliminator.modifier_.modify_ir())
         modified = true;
@@ -93,7 +93,8 @@ std::size_t clean_offline_cache_files(const std::string &path) {
     const auto ext = taichi::filename_extension(name);
     return ext == kLlvmCacheFilenameBCExt || ext == kLlvmCacheFilenameLLExt ||
            ext == kSpirvCacheFilenameExt || ext == kMetalCacheFilenameExt ||
-           ext == kTiCacheFilenameExt || ext == "lock" || ext == "tcb";
+           ext == kTiCacheFilenameExt || ext == "lock" || ext == "tcb" ||
+           ext == "pack" || ext == "idx";
   };
 
   std::size_t count = 0;
@@ -20,6 +20,7 @@ namespace offline_cache {
 
 constexpr char kLlvmCacheFilenameLLExt[] = "ll";
 constexpr char kLlvmCacheFilenameBCExt[] = "bc";
+constexpr char kLlvmCacheFilenameObjExt[] = "o";
 constexpr char kSpirvCacheFilenameExt[] = "spv";
 constexpr char kMetalCacheFilenameExt[] = "metal";
 constexpr char kTiCacheFilenameExt[] = "tic";
@@ -75,6 +76,16 @@ enum class LoadMetadataError {
   kVersionNotMatched,
 };
 
+// A metadata type whose layout changed within a release declares the previous
+// layout as MetadataType::LegacyMetadata, and MetadataType::from_legacy() to
+// convert it. Files in that layout are converted instead of being misread.
+template <typename T, typename = void>
+struct has_legacy_metadata : std::false_type {};
+
+template <typename T>
+struct has_legacy_metadata<T, std::void_t<typename T::LegacyMetadata>>
+    : std::true_type {};
+
 template <typename MetadataType>
 inline LoadMetadataError load_metadata_with_checking(
     MetadataType &result,
@@ -99,6 +110,16 @@ inline LoadMetadataError load_metadata_with_checking(
     return LoadMetadataError::kVersionNotMatched;
   }
 
+  if constexpr (has_legacy_metadata<MetadataType>::value) {
+    // The legacy layout is a prefix of the current one, so it must be tried
+    // first: reading a legacy file as the current layout runs off its end.
+    typename MetadataType::LegacyMetadata legacy;
+    if (read_from_binary(legacy, bytes.data(), bytes.size())) {
+      result = MetadataType::from_legacy(std::move(legacy));
+      return LoadMetadataError::kNoError;
+    }
+  }
+
   return !read_from_binary(result, bytes.data(), bytes.size())
              ? LoadMetadataError::kCorrupted
              : LoadMetadataError::kNoError;
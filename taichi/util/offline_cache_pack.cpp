@@ -0,0 +1,686 @@
+#include "taichi/util/offline_cache_pack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <unordered_set>
+
+#if defined(TI_PLATFORM_WINDOWS)
+#include "taichi/platform/windows/windows.h"
+#else  // POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace taichi::lang::offline_cache {
+
+namespace {
+
+constexpr char kPackMagic[8] = {'T', 'I', 'C', 'P', 'A', 'C', 'K', '1'};
+constexpr char kIndexMagic[8] = {'T', 'I', 'C', 'I', 'D', 'X', '0', '1'};
+constexpr uint32 kRecordMagic = 0x52434954;  // "TICR"
+constexpr uint64 kMinNumSlots = 1024;
+constexpr uint64 kRecordAlignment = 8;
+
+struct PackHeader {
+  char magic[8];
+  Version version;
+  uint16 padding;
+  uint64 pack_id;  // Tells the index which pack it belongs to
+};
+
+struct RecordHeader {
+  uint32 magic;
+  uint32 key_size;
+  uint64 payload_size;
+  uint64 checksum;  // Of the key and the payload
+  int64 created_at;
+};
+
+struct IndexHeader {
+  char magic[8];
+  Version version;
+  uint16 padding;
+  uint64 pack_id;
+  uint64 pack_size;  // The slots cover the records in [0, pack_size)
+  uint64 num_slots;  // A power of two
+  uint64 num_entries;
+  uint64 total_size;  // Of the payloads
+};
+
+struct IndexSlot {
+  uint64 key_hash;
+  uint64 offset;  // Of the record in the pack; 0 marks an empty slot
+  uint64 payload_size;
+  int64 created_at;
+  int64 last_used_at;
+};
+
+uint64 fnv1a(const void *data,
+             std::size_t size,
+             uint64 h = 0xcbf29ce484222325) {
+  auto *p = (const uint8 *)data;
+  for (std::size_t i = 0; i < size; i++) {
+    h = (h ^ p[i]) * 0x100000001b3;
+  }
+  return h;
+}
+
+uint64 hash_key(std::string_view key) {
+  return fnv1a(key.data(), key.size());
+}
+
+uint64 align_up(uint64 x) {
+  return (x + kRecordAlignment - 1) / kRecordAlignment * kRecordAlignment;
+}
+
+uint64 record_size(uint64 key_size, uint64 payload_size) {
+  return align_up(sizeof(RecordHeader) + key_size + payload_size);
+}
+
+bool is_current_version(const Version &version) {
+  return version[0] == TI_VERSION_MAJOR && version[1] == TI_VERSION_MINOR &&
+         version[2] == TI_VERSION_PATCH;
+}
+
+void set_current_version(Version &version) {
+  version[0] = TI_VERSION_MAJOR;
+  version[1] = TI_VERSION_MINOR;
+  version[2] = TI_VERSION_PATCH;
+}
+
+uint64 make_pack_id() {
+  std::random_device rd;
+  return (uint64(rd()) << 32) ^ rd() ^ uint64(std::time(nullptr));
+}
+
+enum class PackState { kMissing, kOutdated, kValid };
+
+PackState check_pack(const MappedFile &pack, uint64 *pack_id) {
+  if (!pack.data()) {
+    return PackState::kMissing;
+  }
+  if (pack.size() < sizeof(PackHeader)) {
+    return PackState::kOutdated;
+  }
+  auto *header = (const PackHeader *)pack.data();
+  if (std::memcmp(header->magic, kPackMagic, sizeof(kPackMagic)) != 0 ||
+      !is_current_version(header->version)) {
+    return PackState::kOutdated;
+  }
+  *pack_id = header->pack_id;
+  return PackState::kValid;
+}
+
+// Returns the header of |index| if it describes the pack |pack_id| of
+// |pack_size| bytes, nullptr otherwise.
+const IndexHeader *check_index(const MappedFile &index,
+                               uint64 pack_id,
+                               uint64 pack_size) {
+  if (index.size() < sizeof(IndexHeader)) {
+    return nullptr;
+  }
+  auto *header = (const IndexHeader *)index.data();
+  if (std::memcmp(header->magic, kIndexMagic, sizeof(kIndexMagic)) != 0 ||
+      !is_current_version(header->version) || header->pack_id != pack_id ||
+      header->pack_size > pack_size || header->num_slots == 0 ||
+      (header->num_slots & (header->num_slots - 1)) != 0 ||
+      index.size() < sizeof(IndexHeader) +
+                         header->num_slots * sizeof(IndexSlot)) {
+    return nullptr;
+  }
+  return header;
+}
+
+const IndexSlot *index_slots(const MappedFile &index) {
+  return (const IndexSlot *)(index.data() + sizeof(IndexHeader));
+}
+
+struct RecordView {
+  const RecordHeader *header{nullptr};
+  std::string_view key;
+  std::string_view payload;
+  uint64 size{0};
+};
+
+// Reads the record at |offset|, rejecting anything that is not a complete and
+// intact record.
+bool read_record(const MappedFile &pack, uint64 offset, RecordView *record) {
+  if (offset < sizeof(PackHeader) || offset % kRecordAlignment != 0 ||
+      offset + sizeof(RecordHeader) > pack.size()) {
+    return false;
+  }
+  auto *header = (const RecordHeader *)(pack.data() + offset);
+  if (header->magic != kRecordMagic ||
+      header->payload_size > pack.size() ||
+      offset + sizeof(RecordHeader) + header->key_size +
+              header->payload_size >
+          pack.size()) {
+    return false;
+  }
+  auto *key = (const char *)(header + 1);
+  record->header = header;
+  record->key = std::string_view(key, header->key_size);
+  record->payload =
+      std::string_view(key + header->key_size, header->payload_size);
+  record->size = record_size(header->key_size, header->payload_size);
+  return fnv1a(record->payload.data(), record->payload.size(),
+               hash_key(record->key)) == header->checksum;
+}
+
+// Calls |f| on every intact record from |offset| on, and returns the offset
+// right after the last one.
+template <typename F>
+uint64 scan_records(const MappedFile &pack, uint64 offset, F &&f) {
+  RecordView record;
+  while (read_record(pack, offset, &record)) {
+    f(offset, record);
+    offset += record.size;
+  }
+  return offset;
+}
+
+void write_record(std::ostream &os,
+                  const std::string &key,
+                  std::string_view payload,
+                  int64 created_at) {
+  RecordHeader header{};
+  header.magic = kRecordMagic;
+  header.key_size = key.size();
+  header.payload_size = payload.size();
+  header.checksum = fnv1a(payload.data(), payload.size(), hash_key(key));
+  header.created_at = created_at;
+  os.write((const char *)&header, sizeof(header));
+  os.write(key.data(), key.size());
+  os.write(payload.data(), payload.size());
+  const char zeros[kRecordAlignment] = {};
+  os.write(zeros, record_size(key.size(), payload.size()) - sizeof(header) -
+                      key.size() - payload.size());
+}
+
+void write_pack_header(std::ostream &os, uint64 pack_id) {
+  PackHeader header{};
+  std::memcpy(header.magic, kPackMagic, sizeof(kPackMagic));
+  set_current_version(header.version);
+  header.pack_id = pack_id;
+  os.write((const char *)&header, sizeof(header));
+}
+
+bool replace_file(const std::string &from, const std::string &to) {
+  std::error_code ec;
+  std::filesystem::rename(from, to, ec);
+  if (ec) {
+    // E.g. |to| is still mapped by another process on Windows
+    TI_DEBUG("Replace {} failed: {}", to, ec.message());
+    taichi::remove(from);
+    return false;
+  }
+  return true;
+}
+
+// The whole index of a pack in memory, as seen by a writer holding the lock.
+struct Table {
+  MappedFile pack;
+  PackState pack_state{PackState::kMissing};
+  uint64 pack_id{0};
+  // Where the next record goes
+  uint64 pack_end{sizeof(PackHeader)};
+  // Set if the index file must be written from scratch
+  bool rebuild{true};
+  uint64 num_entries{0};
+  uint64 total_size{0};
+  std::vector<IndexSlot> slots;
+  // Slots inserted or updated since the index was read
+  std::vector<uint64> dirty_slots;
+  // Keys of the records appended after |pack| was mapped
+  std::unordered_map<uint64, std::string> appended_keys;
+
+  Table(const std::string &pack_path, const std::string &index_path)
+      : pack(pack_path) {
+    pack_state = check_pack(pack, &pack_id);
+    if (pack_state != PackState::kValid) {
+      pack_id = make_pack_id();
+      return;
+    }
+    MappedFile index(index_path);
+    uint64 covered = sizeof(PackHeader);
+    if (auto *header = check_index(index, pack_id, pack.size())) {
+      auto *begin = index_slots(index);
+      slots.assign(begin, begin + header->num_slots);
+      num_entries = header->num_entries;
+      total_size = header->total_size;
+      covered = header->pack_size;
+      rebuild = false;
+    }
+    // Index the records appended after the index was last written
+    pack_end = scan_records(pack, covered, [&](uint64 offset,
+                                               const RecordView &record) {
+      if (find(std::string(record.key))) {
+        return;
+      }
+      IndexSlot slot{};
+      slot.key_hash = hash_key(record.key);
+      slot.offset = offset;
+      slot.payload_size = record.payload.size();
+      slot.created_at = slot.last_used_at = record.header->created_at;
+      insert(slot);
+    });
+    // Leave whatever a crashed writer left behind alone
+    pack_end = std::max(pack_end, align_up(pack.size()));
+  }
+
+  std::string_view key_at(uint64 offset) const {
+    RecordView record;
+    if (read_record(pack, offset, &record)) {
+      return record.key;
+    }
+    auto iter = appended_keys.find(offset);
+    return iter == appended_keys.end() ? std::string_view()
+                                       : std::string_view(iter->second);
+  }
+
+  IndexSlot *find(const std::string &key) {
+    if (slots.empty()) {
+      return nullptr;
+    }
+    const auto mask = slots.size() - 1;
+    const auto h = hash_key(key);
+    for (auto i = h & mask; slots[i].offset != 0; i = (i + 1) & mask) {
+      if (slots[i].key_hash == h && key_at(slots[i].offset) == key) {
+        return &slots[i];
+      }
+    }
+    return nullptr;
+  }
+
+  // Call after changing a slot returned by find().
+  void mark_dirty(const IndexSlot *slot) {
+    dirty_slots.push_back(slot - slots.data());
+  }
+
+  void insert(const IndexSlot &slot) {
+    // Keep the load factor at most 1/2, so that probe sequences stay short.
+    if ((num_entries + 1) * 2 > slots.size()) {
+      std::vector<IndexSlot> old_slots(
+          std::max<uint64>(kMinNumSlots, slots.size() * 2));
+      std::swap(slots, old_slots);
+      rebuild = true;
+      for (const auto &s : old_slots) {
+        if (s.offset != 0) {
+          place(s);
+        }
+      }
+    }
+    dirty_slots.push_back(place(slot));
+    num_entries++;
+    total_size += slot.payload_size;
+  }
+
+  uint64 place(const IndexSlot &slot) {
+    const auto mask = slots.size() - 1;
+    auto i = slot.key_hash & mask;
+    while (slots[i].offset != 0) {
+      i = (i + 1) & mask;
+    }
+    slots[i] = slot;
+    return i;
+  }
+
+  IndexHeader make_index_header() const {
+    IndexHeader header{};
+    std::memcpy(header.magic, kIndexMagic, sizeof(kIndexMagic));
+    set_current_version(header.version);
+    header.pack_id = pack_id;
+    header.pack_size = pack_end;
+    header.num_slots = slots.size();
+    header.num_entries = num_entries;
+    header.total_size = total_size;
+    return header;
+  }
+
+  void write_index(const std::string &index_path) const {
+    const auto header = make_index_header();
+    if (!rebuild) {
+      // Slots first, then the header that makes them count
+      std::fstream fs(index_path,
+                      std::ios::in | std::ios::out | std::ios::binary);
+      if (fs.is_open()) {
+        for (auto i : dirty_slots) {
+          fs.seekp(sizeof(IndexHeader) + i * sizeof(IndexSlot));
+          fs.write((const char *)&slots[i], sizeof(IndexSlot));
+        }
+        fs.seekp(0);
+        fs.write((const char *)&header, sizeof(header));
+        if (fs) {
+          return;
+        }
+      }
+    }
+    const auto tmp_path = index_path + ".tmp";
+    {
+      std::ofstream fs(tmp_path, std::ios::out | std::ios::binary);
+      TI_ASSERT(fs.is_open());
+      fs.write((const char *)&header, sizeof(header));
+      fs.write((const char *)slots.data(), slots.size() * sizeof(IndexSlot));
+    }
+    // A stale index is only slower to open: the records it does not cover
+    // are scanned.
+    replace_file(tmp_path, index_path);
+  }
+
+  template <typename F>
+  void for_each_entry(F &&f) const {
+    for (const auto &slot : slots) {
+      if (slot.offset != 0) {
+        f(slot);
+      }
+    }
+  }
+};
+
+}  // namespace
+
+MappedFile::MappedFile(const std::string &path) {
+#if defined(TI_PLATFORM_WINDOWS)
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE |
+                                FILE_SHARE_DELETE,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return;
+  }
+  LARGE_INTEGER size;
+  if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+    HANDLE mapping =
+        CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping) {
+      // The view keeps the mapping (and the file) alive.
+      if (auto *ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) {
+        data_ = (const uint8 *)ptr;
+        size_ = size.QuadPart;
+      }
+      CloseHandle(mapping);
+    }
+  }
+  CloseHandle(file);
+#else
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+    void *ptr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (ptr != MAP_FAILED) {
+      data_ = (const uint8 *)ptr;
+      size_ = st.st_size;
+    }
+  }
+  ::close(fd);
+#endif
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : data_(other.data_), size_(other.size_) {
+  other.data_ = nullptr;
+  other.size_ = 0;
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+  if (this != &other) {
+    unmap();
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+  }
+  return *this;
+}
+
+MappedFile::~MappedFile() {
+  unmap();
+}
+
+void MappedFile::unmap() {
+  if (data_) {
+#if defined(TI_PLATFORM_WINDOWS)
+    UnmapViewOfFile(data_);
+#else
+    ::munmap((void *)data_, size_);
+#endif
+  }
+  data_ = nullptr;
+  size_ = 0;
+}
+
+CachePack::CachePack(std::string path, std::string lock_name)
+    : path_(std::move(path)), lock_name_(std::move(lock_name)) {
+}
+
+void CachePack::open() {
+  opened_ = true;
+  pack_ = MappedFile(join_path(path_, kPackFilename));
+  uint64 pack_id{0};
+  if (check_pack(pack_, &pack_id) != PackState::kValid) {
+    pack_ = MappedFile();
+    return;
+  }
+  index_ = MappedFile(join_path(path_, kIndexFilename));
+  uint64 covered = sizeof(PackHeader);
+  if (auto *header = check_index(index_, pack_id, pack_.size())) {
+    index_valid_ = true;
+    covered = header->pack_size;
+  } else {
+    index_ = MappedFile();
+  }
+  scan_records(pack_, covered, [&](uint64 offset, const RecordView &record) {
+    unindexed_.emplace(record.key, offset);
+  });
+  TI_DEBUG("Opened cache pack {} ({} bytes, {} unindexed records)", path_,
+           pack_.size(), unindexed_.size());
+}
+
+std::optional<std::string_view> CachePack::find(const std::string &key) {
+  if (!opened_) {
+    open();
+  }
+  RecordView record;
+  if (index_valid_) {
+    auto *header = (const IndexHeader *)index_.data();
+    auto *slots = index_slots(index_);
+    const auto mask = header->num_slots - 1;
+    const auto h = hash_key(key);
+    // Writers may update the slots under our feet; bound the probing and let
+    // read_record() reject anything torn.
+    for (uint64 i = h & mask, n = 0; n < header->num_slots;
+         i = (i + 1) & mask, n++) {
+      const auto offset = slots[i].offset;
+      if (offset == 0) {
+        break;
+      }
+      if (slots[i].key_hash == h && read_record(pack_, offset, &record) &&
+          record.key == key) {
+        return record.payload;
+      }
+    }
+  }
+  auto iter = unindexed_.find(key);
+  if (iter != unindexed_.end() && read_record(pack_, iter->second, &record)) {
+    return record.payload;
+  }
+  return std::nullopt;
+}
+
+bool CachePack::commit(const std::vector<Record> &records,
+                       const std::vector<std::string> &used_keys) {
+  if (records.empty() && used_keys.empty()) {
+    return true;
+  }
+  taichi::create_directories(path_);
+  const auto lock_path = join_path(path_, lock_name_);
+  if (!lock_with_file(lock_path)) {
+    TI_WARN("Lock {} failed. Please run 'ti cache clean -p {}' and try again.",
+            lock_path, path_);
+    return false;
+  }
+  auto _ = make_unlocker(lock_path);
+
+  const auto pack_path = join_path(path_, kPackFilename);
+  const auto index_path = join_path(path_, kIndexFilename);
+  Table table(pack_path, index_path);
+  const int64 now = std::time(nullptr);
+
+  std::vector<const Record *> new_records;
+  std::unordered_set<std::string_view> new_keys;
+  for (const auto &r : records) {
+    if (!table.find(r.key) && new_keys.insert(r.key).second) {
+      new_records.push_back(&r);
+    }
+  }
+
+  if (table.pack_state != PackState::kValid) {
+    // Start a new pack. It is written aside and renamed over the old one, so
+    // that processes still mapping the old one are not affected.
+    const auto tmp_path = pack_path + ".tmp";
+    {
+      std::ofstream fs(tmp_path, std::ios::out | std::ios::binary);
+      TI_ASSERT(fs.is_open());
+      write_pack_header(fs, table.pack_id);
+      for (const auto *r : new_records) {
+        write_record(fs, r->key, r->payload, now);
+      }
+    }
+    if (!replace_file(tmp_path, pack_path)) {
+      return false;
+    }
+  } else if (!new_records.empty()) {
+    std::ofstream fs(pack_path,
+                     std::ios::in | std::ios::out | std::ios::binary);
+    TI_ASSERT(fs.is_open());
+    fs.seekp(table.pack_end);
+    for (const auto *r : new_records) {
+      write_record(fs, r->key, r->payload, now);
+    }
+    TI_ASSERT(!!fs);
+  }
+
+  for (const auto *r : new_records) {
+    IndexSlot slot{};
+    slot.key_hash = hash_key(r->key);
+    slot.offset = table.pack_end;
+    slot.payload_size = r->payload.size();
+    slot.created_at = slot.last_used_at = now;
+    table.appended_keys[slot.offset] = r->key;
+    table.insert(slot);
+    table.pack_end += record_size(r->key.size(), r->payload.size());
+  }
+  for (const auto &key : used_keys) {
+    if (auto *slot = table.find(key)) {
+      slot->last_used_at = now;
+      table.mark_dirty(slot);
+    }
+  }
+  table.write_index(index_path);
+  return true;
+}
+
+void CachePack::clean(CleanCachePolicy policy,
+                      std::size_t max_size,
+                      double cleaning_factor) {
+  if (policy == (std::size_t)NotClean || !taichi::path_exists(path_)) {
+    return;
+  }
+  const auto lock_path = join_path(path_, lock_name_);
+  if (!lock_with_file(lock_path)) {
+    TI_WARN("Lock {} failed. You can run 'ti cache clean -p {}' and try again.",
+            lock_path, path_);
+    return;
+  }
+  auto _ = make_unlocker(lock_path);
+
+  const auto pack_path = join_path(path_, kPackFilename);
+  const auto index_path = join_path(path_, kIndexFilename);
+  Table table(pack_path, index_path);
+  if (table.pack_state == PackState::kMissing) {
+    return;
+  }
+  if (table.pack_state == PackState::kOutdated) {
+    if (policy & CleanOldVersion) {
+      TI_DEBUG("Removing the outdated cache pack {}", pack_path);
+      taichi::remove(pack_path);
+      taichi::remove(index_path);
+    }
+    return;
+  }
+
+  std::vector<IndexSlot> entries;
+  table.for_each_entry([&](const IndexSlot &slot) { entries.push_back(slot); });
+  const auto num_to_remove =
+      static_cast<std::size_t>(cleaning_factor * entries.size());
+  if (table.total_size < max_size || num_to_remove == 0) {
+    return;
+  }
+  int64 IndexSlot::*time_field = nullptr;
+  if (policy & CleanOldUsed) {  // LRU
+    time_field = &IndexSlot::last_used_at;
+  } else if (policy & CleanOldCreated) {  // FIFO
+    time_field = &IndexSlot::created_at;
+  } else {
+    return;
+  }
+  std::sort(entries.begin(), entries.end(),
+            [&](const IndexSlot &a, const IndexSlot &b) {
+              return a.*time_field < b.*time_field;
+            });
+  entries.erase(entries.begin(), entries.begin() + num_to_remove);
+  if (entries.empty()) {
+    taichi::remove(pack_path);
+    taichi::remove(index_path);
+    return;
+  }
+
+  // Compact the survivors into a new pack, in their original order
+  std::sort(entries.begin(), entries.end(),
+            [](const IndexSlot &a, const IndexSlot &b) {
+              return a.offset < b.offset;
+            });
+  Table compacted(/*pack_path=*/"", /*index_path=*/"");
+  const auto tmp_path = pack_path + ".tmp";
+  {
+    std::ofstream fs(tmp_path, std::ios::out | std::ios::binary);
+    TI_ASSERT(fs.is_open());
+    write_pack_header(fs, compacted.pack_id);
+    for (auto slot : entries) {
+      RecordView record;
+      TI_ASSERT(read_record(table.pack, slot.offset, &record));
+      fs.write((const char *)record.header, record.size);
+      slot.offset = compacted.pack_end;
+      compacted.insert(slot);
+      compacted.pack_end += record.size;
+    }
+  }
+  TI_DEBUG("Removed {} kernels from the cache pack {}", num_to_remove,
+           pack_path);
+  if (replace_file(tmp_path, pack_path)) {
+    compacted.write_index(index_path);
+  }
+}
+
+std::vector<CachePack::Entry> CachePack::list_entries() const {
+  std::vector<Entry> result;
+  Table table(join_path(path_, kPackFilename),
+              join_path(path_, kIndexFilename));
+  table.for_each_entry([&](const IndexSlot &slot) {
+    Entry e;
+    e.key = table.key_at(slot.offset);
+    e.size = slot.payload_size;
+    e.created_at = slot.created_at;
+    e.last_used_at = slot.last_used_at;
+    result.push_back(std::move(e));
+  });
+  return result;
+}
+
+}  // namespace taichi::lang::offline_cache
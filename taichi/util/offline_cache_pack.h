@@ -0,0 +1,109 @@
+#pragma once
+
+#include <ctime>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "taichi/util/offline_cache.h"
+
+namespace taichi::lang {
+namespace offline_cache {
+
+// A read-only mapping of a whole file.
+class MappedFile {
+ public:
+  MappedFile() = default;
+  explicit MappedFile(const std::string &path);
+  MappedFile(MappedFile &&other) noexcept;
+  MappedFile &operator=(MappedFile &&other) noexcept;
+  ~MappedFile();
+
+  const uint8 *data() const {
+    return data_;
+  }
+
+  std::size_t size() const {
+    return size_;
+  }
+
+ private:
+  void unmap();
+
+  const uint8 *data_{nullptr};
+  std::size_t size_{0};
+};
+
+// Holds all the cached kernels of a directory in two files:
+//
+//   ticache.pack  An append-only sequence of records, each holding a kernel
+//                 key and its serialized CompiledKernelData.
+//   ticache.idx   An open-addressing hash table from key hashes to record
+//                 offsets, covering the pack up to a recorded size.
+//
+// Both files are mapped and nothing is parsed up front: a lookup hashes the
+// key, probes the index and compares the key stored in the record. Only the
+// records the index does not cover yet (e.g. left by a writer that crashed
+// half-way) are scanned when the pack is opened.
+//
+// Writers append records and update the index while holding the cache lock
+// file. Bytes already in the pack are never modified and the pack is never
+// truncated: cleaning writes new files and renames them over the old ones.
+// Readers take no lock and validate every record they reach, so a concurrent
+// writer can at worst make them miss.
+class CachePack {
+ public:
+  static constexpr char kPackFilename[] = "ticache.pack";
+  static constexpr char kIndexFilename[] = "ticache.idx";
+
+  struct Record {
+    std::string key;
+    std::string payload;
+  };
+
+  struct Entry {
+    std::string key;
+    std::size_t size{0};  // byte
+    std::time_t created_at{0};
+    std::time_t last_used_at{0};
+  };
+
+  CachePack(std::string path, std::string lock_name);
+
+  // Returns the payload stored under |key|. The view remains valid as long as
+  // the CachePack does.
+  std::optional<std::string_view> find(const std::string &key);
+
+  // Appends the |records| whose keys are not in the pack yet, and marks
+  // |used_keys| as used now. Returns false if the cache cannot be locked.
+  bool commit(const std::vector<Record> &records,
+              const std::vector<std::string> &used_keys);
+
+  // Same policies as CacheCleaner, applied to the records of the pack.
+  void clean(CleanCachePolicy policy,
+             std::size_t max_size,
+             double cleaning_factor);
+
+  // Reads the entries currently on disk (for tools and tests)
+  std::vector<Entry> list_entries() const;
+
+ private:
+  struct Snapshot;
+
+  void open();
+
+  std::string path_;
+  std::string lock_name_;
+
+  // The state find() works on, loaded by the first lookup
+  bool opened_{false};
+  MappedFile pack_;
+  MappedFile index_;
+  bool index_valid_{false};
+  std::unordered_map<std::string, uint64> unindexed_;  // key -> offset
+};
+
+}  // namespace offline_cache
+}  // namespace taichi::lang
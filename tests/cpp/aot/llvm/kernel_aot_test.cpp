@@ -1,5 +1,7 @@
 #include "gtest/gtest.h"
 
+#include <filesystem>
+
 #include "taichi/program/kernel_profiler.h"
 #include "taichi/runtime/llvm/llvm_runtime_executor.h"
 #include "taichi/runtime/llvm/llvm_aot_module_loader.h"
@@ -20,7 +22,10 @@
 
 namespace taichi::lang {
 
-TEST(LlvmAotTest, CpuKernel) {
+namespace {
+
+void run_cpu_kernel(const std::string &module_path,
+                    std::size_t expected_native_kernels) {
   CompileConfig cfg;
   cfg.arch = Arch::x64;
   cfg.kernel_profiler = false;
@@ -36,11 +41,7 @@ TEST(LlvmAotTest, CpuKernel) {
   Ndarray arr = Ndarray(arr_devalloc, PrimitiveType::i32, {kArrLen});
 
   LLVM::AotModuleParams aot_params;
-  const auto folder_dir = getenv("TAICHI_AOT_FOLDER_PATH");
-
-  std::stringstream aot_mod_ss;
-  aot_mod_ss << folder_dir;
-  aot_params.module_path = aot_mod_ss.str();
+  aot_params.module_path = module_path;
   aot_params.executor_ = &exec;
   aot_params.kernel_launcher =
       std::make_unique<cpu::KernelLauncher>(cpu::KernelLauncher::Config{&exec});
@@ -48,6 +49,9 @@ TEST(LlvmAotTest, CpuKernel) {
       LLVM::make_aot_module(std::move(aot_params));
 
   auto *k_run = mod->get_kernel("run");
+  auto *llvm_mod = dynamic_cast<LLVM::LlvmAotModule *>(mod.get());
+  ASSERT_NE(llvm_mod, nullptr);
+  EXPECT_EQ(llvm_mod->get_num_native_kernels(), expected_native_kernels);
 
   LaunchContextBuilder builder(k_run);
   builder.set_arg({0}, /*v=*/0);
@@ -65,6 +69,35 @@ TEST(LlvmAotTest, CpuKernel) {
   }
 }
 
+}  // namespace
+
+TEST(LlvmAotTest, CpuKernel) {
+  const auto folder_dir = getenv("TAICHI_AOT_FOLDER_PATH");
+  // The kernel is linked from its native object
+  EXPECT_TRUE(std::filesystem::exists(
+      std::filesystem::path(folder_dir) /
+      fmt::format("run.{}", offline_cache::kLlvmCacheFilenameObjExt)));
+  run_cpu_kernel(folder_dir, /*expected_native_kernels=*/1);
+}
+
+TEST(LlvmAotTest, CpuKernelWithoutNativeObjects) {
+  namespace fs = std::filesystem;
+  const auto folder_dir = getenv("TAICHI_AOT_FOLDER_PATH");
+  const auto module_path =
+      fs::temp_directory_path() / "ti_cpu_kernel_without_native_objects";
+  fs::remove_all(module_path);
+  fs::copy(folder_dir, module_path, fs::copy_options::recursive);
+  for (const auto &entry : fs::directory_iterator(module_path)) {
+    if (entry.path().extension() ==
+        fmt::format(".{}", offline_cache::kLlvmCacheFilenameObjExt)) {
+      fs::remove(entry.path());
+    }
+  }
+  // Falls back to compiling the bitcode
+  run_cpu_kernel(module_path.string(), /*expected_native_kernels=*/0);
+  fs::remove_all(module_path);
+}
+
 TEST(LlvmAotTest, CudaKernel) {
 #ifdef TI_WITH_CUDA
   if (is_cuda_api_available()) {
@@ -0,0 +1,298 @@
+#include "gtest/gtest.h"
+
+#ifdef TI_WITH_FLAGOS
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <vector>
+
+#include "taichi/codegen/llvm/compiled_kernel_data.h"
+#include "taichi/ir/ir_builder.h"
+#include "taichi/ir/statements.h"
+#include "taichi/rhi/flagos/flagos_device.h"
+#include "taichi/rhi/flagos/flagos_sim.h"
+#include "tests/cpp/program/test_program.h"
+
+namespace taichi {
+namespace lang {
+
+namespace {
+
+struct GridStrideContext {
+  int n{0};
+  std::atomic<int> *visits{nullptr};
+};
+
+// A grid-stride loop, like the ones the FlagOS codegen emits for range-fors
+void grid_stride_task(void *context) {
+  auto &ctx = *(GridStrideContext *)context;
+  const auto &dims = flagos::SimContext::current_dims();
+  const int stride = dims.block_dim * dims.grid_dim;
+  for (int i = dims.block_idx * dims.block_dim + dims.thread_idx; i < ctx.n;
+       i += stride) {
+    ctx.visits[i].fetch_add(1);
+  }
+}
+
+// Runs Taichi kernels through the FlagOS codegen and kernel launcher on the
+// "sim" chip
+class FlagosSimKernelTest : public ::testing::Test {
+ protected:
+  static constexpr int kNumHostThreads = 4;
+
+  void SetUp() override {
+    saved_config_ = default_compile_config;
+    default_compile_config.flagos_chip = "sim";
+    default_compile_config.cpu_max_num_threads = kNumHostThreads;
+    test_prog_.setup(Arch::flagos);
+  }
+
+  void TearDown() override {
+    default_compile_config = saved_config_;
+  }
+
+  Program *prog() {
+    return test_prog_.prog();
+  }
+
+  const LLVM::CompiledKernelData &compile(Kernel &kernel) {
+    const auto &ckd = prog()->compile_kernel(prog()->compile_config(),
+                                             prog()->get_device_caps(), kernel);
+    return dynamic_cast<const LLVM::CompiledKernelData &>(ckd);
+  }
+
+  const std::vector<OffloadedTask> &tasks_of(Kernel &kernel) {
+    return compile(kernel).get_internal_data().compiled_data.tasks;
+  }
+
+  void launch(Kernel &kernel, LaunchContextBuilder &ctx) {
+    prog()->launch_kernel(compile(kernel), ctx);
+  }
+
+  // for i in range(n): a[i] = i * 3
+  // where n is the scalar argument, or |const_n| if it is not negative
+  std::unique_ptr<Kernel> make_fill_kernel(int const_n = -1) {
+    IRBuilder builder;
+    auto *arr = builder.create_ndarray_arg_load(/*arg_id=*/{0},
+                                                get_data_type<int>(), 1, 0);
+    Stmt *end = nullptr;
+    if (const_n >= 0) {
+      end = builder.get_int32(const_n);
+    } else {
+      end = builder.create_arg_load(/*arg_id=*/{1}, get_data_type<int>(),
+                                    /*is_ptr=*/false, /*arg_depth=*/0);
+    }
+    auto *loop = builder.create_range_for(builder.get_int32(0), end);
+    {
+      auto _ = builder.get_loop_guard(loop);
+      auto *i = builder.get_loop_index(loop);
+      builder.create_global_store(builder.create_external_ptr(arr, {i}),
+                                  builder.create_mul(i, builder.get_int32(3)));
+    }
+    auto kernel =
+        std::make_unique<Kernel>(*prog(), builder.extract_ir(), "fill");
+    kernel->insert_ndarray_param(get_data_type<int>(), /*total_dim=*/1);
+    kernel->insert_scalar_param(get_data_type<int>());
+    kernel->finalize_params();
+    kernel->finalize_rets();
+    return kernel;
+  }
+
+  // Launches a fill kernel on an array of |n| elements and checks them all
+  void run_fill_kernel(Kernel &kernel, int n) {
+    std::vector<int> arr(n, -1);
+    auto ctx = kernel.make_launch_context();
+    ctx.set_arg_external_array_with_shape(/*arg_id=*/{0}, (uint64)arr.data(),
+                                          n * sizeof(int), {n});
+    ctx.set_arg_int(/*arg_id=*/{1}, n);
+    launch(kernel, ctx);
+    for (int i = 0; i < n; i++) {
+      ASSERT_EQ(arr[i], i * 3) << "i=" << i;
+    }
+  }
+
+ private:
+  CompileConfig saved_config_;
+  TestProgram test_prog_;
+};
+
+}  // namespace
+
+TEST(FlagosSim, AllocAndCopy) {
+  flagos::SimContext sim(1 << 20, 2);
+  auto *ptr = (int *)sim.allocate_memory(400);
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_EQ((std::uintptr_t)ptr % flagos::SimContext::kAlignment, 0);
+  EXPECT_EQ(sim.get_used_memory(), 512);
+
+  std::vector<int> src(100), dst(100);
+  for (int i = 0; i < 100; i++) {
+    src[i] = i;
+  }
+  sim.memcpy_host_to_device(ptr, src.data(), 400);
+  sim.memcpy_device_to_device(ptr + 50, ptr, 200);
+  sim.memcpy_device_to_host(dst.data(), ptr, 400);
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(dst[i], i % 50);
+  }
+
+  // The last byte of the allocation is still in bounds, the next one is not
+  EXPECT_THROW(sim.memset(ptr, 0, 513), std::string);
+  EXPECT_THROW(sim.memcpy_device_to_host(dst.data(), src.data(), 4),
+               std::string);
+
+  sim.free_memory(ptr);
+  EXPECT_EQ(sim.get_used_memory(), 0);
+  EXPECT_THROW(sim.free_memory(src.data()), std::string);
+}
+
+TEST(FlagosSim, OutOfMemory) {
+  flagos::SimContext sim(1024, 1);
+  void *a = sim.allocate_memory(1000);
+  ASSERT_NE(a, nullptr);
+  EXPECT_EQ(sim.allocate_memory(1), nullptr);
+  sim.free_memory(a);
+  EXPECT_NE(sim.allocate_memory(1024), nullptr);
+}
+
+TEST(FlagosSim, LaunchCoversEveryIndexOnce) {
+  flagos::SimContext sim(1 << 20, 4);
+  for (auto [grid_dim, block_dim] :
+       std::vector<std::pair<int, int>>{{1, 1}, {3, 7}, {16, 64}, {64, 16}}) {
+    constexpr int n = 10007;
+    std::vector<std::atomic<int>> visits(n);
+    GridStrideContext ctx;
+    ctx.n = n;
+    ctx.visits = visits.data();
+    sim.launch(grid_stride_task, &ctx, grid_dim, block_dim);
+    for (int i = 0; i < n; i++) {
+      ASSERT_EQ(visits[i].load(), 1) << grid_dim << "x" << block_dim;
+    }
+  }
+  // Outside of a launch, the caller is the only thread of a 1x1 grid
+  EXPECT_EQ(flagos::SimContext::current_dims().grid_dim, 1);
+  EXPECT_EQ(flagos::SimContext::current_dims().thread_idx, 0);
+}
+
+TEST(FlagosSim, DeviceAllocAndMap) {
+  flagos::FlagosDevice device;
+  device.initialize("sim", 2);
+  EXPECT_TRUE(device.is_simulated());
+
+  Device::AllocParams params;
+  params.size = 400;
+  params.host_read = true;
+  params.host_write = true;
+  DeviceAllocation device_alloc;
+  ASSERT_EQ(device.allocate_memory(params, &device_alloc), RhiResult::success);
+
+  void *mapped;
+  EXPECT_EQ(device.map(device_alloc, &mapped), RhiResult::success);
+  int *mapped_int = reinterpret_cast<int *>(mapped);
+  for (int i = 0; i < params.size / sizeof(int); i++) {
+    mapped_int[i] = i;
+  }
+  device.unmap(device_alloc);
+
+  std::vector<int> readback(params.size / sizeof(int));
+  DevicePtr src = device_alloc.get_ptr(0);
+  void *dst = readback.data();
+  std::size_t size = params.size;
+  EXPECT_EQ(device.readback_data(&src, &dst, &size), RhiResult::success);
+  for (int i = 0; i < readback.size(); i++) {
+    EXPECT_EQ(readback[i], i);
+  }
+  device.dealloc_memory(device_alloc);
+}
+
+TEST(FlagosSim, DeviceReportsHostThreadsAsComputeUnits) {
+  flagos::FlagosDevice device;
+  device.initialize("sim", 3);
+  EXPECT_EQ(device.get_num_compute_units(), 3);
+}
+
+TEST_F(FlagosSimKernelTest, GridIsSizedFromComputeUnits) {
+  const auto &config = prog()->compile_config();
+  EXPECT_EQ(config.saturating_grid_dim, kNumHostThreads * 4);
+  const int block_dim = config.default_gpu_block_dim;
+
+  // Dynamic bounds launch a saturating grid
+  auto dynamic_fill = make_fill_kernel();
+  const auto &dynamic_tasks = tasks_of(*dynamic_fill);
+  ASSERT_EQ(dynamic_tasks.size(), 1);
+  EXPECT_EQ(dynamic_tasks[0].grid_dim, config.saturating_grid_dim);
+  EXPECT_EQ(dynamic_tasks[0].block_dim, block_dim);
+
+  // Constant bounds launch no more blocks than they have iterations for
+  for (int n : {1, block_dim, 3 * block_dim + 1, 100 * block_dim}) {
+    auto fill = make_fill_kernel(n);
+    const auto &tasks = tasks_of(*fill);
+    ASSERT_EQ(tasks.size(), 1);
+    const int expected_grid_dim =
+        std::min(config.saturating_grid_dim, (n + block_dim - 1) / block_dim);
+    EXPECT_EQ(tasks[0].grid_dim, expected_grid_dim) << "n=" << n;
+    EXPECT_EQ(tasks[0].block_dim, block_dim);
+    run_fill_kernel(*fill, n);
+  }
+}
+
+TEST_F(FlagosSimKernelTest, RangeFor) {
+  auto fill = make_fill_kernel();
+  // Fewer iterations than threads, one partial block, and many grid strides
+  for (int n : {1, 127, 129, 100003}) {
+    run_fill_kernel(*fill, n);
+  }
+}
+
+TEST_F(FlagosSimKernelTest, Reduction) {
+  // for i in range(n):
+  //   out[0] += a[i]
+  //   ti.atomic_max(out[1], a[i])
+  IRBuilder builder;
+  auto *a = builder.create_ndarray_arg_load(/*arg_id=*/{0},
+                                            get_data_type<int>(), 1, 0);
+  auto *out = builder.create_ndarray_arg_load(/*arg_id=*/{1},
+                                              get_data_type<int>(), 1, 0);
+  auto *n = builder.create_arg_load(/*arg_id=*/{2}, get_data_type<int>(),
+                                    /*is_ptr=*/false, /*arg_depth=*/0);
+  auto *loop = builder.create_range_for(builder.get_int32(0), n);
+  {
+    auto _ = builder.get_loop_guard(loop);
+    auto *i = builder.get_loop_index(loop);
+    auto *ai = builder.create_global_load(builder.create_external_ptr(a, {i}));
+    builder.create_atomic_add(
+        builder.create_external_ptr(out, {builder.get_int32(0)}), ai);
+    builder.create_atomic_max(
+        builder.create_external_ptr(out, {builder.get_int32(1)}), ai);
+  }
+  auto kernel =
+      std::make_unique<Kernel>(*prog(), builder.extract_ir(), "reduce");
+  kernel->insert_ndarray_param(get_data_type<int>(), /*total_dim=*/1);
+  kernel->insert_ndarray_param(get_data_type<int>(), /*total_dim=*/1);
+  kernel->insert_scalar_param(get_data_type<int>());
+  kernel->finalize_params();
+  kernel->finalize_rets();
+
+  constexpr int kN = 100003;
+  std::vector<int> arr(kN);
+  for (int i = 0; i < kN; i++) {
+    arr[i] = (i * 7919) % 1000;
+  }
+  const int expected_sum = std::accumulate(arr.begin(), arr.end(), 0);
+  const int expected_max = *std::max_element(arr.begin(), arr.end());
+
+  std::vector<int> result = {0, 0};
+  auto ctx = kernel->make_launch_context();
+  ctx.set_arg_external_array_with_shape(/*arg_id=*/{0}, (uint64)arr.data(),
+                                        kN * sizeof(int), {kN});
+  ctx.set_arg_external_array_with_shape(/*arg_id=*/{1}, (uint64)result.data(),
+                                        2 * sizeof(int), {2});
+  ctx.set_arg_int(/*arg_id=*/{2}, kN);
+  launch(*kernel, ctx);
+  EXPECT_EQ(result[0], expected_sum);
+  EXPECT_EQ(result[1], expected_max);
+}
+
+}  // namespace lang
+}  // namespace taichi
+#endif
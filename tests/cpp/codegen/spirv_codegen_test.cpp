@@ -0,0 +1,108 @@
+#include "gtest/gtest.h"
+
+#include "taichi/ir/ir_builder.h"
+#include "taichi/ir/statements.h"
+#include "taichi/program/program.h"
+#include "tests/cpp/program/test_program.h"
+#ifdef TI_WITH_VULKAN
+#include "taichi/codegen/spirv/kernel_compiler.h"
+#include "taichi/codegen/spirv/spirv_codegen.h"
+#include "taichi/rhi/vulkan/vulkan_loader.h"
+#endif
+
+namespace taichi::lang {
+#ifdef TI_WITH_VULKAN
+namespace {
+
+// a[i] += k + 1 for each of the |num_loops| range-for loops, so that the
+// kernel is split into |num_loops| offloaded tasks.
+std::unique_ptr<Kernel> setup_multi_task_kernel(Program *prog, int num_loops) {
+  IRBuilder builder;
+  for (int k = 0; k < num_loops; k++) {
+    auto *loop = builder.create_range_for(builder.get_int32(0),
+                                          builder.get_int32(64));
+    {
+      auto _ = builder.get_loop_guard(loop);
+      auto *arg = builder.create_ndarray_arg_load(
+          /*arg_id=*/{0}, get_data_type<int>(), 1, 0);
+      auto *index = builder.get_loop_index(loop);
+      auto *ptr = builder.create_external_ptr(arg, {index});
+      auto *val = builder.create_global_load(ptr);
+      builder.create_global_store(
+          ptr, builder.create_add(val, builder.get_int32(k + 1)));
+    }
+  }
+  auto block = builder.extract_ir();
+  auto ker = std::make_unique<Kernel>(*prog, std::move(block), "multi_task");
+  ker->insert_ndarray_param(get_data_type<int>(), /*total_dim=*/1);
+  ker->finalize_params();
+  ker->finalize_rets();
+  return ker;
+}
+
+std::vector<std::vector<uint32_t>> compile_to_spirv(
+    Program *prog,
+    const Kernel &kernel,
+    int num_compile_threads,
+    spirv::KernelCodegen::Stats *stats) {
+  std::vector<spirv::CompiledSNodeStructs> compiled_structs;
+  spirv::KernelCompiler::Config config;
+  config.compiled_struct_data = &compiled_structs;
+  spirv::KernelCompiler compiler(config);
+  const auto &compile_config = prog->compile_config();
+  auto ir = compiler.compile(compile_config, kernel);
+
+  spirv::KernelCodegen::Params params;
+  params.ti_kernel_name = kernel.name;
+  params.kernel = &kernel;
+  params.ir_root = ir.get();
+  params.arch = compile_config.arch;
+  params.caps = prog->get_device_caps();
+  params.num_compile_threads = num_compile_threads;
+  spirv::KernelCodegen codegen(params);
+  spirv::TaichiKernelAttributes kernel_attribs;
+  std::vector<std::vector<uint32_t>> generated_spirv;
+  codegen.run(kernel_attribs, generated_spirv);
+  *stats = codegen.get_stats();
+  EXPECT_EQ(kernel_attribs.tasks_attribs.size(), generated_spirv.size());
+  return generated_spirv;
+}
+
+}  // namespace
+
+TEST(SpirvCodegenTest, ParallelTasksMatchSerial) {
+  // Otherwise will segfault on macOS VM,
+  // where Vulkan is installed but no devices are present
+  if (!vulkan::is_vulkan_api_available()) {
+    return;
+  }
+  TestProgram test_prog;
+  test_prog.setup(Arch::vulkan);
+
+  const int num_loops = 6;
+  const std::size_t num_tasks = num_loops;
+  auto ker = setup_multi_task_kernel(test_prog.prog(), num_loops);
+
+  spirv::KernelCodegen::Stats serial_stats;
+  auto serial = compile_to_spirv(test_prog.prog(), *ker,
+                                 /*num_compile_threads=*/1, &serial_stats);
+  ASSERT_EQ(serial.size(), num_tasks);
+  EXPECT_EQ(serial_stats.num_threads, 1);
+  ASSERT_EQ(serial_stats.tasks.size(), num_tasks);
+
+  for (int num_threads : {2, 4, 16}) {
+    spirv::KernelCodegen::Stats stats;
+    auto parallel =
+        compile_to_spirv(test_prog.prog(), *ker, num_threads, &stats);
+    EXPECT_EQ(stats.num_threads, std::min(num_threads, num_loops));
+    ASSERT_EQ(stats.tasks.size(), num_tasks);
+    ASSERT_EQ(parallel.size(), serial.size());
+    for (int i = 0; i < num_loops; i++) {
+      EXPECT_EQ(stats.tasks[i].name, serial_stats.tasks[i].name);
+      EXPECT_EQ(stats.tasks[i].size_after_opt, parallel[i].size());
+      EXPECT_EQ(parallel[i], serial[i]) << "task " << i;
+    }
+  }
+}
+#endif
+}  // namespace taichi::lang
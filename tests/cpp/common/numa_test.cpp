@@ -0,0 +1,55 @@
+#include "gtest/gtest.h"
+
+#include <vector>
+
+#include "taichi/system/numa.h"
+#include "taichi/system/threading.h"
+
+#if defined(TI_PLATFORM_LINUX)
+#include <sys/mman.h>
+#endif
+
+namespace taichi {
+
+TEST(Numa, PolicyFromName) {
+  EXPECT_EQ(numa_policy_from_name("none"), NumaPolicy::none);
+  EXPECT_EQ(numa_policy_from_name("first_touch"), NumaPolicy::first_touch);
+  EXPECT_EQ(numa_policy_from_name("interleave"), NumaPolicy::interleave);
+  EXPECT_ANY_THROW(numa_policy_from_name("local"));
+  EXPECT_GE(num_numa_nodes(), 1);
+}
+
+#if defined(TI_PLATFORM_LINUX)
+TEST(Numa, FirstTouchPlacesEveryPage) {
+  ThreadPool pool(4);
+  const std::size_t page_size = 4096;
+  const std::size_t size = (16 << 20) + 3 * page_size + 100;
+  for (auto policy : {NumaPolicy::none, NumaPolicy::first_touch}) {
+    for (bool huge_pages : {false, true}) {
+      void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      ASSERT_NE(ptr, MAP_FAILED);
+      place_host_memory(&pool, ptr, size, policy, huge_pages);
+
+      const std::size_t num_pages = (size + page_size - 1) / page_size;
+      std::vector<unsigned char> resident(num_pages);
+      ASSERT_EQ(mincore(ptr, size, resident.data()), 0);
+      std::size_t num_resident = 0;
+      for (auto r : resident) {
+        num_resident += r & 1;
+      }
+      if (policy == NumaPolicy::first_touch) {
+        EXPECT_EQ(num_resident, num_pages);
+      } else if (!huge_pages) {
+        EXPECT_EQ(num_resident, 0);
+      }
+      for (std::size_t i = 0; i < size; i += 1009) {
+        ASSERT_EQ(((char *)ptr)[i], 0);
+      }
+      munmap(ptr, size);
+    }
+  }
+}
+#endif
+
+}  // namespace taichi
@@ -0,0 +1,88 @@
+/*******************************************************************************
+    Copyright (c) The Taichi Authors (2016- ). All Rights Reserved.
+    The use of this software is governed by the LICENSE file.
+*******************************************************************************/
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <vector>
+
+#include "taichi/system/threading.h"
+
+namespace taichi {
+
+namespace {
+
+struct CountingContext {
+  std::vector<std::atomic<int>> hits;
+  std::atomic<int> max_thread_id{-1};
+
+  explicit CountingContext(int n) : hits(n) {
+  }
+};
+
+void count_task(void *ctx_, int thread_id, int i) {
+  auto ctx = (CountingContext *)ctx_;
+  ctx->hits[i].fetch_add(1);
+  int prev = ctx->max_thread_id.load();
+  while (prev < thread_id &&
+         !ctx->max_thread_id.compare_exchange_weak(prev, thread_id)) {
+  }
+}
+
+}  // namespace
+
+TEST(ThreadPool, EveryTaskRunsExactlyOnce) {
+  ThreadPool pool(8);
+  for (int splits : {1, 2, 7, 64, 1000, 100000}) {
+    for (int num_threads : {1, 3, 8, 32}) {
+      CountingContext ctx(splits);
+      pool.run(splits, num_threads, &ctx, count_task);
+      for (int i = 0; i < splits; i++) {
+        ASSERT_EQ(ctx.hits[i].load(), 1) << "splits=" << splits << " i=" << i;
+      }
+      EXPECT_LT(ctx.max_thread_id.load(), std::min(num_threads, 8));
+    }
+  }
+}
+
+TEST(ThreadPool, ManySmallLaunches) {
+  ThreadPool pool(4);
+  CountingContext ctx(16);
+  for (int j = 0; j < 10000; j++) {
+    pool.run(16, 4, &ctx, count_task);
+  }
+  for (int i = 0; i < 16; i++) {
+    EXPECT_EQ(ctx.hits[i].load(), 10000);
+  }
+}
+
+TEST(ThreadPool, SingleThreadPool) {
+  ThreadPool pool(1);
+  CountingContext ctx(100);
+  pool.run(100, 16, &ctx, count_task);
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(ctx.hits[i].load(), 1);
+  }
+  EXPECT_EQ(ctx.max_thread_id.load(), 0);
+}
+
+TEST(ThreadPool, BusyTimeTracking) {
+  ThreadPool pool(4);
+  CountingContext ctx(64);
+  pool.run(64, 4, &ctx, count_task);
+  for (auto busy : pool.pop_busy_times()) {
+    EXPECT_EQ(busy, 0);
+  }
+  pool.set_busy_time_tracking(true);
+  pool.run(64, 4, &ctx, count_task);
+  auto busy_times = pool.pop_busy_times();
+  EXPECT_EQ(busy_times.size(), 4);
+  // The calling thread always takes part in the launch.
+  EXPECT_GT(busy_times[0], 0);
+  for (auto busy : pool.pop_busy_times()) {
+    EXPECT_EQ(busy, 0);
+  }
+}
+
+}  // namespace taichi
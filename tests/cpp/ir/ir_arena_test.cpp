@@ -0,0 +1,80 @@
+#include "gtest/gtest.h"
+
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/ir_arena.h"
+#include "taichi/ir/ir_builder.h"
+#include "taichi/ir/statements.h"
+
+namespace taichi::lang {
+
+TEST(IRArena, AllocatesWithinScope) {
+  EXPECT_EQ(IRArena::current(), nullptr);
+  std::unique_ptr<Block> block;
+  {
+    IRArenaScope scope;
+    IRArena *arena = scope.arena();
+    ASSERT_NE(arena, nullptr);
+    EXPECT_EQ(IRArena::current(), arena);
+
+    block = std::make_unique<Block>();
+    auto *one = block->push_back<ConstStmt>(TypedConstant(1));
+    block->push_back<BinaryOpStmt>(BinaryOpType::add, one, one);
+    // The block, the statements and the fields of the statements
+    EXPECT_GE(arena->num_live_allocations(), 3);
+    EXPECT_GT(arena->bytes_allocated(), sizeof(Block));
+
+    const std::size_t num_live = arena->num_live_allocations();
+    block->erase(1);
+    block->trash_bin.clear();
+    EXPECT_LT(arena->num_live_allocations(), num_live);
+
+    {
+      IRArenaScope heap_scope(/*enabled=*/false);
+      EXPECT_EQ(IRArena::current(), nullptr);
+      block->push_back<ConstStmt>(TypedConstant(2));
+    }
+    EXPECT_EQ(IRArena::current(), arena);
+  }
+  EXPECT_EQ(IRArena::current(), nullptr);
+
+  // The nodes outlive the scope, and mix arena and heap allocations
+  ASSERT_EQ(block->size(), 2);
+  EXPECT_EQ(block->statements[1]->as<ConstStmt>()->val.val_int32(), 2);
+  block->push_back<ConstStmt>(TypedConstant(3));
+  block.reset();
+}
+
+TEST(IRArena, Clone) {
+  IRBuilder builder;
+  auto *offload = builder.insert(Stmt::make_typed<OffloadedStmt>(
+      OffloadedStmt::TaskType::range_for, Arch::x64, nullptr));
+  offload->tls_prologue = std::make_unique<Block>();
+  offload->tls_prologue->set_parent_stmt(offload);
+  auto *tls_one =
+      offload->tls_prologue->push_back<ConstStmt>(TypedConstant(1));
+  builder.set_insertion_point({offload->body.get(), 0});
+  auto *two = builder.get_int32(2);
+  auto *add = builder.create_add(tls_one, two);
+  auto *mul = builder.create_mul(add, two);
+  // An operand defined after its user is fixed up at the end
+  add->set_operand(1, mul);
+  auto ir = builder.extract_ir();
+
+  IRArenaScope scope;
+  auto cloned = irpass::analysis::clone(ir.get());
+
+  auto *cloned_offload =
+      cloned->as<Block>()->statements[0]->as<OffloadedStmt>();
+  ASSERT_NE(cloned_offload->tls_prologue, nullptr);
+  ASSERT_EQ(cloned_offload->tls_prologue->size(), 1);
+  auto &cloned_body = cloned_offload->body->statements;
+  ASSERT_EQ(cloned_body.size(), 3);
+  Stmt *cloned_add = cloned_body[1].get();
+  EXPECT_EQ(cloned_add->operand(0),
+            cloned_offload->tls_prologue->statements[0].get());
+  EXPECT_EQ(cloned_add->operand(1), cloned_body[2].get());
+  EXPECT_EQ(cloned_body[2]->operand(0), cloned_add);
+  EXPECT_EQ(cloned_body[2]->operand(1), cloned_body[0].get());
+}
+
+}  // namespace taichi::lang
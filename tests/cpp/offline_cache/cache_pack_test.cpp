@@ -0,0 +1,187 @@
+#include "gtest/gtest.h"
+
+#include <fstream>
+#include <thread>
+
+#include "taichi/util/offline_cache_pack.h"
+
+namespace taichi::lang {
+
+namespace {
+
+namespace oc = offline_cache;
+
+constexpr char kLockName[] = "ticache.lock";
+
+std::vector<oc::CachePack::Record> make_records(int begin, int end) {
+  std::vector<oc::CachePack::Record> records;
+  for (int i = begin; i < end; i++) {
+    records.push_back({fmt::format("kernel-{}", i),
+                       std::string(i % 97 + 1, char('a' + i % 26))});
+  }
+  return records;
+}
+
+void expect_found(const std::string &path,
+                  const std::vector<oc::CachePack::Record> &records) {
+  oc::CachePack pack(path, kLockName);
+  for (const auto &r : records) {
+    auto payload = pack.find(r.key);
+    ASSERT_TRUE(payload.has_value()) << r.key;
+    EXPECT_EQ(*payload, r.payload) << r.key;
+  }
+}
+
+class CachePackTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    path_ = fmt::format("{}.ticache", std::tmpnam(nullptr));
+  }
+
+  void TearDown() override {
+    std::filesystem::remove_all(path_);
+  }
+
+  std::string pack_file() const {
+    return join_path(path_, oc::CachePack::kPackFilename);
+  }
+
+  std::string index_file() const {
+    return join_path(path_, oc::CachePack::kIndexFilename);
+  }
+
+  std::string path_;
+};
+
+}  // namespace
+
+TEST_F(CachePackTest, FindAfterCommit) {
+  oc::CachePack empty(path_, kLockName);
+  EXPECT_FALSE(empty.find("kernel-0").has_value());
+
+  auto records = make_records(0, 100);
+  EXPECT_TRUE(oc::CachePack(path_, kLockName).commit(records, {}));
+  expect_found(path_, records);
+  EXPECT_FALSE(oc::CachePack(path_, kLockName).find("kernel-100"));
+  EXPECT_EQ(oc::CachePack(path_, kLockName).list_entries().size(), 100);
+}
+
+TEST_F(CachePackTest, AppendsOnlyNewKeys) {
+  auto first = make_records(0, 100);
+  EXPECT_TRUE(oc::CachePack(path_, kLockName).commit(first, {}));
+  // Overlapping keys with different payloads keep the first payload
+  auto second = make_records(50, 150);
+  for (auto &r : second) {
+    r.payload += "-new";
+  }
+  EXPECT_TRUE(oc::CachePack(path_, kLockName).commit(second, {}));
+  expect_found(path_, first);
+  expect_found(path_, {second.begin() + 50, second.end()});
+  EXPECT_EQ(oc::CachePack(path_, kLockName).list_entries().size(), 150);
+}
+
+TEST_F(CachePackTest, GrowsIndex) {
+  // More than one index rebuild
+  auto records = make_records(0, 5000);
+  oc::CachePack pack(path_, kLockName);
+  for (int i = 0; i < 5000; i += 1000) {
+    EXPECT_TRUE(pack.commit({records.begin() + i, records.begin() + i + 1000},
+                            {}));
+  }
+  expect_found(path_, records);
+}
+
+TEST_F(CachePackTest, ReaderKeepsItsSnapshot) {
+  auto first = make_records(0, 10);
+  EXPECT_TRUE(oc::CachePack(path_, kLockName).commit(first, {}));
+  oc::CachePack reader(path_, kLockName);
+  auto payload = reader.find("kernel-3");
+  ASSERT_TRUE(payload.has_value());
+
+  auto second = make_records(10, 2000);
+  EXPECT_TRUE(oc::CachePack(path_, kLockName).commit(second, {}));
+  EXPECT_EQ(*payload, first[3].payload);
+  EXPECT_EQ(*reader.find("kernel-5"), first[5].payload);
+  EXPECT_FALSE(reader.find("kernel-1000").has_value());
+  expect_found(path_, second);
+}
+
+TEST_F(CachePackTest, ScansRecordsMissingFromIndex) {
+  auto first = make_records(0, 100);
+  EXPECT_TRUE(oc::CachePack(path_, kLockName).commit(first, {}));
+  std::filesystem::remove(index_file());
+  expect_found(path_, first);
+
+  // A writer that died half-way through a record
+  std::ofstream(pack_file(), std::ios::app | std::ios::binary)
+      << "I-AM-BAD-BYTES" << std::flush;
+  expect_found(path_, first);
+
+  auto second = make_records(100, 200);
+  EXPECT_TRUE(oc::CachePack(path_, kLockName).commit(second, {}));
+  expect_found(path_, first);
+  expect_found(path_, second);
+}
+
+TEST_F(CachePackTest, IgnoresCorruptedPack) {
+  taichi::create_directories(path_);
+  std::ofstream(pack_file(), std::ios::binary) << "I-AM-BAD-BYTES"
+                                               << std::flush;
+  EXPECT_FALSE(oc::CachePack(path_, kLockName).find("kernel-0"));
+  auto records = make_records(0, 10);
+  EXPECT_TRUE(oc::CachePack(path_, kLockName).commit(records, {}));
+  expect_found(path_, records);
+}
+
+TEST_F(CachePackTest, ConcurrentWriters) {
+  constexpr int kNumThreads = 4;
+  constexpr int kRecordsPerThread = 200;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&, t] {
+      auto records =
+          make_records(t * kRecordsPerThread, (t + 1) * kRecordsPerThread);
+      oc::CachePack pack(path_, kLockName);
+      for (int i = 0; i < kRecordsPerThread; i += 10) {
+        // The lock may time out under contention; try again, as the next
+        // dump() would.
+        while (!pack.commit({records.begin() + i, records.begin() + i + 10},
+                            {})) {
+        }
+      }
+    });
+  }
+  for (auto &th : threads) {
+    th.join();
+  }
+  expect_found(path_, make_records(0, kNumThreads * kRecordsPerThread));
+}
+
+TEST_F(CachePackTest, Clean) {
+  auto records = make_records(0, 100);
+  EXPECT_TRUE(oc::CachePack(path_, kLockName).commit(records, {}));
+  std::size_t total_size = 0;
+  for (const auto &r : records) {
+    total_size += r.payload.size();
+  }
+
+  oc::CachePack(path_, kLockName).clean(oc::Never, 1, 0.5);
+  oc::CachePack(path_, kLockName).clean(oc::LRU, total_size + 1, 0.5);
+  oc::CachePack(path_, kLockName).clean(oc::OnlyOldVersion, 1, 0.5);
+  EXPECT_EQ(oc::CachePack(path_, kLockName).list_entries().size(), 100);
+
+  oc::CachePack(path_, kLockName).clean(oc::FIFO, 1, 0.25);
+  auto entries = oc::CachePack(path_, kLockName).list_entries();
+  EXPECT_EQ(entries.size(), 75);
+  oc::CachePack pack(path_, kLockName);
+  for (const auto &e : entries) {
+    auto payload = pack.find(e.key);
+    ASSERT_TRUE(payload.has_value());
+    EXPECT_EQ(payload->size(), e.size);
+  }
+
+  oc::CachePack(path_, kLockName).clean(oc::LRU, 1, 1.0);
+  EXPECT_FALSE(taichi::path_exists(pack_file()));
+}
+
+}  // namespace taichi::lang
@@ -119,4 +119,42 @@ TEST(OfflineCache, LoadMetadata) {
   load_metadata_test<oc::Metadata<KernelMetadataBase>>();
 }
 
+#ifdef TI_WITH_LLVM
+TEST(OfflineCache, LoadLegacyLlvmMetadata) {
+  std::string legacy_file = fmt::format("{}.tcb", std::tmpnam(nullptr));
+  std::string true_file = fmt::format("{}.tcb", std::tmpnam(nullptr));
+
+  write_to_binary_file(gen_correct_metadata<LlvmOfflineCache::LegacyMetadata>(),
+                       legacy_file);
+  auto metadata = gen_correct_metadata<LlvmOfflineCache>();
+  metadata.native_target_id = "x86_64-unknown-linux-gnu/skylake/+avx2";
+  write_to_binary_file(metadata, true_file);
+
+  using Error = oc::LoadMetadataError;
+  // Load a metadata file written before native_target_id was added
+  {
+    LlvmOfflineCache data;
+    data.native_target_id = "stale";
+    EXPECT_EQ(oc::load_metadata_with_checking(data, legacy_file),
+              Error::kNoError);
+    EXPECT_EQ(data.size, 1024);
+    EXPECT_TRUE(data.kernels.count("1"));
+    EXPECT_TRUE(data.kernels.count("2"));
+    EXPECT_TRUE(data.native_target_id.empty());
+  }
+  // Load a metadata file with native_target_id
+  {
+    LlvmOfflineCache data;
+    EXPECT_EQ(oc::load_metadata_with_checking(data, true_file),
+              Error::kNoError);
+    EXPECT_EQ(data.size, 1024);
+    EXPECT_TRUE(data.kernels.count("1"));
+    EXPECT_EQ(data.native_target_id, metadata.native_target_id);
+  }
+
+  taichi::remove(legacy_file);
+  taichi::remove(true_file);
+}
+#endif  // TI_WITH_LLVM
+
 }  // namespace taichi::lang
@@ -0,0 +1,72 @@
+#include "gtest/gtest.h"
+
+#include <sstream>
+
+#include "taichi/analysis/offline_cache_util.h"
+#include "taichi/ir/frontend_ir.h"
+
+namespace taichi::lang {
+
+namespace {
+
+std::string hash(const std::string &algorithm, const std::string &data) {
+  auto hasher = OfflineCacheKeyHasher::create(algorithm);
+  hasher->process(data.data(), data.size());
+  return hasher->finish();
+}
+
+std::string make_data(int size) {
+  std::string data;
+  for (int i = 0; i < size; i++) {
+    data.push_back((char)i);
+  }
+  return data;
+}
+
+}  // namespace
+
+TEST(OfflineCacheKey, XxHash64) {
+  EXPECT_EQ(hash("xxhash64", ""), "ef46db3751d8e999");
+  EXPECT_EQ(hash("xxhash64", "abc"), "44bc2cf5ad770999");
+  EXPECT_EQ(hash("xxhash64", make_data(100)), "6ac1e58032166597");
+}
+
+TEST(OfflineCacheKey, HashInChunks) {
+  const auto data = make_data(1000);
+  const auto expected = hash("xxhash64", data);
+  for (int chunk_size : {1, 7, 32, 33, 999}) {
+    auto hasher = OfflineCacheKeyHasher::create("xxhash64");
+    for (int i = 0; i < (int)data.size(); i += chunk_size) {
+      hasher->process(data.data() + i,
+                      std::min<std::size_t>(chunk_size, data.size() - i));
+    }
+    EXPECT_EQ(hasher->finish(), expected) << "chunk_size=" << chunk_size;
+  }
+}
+
+TEST(OfflineCacheKey, CloneHasher) {
+  const auto data = make_data(100);
+  auto hasher = OfflineCacheKeyHasher::create("xxhash64");
+  hasher->process(data.data(), 50);
+  auto clone = hasher->clone();
+  hasher->process(data.data() + 50, 50);
+  clone->process(data.data() + 50, 50);
+  EXPECT_EQ(hasher->finish(), hash("xxhash64", data));
+  EXPECT_EQ(clone->finish(), hash("xxhash64", data));
+}
+
+TEST(OfflineCacheKey, HashAstWithoutSerializingIt) {
+  auto block = std::make_unique<Block>();
+  for (int i = 0; i < 1000; i++) {
+    block->push_back<FrontendExprStmt>(Expr(i));
+  }
+  block->push_back<FrontendBreakStmt>();
+
+  std::ostringstream oss;
+  gen_offline_cache_key(block.get(), &oss);
+  auto hasher = OfflineCacheKeyHasher::create("xxhash64");
+  gen_offline_cache_key(block.get(), hasher.get());
+  EXPECT_EQ(hasher->finish(), hash("xxhash64", oss.str()));
+}
+
+}  // namespace taichi::lang
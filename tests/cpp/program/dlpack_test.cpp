@@ -0,0 +1,261 @@
+#include <numeric>
+
+#include "gtest/gtest.h"
+
+#include "taichi/program/dlpack_funcs.h"
+#include "taichi/program/ndarray.h"
+#include "tests/cpp/ir/ndarray_kernel.h"
+#include "tests/cpp/program/test_program.h"
+
+namespace taichi::lang {
+
+namespace {
+
+// A DLPack tensor over a caller's buffer, recording whether it was deleted
+struct HostTensor {
+  explicit HostTensor(std::vector<int32> *data) {
+    shape = {(int64_t)data->size()};
+    managed.dl_tensor.data = data->data();
+    managed.dl_tensor.device = {kDLCPU, 0};
+    managed.dl_tensor.ndim = 1;
+    managed.dl_tensor.dtype = {kDLInt, 32, 1};
+    managed.dl_tensor.shape = shape.data();
+    managed.dl_tensor.strides = nullptr;
+    managed.dl_tensor.byte_offset = 0;
+    managed.manager_ctx = this;
+    managed.deleter = [](DLManagedTensor *self) {
+      ((HostTensor *)self->manager_ctx)->deleted = true;
+    };
+  }
+
+  std::function<void()> release() {
+    return [this]() { managed.deleter(&managed); };
+  }
+
+  DLManagedTensor managed;
+  std::vector<int64_t> shape;
+  bool deleted{false};
+};
+
+// a[1, 2] = 7; a[2, 0] += a[0, 1], over a strided 2D ndarray
+std::unique_ptr<Kernel> setup_strided_kernel(Program *prog) {
+  IRBuilder builder;
+  {
+    auto *arg = builder.create_ndarray_arg_load(
+        /*arg_id=*/{0}, get_data_type<int>(), 2, 0, /*strided=*/true);
+    auto *zero = builder.get_int32(0);
+    auto *one = builder.get_int32(1);
+    auto *two = builder.get_int32(2);
+    builder.create_global_store(builder.create_external_ptr(arg, {one, two}),
+                                builder.get_int32(7));
+    auto *a01 =
+        builder.create_global_load(builder.create_external_ptr(arg, {zero, one}));
+    auto *a20ptr = builder.create_external_ptr(arg, {two, zero});
+    auto *a20 = builder.create_global_load(a20ptr);
+    builder.create_global_store(a20ptr, builder.create_add(a01, a20));
+  }
+  auto ker =
+      std::make_unique<Kernel>(*prog, builder.extract_ir(), "strided_ker");
+  ker->insert_ndarray_param(get_data_type<int>(), /*ndim=*/2, "",
+                            /*needs_grad=*/false, /*strided=*/true);
+  ker->finalize_params();
+  ker->finalize_rets();
+  return ker;
+}
+
+void run_kernel(Program *prog, Kernel *ker, Ndarray &array) {
+  auto launch_ctx = ker->make_launch_context();
+  launch_ctx.set_arg_ndarray(/*arg_id=*/{0}, array);
+  const auto &compiled_kernel_data = prog->compile_kernel(
+      prog->compile_config(), prog->get_device_caps(), *ker);
+  prog->launch_kernel(compiled_kernel_data, launch_ctx);
+  prog->synchronize();
+}
+
+void run_kernel1(Program *prog, Ndarray &array) {
+  auto ker = setup_kernel1(prog);
+  run_kernel(prog, ker.get(), array);
+}
+
+}  // namespace
+
+TEST(DLPack, Import) {
+  TestProgram test_prog;
+  test_prog.setup();
+  auto *prog = test_prog.prog();
+
+  std::vector<int32> data(10, 0);
+  data[0] = 2;
+  data[2] = 40;
+  HostTensor tensor(&data);
+  Ndarray *array =
+      ndarray_from_dlpack(prog, &tensor.managed, {}, tensor.release());
+  EXPECT_EQ(array->shape, std::vector<int>{10});
+  EXPECT_EQ(array->dtype, PrimitiveType::i32);
+  // The kernel writes to the caller's buffer
+  run_kernel1(prog, *array);
+  EXPECT_EQ(data[1], 1);
+  EXPECT_EQ(data[2], 42);
+
+  EXPECT_FALSE(tensor.deleted);
+  prog->delete_ndarray(array);
+  EXPECT_TRUE(tensor.deleted);
+}
+
+TEST(DLPack, ImportLayouts) {
+  TestProgram test_prog;
+  test_prog.setup();
+  auto *prog = test_prog.prog();
+
+  std::vector<int32> data(12, 0);
+  HostTensor tensor(&data);
+  int64_t shape[] = {4, 3};
+  tensor.managed.dl_tensor.ndim = 2;
+  tensor.managed.dl_tensor.shape = shape;
+
+  // Compact strides, and a size-1 dimension with any stride
+  int64_t compact[] = {3, 1};
+  tensor.managed.dl_tensor.strides = compact;
+  Ndarray *vectors =
+      ndarray_from_dlpack(prog, &tensor.managed, {3}, tensor.release());
+  EXPECT_EQ(vectors->shape, std::vector<int>{4});
+  EXPECT_EQ(vectors->get_element_shape(), std::vector<int>{3});
+  prog->delete_ndarray(vectors);
+
+  int64_t column_shape[] = {12, 1};
+  int64_t column_strides[] = {1, 42};
+  tensor.managed.dl_tensor.shape = column_shape;
+  tensor.managed.dl_tensor.strides = column_strides;
+  prog->delete_ndarray(
+      ndarray_from_dlpack(prog, &tensor.managed, {}, tensor.release()));
+
+  // Elements that overlap, or are not compact, cannot be imported
+  int64_t overlapping[] = {2, 1};
+  int64_t negative[] = {-3, 1};
+  int64_t strided_elements[] = {1, 4};
+  tensor.managed.dl_tensor.shape = shape;
+  tensor.deleted = false;
+  for (int64_t *strides : {overlapping, negative}) {
+    tensor.managed.dl_tensor.strides = strides;
+    EXPECT_THROW(
+        ndarray_from_dlpack(prog, &tensor.managed, {}, tensor.release()),
+        std::string);
+  }
+  tensor.managed.dl_tensor.strides = strided_elements;
+  EXPECT_THROW(
+      ndarray_from_dlpack(prog, &tensor.managed, {3}, tensor.release()),
+      std::string);
+  EXPECT_FALSE(tensor.deleted);
+
+  // The element shape does not match
+  tensor.managed.dl_tensor.strides = nullptr;
+  EXPECT_THROW(
+      ndarray_from_dlpack(prog, &tensor.managed, {4}, tensor.release()),
+      std::string);
+  tensor.managed.dl_tensor.device = {kDLCUDA, 0};
+  EXPECT_THROW(ndarray_from_dlpack(prog, &tensor.managed, {}, tensor.release()),
+               std::string);
+}
+
+TEST(DLPack, ImportStrided) {
+  TestProgram test_prog;
+  test_prog.setup();
+  auto *prog = test_prog.prog();
+
+  // A transposed view of a 4x6 array
+  std::vector<int32> data(24);
+  std::iota(data.begin(), data.end(), 0);
+  HostTensor tensor(&data);
+  int64_t shape[] = {6, 4};
+  int64_t strides[] = {1, 6};
+  tensor.managed.dl_tensor.ndim = 2;
+  tensor.managed.dl_tensor.shape = shape;
+  tensor.managed.dl_tensor.strides = strides;
+  Ndarray *array =
+      ndarray_from_dlpack(prog, &tensor.managed, {}, tensor.release());
+  EXPECT_EQ(array->shape, (std::vector<int>{6, 4}));
+  EXPECT_EQ(array->strides, (std::vector<int>{1, 6}));
+  EXPECT_EQ(array->read_int({5, 1}), 11);
+  array->write_int({2, 3}, -1);
+  EXPECT_EQ(data[20], -1);
+
+  auto ker = setup_strided_kernel(prog);
+  run_kernel(prog, ker.get(), *array);
+  EXPECT_EQ(data[13], 7);
+  EXPECT_EQ(data[2], 8);
+  EXPECT_EQ(data[12], 12);
+
+  // Exported with the same strides
+  DLManagedTensor *exported = ndarray_to_dlpack(prog, array, nullptr);
+  EXPECT_EQ(exported->dl_tensor.data, data.data());
+  EXPECT_EQ(exported->dl_tensor.strides[0], 1);
+  EXPECT_EQ(exported->dl_tensor.strides[1], 6);
+  exported->deleter(exported);
+
+  // Kernels for compact ndarrays do not take it
+  EXPECT_THROW(run_kernel1(prog, *array), std::string);
+  prog->delete_ndarray(array);
+
+  // Compact strides are dropped, and strided kernels take compact ndarrays
+  int64_t compact_shape[] = {4, 6};
+  int64_t compact_strides[] = {6, 1};
+  tensor.managed.dl_tensor.shape = compact_shape;
+  tensor.managed.dl_tensor.strides = compact_strides;
+  array = ndarray_from_dlpack(prog, &tensor.managed, {}, tensor.release());
+  EXPECT_FALSE(array->is_strided());
+  run_kernel(prog, ker.get(), *array);
+  EXPECT_EQ(data[8], 7);
+  EXPECT_EQ(data[12], 13);
+  prog->delete_ndarray(array);
+
+  // Every other row of the array, as 3D vectors
+  std::vector<int32> vectors(12, 0);
+  HostTensor vector_tensor(&vectors);
+  int64_t vector_shape[] = {2, 3};
+  int64_t vector_strides[] = {6, 1};
+  vector_tensor.managed.dl_tensor.ndim = 2;
+  vector_tensor.managed.dl_tensor.shape = vector_shape;
+  vector_tensor.managed.dl_tensor.strides = vector_strides;
+  array = ndarray_from_dlpack(prog, &vector_tensor.managed, {3},
+                              vector_tensor.release());
+  EXPECT_EQ(array->strides, std::vector<int>{6});
+  array->write_int({1, 2}, 5);
+  EXPECT_EQ(vectors[8], 5);
+  EXPECT_EQ(array->read_int({1, 2}), 5);
+  prog->delete_ndarray(array);
+}
+
+TEST(DLPack, Export) {
+  TestProgram test_prog;
+  test_prog.setup();
+  auto *prog = test_prog.prog();
+
+  Ndarray *array = prog->create_ndarray(PrimitiveType::i32, {10},
+                                        ExternalArrayLayout::kNull,
+                                        /*zero_fill=*/true);
+  array->write_int({0}, 2);
+  run_kernel1(prog, *array);
+
+  bool released = false;
+  DLManagedTensor *tensor =
+      ndarray_to_dlpack(prog, array, [&]() { released = true; });
+  const DLTensor &dl_tensor = tensor->dl_tensor;
+  EXPECT_EQ(dl_tensor.device.device_type, kDLCPU);
+  EXPECT_EQ(dl_tensor.ndim, 1);
+  EXPECT_EQ(dl_tensor.shape[0], 10);
+  EXPECT_EQ(dl_tensor.strides[0], 1);
+  EXPECT_EQ(dl_tensor.dtype.code, kDLInt);
+  EXPECT_EQ(dl_tensor.dtype.bits, 32);
+  // Same memory, no copy
+  auto *data = (int32 *)dl_tensor.data;
+  EXPECT_EQ(data[1], 1);
+  EXPECT_EQ(data[2], 2);
+  data[3] = 7;
+  EXPECT_EQ(array->read_int({3}), 7);
+
+  tensor->deleter(tensor);
+  EXPECT_TRUE(released);
+  prog->delete_ndarray(array);
+}
+
+}  // namespace taichi::lang
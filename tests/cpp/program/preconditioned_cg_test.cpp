@@ -0,0 +1,259 @@
+#include "gtest/gtest.h"
+
+#include <cmath>
+
+#include "Eigen/Dense"
+
+#include "taichi/program/conjugate_gradient.h"
+#include "taichi/program/preconditioned_cg.h"
+
+namespace taichi::lang {
+
+namespace {
+
+// The 5-point Laplacian of a k x k grid, plus a varying diagonal, in CSR
+template <typename DT>
+struct Laplacian {
+  explicit Laplacian(int k) : n(k * k) {
+    outer_ptr.push_back(0);
+    for (int i = 0; i < k; i++) {
+      for (int j = 0; j < k; j++) {
+        const int row = i * k + j;
+        auto add = [&](int col, DT value) {
+          inner_indices.push_back(col);
+          values.push_back(value);
+        };
+        if (i > 0) {
+          add(row - k, -1);
+        }
+        if (j > 0) {
+          add(row - 1, -1);
+        }
+        add(row, 4 + DT(row % 7) * DT(0.5));
+        if (j < k - 1) {
+          add(row + 1, -1);
+        }
+        if (i < k - 1) {
+          add(row + k, -1);
+        }
+        outer_ptr.push_back((int)values.size());
+      }
+    }
+  }
+
+  void multiply(const DT *x, DT *y) const {
+    for (int i = 0; i < n; i++) {
+      DT s = 0;
+      for (int k = outer_ptr[i]; k < outer_ptr[i + 1]; k++) {
+        s += values[k] * x[inner_indices[k]];
+      }
+      y[i] = s;
+    }
+  }
+
+  // |b - A x| / |b|
+  double relative_residual(const std::vector<DT> &x,
+                           const std::vector<DT> &b) const {
+    std::vector<DT> Ax(n);
+    multiply(x.data(), Ax.data());
+    double r2 = 0, b2 = 0;
+    for (int i = 0; i < n; i++) {
+      r2 += double(b[i] - Ax[i]) * double(b[i] - Ax[i]);
+      b2 += double(b[i]) * double(b[i]);
+    }
+    return std::sqrt(r2 / b2);
+  }
+
+  int n{0};
+  std::vector<int> outer_ptr;
+  std::vector<int> inner_indices;
+  std::vector<DT> values;
+};
+
+template <typename DT>
+std::vector<DT> make_rhs(int n) {
+  std::vector<DT> b(n);
+  for (int i = 0; i < n; i++) {
+    b[i] = DT(i % 11) - 5;
+  }
+  return b;
+}
+
+template <typename DT>
+int solve_and_check(const Laplacian<DT> &A,
+                    CGPreconditioner preconditioner,
+                    ThreadPool *thread_pool,
+                    double tol) {
+  PreconditionedCG<DT> cg(A.n, A.outer_ptr.data(), A.inner_indices.data(),
+                          A.values.data(), preconditioner, 3);
+  cg.set_thread_pool(thread_pool);
+  auto b = make_rhs<DT>(A.n);
+  std::vector<DT> x(A.n, 0);
+  EXPECT_TRUE(cg.solve(x.data(), b.data(), 1000, DT(tol), 0));
+  EXPECT_LE(cg.relative_residual(), tol);
+  // Loose bound, the recursive residual drifts from the true one
+  EXPECT_LE(A.relative_residual(x, b), tol * 10);
+  return cg.num_iterations();
+}
+
+// The system of test_cg_preconditioner in tests/python/test_sparse_cg.py,
+// solved by CG, the solver behind ti.linalg.SparseCG on CPUs
+template <typename DT>
+void solve_with_sparse_cg(const std::string &preconditioner) {
+  using EigenMatrix = Eigen::SparseMatrix<DT>;
+  using EigenVector = Eigen::Matrix<DT, Eigen::Dynamic, 1>;
+  const int n = 64;
+  std::vector<Eigen::Triplet<DT>> triplets;
+  EigenVector b(n);
+  for (int i = 0; i < n; i++) {
+    triplets.emplace_back(i, i, DT(2.5) + DT(i % 3));
+    if (i > 0) {
+      triplets.emplace_back(i, i - 1, DT(-1));
+    }
+    if (i < n - 1) {
+      triplets.emplace_back(i, i + 1, DT(-1));
+    }
+    b[i] = DT(i % 5 - 2);
+  }
+  EigenMatrix A_eigen(n, n);
+  A_eigen.setFromTriplets(triplets.begin(), triplets.end());
+  EigenSparseMatrix<EigenMatrix> A(A_eigen);
+
+  CG<EigenVector, DT> cg(A, 200, 1e-6, false, preconditioner, 3);
+  cg.set_b(b);
+  cg.solve(nullptr);
+  EXPECT_TRUE(cg.is_success()) << preconditioner;
+  EigenVector expected =
+      Eigen::Matrix<DT, Eigen::Dynamic, Eigen::Dynamic>(A_eigen).ldlt().solve(
+          b);
+  EXPECT_LE((cg.get_x() - expected).cwiseAbs().maxCoeff(), 1e-4)
+      << preconditioner;
+}
+
+// The operator of test_matrixfree_cg_ndarray in
+// tests/python/test_matrixfree_cg.py, on a 32 x 32 grid
+template <typename DT>
+void solve_matrix_free_stencil() {
+  const int k = 32, n = k * k;
+  std::vector<DT> p(n), Ap(n);
+  auto apply = [&](const DT *v, DT *mv) {
+    for (int i = 0; i < k; i++) {
+      for (int j = 0; j < k; j++) {
+        DT s = 20 * v[i * k + j];
+        s -= i > 0 ? v[(i - 1) * k + j] : 0;
+        s -= i < k - 1 ? v[(i + 1) * k + j] : 0;
+        s -= j < k - 1 ? v[i * k + j + 1] : 0;
+        s -= j > 0 ? v[i * k + j - 1] : 0;
+        mv[i * k + j] = s;
+      }
+    }
+  };
+  PreconditionedCG<DT> cg(n, p.data(), Ap.data(),
+                          [&]() { apply(p.data(), Ap.data()); });
+  std::vector<DT> b(n), x(n, 0), Ax(n);
+  for (int i = 0; i < k; i++) {
+    for (int j = 0; j < k; j++) {
+      const double pi = 3.14159265358979323846;
+      b[i * k + j] = DT(std::sin(2 * pi * i / (k - 1)) *
+                        std::sin(2 * pi * j / (k - 1)));
+    }
+  }
+  ASSERT_TRUE(cg.solve(x.data(), b.data(), 10 * n, 0, DT(1e-5)));
+  apply(x.data(), Ax.data());
+  for (int i = 0; i < n; i++) {
+    EXPECT_NEAR(Ax[i], b[i], 1e-4);
+  }
+}
+
+}  // namespace
+
+TEST(PreconditionedCG, Preconditioners) {
+  ThreadPool thread_pool(4);
+  for (ThreadPool *pool : {(ThreadPool *)nullptr, &thread_pool}) {
+    // Large enough to be split across threads
+    Laplacian<float64> A(100);
+    const int none = solve_and_check(A, CGPreconditioner::none, pool, 1e-10);
+    const int jacobi =
+        solve_and_check(A, CGPreconditioner::jacobi, pool, 1e-10);
+    solve_and_check(A, CGPreconditioner::block_jacobi, pool, 1e-10);
+    const int ic = solve_and_check(A, CGPreconditioner::ic, pool, 1e-10);
+    EXPECT_LT(jacobi, none);
+    EXPECT_LT(ic, jacobi);
+
+    Laplacian<float32> A32(70);
+    for (auto preconditioner :
+         {CGPreconditioner::none, CGPreconditioner::jacobi,
+          CGPreconditioner::block_jacobi, CGPreconditioner::ic}) {
+      solve_and_check(A32, preconditioner, pool, 1e-5);
+    }
+  }
+}
+
+TEST(PreconditionedCG, InitialGuess) {
+  Laplacian<float64> A(10);
+  PreconditionedCG<float64> cg(A.n, A.outer_ptr.data(), A.inner_indices.data(),
+                               A.values.data(), CGPreconditioner::jacobi, 1);
+  auto b = make_rhs<float64>(A.n);
+  std::vector<float64> x(A.n, 0);
+  ASSERT_TRUE(cg.solve(x.data(), b.data(), 1000, 1e-12, 0));
+  // Starting from the solution takes no iteration
+  ASSERT_TRUE(cg.solve(x.data(), b.data(), 1000, 1e-8, 0));
+  EXPECT_EQ(cg.num_iterations(), 0);
+
+  // A zero right-hand side has the solution zero
+  std::vector<float64> zero(A.n, 0);
+  ASSERT_TRUE(cg.solve(x.data(), zero.data(), 1000, 1e-8, 0));
+  for (auto value : x) {
+    EXPECT_EQ(value, 0);
+  }
+
+  // Running out of iterations
+  std::vector<float64> y(A.n, 0);
+  EXPECT_FALSE(cg.solve(y.data(), b.data(), 2, 1e-12, 0));
+  EXPECT_EQ(cg.num_iterations(), 2);
+}
+
+TEST(PreconditionedCG, MatrixFree) {
+  ThreadPool thread_pool(4);
+  Laplacian<float64> A(80);
+  std::vector<float64> p(A.n), Ap(A.n);
+  int num_applications = 0;
+  PreconditionedCG<float64> cg(A.n, p.data(), Ap.data(), [&]() {
+    A.multiply(p.data(), Ap.data());
+    num_applications++;
+  });
+  cg.set_thread_pool(&thread_pool);
+  auto b = make_rhs<float64>(A.n);
+  std::vector<float64> x(A.n, 0);
+  // Absolute tolerance
+  ASSERT_TRUE(cg.solve(x.data(), b.data(), 1000, 0, 1e-8));
+  EXPECT_LE(A.relative_residual(x, b), 1e-8);
+  // One product for the initial residual, one per iteration
+  EXPECT_EQ(num_applications, cg.num_iterations() + 1);
+}
+
+TEST(PreconditionedCG, SparseCG) {
+  for (auto preconditioner : {"none", "jacobi", "block_jacobi", "ic"}) {
+    solve_with_sparse_cg<float32>(preconditioner);
+    solve_with_sparse_cg<float64>(preconditioner);
+  }
+}
+
+TEST(PreconditionedCG, MatrixFreeStencil) {
+  solve_matrix_free_stencil<float32>();
+  solve_matrix_free_stencil<float64>();
+}
+
+TEST(PreconditionedCG, NotPositiveDefinite) {
+  Laplacian<float64> A(4);
+  A.values[A.outer_ptr[5] + 2] = -1;
+  EXPECT_THROW((PreconditionedCG<float64>(
+                   A.n, A.outer_ptr.data(), A.inner_indices.data(),
+                   A.values.data(), CGPreconditioner::jacobi, 1)),
+               std::string);
+  EXPECT_THROW(cg_preconditioner_from_name("ilu"), std::string);
+  EXPECT_EQ(cg_preconditioner_from_name("block_jacobi"),
+            CGPreconditioner::block_jacobi);
+}
+
+}  // namespace taichi::lang
@@ -0,0 +1,119 @@
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <random>
+
+#include "taichi/inc/constants.h"
+#include "taichi/program/sparse_matrix_assembler.h"
+
+#include "Eigen/Sparse"
+
+namespace taichi::lang {
+
+namespace {
+
+template <typename T, typename G>
+std::vector<G> random_triplets(int rows,
+                               int cols,
+                               int num_triplets,
+                               std::mt19937 &rng) {
+  // Few distinct columns per row, so that there are plenty of duplicates
+  std::uniform_int_distribution<int> row_dist(0, rows - 1);
+  std::uniform_int_distribution<int> col_dist(0, std::min(cols, 8) - 1);
+  std::uniform_real_distribution<T> value_dist(-1, 1);
+  std::vector<G> triplets;
+  for (int i = 0; i < num_triplets; i++) {
+    const int row = row_dist(rng);
+    triplets.push_back(row);
+    triplets.push_back((row + col_dist(rng)) % cols);
+    triplets.push_back(taichi_union_cast<G>(value_dist(rng)));
+  }
+  return triplets;
+}
+
+template <typename T, typename G, int Storage>
+void check_against_eigen(const SparseMatrixAssembler &assembler,
+                         const std::vector<T> &values,
+                         const std::vector<G> &triplets,
+                         int rows,
+                         int cols) {
+  using Matrix = Eigen::SparseMatrix<T, Storage>;
+  std::vector<Eigen::Triplet<T>> eigen_triplets;
+  for (std::size_t i = 0; i < triplets.size(); i += 3) {
+    eigen_triplets.emplace_back(triplets[i], triplets[i + 1],
+                                taichi_union_cast<T>(triplets[i + 2]));
+  }
+  Matrix expected(rows, cols);
+  expected.setFromTriplets(eigen_triplets.begin(), eigen_triplets.end());
+
+  ASSERT_EQ(assembler.num_nonzeros(), expected.nonZeros());
+  for (int o = 0; o <= expected.outerSize(); o++) {
+    ASSERT_EQ(assembler.outer_ptr()[o], expected.outerIndexPtr()[o]);
+  }
+  for (int k = 0; k < expected.nonZeros(); k++) {
+    ASSERT_EQ(assembler.inner_indices()[k], expected.innerIndexPtr()[k]);
+    // Duplicates are summed in the same order as Eigen does
+    ASSERT_EQ(values[k], expected.valuePtr()[k]);
+  }
+}
+
+template <typename T, typename G, int Storage>
+void test_assemble(int rows, int cols, int num_triplets, int num_threads) {
+  std::mt19937 rng(rows * 7 + num_triplets);
+  // A single thread runs without a pool
+  std::unique_ptr<ThreadPool> pool;
+  if (num_threads > 1) {
+    pool = std::make_unique<ThreadPool>(num_threads);
+  }
+  SparseMatrixAssembler assembler(rows, cols, Storage == Eigen::RowMajor,
+                                  pool.get());
+  auto triplets = random_triplets<T, G>(rows, cols, num_triplets, rng);
+  std::vector<T> values;
+  EXPECT_FALSE(
+      (assembler.assemble<T, G>(triplets.data(), num_triplets, values)));
+  check_against_eigen<T, G, Storage>(assembler, values, triplets, rows, cols);
+
+  // Same pattern, new values
+  for (std::size_t i = 2; i < triplets.size(); i += 3) {
+    triplets[i] = taichi_union_cast<G>(taichi_union_cast<T>(triplets[i]) * 2);
+  }
+  EXPECT_TRUE(
+      (assembler.assemble<T, G>(triplets.data(), num_triplets, values)));
+  check_against_eigen<T, G, Storage>(assembler, values, triplets, rows, cols);
+
+  // Same number of triplets, different pattern
+  if (num_triplets > 0) {
+    triplets[0] = (triplets[0] + 1) % rows;
+    EXPECT_FALSE(
+        (assembler.assemble<T, G>(triplets.data(), num_triplets, values)));
+    check_against_eigen<T, G, Storage>(assembler, values, triplets, rows, cols);
+  }
+}
+
+}  // namespace
+
+TEST(SparseMatrixAssembler, Small) {
+  test_assemble<float32, int32, Eigen::ColMajor>(8, 8, 100, 1);
+  test_assemble<float32, int32, Eigen::RowMajor>(8, 5, 100, 4);
+  test_assemble<float64, int64, Eigen::ColMajor>(3, 17, 50, 4);
+  test_assemble<float64, int64, Eigen::RowMajor>(16, 16, 0, 2);
+}
+
+TEST(SparseMatrixAssembler, Parallel) {
+  test_assemble<float32, int32, Eigen::ColMajor>(1000, 1000, 200000, 8);
+  test_assemble<float32, int32, Eigen::RowMajor>(1000, 1000, 200000, 8);
+  test_assemble<float64, int64, Eigen::RowMajor>(50000, 20000, 300000, 4);
+  test_assemble<float64, int64, Eigen::ColMajor>(20, 100000, 100000, 3);
+}
+
+TEST(SparseMatrixAssembler, OutOfRange) {
+  ThreadPool pool(2);
+  SparseMatrixAssembler assembler(4, 4, true, &pool);
+  std::vector<int32> triplets = {0, 0, taichi_union_cast<int32>(1.0f),
+                                 4, 1, taichi_union_cast<int32>(1.0f)};
+  std::vector<float32> values;
+  EXPECT_THROW((assembler.assemble<float32, int32>(triplets.data(), 2, values)),
+               std::string);
+}
+
+}  // namespace taichi::lang
@@ -0,0 +1,170 @@
+#include "gtest/gtest.h"
+
+#include <cmath>
+
+#include "taichi/program/supernodal_cholesky.h"
+
+namespace taichi::lang {
+
+namespace {
+
+// The 7-point Laplacian of a kx x ky x kz grid, plus a varying diagonal, in
+// CSC. With kz = 1 this is the 5-point Laplacian of a 2D grid.
+template <typename DT>
+struct Laplacian {
+  Laplacian(int kx, int ky, int kz) : n(kx * ky * kz) {
+    outer_ptr.push_back(0);
+    for (int z = 0; z < kz; z++) {
+      for (int y = 0; y < ky; y++) {
+        for (int x = 0; x < kx; x++) {
+          const int col = (z * ky + y) * kx + x;
+          auto add = [&](int row, DT value) {
+            inner_indices.push_back(row);
+            values.push_back(value);
+          };
+          if (z > 0) {
+            add(col - kx * ky, -1);
+          }
+          if (y > 0) {
+            add(col - kx, -1);
+          }
+          if (x > 0) {
+            add(col - 1, -1);
+          }
+          add(col, 6 + DT(col % 7) * DT(0.5));
+          if (x < kx - 1) {
+            add(col + 1, -1);
+          }
+          if (y < ky - 1) {
+            add(col + kx, -1);
+          }
+          if (z < kz - 1) {
+            add(col + kx * ky, -1);
+          }
+          outer_ptr.push_back((int)values.size());
+        }
+      }
+    }
+  }
+
+  // |b - A x| / |b|
+  double relative_residual(const std::vector<DT> &x,
+                           const std::vector<DT> &b) const {
+    std::vector<double> Ax(n, 0);
+    for (int j = 0; j < n; j++) {
+      for (int k = outer_ptr[j]; k < outer_ptr[j + 1]; k++) {
+        Ax[inner_indices[k]] += double(values[k]) * double(x[j]);
+      }
+    }
+    double r2 = 0, b2 = 0;
+    for (int i = 0; i < n; i++) {
+      r2 += (double(b[i]) - Ax[i]) * (double(b[i]) - Ax[i]);
+      b2 += double(b[i]) * double(b[i]);
+    }
+    return std::sqrt(r2 / b2);
+  }
+
+  int n{0};
+  std::vector<int> outer_ptr;
+  std::vector<int> inner_indices;
+  std::vector<DT> values;
+};
+
+template <typename DT>
+std::vector<DT> make_rhs(int n) {
+  std::vector<DT> b(n);
+  for (int i = 0; i < n; i++) {
+    b[i] = DT(i % 11) - 5;
+  }
+  return b;
+}
+
+template <typename DT>
+void factorize_and_check(const Laplacian<DT> &A,
+                         bool ldlt,
+                         SupernodalOrdering ordering,
+                         ThreadPool *thread_pool,
+                         double tol) {
+  SupernodalCholesky<DT> solver(ldlt, ordering);
+  solver.set_thread_pool(thread_pool);
+  solver.analyze_pattern(A.n, A.outer_ptr.data(), A.inner_indices.data());
+  ASSERT_TRUE(solver.factorize(A.values.data()));
+  EXPECT_LT(solver.num_supernodes(), A.n);
+  auto b = make_rhs<DT>(A.n);
+  std::vector<DT> x(A.n);
+  solver.solve(b.data(), x.data());
+  EXPECT_LE(A.relative_residual(x, b), tol);
+}
+
+}  // namespace
+
+TEST(SupernodalCholesky, Laplacian) {
+  ThreadPool thread_pool(4);
+  for (ThreadPool *pool : {(ThreadPool *)nullptr, &thread_pool}) {
+    for (bool ldlt : {false, true}) {
+      for (auto ordering :
+           {SupernodalOrdering::natural, SupernodalOrdering::amd,
+            SupernodalOrdering::colamd}) {
+        factorize_and_check(Laplacian<float64>(40, 40, 1), ldlt, ordering,
+                            pool, 1e-12);
+        // Large supernodes near the root, which are split across threads
+        factorize_and_check(Laplacian<float64>(14, 14, 14), ldlt, ordering,
+                            pool, 1e-12);
+        factorize_and_check(Laplacian<float32>(20, 20, 1), ldlt, ordering,
+                            pool, 1e-5);
+      }
+    }
+  }
+}
+
+TEST(SupernodalCholesky, Refactorize) {
+  Laplacian<float64> A(12, 12, 6);
+  SupernodalCholesky<float64> solver(false, SupernodalOrdering::amd);
+  solver.analyze_pattern(A.n, A.outer_ptr.data(), A.inner_indices.data());
+  const std::size_t factor_size = solver.factor_size();
+  ASSERT_TRUE(solver.factorize(A.values.data()));
+
+  // Same pattern, other values: the analysis is reused
+  for (auto &value : A.values) {
+    value *= 2;
+  }
+  EXPECT_TRUE(solver.has_pattern(A.n, A.outer_ptr.data(),
+                                 A.inner_indices.data()));
+  ASSERT_TRUE(solver.factorize(A.values.data()));
+  EXPECT_EQ(solver.factor_size(), factor_size);
+  auto b = make_rhs<float64>(A.n);
+  // In place
+  auto x = b;
+  solver.solve(x.data(), x.data());
+  EXPECT_LE(A.relative_residual(x, b), 1e-12);
+
+  Laplacian<float64> B(12, 12, 5);
+  EXPECT_FALSE(solver.has_pattern(B.n, B.outer_ptr.data(),
+                                  B.inner_indices.data()));
+}
+
+TEST(SupernodalCholesky, Indefinite) {
+  // Negative definite: LL^T fails, LDL^T does not
+  Laplacian<float64> A(10, 10, 1);
+  for (auto &value : A.values) {
+    value = -value;
+  }
+  SupernodalCholesky<float64> llt(false, SupernodalOrdering::amd);
+  llt.analyze_pattern(A.n, A.outer_ptr.data(), A.inner_indices.data());
+  EXPECT_FALSE(llt.factorize(A.values.data()));
+  EXPECT_FALSE(llt.info());
+  std::vector<float64> b = make_rhs<float64>(A.n), x(A.n);
+  EXPECT_THROW(llt.solve(b.data(), x.data()), std::string);
+
+  SupernodalCholesky<float64> ldlt(true, SupernodalOrdering::amd);
+  ldlt.analyze_pattern(A.n, A.outer_ptr.data(), A.inner_indices.data());
+  ASSERT_TRUE(ldlt.factorize(A.values.data()));
+  ldlt.solve(b.data(), x.data());
+  EXPECT_LE(A.relative_residual(x, b), 1e-12);
+
+  EXPECT_THROW(supernodal_ordering_from_name("METIS"), std::string);
+  EXPECT_EQ(supernodal_ordering_from_name("COLAMD"),
+            SupernodalOrdering::colamd);
+}
+
+}  // namespace taichi::lang
@@ -1,5 +1,9 @@
 #include "gtest/gtest.h"
 
+#include <cstring>
+#include <set>
+#include <thread>
+
 #include "taichi/rhi/common/host_memory_pool.h"
 
 namespace taichi::lang {
@@ -34,4 +38,185 @@ TEST(HostMemoryPool, AllocateMemory) {
   HostMemoryPoolTestHelper::setDefaultAllocatorSize(oldAllocatorSize);
 }
 
+TEST(HostMemoryPool, ReuseSmallAllocations) {
+  HostMemoryPool pool;
+
+  std::set<void *> allocated;
+  for (int i = 0; i < 1000; i++) {
+    void *ptr = pool.allocate(200, 16);
+    std::memset(ptr, 0xff, 200);
+    allocated.insert(ptr);
+  }
+  EXPECT_EQ(allocated.size(), 1000);
+  const auto span_bytes = pool.get_stats().small_span_bytes;
+  for (void *ptr : allocated) {
+    pool.release(200, ptr);
+  }
+  // The freed blocks are handed out again, cleared
+  int num_reused = 0;
+  for (int i = 0; i < 1000; i++) {
+    auto *ptr = (char *)pool.allocate(200, 16);
+    num_reused += allocated.count(ptr);
+    for (int j = 0; j < 200; j++) {
+      ASSERT_EQ(ptr[j], 0);
+    }
+  }
+  EXPECT_GT(num_reused, 900);
+  auto stats = pool.get_stats();
+  EXPECT_EQ(stats.small_span_bytes, span_bytes);
+  EXPECT_EQ(stats.reserved_bytes,
+            stats.small_span_bytes + stats.free_run_bytes);
+}
+
+TEST(HostMemoryPool, Alignment) {
+  HostMemoryPool pool;
+  for (std::size_t alignment : {8, 16, 64, 256, 4096, 65536}) {
+    for (std::size_t size : {1, 24, 100, 5000, 70000}) {
+      void *ptr = pool.allocate(size, alignment);
+      EXPECT_EQ((std::size_t)ptr % alignment, 0);
+      pool.release(size, ptr);
+    }
+  }
+}
+
+TEST(HostMemoryPool, CoalesceLargeAllocations) {
+  auto oldAllocatorSize = HostMemoryPoolTestHelper::getDefaultAllocatorSize();
+  HostMemoryPoolTestHelper::setDefaultAllocatorSize(1 << 20);  // 1MB
+
+  HostMemoryPool pool;
+  const std::size_t size = 256 << 10;
+  auto *ptr1 = (char *)pool.allocate(size, 16);
+  auto *ptr2 = (char *)pool.allocate(size, 16);
+  auto *ptr3 = (char *)pool.allocate(size, 16);
+  std::memset(ptr2, 0xff, size);
+  EXPECT_EQ(pool.get_stats().large_bytes, 3 * size);
+
+  pool.release(size, ptr2);
+  auto stats = pool.get_stats();
+  EXPECT_EQ(stats.num_free_runs, 2);
+  EXPECT_EQ(stats.free_run_bytes, (1 << 20) - 2 * size);
+  EXPECT_EQ(stats.largest_free_run_bytes, size);
+  EXPECT_DOUBLE_EQ(stats.fragmentation(), 0.5);
+
+  // The freed run is reused, zero-filled
+  auto *ptr4 = (char *)pool.allocate(size, 16);
+  EXPECT_EQ(ptr4, ptr2);
+  for (std::size_t i = 0; i < size; i++) {
+    ASSERT_EQ(ptr4[i], 0);
+  }
+
+  pool.release(size, ptr1);
+  pool.release(size, ptr4);
+  pool.release(size, ptr3);
+  stats = pool.get_stats();
+  EXPECT_EQ(stats.reserved_bytes, 1 << 20);
+  EXPECT_EQ(stats.num_free_runs, 1);
+  EXPECT_EQ(stats.free_run_bytes, 1 << 20);
+  EXPECT_EQ(stats.fragmentation(), 0.0);
+
+  // Chunks beyond the first one are released once they are free
+  void *big = pool.allocate(4 << 20, 16);
+  EXPECT_EQ(pool.get_stats().reserved_bytes, 5 << 20);
+  pool.release(4 << 20, big);
+  EXPECT_EQ(pool.get_stats().reserved_bytes, 1 << 20);
+
+  void *exclusive = pool.allocate(size, 16, /*exclusive=*/true);
+  EXPECT_EQ(pool.get_stats().exclusive_bytes, size);
+  pool.release(size, exclusive);
+  EXPECT_EQ(pool.get_stats().reserved_bytes, 1 << 20);
+
+  HostMemoryPoolTestHelper::setDefaultAllocatorSize(oldAllocatorSize);
+}
+
+TEST(HostMemoryPool, FlushThreadCache) {
+  auto allocate_and_release = [](HostMemoryPool &pool) {
+    std::vector<void *> ptrs;
+    for (int i = 0; i < 16; i++) {
+      ptrs.push_back(pool.allocate(200, 16));
+    }
+    // All of them fit in the cache of the thread
+    for (void *ptr : ptrs) {
+      pool.release(200, ptr);
+    }
+  };
+
+  // The blocks go back to the pool when the thread exits
+  HostMemoryPool pool;
+  std::thread([&]() { allocate_and_release(pool); }).join();
+  EXPECT_GE(pool.get_stats().small_free_bytes, 16 * 200);
+
+  // ...and when the thread moves on to another pool
+  HostMemoryPool pool_a, pool_b;
+  allocate_and_release(pool_a);
+  EXPECT_EQ(pool_a.get_stats().small_free_bytes, 0);
+  pool_b.release(200, pool_b.allocate(200, 16));
+  EXPECT_GE(pool_a.get_stats().small_free_bytes, 16 * 200);
+}
+
+TEST(HostMemoryPool, ResetDropsThreadCache) {
+  HostMemoryPool pool;
+  std::vector<void *> ptrs;
+  for (int i = 0; i < 16; i++) {
+    ptrs.push_back(pool.allocate(200, 16));
+  }
+  for (void *ptr : ptrs) {
+    pool.release(200, ptr);
+  }
+  // The blocks cached by this thread went away with the memory of the pool
+  pool.reset();
+  EXPECT_EQ(pool.get_stats().reserved_bytes, 0);
+  auto *ptr = (char *)pool.allocate(200, 16);
+  EXPECT_GT(pool.get_stats().small_span_bytes, 0);
+  std::memset(ptr, 0xff, 200);
+  pool.release(200, ptr);
+
+  // Threads that cached blocks before the reset start over as well
+  std::thread([&]() {
+    pool.release(200, pool.allocate(200, 16));
+    pool.reset();
+    auto *ptr = (char *)pool.allocate(200, 16);
+    std::memset(ptr, 0xff, 200);
+    pool.release(200, ptr);
+  }).join();
+  EXPECT_GT(pool.get_stats().small_span_bytes, 0);
+}
+
+TEST(HostMemoryPool, MultipleThreads) {
+  HostMemoryPool pool;
+
+  // Each thread frees the allocations of the previous one
+  const int kNumThreads = 4;
+  const int kNumAllocations = 10000;
+  std::vector<std::vector<void *>> allocations(kNumThreads + 1);
+  for (int i = 0; i < kNumAllocations; i++) {
+    allocations[0].push_back(pool.allocate(16 + i % 1000, 16));
+  }
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < kNumAllocations; i++) {
+        auto *ptr = (int *)pool.allocate(16 + i % 1000, 16);
+        ASSERT_EQ(*ptr, 0);
+        *ptr = t + 1;
+        allocations[t + 1].push_back(ptr);
+      }
+    });
+    threads.back().join();
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < kNumAllocations; i++) {
+        pool.release(16 + i % 1000, allocations[t][i]);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+  std::set<void *> live(allocations[kNumThreads].begin(),
+                        allocations[kNumThreads].end());
+  EXPECT_EQ(live.size(), kNumAllocations);
+  EXPECT_FALSE(pool.report().empty());
+}
+
 }  // namespace taichi::lang
@@ -190,5 +190,88 @@ TEST_F(MakeBlockLocalTest, Basic) {
   }
 }
 
+TEST_F(MakeBlockLocalTest, CpuPrologue) {
+  initialize(/*pointer_size=*/2, /*block_size=*/4);
+
+  // x[block_size * i - 1, block_size * j - 3]: the pad size is 5 x 7
+  auto *loop_idx0_ = builder_.get_loop_index(for_stmt_.get(), /*index=*/0);
+  auto *loop_idx1_ = builder_.get_loop_index(for_stmt_.get(), /*index=*/1);
+  auto *idx0 = builder_.create_mul(loop_idx0_,
+                                   builder_.get_int32(get_block_size(0)));
+  auto *idx1 = builder_.create_mul(loop_idx1_,
+                                   builder_.get_int32(get_block_size(1)));
+  builder_.create_global_load(builder_.create_global_ptr(
+      bls_place_snode_, /*indices=*/{idx0, idx1}));
+  builder_.create_global_load(builder_.create_global_ptr(
+      bls_place_snode_, /*indices=*/{builder_.create_add(
+                                         idx0, builder_.get_int32(-1)),
+                                     builder_.create_add(
+                                         idx1, builder_.get_int32(-3))}));
+
+  CompileConfig config;
+  config.arch = Arch::x64;
+  irpass::make_block_local(for_stmt_.get(), config,
+                           MakeBlockLocalPass::Args{});
+  EXPECT_EQ(for_stmt_->bls_size, 5 * 7 * sizeof(float));
+
+  // The prologue walks the pad with one serial loop per axis
+  ASSERT_NE(for_stmt_->bls_prologue, nullptr);
+  std::vector<RangeForStmt *> loops;
+  Block *block = for_stmt_->bls_prologue.get();
+  while (true) {
+    RangeForStmt *loop = nullptr;
+    for (auto &stmt : block->statements) {
+      if (auto *range_for = stmt->cast<RangeForStmt>()) {
+        loop = range_for;
+      }
+    }
+    if (!loop) {
+      break;
+    }
+    EXPECT_TRUE(loop->strictly_serialized);
+    loops.push_back(loop);
+    block = loop->body.get();
+  }
+  ASSERT_EQ(loops.size(), 2);
+  EXPECT_EQ(loops[0]->end->as<ConstStmt>()->val.val_int32(), 5);
+  EXPECT_EQ(loops[1]->end->as<ConstStmt>()->val.val_int32(), 7);
+
+  for (int i = 0; i < 5; i++) {
+    for (int j = 0; j < 7; j++) {
+      ArithmeticInterpretor::CodeRegion code_region;
+      ArithmeticInterpretor::EvalContext init_ctx;
+      code_region.block = block;
+      code_region.begin = block->statements.front().get();
+      // The global pointer and load are emitted between the offset and the
+      // block local ptr, so stop right after the offset.
+      Stmt *offset = nullptr;
+      for (auto &stmt : block->statements) {
+        if (auto *bls_ptr = stmt->cast<BlockLocalPtrStmt>()) {
+          offset = bls_ptr->offset;
+        }
+      }
+      ASSERT_NE(offset, nullptr);
+      for (int k = 0; k < block->statements.size(); k++) {
+        auto *stmt = block->statements[k].get();
+        if (auto *li = stmt->cast<LoopIndexStmt>()) {
+          init_ctx.insert(
+              li, TypedConstant(PrimitiveType::i32, li->loop == loops[0] ? i
+                                                                         : j));
+        } else if (stmt->is<BlockCornerIndexStmt>()) {
+          init_ctx.insert(stmt, TypedConstant(PrimitiveType::i32, 0));
+        } else if (stmt == offset) {
+          code_region.end = block->statements[k + 1].get();
+          break;
+        }
+      }
+      auto bls_offset_opt = ArithmeticInterpretor().evaluate(code_region,
+                                                             init_ctx);
+      ASSERT_TRUE(bls_offset_opt.has_value());
+      EXPECT_EQ(bls_offset_opt.value().val_int32(),
+                (i * 7 + j) * (int)sizeof(float));
+    }
+  }
+}
+
 }  // namespace
 }  // namespace taichi::lang
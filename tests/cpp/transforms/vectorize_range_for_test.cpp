@@ -0,0 +1,207 @@
+#include "gtest/gtest.h"
+
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/ir_builder.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+
+namespace taichi::lang {
+namespace {
+
+class VectorizeRangeForTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    config_.arch = Arch::x64;
+    config_.real_matrix_scalarize = false;
+    config_.vectorize_range_for = true;
+    config_.simd_width = 8;
+    config_.max_vector_width = 8;
+
+    // The range-for task as made by make_cpu_multithreaded_range_for
+    offload_ = builder_.insert(Stmt::make_typed<OffloadedStmt>(
+        OffloadedStmt::TaskType::range_for, Arch::x64, nullptr));
+    builder_.set_insertion_point({offload_->body.get(), 0});
+    auto *begin = builder_.get_int32(0);
+    auto *end = builder_.get_int32(1000);
+    loop_ = builder_.create_range_for(begin, end, /*is_bit_vectorized=*/false,
+                                      /*num_cpu_threads=*/1, /*block_dim=*/1,
+                                      /*strictly_serialized=*/true);
+    builder_.set_insertion_point_to_loop_begin(loop_);
+    index_ = builder_.get_loop_index(loop_);
+  }
+
+  // Runs the pass, returns whether the loop is vectorized.
+  bool run() {
+    ir_ = builder_.extract_ir();
+    irpass::type_check(ir_.get(), config_);
+    return irpass::vectorize_range_for(ir_.get(), config_);
+  }
+
+  template <typename T>
+  int count() const {
+    return irpass::analysis::gather_statements(ir_.get(), [](Stmt *stmt) {
+             return stmt->is<T>();
+           }).size();
+  }
+
+  // The loops of the offloaded task
+  std::vector<RangeForStmt *> loops() const {
+    std::vector<RangeForStmt *> result;
+    for (auto &stmt : offload_->body->statements) {
+      if (auto *loop = stmt->cast<RangeForStmt>()) {
+        result.push_back(loop);
+      }
+    }
+    return result;
+  }
+
+  CompileConfig config_;
+  IRBuilder builder_;
+  OffloadedStmt *offload_{nullptr};
+  RangeForStmt *loop_{nullptr};
+  Stmt *index_{nullptr};
+  std::unique_ptr<Block> ir_;
+};
+
+TEST_F(VectorizeRangeForTest, Dot) {
+  // s += x[i] * y[i]
+  auto *x = builder_.create_ndarray_arg_load({0}, PrimitiveType::f32, 1, 0);
+  auto *y = builder_.create_ndarray_arg_load({1}, PrimitiveType::f32, 1, 0);
+  auto *x_ptr = builder_.create_external_ptr(x, {index_});
+  auto *y_ptr = builder_.create_external_ptr(y, {index_});
+  auto *sum = builder_.insert(
+      Stmt::make_typed<GlobalTemporaryStmt>(0, PrimitiveType::f32));
+  builder_.create_atomic_add(
+      sum, builder_.create_mul(builder_.create_global_load(x_ptr),
+                               builder_.create_global_load(y_ptr)));
+
+  ASSERT_TRUE(run());
+  EXPECT_EQ(count<VectorLoadStmt>(), 2);
+
+  // The vector loop, then the original loop for the remaining iterations
+  auto loops = this->loops();
+  ASSERT_EQ(loops.size(), 2);
+  EXPECT_NE(loops[0], loop_);
+  EXPECT_EQ(loops[1], loop_);
+  EXPECT_TRUE(loops[0]->strictly_serialized);
+  EXPECT_FALSE(loop_->begin->is<ConstStmt>());
+
+  for (auto *stmt : irpass::analysis::gather_statements(
+           loops[0]->body.get(),
+           [](Stmt *stmt) { return stmt->is<VectorLoadStmt>(); })) {
+    auto *type = stmt->ret_type->cast<TensorType>();
+    ASSERT_NE(type, nullptr);
+    EXPECT_EQ(type->get_num_elements(), 8);
+    EXPECT_EQ(stmt->as<VectorLoadStmt>()->mask, nullptr);
+  }
+}
+
+TEST_F(VectorizeRangeForTest, Saxpy) {
+  // y[i] = 2 * x[i] + y[i] is left to the LLVM loop vectorizer
+  auto *x = builder_.create_ndarray_arg_load({0}, PrimitiveType::f32, 1, 0);
+  auto *y = builder_.create_ndarray_arg_load({1}, PrimitiveType::f32, 1, 0);
+  auto *x_ptr = builder_.create_external_ptr(x, {index_});
+  auto *y_ptr = builder_.create_external_ptr(y, {index_});
+  auto *ax = builder_.create_mul(builder_.get_float32(2),
+                                 builder_.create_global_load(x_ptr));
+  builder_.create_global_store(
+      y_ptr, builder_.create_add(ax, builder_.create_global_load(y_ptr)));
+
+  ASSERT_FALSE(run());
+  EXPECT_EQ(loops().size(), 1);
+  EXPECT_EQ(count<VectorLoadStmt>(), 0);
+  EXPECT_EQ(count<VectorStoreStmt>(), 0);
+}
+
+TEST_F(VectorizeRangeForTest, MaskedStore) {
+  // if x[i] > 0: x[i] = 0; num_positive += 1
+  auto *x = builder_.create_ndarray_arg_load({0}, PrimitiveType::f32, 1, 0);
+  auto *x_ptr = builder_.create_external_ptr(x, {index_});
+  auto *num_positive = builder_.insert(
+      Stmt::make_typed<GlobalTemporaryStmt>(0, PrimitiveType::i32));
+  auto *zero = builder_.get_float32(0);
+  auto *if_stmt = builder_.create_if(
+      builder_.create_cmp_lt(zero, builder_.create_global_load(x_ptr)));
+  {
+    auto _ = builder_.get_if_guard(if_stmt, true);
+    builder_.create_global_store(x_ptr, zero);
+    builder_.create_atomic_add(num_positive, builder_.get_int32(1));
+  }
+
+  ASSERT_TRUE(run());
+  // The branch is only left in the tail loop
+  auto loops = this->loops();
+  ASSERT_EQ(loops.size(), 2);
+  EXPECT_TRUE(loop_->body->back()->is<IfStmt>());
+  EXPECT_FALSE(loops[0]->body->back()->is<IfStmt>());
+  ASSERT_EQ(count<VectorStoreStmt>(), 1);
+  auto *store = irpass::analysis::gather_statements(ir_.get(), [](Stmt *stmt) {
+                  return stmt->is<VectorStoreStmt>();
+                })[0]->as<VectorStoreStmt>();
+  EXPECT_NE(store->mask, nullptr);
+}
+
+TEST_F(VectorizeRangeForTest, Reduction) {
+  // s += x[i]
+  auto *x = builder_.create_ndarray_arg_load({0}, PrimitiveType::f32, 1, 0);
+  auto *x_ptr = builder_.create_external_ptr(x, {index_});
+  auto *sum = builder_.insert(
+      Stmt::make_typed<GlobalTemporaryStmt>(0, PrimitiveType::f32));
+  builder_.create_atomic_add(sum, builder_.create_global_load(x_ptr));
+
+  ASSERT_TRUE(run());
+  EXPECT_EQ(count<VectorLoadStmt>(), 1);
+  // The atomic of the tail loop and the one after the vector loop
+  EXPECT_EQ(count<AtomicOpStmt>(), 2);
+  auto loops = this->loops();
+  ASSERT_EQ(loops.size(), 2);
+  EXPECT_EQ(irpass::analysis::gather_statements(
+                loops[0]->body.get(),
+                [](Stmt *stmt) { return stmt->is<AtomicOpStmt>(); })
+                .size(),
+            0);
+}
+
+TEST_F(VectorizeRangeForTest, Gather) {
+  // s += x[i * i] is not vectorized
+  auto *x = builder_.create_ndarray_arg_load({0}, PrimitiveType::f32, 1, 0);
+  auto *x_ptr =
+      builder_.create_external_ptr(x, {builder_.create_mul(index_, index_)});
+  auto *sum = builder_.insert(
+      Stmt::make_typed<GlobalTemporaryStmt>(0, PrimitiveType::f32));
+  builder_.create_atomic_add(sum, builder_.create_global_load(x_ptr));
+
+  ASSERT_FALSE(run());
+  EXPECT_EQ(loops().size(), 1);
+  EXPECT_TRUE(loop_->begin->is<ConstStmt>());
+  EXPECT_EQ(count<MatrixInitStmt>(), 0);
+}
+
+TEST_F(VectorizeRangeForTest, StridedNdarray) {
+  // s += x[i], where the stride of x is only known at runtime
+  auto *x = builder_.create_ndarray_arg_load({0}, PrimitiveType::f32, 1, 0,
+                                             /*strided=*/true);
+  auto *x_ptr = builder_.create_external_ptr(x, {index_});
+  auto *sum = builder_.insert(
+      Stmt::make_typed<GlobalTemporaryStmt>(0, PrimitiveType::f32));
+  builder_.create_atomic_add(sum, builder_.create_global_load(x_ptr));
+
+  ASSERT_FALSE(run());
+  EXPECT_EQ(loops().size(), 1);
+  EXPECT_EQ(count<VectorLoadStmt>(), 0);
+}
+
+TEST_F(VectorizeRangeForTest, ScalarizedMatrices) {
+  auto *x = builder_.create_ndarray_arg_load({0}, PrimitiveType::f32, 1, 0);
+  auto *x_ptr = builder_.create_external_ptr(x, {index_});
+  auto *sum = builder_.insert(
+      Stmt::make_typed<GlobalTemporaryStmt>(0, PrimitiveType::f32));
+  builder_.create_atomic_add(sum, builder_.create_global_load(x_ptr));
+
+  config_.real_matrix_scalarize = true;
+  EXPECT_FALSE(run());
+  EXPECT_EQ(count<VectorLoadStmt>(), 0);
+}
+
+}  // namespace
+}  // namespace taichi::lang
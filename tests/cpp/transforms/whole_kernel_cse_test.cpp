@@ -0,0 +1,51 @@
+#include "gtest/gtest.h"
+
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+
+namespace taichi::lang {
+
+TEST(WholeKernelCSE, EliminatesChainsOfDuplicates) {
+  auto block = std::make_unique<Block>();
+
+  auto load_addr =
+      block->push_back<GlobalTemporaryStmt>(0, PrimitiveType::i32);
+  auto load = block->push_back<GlobalLoadStmt>(load_addr);
+  auto one = block->push_back<ConstStmt>(TypedConstant(1));
+  auto add = block->push_back<BinaryOpStmt>(BinaryOpType::add, load, one);
+  auto mul = block->push_back<BinaryOpStmt>(BinaryOpType::mul, add, add);
+
+  // The same computation again. The second multiplication only becomes a
+  // duplicate once the operands of it are replaced.
+  auto one2 = block->push_back<ConstStmt>(TypedConstant(1));
+  auto add2 = block->push_back<BinaryOpStmt>(BinaryOpType::add, load, one2);
+  auto mul2 = block->push_back<BinaryOpStmt>(BinaryOpType::mul, add2, add2);
+  auto if_stmt = block->push_back<IfStmt>(load)->as<IfStmt>();
+
+  auto true_clause = std::make_unique<Block>();
+  auto store_addr =
+      true_clause->push_back<GlobalTemporaryStmt>(4, PrimitiveType::i32);
+  auto store = true_clause->push_back<GlobalStoreStmt>(store_addr, mul2);
+  auto sub =
+      true_clause->push_back<BinaryOpStmt>(BinaryOpType::sub, mul2, add2);
+  true_clause->push_back<GlobalStoreStmt>(store_addr, sub);
+  if_stmt->set_true_statements(std::move(true_clause));
+
+  irpass::type_check(block.get(), CompileConfig());
+  EXPECT_TRUE(irpass::whole_kernel_cse(block.get()));
+
+  EXPECT_EQ(block->size(), 6);
+  EXPECT_EQ(block->statements[4].get(), mul);
+  EXPECT_EQ(store->as<GlobalStoreStmt>()->val, mul);
+  EXPECT_EQ(sub->as<BinaryOpStmt>()->lhs, mul);
+  EXPECT_EQ(sub->as<BinaryOpStmt>()->rhs, add);
+  EXPECT_EQ(irpass::analysis::gather_statements(block.get(), [](Stmt *stmt) {
+              return stmt->is<BinaryOpStmt>();
+            }).size(),
+            3);
+
+  EXPECT_FALSE(irpass::whole_kernel_cse(block.get()));
+}
+
+}  // namespace taichi::lang
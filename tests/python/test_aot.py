@@ -1,6 +1,7 @@
 import hashlib
 import json
 import os
+import re
 import subprocess
 import sys
 import tempfile
@@ -713,3 +714,38 @@ def test_rwtexture_with_ndarray():
     )
     with tempfile.TemporaryDirectory() as tmpdir:
         m.save(tmpdir)
+
+
+@test_utils.test(arch=[ti.vulkan], offline_cache=False)
+def test_aot_spirv_parallel_codegen_is_deterministic():
+    x = ti.field(ti.f32, shape=64)
+    y = ti.field(ti.f32, shape=64)
+
+    def make_kernel():
+        @ti.kernel
+        def multi_task(a: ti.f32):
+            for i in x:
+                x[i] = ti.sin(a * i)
+            for i in y:
+                y[i] = x[i] * 2 + a
+            for i in x:
+                x[i] += ti.cos(y[i])
+            y[0] = x[1]
+
+        return multi_task
+
+    def save(num_compile_threads, tmpdir):
+        ti.lang.impl.current_cfg().num_compile_threads = num_compile_threads
+        m = ti.aot.Module()
+        m.add_kernel(make_kernel())
+        m.save(tmpdir)
+        # Each definition of the kernel gets its own counter in its name
+        contents = {}
+        for name in sorted(os.listdir(tmpdir)):
+            with open(os.path.join(tmpdir, name), "rb") as f:
+                key = re.sub(r"multi_task_c\d+", "multi_task", name)
+                contents[key] = re.sub(rb"multi_task_c\d+", b"multi_task", f.read())
+        return contents
+
+    with tempfile.TemporaryDirectory() as serial_dir, tempfile.TemporaryDirectory() as parallel_dir:
+        assert save(1, serial_dir) == save(4, parallel_dir)
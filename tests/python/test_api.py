@@ -140,6 +140,7 @@ user_api[ti] = [
     "float64",
     "floor",
     "frexp",
+    "from_dlpack",
     "func",
     "get_addr",
     "gles",
@@ -193,6 +194,7 @@ user_api[ti] = [
     "opengl",
     "polar_decompose",
     "pow",
+    "prefetch",
     "profiler",
     "pyfunc",
     "randn",
@@ -373,9 +375,10 @@ user_api[ti.MatrixNdarray] = [
     "fill",
     "from_numpy",
     "get_type",
+    "to_dlpack",
     "to_numpy",
 ]
-user_api[ti.Ndarray] = ["copy_from", "element_shape", "fill", "get_type"]
+user_api[ti.Ndarray] = ["copy_from", "element_shape", "fill", "get_type", "to_dlpack"]
 user_api[ti.Texture] = ["from_field", "from_image", "from_ndarray", "to_image"]
 user_api[ti.SNode] = [
     "bitmasked",
@@ -410,6 +413,7 @@ user_api[ti.ScalarNdarray] = [
     "fill",
     "from_numpy",
     "get_type",
+    "to_dlpack",
     "to_numpy",
 ]
 user_api[ti.Struct] = ["entries", "field", "items", "keys", "methods", "to_dict"]
@@ -436,6 +440,7 @@ user_api[ti.VectorNdarray] = [
     "fill",
     "from_numpy",
     "get_type",
+    "to_dlpack",
     "to_numpy",
 ]
 user_api[ti.sparse] = ["grid", "usage"]
@@ -181,6 +181,43 @@ def test_bls_large_block():
     foo()
 
 
-# TODO: BLS on CPU
+@test_utils.test(require=ti.extension.bls)
+def test_bls_with_tls():
+    x = ti.field(ti.i32)
+    total = ti.field(ti.i32, shape=())
+
+    N = 128
+    bs = 16
+
+    ti.root.pointer(ti.i, N // bs).dense(ti.i, bs).place(x)
+
+    @ti.kernel
+    def populate():
+        for i in range(bs, N - bs):
+            x[i] = i
+
+    @ti.kernel
+    def reduce():
+        ti.block_local(x)
+        for i in x:
+            # The reduction goes through TLS, which shares the buffer with BLS on CPU
+            total[None] += x[i - 1] + x[i] + x[i + 1]
+
+    populate()
+    reduce()
+
+    def x_ref(i):
+        return i if bs <= i < N - bs else 0
+
+    assert total[None] == sum(x_ref(i - 1) + x_ref(i) + x_ref(i + 1) for i in range(bs, N - bs))
+
+
+@test_utils.test(arch=ti.cpu, require=ti.extension.bls)
+def test_bls_cpu_large_footprint():
+    # The footprint of a 256x256 block is over 256 KiB, which is more than CPU BLS
+    # stages, so x is read from global memory instead
+    stencil = [(0, 0), (0, -1), (0, 1), (1, 0)]
+    _test_bls_stencil(2, 1280, bs=256, stencil=stencil)
+
+
 # TODO: BLS boundary out of bound
-# TODO: BLS with TLS
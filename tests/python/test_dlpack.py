@@ -0,0 +1,149 @@
+import gc
+
+import numpy as np
+import pytest
+from taichi.lang.util import has_pytorch
+
+import taichi as ti
+from tests import test_utils
+
+if has_pytorch():
+    import torch
+
+
+@test_utils.test(arch=[ti.cpu])
+def test_ndarray_to_numpy_dlpack():
+    x = ti.ndarray(ti.f32, shape=(4, 5))
+
+    @ti.kernel
+    def fill(x: ti.types.ndarray()):
+        for i, j in x:
+            x[i, j] = i * 10 + j
+
+    fill(x)
+    y = np.from_dlpack(x)
+    assert y.shape == (4, 5)
+    assert y.dtype == np.float32
+    assert np.array_equal(y, x.to_numpy())
+
+    # Both sides see the writes of the other one
+    y[1, 2] = -1
+    assert x[1, 2] == -1
+    fill(x)
+    ti.sync()
+    assert y[1, 2] == 12
+
+    # The exported array keeps the ndarray alive
+    del x
+    gc.collect()
+    assert y[3, 4] == 34
+
+
+@test_utils.test(arch=[ti.cpu])
+def test_vector_ndarray_to_numpy_dlpack():
+    x = ti.Vector.ndarray(3, ti.i32, shape=(2, 4))
+    x[1, 3] = [1, 2, 3]
+    y = np.from_dlpack(x)
+    assert y.shape == (2, 4, 3)
+    assert list(y[1, 3]) == [1, 2, 3]
+
+
+@test_utils.test(arch=[ti.cpu])
+def test_ndarray_from_numpy_dlpack():
+    a = np.arange(24, dtype=np.float32).reshape(8, 3)
+
+    @ti.kernel
+    def scale(x: ti.types.ndarray(dtype=ti.math.vec3, ndim=1)):
+        for i in x:
+            x[i] *= 2
+
+    x = ti.from_dlpack(a, element_shape=(3,))
+    assert x.shape == (8,)
+    assert x.element_shape == (3,)
+    scale(x)
+    ti.sync()
+    # The kernel wrote into a
+    assert np.array_equal(a, np.arange(24, dtype=np.float32).reshape(8, 3) * 2)
+
+    s = ti.from_dlpack(a)
+    assert s.shape == (8, 3)
+    assert s[7, 2] == 46
+
+    # The ndarray keeps the numpy array alive
+    b = np.ones((5, 5), dtype=np.int32)
+    m = ti.from_dlpack(b, element_shape=(5,))
+    del b
+    gc.collect()
+    assert m.to_numpy()[4, 4] == 1
+
+
+@test_utils.test(arch=[ti.cpu])
+def test_ndarray_from_dlpack_strided():
+    a = np.arange(24, dtype=np.float32).reshape(4, 6)
+
+    @ti.kernel
+    def add_index(x: ti.types.ndarray(dtype=ti.f32, ndim=2)):
+        for i, j in x:
+            x[i, j] += i * 10 + j
+
+    # A transposed view is imported with its strides
+    t = ti.from_dlpack(a.T)
+    assert t.shape == (6, 4)
+    assert t[5, 1] == a[1, 5]
+    t[2, 3] = -1
+    assert a[3, 2] == -1
+    expected = a.T + np.add.outer(np.arange(6) * 10, np.arange(4))
+    add_index(t)
+    ti.sync()
+    assert np.array_equal(a.T, expected)
+    assert np.array_equal(t.to_numpy(), expected)
+
+    # So is a sliced one, and the same kernel takes compact ndarrays too
+    b = np.zeros((8, 6), dtype=np.float32)
+    s = ti.from_dlpack(b[1::2, ::3])
+    assert s.shape == (4, 2)
+    add_index(s)
+    ti.sync()
+    assert b[7, 3] == 31
+    assert b[0, 0] == 0 and b[7, 4] == 0
+
+    c = np.zeros((3, 2), dtype=np.float32)
+    add_index(ti.from_dlpack(c))
+    ti.sync()
+    assert c[2, 1] == 21
+
+    s.fill(5)
+    assert b[1, 0] == 5 and b[1, 1] == 0
+
+    # Vector elements must be compact
+    v = np.zeros((8, 3), dtype=np.float32)
+    with pytest.raises(RuntimeError, match="elements of the DLPack tensor are not compact"):
+        ti.from_dlpack(v[:, ::2], element_shape=(2,))
+    with pytest.raises(RuntimeError):
+        ti.from_dlpack(a, element_shape=(4,))
+
+    @ti.kernel
+    def scale(x: ti.types.ndarray(dtype=ti.math.vec3, ndim=1)):
+        for i in x:
+            x[i] *= 2
+
+    v[:] = 1
+    w = ti.from_dlpack(v[::2], element_shape=(3,))
+    scale(w)
+    ti.sync()
+    assert np.array_equal(v[::2], np.full((4, 3), 2))
+    assert np.array_equal(v[1::2], np.ones((4, 3)))
+
+
+@pytest.mark.skipif(not has_pytorch(), reason="Pytorch not installed.")
+@test_utils.test(arch=[ti.cpu])
+def test_ndarray_torch_dlpack():
+    x = ti.ndarray(ti.f64, shape=(3, 3))
+    x[1, 1] = 4
+    t = torch.utils.dlpack.from_dlpack(x.to_dlpack())
+    assert t[1, 1] == 4
+
+    u = torch.zeros((4,), dtype=torch.int32)
+    y = ti.from_dlpack(u)
+    y[2] = 9
+    assert u[2] == 9
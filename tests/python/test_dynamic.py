@@ -178,6 +178,39 @@ def test_dense_dynamic_len():
         assert l[i] == 0
 
 
+@test_utils.test(require=ti.extension.sparse, exclude=[ti.metal])
+def test_dense_dynamic_many_chunks():
+    # Each list spans many small chunks, so that the chunk directory has to
+    # grow several times, and is reused after deactivation.
+    n = 16
+    m = 3000
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i64, shape=n)
+
+    block = ti.root.dense(ti.i, n).dynamic(ti.j, 4096, 8)
+    block.place(x)
+
+    @ti.kernel
+    def fill():
+        for i, k in ti.ndrange(n, m):
+            ti.append(block, i, i * m + k)
+
+    @ti.kernel
+    def total():
+        for i, j in x:
+            s[i] += x[i, j]
+
+    for _ in range(2):
+        fill()
+        s.fill(0)
+        total()
+        for i in range(n):
+            assert s[i] == sum(range(i * m, (i + 1) * m))
+            assert x[i, m - 1] // m == i
+            assert x[i, m] == 0
+        block.deactivate_all()
+
+
 @test_utils.test(require=ti.extension.sparse, exclude=[ti.metal])
 def test_dynamic_activate():
     # record the lengths
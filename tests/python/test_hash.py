@@ -0,0 +1,211 @@
+import time
+
+import pytest
+
+import taichi as ti
+from tests import test_utils
+
+
+@test_utils.test(arch=ti.cpu)
+def test_hash_struct_for():
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i32)
+
+    # A huge bounding box that only holds a few active blocks.
+    ti.root.hash(ti.ij, 32768, capacity=64).dense(ti.ij, 4).place(x)
+    ti.root.place(s)
+
+    @ti.kernel
+    def fill():
+        for k in range(16):
+            x[k * 4000, 100000] = k + 1
+
+    @ti.kernel
+    def func():
+        for i, j in x:
+            s[None] += x[i, j]
+
+    fill()
+    func()
+    assert s[None] == sum(range(1, 17))
+    assert x[4000 * 15, 100000] == 16
+    assert x[4000 * 15 + 1, 100000] == 0
+
+
+@test_utils.test(arch=ti.cpu)
+def test_hash_leaf_struct_for():
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i64)
+
+    ti.root.hash(ti.i, 1 << 24, capacity=1000).place(x)
+    ti.root.place(s)
+
+    @ti.kernel
+    def fill():
+        for k in range(1000):
+            x[k * 16777] = k
+
+    @ti.kernel
+    def func():
+        for i in x:
+            s[None] += i
+
+    fill()
+    func()
+    assert s[None] == sum(k * 16777 for k in range(1000))
+
+
+@test_utils.test(arch=ti.cpu)
+def test_hash_is_active_and_deactivate():
+    x = ti.field(ti.f32)
+    c = ti.field(ti.i32)
+
+    blk = ti.root.hash(ti.i, 1 << 20, capacity=128)
+    blk.dense(ti.i, 8).place(x)
+    ti.root.place(c)
+
+    @ti.kernel
+    def activate():
+        for k in range(100):
+            x[k * 1024] = 1
+
+    @ti.kernel
+    def deactivate_odd():
+        for k in range(100):
+            if k % 2 == 1:
+                ti.deactivate(blk, [k * 128])
+
+    @ti.kernel
+    def count():
+        for i in range(1 << 17):
+            if ti.is_active(blk, [i]):
+                c[None] += 1
+
+    activate()
+    count()
+    assert c[None] == 100
+
+    deactivate_odd()
+    c[None] = 0
+    count()
+    assert c[None] == 50
+    assert x[1024] == 0
+    assert x[2048] == 1
+
+    # Deactivated indices can be activated again.
+    for _ in range(3):
+        activate()
+        blk.deactivate_all()
+    c[None] = 0
+    count()
+    assert c[None] == 0
+
+
+@test_utils.test(arch=ti.cpu)
+def test_hash_capacity_bounds_live_cells_only():
+    x = ti.field(ti.i32)
+    c = ti.field(ti.i32)
+
+    capacity = 16
+    blk = ti.root.hash(ti.i, 1 << 20, capacity=capacity)
+    blk.dense(ti.i, 4).place(x)
+    ti.root.place(c)
+
+    @ti.kernel
+    def activate(base: ti.i32):
+        for k in range(capacity):
+            x[(base + k) * 4] = base + k
+
+    @ti.kernel
+    def count():
+        for i in x:
+            if x[i] != 0:
+                c[None] += 1
+
+    # Far more distinct cells than the table has slots go through it over
+    # time, with at most |capacity| of them active at once.
+    for r in range(1, 40):
+        activate(r * capacity)
+        c[None] = 0
+        count()
+        assert c[None] == capacity
+        assert x[r * capacity * 4] == r * capacity
+        blk.deactivate_all()
+        assert x[r * capacity * 4] == 0
+
+
+@test_utils.test(arch=ti.cpu)
+def test_hash_churn_keeps_lookups_fast():
+    x = ti.field(ti.i32)
+
+    capacity = 4096
+    blk = ti.root.hash(ti.i, 1 << 30, capacity=capacity)
+    blk.place(x)
+
+    @ti.kernel
+    def activate(base: ti.i32):
+        for k in range(capacity // 2):
+            x[base + k] = 1
+
+    @ti.kernel
+    def deactivate(base: ti.i32):
+        for k in range(capacity // 2):
+            ti.deactivate(blk, [base + k])
+
+    @ti.kernel
+    def count_misses(base: ti.i32, n: ti.i32) -> ti.i32:
+        s = 0
+        for k in range(n):
+            if not ti.is_active(blk, [base + k]):
+                s += 1
+        return s
+
+    # Far more distinct indices than the table has slots churn through it.
+    rounds = 32
+    for r in range(rounds):
+        activate(r * capacity)
+        deactivate(r * capacity)
+    activate(rounds * capacity)
+    assert x[rounds * capacity] == 1
+    assert x[(rounds - 1) * capacity] == 0
+
+    # Compile the kernel before timing it.
+    count_misses(0, 1)
+    # If the slots of deactivated cells were never reclaimed, each of these
+    # misses would probe the whole table.
+    n = 1 << 22
+    t = time.perf_counter()
+    misses = count_misses((rounds + 1) * capacity, n)
+    elapsed = time.perf_counter() - t
+    assert misses == n
+    assert elapsed < 1
+
+
+@test_utils.test(arch=ti.cpu)
+def test_hash_parallel_activation():
+    x = ti.field(ti.i32)
+
+    ti.root.hash(ti.i, 1 << 20, capacity=256).dense(ti.i, 16).place(x)
+
+    @ti.kernel
+    def fill():
+        for i in range(256 * 16):
+            # Every block is activated by 16 iterations at once.
+            ti.atomic_add(x[(i % 256) * 4096 + i // 256], 1)
+
+    @ti.kernel
+    def total() -> ti.i32:
+        s = 0
+        for i in x:
+            s += x[i]
+        return s
+
+    fill()
+    assert total() == 256 * 16
+
+
+@test_utils.test(arch=ti.cpu)
+def test_hash_must_be_child_of_root():
+    x = ti.field(ti.i32)
+    with pytest.raises(ti.TaichiRuntimeError, match="child of root"):
+        ti.root.dense(ti.i, 4).hash(ti.i, 4).place(x)
@@ -40,6 +40,16 @@ def test_list_manager():
     test()
 
 
+@test_utils.test(exclude=[ti.metal, ti.opengl, ti.gles, ti.cuda, ti.vulkan, ti.amdgpu])
+def test_runtime_object_allocator():
+    @ti.kernel
+    def test():
+        impl.call_internal("test_runtime_object_allocator")
+
+    test()
+    test()
+
+
 @test_utils.test(exclude=[ti.metal, ti.opengl, ti.gles, ti.cuda, ti.vulkan, ti.amdgpu])
 def test_node_manager():
     @ti.kernel
@@ -59,6 +69,15 @@ def test_node_manager_gc():
     test_cpu()
 
 
+@test_utils.test(arch=ti.cpu)
+def test_node_manager_gc_parallel():
+    @ti.kernel
+    def test_cpu():
+        impl.call_internal("test_node_allocator_gc_parallel_cpu")
+
+    test_cpu()
+
+
 @test_utils.test(arch=[ti.cpu, ti.cuda, ti.amdgpu], debug=True)
 def test_return():
     @ti.kernel
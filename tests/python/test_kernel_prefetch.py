@@ -0,0 +1,93 @@
+import pytest
+
+import taichi as ti
+from tests import test_utils
+
+
+@test_utils.test()
+def test_prefetch_kernels():
+    n = 64
+    x = ti.field(ti.f32, shape=n)
+    s = ti.field(ti.f32, shape=())
+
+    @ti.kernel
+    def fill():
+        for i in x:
+            x[i] = i
+
+    @ti.kernel
+    def scale(k: ti.f32):
+        for i in x:
+            x[i] *= k
+
+    @ti.kernel
+    def add(a: ti.template(), k: ti.template()):
+        for i in a:
+            a[i] += k
+
+    @ti.kernel
+    def total():
+        for i in x:
+            s[None] += x[i]
+
+    ti.prefetch(fill, scale, (add, x, 1), (add, x, 2), total)
+    fill()
+    scale(2.0)
+    add(x, 1)
+    add(x, 2)
+    total()
+    assert s[None] == pytest.approx(sum(2 * i + 3 for i in range(n)))
+
+
+@test_utils.test()
+def test_prefetch_class_kernels():
+    @ti.data_oriented
+    class Counter:
+        def __init__(self):
+            self.c = ti.field(ti.i32, shape=())
+
+        @ti.kernel
+        def inc(self, k: ti.i32):
+            self.c[None] += k
+
+        @staticmethod
+        @ti.kernel
+        def double(a: ti.template()):
+            a[None] *= 2
+
+    counter = Counter()
+    ti.prefetch(counter.inc, (counter.double, counter.c))
+    counter.inc(3)
+    counter.double(counter.c)
+    assert counter.c[None] == 6
+
+
+@test_utils.test(arch=ti.cpu)
+def test_prefetch_many_kernels():
+    x = ti.field(ti.i32, shape=16)
+
+    kernels = []
+    for j in range(32):
+
+        @ti.kernel
+        def add_j():
+            for i in x:
+                x[i] += ti.static(j)
+
+        kernels.append(add_j)
+
+    ti.prefetch(*kernels)
+    # Launched in reverse, so that most kernels are still compiling when the
+    # first ones are needed.
+    for k in reversed(kernels):
+        k()
+    assert x.to_numpy().tolist() == [sum(range(32))] * 16
+
+
+@test_utils.test()
+def test_prefetch_not_a_kernel():
+    def foo():
+        pass
+
+    with pytest.raises(ti.TaichiSyntaxError, match="not a Taichi kernel"):
+        ti.prefetch(foo)
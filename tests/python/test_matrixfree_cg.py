@@ -1,5 +1,6 @@
 import math
 
+import numpy as np
 import pytest
 from taichi.linalg import LinearOperator, MatrixFreeCG
 
@@ -54,3 +55,35 @@ def test_matrixfree_cg(ti_dtype):
     # for more details.
     result = check_solution(Ax, b, tol=1e-6)
     assert result
+
+
+@pytest.mark.parametrize("ti_dtype", [ti.f32, ti.f64])
+@test_utils.test(arch=[ti.cpu])
+def test_matrixfree_cg_ndarray(ti_dtype):
+    GRID = 32
+    x = ti.ndarray(dtype=ti_dtype, shape=(GRID, GRID))
+    b = ti.ndarray(dtype=ti_dtype, shape=(GRID, GRID))
+    Ax = ti.ndarray(dtype=ti_dtype, shape=(GRID, GRID))
+
+    @ti.kernel
+    def init(b: ti.types.ndarray()):
+        for i, j in ti.ndrange(GRID, GRID):
+            xl = i / (GRID - 1)
+            yl = j / (GRID - 1)
+            b[i, j] = ti.sin(2 * math.pi * xl) * ti.sin(2 * math.pi * yl)
+
+    @ti.kernel
+    def compute_Ax(v: ti.types.ndarray(), mv: ti.types.ndarray()):
+        for i, j in ti.ndrange(GRID, GRID):
+            l = v[i - 1, j] if i - 1 >= 0 else 0.0
+            r = v[i + 1, j] if i + 1 <= GRID - 1 else 0.0
+            t = v[i, j + 1] if j + 1 <= GRID - 1 else 0.0
+            b = v[i, j - 1] if j - 1 >= 0 else 0.0
+            mv[i, j] = 20 * v[i, j] - l - r - t - b
+
+    A = LinearOperator(compute_Ax)
+    init(b)
+    # The native solver works in place on the ndarrays
+    assert MatrixFreeCG(A, b, x, maxiter=10 * GRID * GRID, tol=1e-5, quiet=True)
+    compute_Ax(x, Ax)
+    np.testing.assert_allclose(Ax.to_numpy(), b.to_numpy(), atol=1e-4)
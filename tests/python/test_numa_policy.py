@@ -0,0 +1,55 @@
+import numpy as np
+import pytest
+
+import taichi as ti
+from tests import test_utils
+
+
+def _check_zero_and_writable():
+    # Large enough for the pages to be placed explicitly
+    n = 2 * 1024 * 1024
+    x = ti.field(ti.f32, shape=n)
+    a = ti.ndarray(ti.i32, shape=n)
+
+    @ti.kernel
+    def total(a: ti.types.ndarray()) -> ti.f64:
+        s = ti.f64(0)
+        for i in x:
+            s += x[i] + a[i]
+        return s
+
+    @ti.kernel
+    def fill(a: ti.types.ndarray()):
+        for i in x:
+            x[i] = 1
+            a[i] = i % 3
+
+    assert total(a) == 0
+    fill(a)
+    assert total(a) == n + np.sum(np.arange(n) % 3)
+
+
+@test_utils.test(arch=[ti.cpu], cpu_numa_policy="first_touch")
+def test_cpu_numa_policy_first_touch():
+    _check_zero_and_writable()
+
+
+@test_utils.test(arch=[ti.cpu], cpu_numa_policy="interleave")
+def test_cpu_numa_policy_interleave():
+    _check_zero_and_writable()
+
+
+@test_utils.test(arch=[ti.cpu], cpu_numa_policy="none")
+def test_cpu_numa_policy_none():
+    _check_zero_and_writable()
+
+
+@test_utils.test(arch=[ti.cpu], cpu_huge_pages=True)
+def test_cpu_huge_pages():
+    _check_zero_and_writable()
+
+
+@test_utils.test(arch=ti.cpu)
+def test_unknown_cpu_numa_policy():
+    with pytest.raises(RuntimeError):
+        ti.init(arch=ti.cpu, cpu_numa_policy="local")
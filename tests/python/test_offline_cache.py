@@ -3,7 +3,7 @@ import functools
 import math
 import shutil
 import threading
-from os import listdir, rmdir, stat
+from os import listdir, rmdir
 from os.path import join
 from tempfile import mkdtemp
 
@@ -26,20 +26,12 @@ def is_offline_cache_file(filename):
     return filename.endswith(suffixes)
 
 
-def cache_files_size(path):
-    files = listdir(path)
-    result = 0
-    for file in files:
-        if is_offline_cache_file(file):
-            result += stat(join(path, file)).st_size
-    return result
+def cached_kernels_size(path):
+    return sum(size for _, size in ti._lib.core.list_offline_cache_pack(path))
 
 
-def expected_num_cache_files(num_kernels: int = 0) -> int:
-    if num_kernels == 0:
-        return 0
-    # code files(*.tic) + metadata files(ticache.tcb)
-    return num_kernels + 1
+def expected_num_cached_kernels(num_kernels: int = 0) -> int:
+    return num_kernels
 
 
 def tmp_offline_cache_file_path():
@@ -55,11 +47,8 @@ def current_thread_ext_options():
     }
 
 
-def cache_files_cnt():
-    try:
-        return len(listdir(tmp_offline_cache_file_path()))
-    except FileNotFoundError:
-        return 0
+def cached_kernels_cnt():
+    return len(ti._lib.core.list_offline_cache_pack(tmp_offline_cache_file_path()))
 
 
 @ti.kernel
@@ -187,30 +176,30 @@ def _test_offline_cache_dec(func):
 
 @_test_offline_cache_dec
 def _test_offline_cache_for_a_kernel(curr_arch, kernel, args, result):
-    count_of_cache_file = cache_files_cnt()
+    count_of_cached_kernels = cached_kernels_cnt()
 
-    def added_files():
-        return cache_files_cnt() - count_of_cache_file
+    def added_kernels():
+        return cached_kernels_cnt() - count_of_cached_kernels
 
     ti.init(arch=curr_arch, enable_fallback=False, **current_thread_ext_options())
     res1 = kernel(*args)
-    assert added_files() == expected_num_cache_files()
+    assert added_kernels() == expected_num_cached_kernels()
 
     ti.init(arch=curr_arch, enable_fallback=False, **current_thread_ext_options())
-    assert added_files() == expected_num_cache_files(1)
+    assert added_kernels() == expected_num_cached_kernels(1)
     res2 = kernel(*args)
     assert res1 == test_utils.approx(result) and res1 == test_utils.approx(res2)
 
     ti.reset()
-    assert added_files() == expected_num_cache_files(1)
+    assert added_kernels() == expected_num_cached_kernels(1)
 
 
 @_test_offline_cache_dec
 def _test_closing_offline_cache_for_a_kernel(curr_arch, kernel, args, result):
-    count_of_cache_file = cache_files_cnt()
+    count_of_cached_kernels = cached_kernels_cnt()
 
-    def added_files():
-        return cache_files_cnt() - count_of_cache_file
+    def added_kernels():
+        return cached_kernels_cnt() - count_of_cached_kernels
 
     def my_init():
         ti.init(
@@ -224,16 +213,16 @@ def _test_closing_offline_cache_for_a_kernel(curr_arch, kernel, args, result):
 
     my_init()
     res1 = kernel(*args)
-    assert added_files() == expected_num_cache_files()
+    assert added_kernels() == expected_num_cached_kernels()
 
     my_init()
-    assert added_files() == expected_num_cache_files()
+    assert added_kernels() == expected_num_cached_kernels()
     res2 = kernel(*args)
 
     assert res1 == test_utils.approx(result) and res1 == test_utils.approx(res2)
 
     ti.reset()
-    assert added_files() == expected_num_cache_files()
+    assert added_kernels() == expected_num_cached_kernels()
 
 
 @pytest.mark.parametrize("curr_arch", supported_archs_offline_cache)
@@ -251,10 +240,10 @@ def test_offline_cache_per_kernel(curr_arch):
 @pytest.mark.parametrize("curr_arch", supported_archs_offline_cache)
 @_test_offline_cache_dec
 def test_multiple_ib_with_offline_cache(curr_arch):
-    count_of_cache_file = cache_files_cnt()
+    count_of_cached_kernels = cached_kernels_cnt()
 
-    def added_files():
-        return cache_files_cnt() - count_of_cache_file
+    def added_kernels():
+        return cached_kernels_cnt() - count_of_cached_kernels
 
     def helper():
         x = ti.field(float, (), needs_grad=True)
@@ -277,23 +266,23 @@ def test_multiple_ib_with_offline_cache(curr_arch):
 
     ti.init(arch=curr_arch, enable_fallback=False, **current_thread_ext_options())
     helper()
-    assert added_files() == expected_num_cache_files()
+    assert added_kernels() == expected_num_cached_kernels()
 
     ti.init(arch=curr_arch, enable_fallback=False, **current_thread_ext_options())
-    assert added_files() == expected_num_cache_files(9)
+    assert added_kernels() == expected_num_cached_kernels(9)
     helper()
 
     ti.reset()
-    assert added_files() == expected_num_cache_files(9)
+    assert added_kernels() == expected_num_cached_kernels(9)
 
 
 @pytest.mark.parametrize("curr_arch", supported_archs_offline_cache)
 @_test_offline_cache_dec
 def test_calling_a_kernel_with_different_param_list(curr_arch):
-    count_of_cache_file = cache_files_cnt()
+    count_of_cached_kernels = cached_kernels_cnt()
 
-    def added_files():
-        return cache_files_cnt() - count_of_cache_file
+    def added_kernels():
+        return cached_kernels_cnt() - count_of_cached_kernels
 
     mat_type = ti.types.matrix(2, 3, ti.i32)
 
@@ -311,12 +300,12 @@ def test_calling_a_kernel_with_different_param_list(curr_arch):
     np_mat2 = mat2.to_numpy()
     np_mat3 = mat3.to_numpy()
 
-    assert added_files() == expected_num_cache_files()
+    assert added_kernels() == expected_num_cached_kernels()
     ti.init(arch=curr_arch, enable_fallback=False, **current_thread_ext_options())
     assert (kernel(mat1, mat1).to_numpy() == np_kernel(np_mat1, np_mat1)).all()
 
     ti.init(arch=curr_arch, enable_fallback=False, **current_thread_ext_options())
-    assert added_files() == expected_num_cache_files(1)
+    assert added_kernels() == expected_num_cached_kernels(1)
 
     assert (kernel(mat1, mat1).to_numpy() == np_kernel(np_mat1, np_mat1)).all()
     assert (kernel(mat1, mat2).to_numpy() == np_kernel(np_mat1, np_mat2)).all()
@@ -324,16 +313,16 @@ def test_calling_a_kernel_with_different_param_list(curr_arch):
     assert (kernel(mat2, mat3).to_numpy() == np_kernel(np_mat2, np_mat3)).all()
 
     ti.reset()
-    assert added_files() == expected_num_cache_files(1)
+    assert added_kernels() == expected_num_cached_kernels(1)
 
 
 @pytest.mark.parametrize("curr_arch", supported_archs_offline_cache)
 @_test_offline_cache_dec
 def test_snode_reader_and_writer_with_offline_cache(curr_arch):
-    count_of_cache_file = cache_files_cnt()
+    count_of_cached_kernels = cached_kernels_cnt()
 
-    def added_files():
-        return cache_files_cnt() - count_of_cache_file
+    def added_kernels():
+        return cached_kernels_cnt() - count_of_cached_kernels
 
     def helper():
         x = ti.field(dtype=ti.f32, shape=())
@@ -349,25 +338,25 @@ def test_snode_reader_and_writer_with_offline_cache(curr_arch):
         assert x[None] == test_utils.approx(6.28)
         assert y[None] == test_utils.approx(7.28)
 
-    assert added_files() == expected_num_cache_files()
+    assert added_kernels() == expected_num_cached_kernels()
     ti.init(arch=curr_arch, enable_fallback=False, **current_thread_ext_options())
     helper()
 
     ti.init(arch=curr_arch, enable_fallback=False, **current_thread_ext_options())
-    assert added_files() == expected_num_cache_files(4)
+    assert added_kernels() == expected_num_cached_kernels(4)
     helper()
 
     ti.reset()
-    assert added_files() == expected_num_cache_files(4)
+    assert added_kernels() == expected_num_cached_kernels(4)
 
 
 @pytest.mark.parametrize("curr_arch", supported_archs_offline_cache)
 @_test_offline_cache_dec
 def test_calling_many_kernels(curr_arch):
-    count_of_cache_file = cache_files_cnt()
+    count_of_cached_kernels = cached_kernels_cnt()
 
-    def added_files():
-        return cache_files_cnt() - count_of_cache_file
+    def added_kernels():
+        return cached_kernels_cnt() - count_of_cached_kernels
 
     def helper():
         for kernel, args, get_res in simple_kernels_to_test:
@@ -375,22 +364,88 @@ def test_calling_many_kernels(curr_arch):
 
     ti.init(arch=curr_arch, enable_fallback=False, **current_thread_ext_options())
     helper()
-    assert added_files() == expected_num_cache_files()
+    assert added_kernels() == expected_num_cached_kernels()
 
     ti.init(arch=curr_arch, enable_fallback=False, **current_thread_ext_options())
-    assert added_files() == expected_num_cache_files(len(simple_kernels_to_test))
+    assert added_kernels() == expected_num_cached_kernels(len(simple_kernels_to_test))
     helper()
     ti.reset()
-    assert added_files() == expected_num_cache_files(len(simple_kernels_to_test))
+    assert added_kernels() == expected_num_cached_kernels(len(simple_kernels_to_test))
+
+
+@pytest.mark.parametrize("curr_arch", supported_archs_offline_cache)
+@_test_offline_cache_dec
+def test_offline_cache_pack_files(curr_arch):
+    def helper():
+        ti.init(arch=curr_arch, enable_fallback=False, **current_thread_ext_options())
+        for kernel, args, get_res in simple_kernels_to_test:
+            assert kernel(*args) == test_utils.approx(get_res(*args))
+        ti.reset()
+
+    helper()
+    assert sorted(listdir(tmp_offline_cache_file_path())) == ["ticache.idx", "ticache.pack"]
+    size = cached_kernels_size(tmp_offline_cache_file_path())
+    helper()
+    assert sorted(listdir(tmp_offline_cache_file_path())) == ["ticache.idx", "ticache.pack"]
+    assert cached_kernels_size(tmp_offline_cache_file_path()) == size
+
+
+@pytest.mark.parametrize("curr_arch", supported_archs_offline_cache)
+@_test_offline_cache_dec
+def test_offline_cache_files_layout(curr_arch):
+    def helper():
+        ti.init(
+            arch=curr_arch,
+            enable_fallback=False,
+            offline_cache_layout="files",
+            **current_thread_ext_options(),
+        )
+        for kernel, args, get_res in simple_kernels_to_test:
+            assert kernel(*args) == test_utils.approx(get_res(*args))
+        ti.reset()
+
+    for _ in range(2):
+        helper()
+        files = listdir(tmp_offline_cache_file_path())
+        # code files(*.tic) + metadata files(ticache.tcb)
+        assert len([f for f in files if is_offline_cache_file(f)]) == len(simple_kernels_to_test)
+        assert "ticache.tcb" in files
+        assert len(files) == len(simple_kernels_to_test) + 1
+
+
+@pytest.mark.parametrize("curr_arch", supported_archs_offline_cache)
+@_test_offline_cache_dec
+def test_offline_cache_key_hash(curr_arch):
+    def helper(key_hash):
+        ti.init(
+            arch=curr_arch,
+            enable_fallback=False,
+            offline_cache_key_hash=key_hash,
+            **current_thread_ext_options(),
+        )
+        for kernel, args, get_res in simple_kernels_to_test:
+            assert kernel(*args) == test_utils.approx(get_res(*args))
+        ti.reset()
+
+    num_kernels = len(simple_kernels_to_test)
+    helper("xxhash64")
+    assert cached_kernels_cnt() == expected_num_cached_kernels(num_kernels)
+    keys = {key for key, _ in ti._lib.core.list_offline_cache_pack(tmp_offline_cache_file_path())}
+    assert all(len(key) == len("T") + 16 for key in keys)
+    helper("xxhash64")
+    assert cached_kernels_cnt() == expected_num_cached_kernels(num_kernels)
+    # The keys depend on the hash, so switching it recompiles the kernels
+    helper("sha256")
+    assert cached_kernels_cnt() == expected_num_cached_kernels(2 * num_kernels)
 
 
 @pytest.mark.parametrize("curr_arch", supported_archs_offline_cache)
 @_test_offline_cache_dec
 def test_offline_cache_with_different_snode_trees(curr_arch):
-    count_of_cache_file = cache_files_cnt()
+    count_of_cached_kernels = cached_kernels_cnt()
 
-    def added_files():
-        return cache_files_cnt() - count_of_cache_file
+    def added_kernels():
+        return cached_kernels_cnt() - count_of_cached_kernels
 
     def helper():
         x = ti.field(float, shape=5)
@@ -437,28 +492,28 @@ def test_offline_cache_with_different_snode_trees(curr_arch):
 
         kernel_forward()
 
-    assert added_files() == expected_num_cache_files(0)
+    assert added_kernels() == expected_num_cached_kernels(0)
     ti.init(arch=curr_arch, enable_fallback=False, **current_thread_ext_options())
     helper()
 
     ti.init(arch=curr_arch, enable_fallback=False, **current_thread_ext_options())
-    assert added_files() == expected_num_cache_files(2)
+    assert added_kernels() == expected_num_cached_kernels(2)
     helper()
 
     # The number of cache file should not change
     for _ in range(5):
         ti.init(arch=curr_arch, enable_fallback=False, **current_thread_ext_options())
-        assert added_files() == expected_num_cache_files(2)
+        assert added_kernels() == expected_num_cached_kernels(2)
         helper()
 
 
 @pytest.mark.parametrize("curr_arch", supported_archs_offline_cache)
 @_test_offline_cache_dec
 def test_offline_cache_with_changing_compile_config(curr_arch):
-    count_of_cache_file = cache_files_cnt()
+    count_of_cached_kernels = cached_kernels_cnt()
 
-    def added_files():
-        return cache_files_cnt() - count_of_cache_file
+    def added_kernels():
+        return cached_kernels_cnt() - count_of_cached_kernels
 
     @ti.kernel
     def helper():
@@ -467,21 +522,21 @@ def test_offline_cache_with_changing_compile_config(curr_arch):
         for i in range(b):
             c += i
 
-    assert added_files() == expected_num_cache_files()
+    assert added_kernels() == expected_num_cached_kernels()
     ti.init(arch=curr_arch, enable_fallback=False, opt_level=0, **current_thread_ext_options())
     helper()
 
     ti.init(arch=curr_arch, enable_fallback=False, opt_level=1, **current_thread_ext_options())
-    assert added_files() == expected_num_cache_files(1)
+    assert added_kernels() == expected_num_cached_kernels(1)
     helper()
 
     ti.reset()
-    assert added_files() == expected_num_cache_files(2)
+    assert added_kernels() == expected_num_cached_kernels(2)
     ti.init(arch=curr_arch, enable_fallback=False, default_fp=ti.f32, **current_thread_ext_options())
     helper()
 
     ti.reset()
-    assert added_files() == expected_num_cache_files(2)
+    assert added_kernels() == expected_num_cached_kernels(2)
 
 
 @pytest.mark.parametrize("curr_arch", supported_archs_offline_cache)
@@ -505,23 +560,23 @@ def test_offline_cache_cleaning(curr_arch, factor, policy):
             assert kernel(*args) == test_utils.approx(get_res(*args))
 
     kernel_count = len(simple_kernels_to_test)
-    count_of_cache_file = cache_files_cnt()
+    count_of_cached_kernels = cached_kernels_cnt()
 
-    def added_files():
-        return cache_files_cnt() - count_of_cache_file
+    def added_kernels():
+        return cached_kernels_cnt() - count_of_cached_kernels
 
-    assert added_files() == expected_num_cache_files()
+    assert added_kernels() == expected_num_cached_kernels()
 
-    run_simple_kernels(1024**3)  # 1GB (>> size_of_cache_files)
+    run_simple_kernels(1024**3)  # 1GB (>> size_of_cached_kernels)
     ti.reset()  # Dumping cache data
-    size_of_cache_files = cache_files_size(tmp_offline_cache_file_path())
-    assert added_files() == expected_num_cache_files(kernel_count)
+    size_of_cached_kernels = cached_kernels_size(tmp_offline_cache_file_path())
+    assert added_kernels() == expected_num_cached_kernels(kernel_count)
 
-    only_init(size_of_cache_files * 2)
+    only_init(size_of_cached_kernels * 2)
     ti.reset()
-    assert added_files() == expected_num_cache_files(kernel_count)
+    assert added_kernels() == expected_num_cached_kernels(kernel_count)
 
-    only_init(1)  # 1B (<< size_of_cache_files)
+    only_init(1)  # 1B (<< size_of_cached_kernels)
     ti.reset()
     rem = []
     if policy in ["never", "version"]:
@@ -530,7 +585,7 @@ def test_offline_cache_cleaning(curr_arch, factor, policy):
         lo = -min(kernel_count - int(factor * kernel_count), kernel_count)
         lo = kernel_count if lo == 0 else lo
         rem = len(simple_kernels_to_test[lo:])
-    assert added_files() == expected_num_cache_files(rem)
+    assert added_kernels() == expected_num_cached_kernels(rem)
 
 
 # FIXME: Change to `supported_archs_offline_cache` after fixing bugs of real-function on gpu
@@ -539,10 +594,10 @@ def test_offline_cache_cleaning(curr_arch, factor, policy):
 @_test_offline_cache_dec
 @test_utils.test(cuda_stack_limit=8192)
 def test_offline_cache_for_kernels_calling_real_func(curr_arch):
-    count_of_cache_file = cache_files_cnt()
+    count_of_cached_kernels = cached_kernels_cnt()
 
-    def added_files():
-        return cache_files_cnt() - count_of_cache_file
+    def added_kernels():
+        return cached_kernels_cnt() - count_of_cached_kernels
 
     def helper1():
         @ti.real_func
@@ -572,7 +627,7 @@ def test_offline_cache_for_kernels_calling_real_func(curr_arch):
 
         assert get_sum() == 99 * 50
 
-    assert added_files() == expected_num_cache_files()
+    assert added_kernels() == expected_num_cached_kernels()
 
     def my_init():
         ti.init(arch=curr_arch, enable_fallback=False, **{**current_thread_ext_options(), "cuda_stack_limit": 4096})
@@ -581,16 +636,22 @@ def test_offline_cache_for_kernels_calling_real_func(curr_arch):
     helper1()
 
     my_init()
-    assert added_files() == expected_num_cache_files(1)
+    assert added_kernels() == expected_num_cached_kernels(1)
     helper1()
 
     my_init()
-    assert added_files() == expected_num_cache_files(1)
+    assert added_kernels() == expected_num_cached_kernels(1)
     helper2()
 
     my_init()
-    assert added_files() == expected_num_cache_files(2)
+    assert added_kernels() == expected_num_cached_kernels(2)
     helper2()
 
     ti.reset()
-    assert added_files() == expected_num_cache_files(2)
+    assert added_kernels() == expected_num_cached_kernels(2)
+
+
+@test_utils.test(arch=ti.cpu)
+def test_unknown_offline_cache_layout():
+    with pytest.raises(RuntimeError):
+        ti.init(arch=ti.cpu, offline_cache_layout="zip")
@@ -87,3 +87,27 @@ def test_loop_config_block_dim_adaptive():
     val_np = val.to_numpy()
     for i in range(n):
         assert val_np[i] == i
+
+
+@test_utils.test(arch=[ti.cpu], cpu_block_dim_adaptive_policy="guided")
+def test_guided_parallel_range_for():
+    n = 100003
+    val = ti.field(ti.i32, shape=(n))
+
+    @ti.kernel
+    def fill():
+        for i in range(n):
+            val[i] += i
+
+    @ti.kernel
+    def total() -> ti.i64:
+        s = ti.i64(0)
+        ti.loop_config(block_dim=4)
+        for i in range(n):
+            s += val[i]
+        return s
+
+    fill()
+    val_np = val.to_numpy()
+    assert (val_np == list(range(n))).all()
+    assert total() == n * (n - 1) // 2
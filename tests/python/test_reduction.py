@@ -163,3 +163,42 @@ def test_reduction_ndarray():
     n = 1024
     x = np.ones(n, dtype=np.int32)
     assert reduce(x) == -n
+
+
+@test_utils.test()
+def test_reduction_small_block_dim_repeated():
+    # Thread-local reduction buffers may outlive a single block (and a single
+    # launch), so make sure they are re-initialized for every launch.
+    n = 100000
+    x = ti.field(ti.i32, shape=n)
+    block = ti.root.pointer(ti.i, n // 16)
+    y = ti.field(ti.i32)
+    block.dense(ti.i, 16).place(y)
+
+    @ti.kernel
+    def fill():
+        for i in x:
+            x[i] = 1
+            if i % 3 == 0:
+                y[i] = 2
+
+    @ti.kernel
+    def range_sum() -> ti.i32:
+        s = 0
+        ti.loop_config(block_dim=4)
+        for i in range(n):
+            s += x[i]
+        return s
+
+    @ti.kernel
+    def struct_sum() -> ti.i32:
+        s = 0
+        ti.loop_config(block_dim=4)
+        for i in y:
+            s += y[i]
+        return s
+
+    fill()
+    for _ in range(3):
+        assert range_sum() == n
+        assert struct_sum() == 2 * len(range(0, n, 3))
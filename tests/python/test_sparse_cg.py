@@ -65,3 +65,48 @@ def test_cg_cuda(ti_dtype):
     assert exit_code == True
     for i in range(n):
         assert x[i] == test_utils.approx(res[i], rel=1.0)
+
+
+@pytest.mark.parametrize("ti_dtype", [ti.f32, ti.f64])
+@pytest.mark.parametrize("preconditioner", ["none", "jacobi", "block_jacobi", "ic"])
+@test_utils.test(arch=[ti.cpu])
+def test_cg_preconditioner(ti_dtype, preconditioner):
+    n = 64
+    Abuilder = ti.linalg.SparseMatrixBuilder(n, n, max_num_triplets=4 * n, dtype=ti_dtype)
+    b = ti.ndarray(dtype=ti_dtype, shape=n)
+    x0 = ti.ndarray(dtype=ti_dtype, shape=n)
+
+    # A 1D Laplacian with a varying diagonal
+    @ti.kernel
+    def fill(Abuilder: ti.types.sparse_matrix_builder(), b: ti.types.ndarray()):
+        for i in range(n):
+            Abuilder[i, i] += 2.5 + i % 3
+            if i > 0:
+                Abuilder[i, i - 1] += -1.0
+            if i < n - 1:
+                Abuilder[i, i + 1] += -1.0
+            b[i] = i % 5 - 2
+
+    fill(Abuilder, b)
+    A = Abuilder.build(dtype=ti_dtype)
+    cg = ti.linalg.SparseCG(A, b, x0, max_iter=200, atol=1e-6, preconditioner=preconditioner, block_size=3)
+    x, exit_code = cg.solve()
+    assert exit_code == True
+    # The solution is written into x0
+    assert x is x0
+    A_dense = np.zeros((n, n))
+    for i in range(n):
+        A_dense[i, i] = 2.5 + i % 3
+        if i > 0:
+            A_dense[i, i - 1] = A_dense[i - 1, i] = -1.0
+    res = np.linalg.solve(A_dense, b.to_numpy())
+    np.testing.assert_allclose(x0.to_numpy(), res, rtol=1e-4, atol=1e-4)
+
+
+@test_utils.test(arch=[ti.cpu])
+def test_cg_unknown_preconditioner():
+    Abuilder = ti.linalg.SparseMatrixBuilder(4, 4, max_num_triplets=4)
+    A = Abuilder.build()
+    b = ti.ndarray(dtype=ti.f32, shape=4)
+    with pytest.raises(RuntimeError, match="Unknown CG preconditioner"):
+        ti.linalg.SparseCG(A, b, preconditioner="ilu")
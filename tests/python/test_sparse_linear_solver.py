@@ -174,3 +174,55 @@ def test_gpu_sparse_solver2(dtype, solver_type):
     res = np.linalg.solve(A_psd, b.to_numpy())
     for i in range(n):
         assert x[i] == test_utils.approx(res[i], rel=1.0)
+
+
+@pytest.mark.parametrize("dtype", [ti.f32, ti.f64])
+@pytest.mark.parametrize("solver_type", ["LLT", "LDLT"])
+@pytest.mark.parametrize("ordering", ["AMD", "COLAMD", "natural"])
+@test_utils.test(arch=ti.cpu)
+def test_supernodal_sparse_solver(dtype, solver_type, ordering):
+    np_dtype = ti.lang.util.to_numpy_type(dtype)
+    k = 16
+    n = k * k
+    b = ti.ndarray(dtype, shape=n)
+
+    @ti.kernel
+    def fill(Abuilder: ti.types.sparse_matrix_builder(), b: ti.types.ndarray(), scale: ti.f32):
+        for i, j in ti.ndrange(k, k):
+            row = i * k + j
+            Abuilder[row, row] += scale * (4.0 + (row % 7) * 0.5)
+            if i > 0:
+                Abuilder[row, row - k] += -scale
+            if i < k - 1:
+                Abuilder[row, row + k] += -scale
+            if j > 0:
+                Abuilder[row, row - 1] += -scale
+            if j < k - 1:
+                Abuilder[row, row + 1] += -scale
+        for i in range(n):
+            b[i] = i % 11 - 5
+
+    solver = ti.linalg.SparseSolver(dtype=dtype, solver_type=solver_type, ordering=ordering, backend="supernodal")
+    rtol = 1e-4 if dtype == ti.f32 else 1e-10
+    for scale in [1.0, 2.0]:
+        Abuilder = ti.linalg.SparseMatrixBuilder(n, n, max_num_triplets=5 * n, dtype=dtype)
+        fill(Abuilder, b, scale)
+        A = Abuilder.build(dtype=dtype)
+        # The second factorization reuses the analysis of the first one
+        if scale == 1.0:
+            solver.analyze_pattern(A)
+        solver.factorize(A)
+        assert solver.info()
+
+        x = solver.solve(b)
+        x_np = solver.solve(b.to_numpy().astype(np_dtype))
+        assert np.allclose(x.to_numpy(), x_np, rtol=rtol)
+        assert np.allclose(A @ x_np, b.to_numpy(), rtol=rtol, atol=rtol)
+
+
+@test_utils.test(arch=ti.cpu)
+def test_supernodal_sparse_solver_unsupported():
+    with pytest.raises(ti.TaichiRuntimeError):
+        ti.linalg.SparseSolver(solver_type="LU", backend="supernodal")
+    with pytest.raises(ti.TaichiRuntimeError):
+        ti.linalg.SparseSolver(backend="cholmod")
@@ -56,6 +56,39 @@ def test_sparse_matrix_builder(dtype, storage_format):
             assert A[i, j] == i + j
 
 
+@pytest.mark.parametrize(
+    "dtype, storage_format",
+    [
+        (ti.f32, "col_major"),
+        (ti.f32, "row_major"),
+        (ti.f64, "col_major"),
+        (ti.f64, "row_major"),
+    ],
+)
+@test_utils.test(arch=ti.cpu)
+def test_sparse_matrix_builder_rebuild(dtype, storage_format):
+    n = 8
+    Abuilder = ti.linalg.SparseMatrixBuilder(n, n, max_num_triplets=300, dtype=dtype, storage_format=storage_format)
+
+    @ti.kernel
+    def fill(Abuilder: ti.types.sparse_matrix_builder(), scale: ti.f32, shift: ti.i32):
+        ti.loop_config(serialize=True)
+        for i, j in ti.ndrange(n, n):
+            if (i + j + shift) % 3 == 0:
+                Abuilder[i, j] += scale * (i + j)
+                Abuilder[i, j] += scale
+
+    # The second build writes the same triplets as the first one, so it reuses
+    # the sparsity pattern. The third one does not.
+    for scale, shift in [(1, 0), (2, 0), (3, 1)]:
+        fill(Abuilder, scale, shift)
+        A = Abuilder.build()
+        for i in range(n):
+            for j in range(n):
+                expected = scale * (i + j + 1) if (i + j + shift) % 3 == 0 else 0
+                assert A[i, j] == expected
+
+
 @pytest.mark.parametrize(
     "dtype, storage_format",
     [
@@ -66,8 +66,8 @@ def test_require_extensions_2():
 
 
 @test_utils.test(arch=[ti.cpu, ti.opengl], require=[ti.extension.sparse, ti.extension.bls])
-def test_require_extensions_2():
-    assert ti.lang.impl.current_cfg().arch in [ti.cuda]
+def test_require_extensions_3():
+    assert ti.lang.impl.current_cfg().arch in [ti.cpu]
 
 
 ### `test_utils.approx` and `test_utils.allclose`
@@ -0,0 +1,94 @@
+import numpy as np
+import pytest
+
+import taichi as ti
+from tests import test_utils
+
+
+@pytest.mark.parametrize("n", [0, 5, 64, 1003])
+@test_utils.test(arch=ti.cpu, real_matrix_scalarize=False, vectorize_range_for=True)
+def test_vectorize_saxpy(n):
+    x = ti.ndarray(ti.f32, shape=max(n, 1))
+    y = ti.ndarray(ti.f32, shape=max(n, 1))
+
+    @ti.kernel
+    def saxpy(a: ti.f32, x: ti.types.ndarray(ndim=1), y: ti.types.ndarray(ndim=1)):
+        for i in range(n):
+            y[i] = a * x[i] + y[i]
+
+    x_np = np.arange(max(n, 1), dtype=np.float32)
+    y_np = np.ones(max(n, 1), dtype=np.float32)
+    x.from_numpy(x_np)
+    y.from_numpy(y_np)
+    saxpy(2.0, x, y)
+    expected = y_np.copy()
+    expected[:n] = 2 * x_np[:n] + y_np[:n]
+    assert np.allclose(y.to_numpy(), expected)
+
+
+@test_utils.test(arch=ti.cpu, real_matrix_scalarize=False, vectorize_range_for=True)
+def test_vectorize_stencil_with_branch():
+    n = 1000
+    x = ti.field(ti.f32, shape=n)
+    y = ti.field(ti.f32, shape=n)
+
+    @ti.kernel
+    def stencil():
+        for i in range(1, n - 1):
+            v = x[i - 1] + x[i + 1] - 2 * x[i]
+            if v > 0:
+                v = -v
+            else:
+                v = v * 0.5
+            y[i] = v
+
+    x_np = np.sin(np.arange(n)).astype(np.float32)
+    x.from_numpy(x_np)
+    stencil()
+    v = x_np[:-2] + x_np[2:] - 2 * x_np[1:-1]
+    expected = np.where(v > 0, -v, v * 0.5)
+    assert np.allclose(y.to_numpy()[1:-1], expected)
+
+
+@test_utils.test(arch=ti.cpu, real_matrix_scalarize=False, vectorize_range_for=True)
+def test_vectorize_reductions():
+    n = 1001
+    x = ti.field(ti.i32, shape=n)
+    s = ti.field(ti.i32, shape=())
+    m = ti.field(ti.i32, shape=())
+    c = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def reduce():
+        for i in range(n):
+            s[None] += x[i]
+            ti.atomic_max(m[None], x[i])
+            if x[i] % 3 == 0:
+                c[None] += 1
+
+    x_np = (np.arange(n, dtype=np.int32) * 7) % 101
+    x.from_numpy(x_np)
+    m[None] = -1
+    reduce()
+    assert s[None] == x_np.sum()
+    assert m[None] == x_np.max()
+    assert c[None] == (x_np % 3 == 0).sum()
+
+
+@test_utils.test(arch=ti.cpu, real_matrix_scalarize=False, vectorize_range_for=True)
+def test_vectorize_skips_serialized_prefix_sum():
+    n = 1000
+    a = ti.field(ti.i32, shape=n)
+    b = ti.field(ti.i32, shape=n)
+
+    @ti.kernel
+    def prefix_sum():
+        ti.loop_config(serialize=True)
+        for i in range(1, n):
+            a[i] = a[i - 1] + b[i]
+
+    b_np = np.arange(n, dtype=np.int32) % 7
+    b.from_numpy(b_np)
+    a[0] = b_np[0]
+    prefix_sum()
+    assert np.array_equal(a.to_numpy(), np.cumsum(b_np))